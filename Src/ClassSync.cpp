@@ -1,7 +1,14 @@
 #include "APIEnvir.h"
 #include "ACAPinc.h"
 #include "DGModule.hpp"
+#include "DGFileDlg.hpp"
 #include "ClassSyncPalette.hpp"
+#include "CoreAdapters.hpp"
+#include "ShardedMaster.hpp"
+#include "ChangeLog.hpp"
+#include "Log.hpp"
+#include "MasterDateDialog.hpp"
+#include "Trace.hpp"
 
 
 // ---------------------------------------------------------------------------
@@ -40,6 +47,54 @@ static void UpdateMenuCheckmark ()
 }
 
 
+// ---------------------------------------------------------------------------
+// Split a single-file master into a sharded layout next to it
+// ---------------------------------------------------------------------------
+
+static void SplitMasterCommand ()
+{
+	DGTypePopupItem popup;
+	popup.text = "XML Files (*.xml)";
+	popup.extensions = "xml";
+
+	IO::Location loc;
+	if (!DGGetOpenFile (&loc, 1, &popup, nullptr, GS::UniString ("Select Master XML to Split")))
+		return;
+
+	std::string pathUtf8 = ToUtf8 (loc.ToDisplayText ());
+
+	std::string manifestPath, error;
+	if (SplitMasterIntoShards (pathUtf8.c_str (), manifestPath, error)) {
+		CS_LOG_INFO ("ClassSync: Split %s -> %s", pathUtf8.c_str (), manifestPath.c_str ());
+		DGAlert (DG_INFORMATION, "ClassSync", "Master split into shards",
+				 "Select this manifest with Browse... to use the sharded master:\n"
+				 + FromUtf8 (manifestPath), "OK");
+	} else {
+		CS_LOG_ERROR ("ClassSync: Split failed: %s", error.c_str ());
+		DGAlert (DG_WARNING, "ClassSync", "Cannot split master",
+				 FromUtf8 (error), "OK");
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+// Compare the project with the master as it was at a chosen date
+// ---------------------------------------------------------------------------
+
+static void CompareMasterAtDateCommand ()
+{
+	MasterDateDialog dialog;
+	if (!dialog.Invoke ())
+		return;
+
+	if (!ClassSyncPalette::HasInstance ())
+		ClassSyncPalette::CreateInstance ();
+	ClassSyncPalette::GetInstance ().Show ();
+	ClassSyncPalette::GetInstance ().ShowMasterAt (dialog.GetTimeKey ());
+	UpdateMenuCheckmark ();
+}
+
+
 // ---------------------------------------------------------------------------
 // Menu command handler: toggle palette visibility
 // ---------------------------------------------------------------------------
@@ -61,6 +116,14 @@ static GSErrCode MenuCommandHandler (const API_MenuParams* menuParams)
 			}
 			UpdateMenuCheckmark ();
 			break;
+
+		case 2:
+			SplitMasterCommand ();
+			break;
+
+		case 3:
+			CompareMasterAtDateCommand ();
+			break;
 	}
 
 	return NoError;
@@ -87,6 +150,18 @@ GSErrCode RegisterInterface (void)
 
 GSErrCode Initialize (void)
 {
+	// Core library report lines go to the session report
+	InstallCoreReportSink ();
+
+	// Session log levels and file (CLASSSYNC_LOG / CLASSSYNC_LOG_FILE)
+	ClassSyncPalette::StartLogging ();
+
+	// Refresh spans (Diagnostics / CLASSSYNC_TRACE)
+	ClassSyncPalette::StartTracing ();
+
+	// Allocation counting per refresh stage (CLASSSYNC_MEMORY)
+	ClassSyncPalette::StartMemoryAccounting ();
+
 	// Load saved preferences (XML path)
 	ClassSyncPalette::LoadPreferences ();
 
@@ -118,5 +193,13 @@ GSErrCode FreeData (void)
 	if (ClassSyncPalette::HasInstance ())
 		ClassSyncPalette::DestroyInstance ();
 
+	// Write out queued changelog records and stop the writer thread
+	ShutdownChangeLog ();
+	StopLogFile ();
+
+	std::string tracePath = ClassSyncPalette::GetTraceFilePath ();
+	if (!tracePath.empty ())
+		WriteTraceJson (tracePath);
+
 	return ACAPI_UnregisterModelessWindow (ClassSyncPalette::GetRefId ());
 }
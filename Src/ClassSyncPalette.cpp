@@ -1,12 +1,25 @@
 #include "ClassSyncPalette.hpp"
+#include "CoreAdapters.hpp"
 #include "XmlReader.hpp"
 #include "XmlWriter.hpp"
 #include "FileLock.hpp"
+#include "ItemIndex.hpp"
 #include "ChangeLog.hpp"
+#include "Counters.hpp"
+#include "Log.hpp"
+#include "Report.hpp"
+#include "MasterHistory.hpp"
+#include "MasterStore.hpp"
+#include "MemoryStats.hpp"
+#include "SyncProtocol.hpp"
+#include "Trace.hpp"
 #include "DGFileDlg.hpp"
 
-#include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
 
 
 // ---------------------------------------------------------------------------
@@ -22,16 +35,59 @@ static const GS::Guid kPaletteGuid ("C1A55710-DA7A-4B2E-9F3C-8E2D1A6B5C4E");
 
 ClassSyncPalette*  ClassSyncPalette::instance          = nullptr;
 bool               ClassSyncPalette::wasOpenBeforeHide = false;
-GS::UniString      ClassSyncPalette::xmlFilePath;
+std::string        ClassSyncPalette::xmlFilePath;
 
 
 // ---------------------------------------------------------------------------
 // Color constants (muted, 3-color scheme)
 // ---------------------------------------------------------------------------
 
-static const Gfx::Color kColorNew      (  0, 130,  60);   // dark green  - unique to this side
-static const Gfx::Color kColorMissing  (  0,  80, 170);   // dark blue   - missing (exists on other side)
-static const Gfx::Color kColorConflict (180,  50,   0);   // brick red   - conflict (same ID, different name)
+static const std::uint32_t kColorNew      = 0x00823C;   // dark green  - unique to this side
+static const std::uint32_t kColorMissing  = 0x0050AA;   // dark blue   - missing (exists on other side)
+static const std::uint32_t kColorConflict = 0xB43200;   // brick red   - conflict (same ID, different name)
+static const std::uint32_t kColorProperty = 0x6E3C96;   // plum        - property applicability differs
+
+
+// ---------------------------------------------------------------------------
+// Watcher: coalesce bursts (tmp write + rename + changelog append) into one update
+// ---------------------------------------------------------------------------
+
+static const unsigned kWatcherDebounceMs = 300;
+
+
+// ---------------------------------------------------------------------------
+// History: most recent entries shown in the alert (all go to the report)
+// ---------------------------------------------------------------------------
+
+static const size_t kHistoryAlertEntries = 12;
+
+
+// ---------------------------------------------------------------------------
+// Master snapshots for point-in-time compare: at most one per day
+// ---------------------------------------------------------------------------
+
+static const std::int64_t kSnapshotIntervalSec = 24 * 60 * 60;
+
+
+// ---------------------------------------------------------------------------
+// Background refresh: nothing shown yet in the status line
+// ---------------------------------------------------------------------------
+
+static const unsigned kNoRefreshProgress = 0xFFFFFFFF;
+
+
+// ---------------------------------------------------------------------------
+// Differences grouped by category: larger groups start collapsed
+// ---------------------------------------------------------------------------
+
+static const size_t kGroupExpandEntries = 20;
+
+
+// ---------------------------------------------------------------------------
+// Bulk actions: conflicting IDs listed in the alert (all go to the report)
+// ---------------------------------------------------------------------------
+
+static const UInt32 kAlertMaxConflictIds = 15;
 
 
 // ---------------------------------------------------------------------------
@@ -60,9 +116,30 @@ ClassSyncPalette::ClassSyncPalette () :
 	buttonUseServer    (GetReference (), ItemButtonUseServer),
 	labelVersion       (GetReference (), ItemLabelVersion),
 	buttonLock         (GetReference (), ItemButtonLock),
-	labelWriteMode     (GetReference (), ItemLabelWriteMode)
+	labelWriteMode     (GetReference (), ItemLabelWriteMode),
+	buttonHistory      (GetReference (), ItemButtonHistory),
+	checkGroup         (GetReference (), ItemCheckGroup),
+	buttonDiagnostics  (GetReference (), ItemButtonDiagnostics)
 {
-	writeMode = false;
+	writeMode     = false;
+	lockedByOther = false;
+	updatingTrees = false;
+	groupByCategory = false;
+
+	fullRefreshPending   = false;
+	shownRefreshProgress = kNoRefreshProgress;
+	refreshCounters      = TakeCounterSnapshot ();
+
+	projectHash       = 0;
+	serverHash        = 0;
+	diffHash          = 0;
+	propertyHash      = 0;
+	projectStatusHash = 0;
+	serverStatusHash  = 0;
+	projectTreeKey    = 0;
+	serverTreeKey     = 0;
+	conflictsTreeKey  = 0;
+	pendingChanges = MasterChangeNone;
 
 	Attach (*this);
 	buttonRefresh.Attach (*this);
@@ -73,15 +150,21 @@ ClassSyncPalette::ClassSyncPalette () :
 	buttonUseProject.Attach (*this);
 	buttonUseServer.Attach (*this);
 	buttonLock.Attach (*this);
+	buttonHistory.Attach (*this);
+	checkGroup.Attach (*this);
+	buttonDiagnostics.Attach (*this);
+	treeProject.Attach (static_cast<DG::TreeViewObserver&> (*this));
 	treeConflicts.Attach (static_cast<DG::TreeViewObserver&> (*this));
+	treeServer.Attach (static_cast<DG::TreeViewObserver&> (*this));
 	BeginEventProcessing ();
+	EnableIdleEvent ();
 
 	// Version label
 	labelVersion.SetText (GS::UniString ("v") + kClassSyncVersion);
 
 	// XML path label
-	if (!xmlFilePath.IsEmpty ())
-		labelXmlPath.SetText (xmlFilePath);
+	if (!xmlFilePath.empty ())
+		labelXmlPath.SetText (FromUtf8 (xmlFilePath));
 	else
 		labelXmlPath.SetText ("No XML file selected - click Browse...");
 
@@ -93,18 +176,20 @@ ClassSyncPalette::ClassSyncPalette () :
 
 	// Lock button: enable only if XML path is set
 	labelWriteMode.SetText ("WRITE MODE");
-	labelWriteMode.SetTextColor (kColorConflict);
+	labelWriteMode.SetTextColor (Gfx::Color (180, 50, 0));
 	labelWriteMode.Hide ();
 
-	if (xmlFilePath.IsEmpty ())
+	if (xmlFilePath.empty ())
 		buttonLock.Disable ();
 	else
 		CheckLockStatus ();
 
-	ACAPI_WriteReport ("ClassSync v%s started", false, kClassSyncVersion);
+	CS_LOG_DEBUG ("ClassSync v%s started", kClassSyncVersion);
 
-	if (!xmlFilePath.IsEmpty ())
+	if (!xmlFilePath.empty ()) {
+		StartWatching ();
 		RefreshData ();
+	}
 }
 
 
@@ -114,9 +199,16 @@ ClassSyncPalette::ClassSyncPalette () :
 
 ClassSyncPalette::~ClassSyncPalette ()
 {
+	masterWatcher.Stop ();
+	refreshWorker.Stop ();
 	ReleaseLockIfHeld ();
 	EndEventProcessing ();
+	treeServer.Detach (static_cast<DG::TreeViewObserver&> (*this));
 	treeConflicts.Detach (static_cast<DG::TreeViewObserver&> (*this));
+	treeProject.Detach (static_cast<DG::TreeViewObserver&> (*this));
+	buttonDiagnostics.Detach (*this);
+	checkGroup.Detach (*this);
+	buttonHistory.Detach (*this);
 	buttonLock.Detach (*this);
 	buttonUseServer.Detach (*this);
 	buttonUseProject.Detach (*this);
@@ -218,6 +310,7 @@ void ClassSyncPalette::PanelCloseRequested (const DG::PanelCloseRequestEvent& /*
 											bool* accepted)
 {
 	ReleaseLockIfHeld ();
+	FlushChangeLog ();
 	Hide ();
 	*accepted = true;
 
@@ -298,15 +391,52 @@ void ClassSyncPalette::PanelResized (const DG::PanelResizeEvent& /*ev*/)
 	buttonLock.SetWidth          (130);
 	labelWriteMode.SetPosition   (col1 + 660, btnActY + 4);
 
-	// Bottom row: version left, Refresh+Close right
-	labelVersion.SetPosition  (col1,            bottomY);
-	buttonRefresh.SetPosition (w - margin - 190, bottomY);
-	buttonClose.SetPosition   (w - margin - 90,  bottomY);
+	// Bottom row: version left, Diagnostics+History+Refresh+Close right
+	labelVersion.SetPosition      (col1,            bottomY);
+	checkGroup.SetPosition        (col2,            bottomY + 3);
+	buttonDiagnostics.SetPosition (w - margin - 390, bottomY);
+	buttonHistory.SetPosition     (w - margin - 290, bottomY);
+	buttonRefresh.SetPosition     (w - margin - 190, bottomY);
+	buttonClose.SetPosition       (w - margin - 90,  bottomY);
 
 	RedrawItems ();
 }
 
 
+// ---------------------------------------------------------------------------
+// CheckItemObserver: group the Differences panel by top-level category
+// ---------------------------------------------------------------------------
+
+void ClassSyncPalette::CheckItemChanged (const DG::CheckItemChangeEvent& ev)
+{
+	if (ev.GetSource () != &checkGroup)
+		return;
+
+	groupByCategory = checkGroup.IsChecked ();
+	PopulateConflictsTree ();
+	conflictsTreeKey = GetConflictsTreeKey ();
+}
+
+
+// ---------------------------------------------------------------------------
+// PanelObserver: idle - deliver background refreshes, apply changes reported
+// by the watcher thread
+// ---------------------------------------------------------------------------
+
+void ClassSyncPalette::PanelIdle (const DG::PanelIdleEvent& /*ev*/)
+{
+	RefreshResult result;
+	if (refreshWorker.TakeResult (result))
+		ApplyRefreshResult (result);
+	else if (refreshWorker.IsBusy ())
+		ShowRefreshProgress ();
+
+	unsigned changes = pendingChanges.exchange (MasterChangeNone);
+	if (changes != MasterChangeNone)
+		ApplyMasterChanges (changes);
+}
+
+
 // ---------------------------------------------------------------------------
 // ButtonItemObserver: button clicked
 // ---------------------------------------------------------------------------
@@ -329,6 +459,10 @@ void ClassSyncPalette::ButtonClicked (const DG::ButtonClickEvent& ev)
 		DoUseServer ();
 	} else if (ev.GetSource () == &buttonLock) {
 		DoToggleLock ();
+	} else if (ev.GetSource () == &buttonHistory) {
+		DoShowHistory ();
+	} else if (ev.GetSource () == &buttonDiagnostics) {
+		DoShowDiagnostics ();
 	}
 }
 
@@ -361,17 +495,28 @@ void ClassSyncPalette::TreeViewItemClicked (const DG::TreeViewItemClickEvent& ev
 }
 
 
+// ---------------------------------------------------------------------------
+// TreeViewObserver: branch expanded - create lazy children on first expand
+// ---------------------------------------------------------------------------
+
+void ClassSyncPalette::TreeViewItemExpanded (const DG::TreeViewExpandEvent& ev)
+{
+	if (ev.GetSource () == &treeProject)
+		MaterializeBranch (SideProject, ev.GetTreeItem ());
+	else if (ev.GetSource () == &treeServer)
+		MaterializeBranch (SideServer, ev.GetTreeItem ());
+}
+
+
 // ---------------------------------------------------------------------------
 // Sync side tree selection: select and scroll to the matching item
 // ---------------------------------------------------------------------------
 
 void ClassSyncPalette::SyncSideTreeSelection (const DiffEntry& entry)
 {
-	Int32 projItem = 0;
-	Int32 servItem = 0;
-
-	projectIdToTreeItem.Get (entry.id, &projItem);
-	serverIdToTreeItem.Get (entry.id, &servItem);
+	// The item may sit in a branch that was never expanded
+	Int32 projItem = RevealItem (entry.id, SideProject);
+	Int32 servItem = RevealItem (entry.id, SideServer);
 
 	if (projItem != 0)
 		treeProject.SelectItem (projItem);
@@ -382,53 +527,72 @@ void ClassSyncPalette::SyncSideTreeSelection (const DiffEntry& entry)
 
 
 // ---------------------------------------------------------------------------
-// Update action button enabled states based on conflicts tree selection
+// Differences selection -> diff indices. A selected section or group stands
+// for every entry below it ("apply to section"); the result is in diff order,
+// which lists parents before their children.
 // ---------------------------------------------------------------------------
 
-void ClassSyncPalette::UpdateActionButtons ()
+static void CollectSelectedEntries (const ViewNode& parent,
+									const std::set<Int32>& selected,
+									bool parentSelected,
+									std::set<UInt32>& indices)
 {
-	Int32 selected = treeConflicts.GetSelectedItem ();
-
-	if (selected == 0 || selected == DG::TreeView::RootItem) {
-		buttonImport.Disable ();
-		buttonExport.Disable ();
-		buttonUseProject.Disable ();
-		buttonUseServer.Disable ();
-		return;
+	for (const ViewNode& node : parent.children) {
+		bool inSelection = parentSelected || selected.count (node.item) != 0;
+		if (node.tag >= 0) {
+			if (inSelection)
+				indices.insert ((UInt32)node.tag);
+		} else {
+			CollectSelectedEntries (node, selected, inSelection, indices);
+		}
 	}
+}
 
-	UInt32 diffIdx;
-	if (!conflictItemToDiffIndex.Get (selected, &diffIdx)) {
-		// Section header or non-actionable item
-		buttonImport.Disable ();
-		buttonExport.Disable ();
-		buttonUseProject.Disable ();
-		buttonUseServer.Disable ();
-		return;
+
+GS::Array<UInt32> ClassSyncPalette::GetSelectedDiffIndices (DiffStatus status) const
+{
+	std::set<Int32> selected;
+	for (Int32 item : treeConflicts.GetSelectedItems ())
+		selected.insert (item);
+
+	std::set<UInt32> indices;
+	if (!selected.empty ())
+		CollectSelectedEntries (conflictsView, selected, false, indices);
+
+	GS::Array<UInt32> result;
+	for (UInt32 i : indices) {
+		if (diffEntries[i].status == status)
+			result.Push (i);
 	}
+	return result;
+}
+
 
-	const DiffEntry& entry = diffEntries[diffIdx];
+// ---------------------------------------------------------------------------
+// Update action button enabled states based on conflicts tree selection.
+// Each action applies to the selected entries of its status.
+// ---------------------------------------------------------------------------
 
+void ClassSyncPalette::UpdateActionButtons ()
+{
 	buttonImport.Disable ();
 	buttonExport.Disable ();
 	buttonUseProject.Disable ();
 	buttonUseServer.Disable ();
 
-	switch (entry.status) {
-		case DiffStatus::OnlyInServer:
-			buttonImport.Enable ();
-			break;
-		case DiffStatus::OnlyInProject:
-			if (writeMode)
-				buttonExport.Enable ();
-			break;
-		case DiffStatus::Conflict:
-			if (writeMode)
-				buttonUseProject.Enable ();
-			buttonUseServer.Enable ();
-			break;
-		default:
-			break;
+	// A reconstructed master is read-only: Import and XML edits need the live file
+	bool live = historicalKey.empty ();
+
+	if (live && !GetSelectedDiffIndices (DiffStatus::OnlyInServer).IsEmpty ())
+		buttonImport.Enable ();
+
+	if (live && !lockedByOther && !GetSelectedDiffIndices (DiffStatus::OnlyInProject).IsEmpty ())
+		buttonExport.Enable ();
+
+	if (!GetSelectedDiffIndices (DiffStatus::Conflict).IsEmpty ()) {
+		if (live && !lockedByOther)
+			buttonUseProject.Enable ();
+		buttonUseServer.Enable ();
 	}
 }
 
@@ -439,52 +603,66 @@ void ClassSyncPalette::UpdateActionButtons ()
 
 void ClassSyncPalette::BrowseForXml ()
 {
-	DGTypePopupItem popup;
-	popup.text = "XML Files (*.xml)";
-	popup.extensions = "xml";
+	DGTypePopupItem popups[3];
+	popups[0].text = "XML Files (*.xml)";
+	popups[0].extensions = "xml";
+	popups[1].text = "Sharded Master (*.manifest)";
+	popups[1].extensions = "manifest";
+	popups[2].text = "Master Catalog (*.catalog)";
+	popups[2].extensions = "catalog";
 
 	IO::Location loc;
-	bool success = DGGetOpenFile (&loc, 1, &popup, nullptr,
+	bool success = DGGetOpenFile (&loc, 3, popups, nullptr,
 								  GS::UniString ("Select Classification XML"));
 
 	if (success) {
 		// Release old lock if switching XML files
 		ReleaseLockIfHeld ();
 
-		xmlFilePath = loc.ToDisplayText ();
-		labelXmlPath.SetText (xmlFilePath);
+		xmlFilePath = ToUtf8 (loc.ToDisplayText ());
+		labelXmlPath.SetText (FromUtf8 (xmlFilePath));
 		buttonLock.Enable ();
 		SavePreferences ();
+		StartWatching ();
+		CheckLockStatus ();
 		RefreshData ();
 	}
 }
 
 
 // ---------------------------------------------------------------------------
-// Import from server: add all missing items to project using XML import
+// Import from server: add the selected OnlyOnServer items to the project in
+// one undoable command. The document holds only those items and their
+// ancestors, built from the displayed server model (no file read).
 // ---------------------------------------------------------------------------
 
 void ClassSyncPalette::DoImportFromServer ()
 {
-	if (xmlFilePath.IsEmpty ()) return;
+	if (xmlFilePath.empty ()) return;
+
+	GS::Array<UInt32> indices = GetSelectedDiffIndices (DiffStatus::OnlyInServer);
+	if (indices.IsEmpty ()) return;
 
-	std::string pathUtf8 (xmlFilePath.ToCStr (0, MaxUSize, CC_UTF8).Get ());
+	std::vector<std::string> ids;
+	for (UInt32 diffIdx : indices)
+		ids.push_back (diffEntries[diffIdx].id);
 
-	std::ifstream file (pathUtf8, std::ios::binary);
-	if (!file.is_open ()) {
-		ACAPI_WriteReport ("ClassSync: Cannot open XML for import: %s", false, pathUtf8.c_str ());
+	std::string content;
+	UInt32 itemCount = (UInt32)FormatImportFragment (serverData, ids, content);
+	if (itemCount == 0) {
+		CS_LOG_INFO ("ClassSync: Nothing to import - the selected items are not in the master");
 		return;
 	}
-	std::ostringstream ss;
-	ss << file.rdbuf ();
-	std::string content = ss.str ();
-	file.close ();
 
-	GS::UniString xmlContent (content.c_str (), CC_UTF8);
+	CS_LOG_DEBUG ("ClassSync: Import of %u selected item(s): %u items with ancestors, %u bytes",
+				  indices.GetSize (), itemCount, (unsigned)content.size ());
+
+	GS::UniString xmlContent = FromUtf8 (content);
 
 	GSErrCode err = ACAPI_CallUndoableCommand (
 		GS::UniString ("ClassSync: Import from Server"),
 		[&] () -> GSErrCode {
+			AddCounter (Counter::AcapiClassificationCalls);
 			return ACAPI_Classification_Import (
 				xmlContent,
 				API_MergeConflictingSystems,
@@ -492,10 +670,13 @@ void ClassSyncPalette::DoImportFromServer ()
 		});
 
 	if (err == NoError) {
-		ACAPI_WriteReport ("ClassSync: Import successful", false);
-		LogImport (xmlFilePath);
+		CS_LOG_INFO ("ClassSync: Import successful");
+
+		ChangeLogBatch logBatch;
+		for (UInt32 diffIdx : indices)
+			LogImport (xmlFilePath, diffEntries[diffIdx].id, diffEntries[diffIdx].serverName);
 	} else {
-		ACAPI_WriteReport ("ClassSync: Import failed, error %d", false, (int)err);
+		CS_LOG_ERROR ("ClassSync: Import failed, error %d", (int)err);
 	}
 
 	RefreshData ();
@@ -503,44 +684,94 @@ void ClassSyncPalette::DoImportFromServer ()
 
 
 // ---------------------------------------------------------------------------
-// Export to server: add selected OnlyInProject item to XML file
+// Export to server: add the selected OnlyInProject items to the master in one
+// commit (parents first, so a branch and its children go together)
 // ---------------------------------------------------------------------------
 
 void ClassSyncPalette::DoExportToServer ()
 {
-	if (xmlFilePath.IsEmpty ()) return;
+	if (xmlFilePath.empty ()) return;
+
+	GS::Array<UInt32> indices = GetSelectedDiffIndices (DiffStatus::OnlyInProject);
+	if (indices.IsEmpty ()) return;
+
+	// Parents come from the project tree, not from the ID ("DR.L.01" sits
+	// under "DRZ.L")
+	ItemIndex projectIndex (projectData);
+
+	std::vector<MasterEdit> edits;
+	for (UInt32 diffIdx : indices) {
+		const DiffEntry& entry = diffEntries[diffIdx];
+
+		MasterEdit edit;
+		edit.kind             = MasterEditKind::AddItem;
+		edit.itemId           = entry.id;
+		edit.newName          = entry.projectName;
+		edit.node.id          = entry.id;
+		edit.node.name        = entry.projectName;
+		edit.node.description = entry.description;
+
+		ItemIndex::Ref ref = projectIndex.Find (entry.id);
+		if (ref != ItemIndex::kNoItem) {
+			edit.parentId = projectIndex.FindParentId (entry.id);
+
+			// A root item of a catalog goes to the master of its system
+			if (edit.parentId.empty ())
+				edit.systemName = projectData[projectIndex.GetSystem (ref)].systemName;
+		}
 
-	Int32 selected = treeConflicts.GetSelectedItem ();
-	UInt32 diffIdx;
-	if (!conflictItemToDiffIndex.Get (selected, &diffIdx)) return;
+		edits.push_back (edit);
+	}
 
-	const DiffEntry& entry = diffEntries[diffIdx];
-	if (entry.status != DiffStatus::OnlyInProject) return;
+	CommitResult result = CommitMasterEdits (edits);
 
-	ClassificationNode node;
-	node.id          = entry.id;
-	node.name        = entry.projectName;
-	node.description = entry.description;
-	node.guid        = APINULLGuid;
+	ReportEditResults ("Export", edits, result);
 
-	std::string pathUtf8 (xmlFilePath.ToCStr (0, MaxUSize, CC_UTF8).Get ());
+	{
+		ChangeLogBatch logBatch;
+		for (const MasterEdit& edit : edits) {
+			if (IsCommitSuccess (edit.result))
+				LogExport (xmlFilePath, edit.itemId, edit.newName, edit.parentId);
+		}
+	}
 
-	// Determine parent ID: strip last segment from the item ID
-	// e.g. "DRZ.L.01.03" -> parent is "DRZ.L.01", "DRZ.L" -> parent is "DRZ"
-	GS::UniString parentId;
-	auto lastDot = entry.id.FindLast ('.');
-	if (lastDot != MaxUIndex)
-		parentId = entry.id.GetSubstring (0, lastDot);
+	RefreshData ();
+}
 
-	bool success = AddItemToXml (pathUtf8.c_str (), parentId, node);
 
-	if (success) {
-		ACAPI_WriteReport ("ClassSync: Exported '%s' to XML", false,
-						   entry.id.ToCStr ().Get ());
-		LogExport (xmlFilePath, entry.id, entry.projectName, parentId);
-	} else {
-		ACAPI_WriteReport ("ClassSync: Export failed for '%s'", false,
-						   entry.id.ToCStr ().Get ());
+// ---------------------------------------------------------------------------
+// Use Project: update the master names of the selected conflicts in one commit
+// ---------------------------------------------------------------------------
+
+void ClassSyncPalette::DoUseProject ()
+{
+	if (xmlFilePath.empty ()) return;
+
+	GS::Array<UInt32> indices = GetSelectedDiffIndices (DiffStatus::Conflict);
+	if (indices.IsEmpty ()) return;
+
+	std::vector<MasterEdit> edits;
+	for (UInt32 diffIdx : indices) {
+		const DiffEntry& entry = diffEntries[diffIdx];
+
+		MasterEdit edit;
+		edit.kind     = MasterEditKind::ChangeName;
+		edit.itemId   = entry.id;
+		edit.baseName = entry.serverName;
+		edit.newName  = entry.projectName;
+		edits.push_back (edit);
+	}
+
+	CommitResult result = CommitMasterEdits (edits);
+
+	ReportEditResults ("Use Project", edits, result);
+
+	{
+		ChangeLogBatch logBatch;
+		for (const MasterEdit& edit : edits) {
+			if (IsCommitSuccess (edit.result))
+				LogUseProject (xmlFilePath, edit.itemId, edit.baseName, edit.newName);
+		}
 	}
 
 	RefreshData ();
@@ -548,76 +779,130 @@ void ClassSyncPalette::DoExportToServer ()
 
 
 // ---------------------------------------------------------------------------
-// Use Project: update XML item name to match project
+// One commit of master edits: through the sync service while connected,
+// otherwise to the shards, the catalog's masters or the XML file
 // ---------------------------------------------------------------------------
 
-void ClassSyncPalette::DoUseProject ()
+CommitResult ClassSyncPalette::CommitMasterEdits (std::vector<MasterEdit>& edits)
 {
-	if (xmlFilePath.IsEmpty ()) return;
+	if (IsShardedMaster (xmlFilePath.c_str ()))
+		return ApplyEditsToShards (xmlFilePath.c_str (), shardCache, edits);
+	if (IsMasterCatalog (xmlFilePath.c_str ()))
+		return ApplyEditsToCatalog (catalogCache, edits);
+
+	CommitResult result;
+	if (syncClient != nullptr && syncClient->Commit (serverVersion, edits, result))
+		return result;
+	return ApplyEditsToXml (xmlFilePath.c_str (), serverVersion, edits);
+}
 
-	Int32 selected = treeConflicts.GetSelectedItem ();
-	UInt32 diffIdx;
-	if (!conflictItemToDiffIndex.Get (selected, &diffIdx)) return;
 
-	const DiffEntry& entry = diffEntries[diffIdx];
-	if (entry.status != DiffStatus::Conflict) return;
+// ---------------------------------------------------------------------------
+// Report the outcome of a batch of master edits: one report line per edit,
+// one alert for all conflicts. Returns the number of edits written.
+// ---------------------------------------------------------------------------
 
-	std::string pathUtf8 (xmlFilePath.ToCStr (0, MaxUSize, CC_UTF8).Get ());
+UInt32 ClassSyncPalette::ReportEditResults (const char* action,
+											const std::vector<MasterEdit>& edits,
+											CommitResult result)
+{
+	UInt32      written = 0;
+	UInt32      conflicts = 0;
+	std::string conflictIds;
+
+	for (const MasterEdit& edit : edits) {
+		CS_LOG (IsCommitSuccess (edit.result) ? LogLevel::Debug : LogLevel::Warning,
+				"ClassSync: %s '%s' - %s (base %s)",
+				action, edit.itemId.c_str (), CommitResultName (edit.result),
+				MasterVersionToString (serverVersion).c_str ());
+
+		if (IsCommitSuccess (edit.result)) {
+			written++;
+		} else if (edit.result == CommitResult::Conflict) {
+			if (conflicts < kAlertMaxConflictIds)
+				conflictIds += "\n  " + edit.itemId;
+			conflicts++;
+		}
+	}
 
-	bool success = ChangeItemNameInXml (pathUtf8.c_str (), entry.id, entry.projectName);
+	CS_LOG_INFO ("ClassSync: %s - %u of %u item(s) written in one commit (%s)",
+				 action, written, (UInt32)edits.size (), CommitResultName (result));
 
-	if (success) {
-		ACAPI_WriteReport ("ClassSync: XML updated - '%s' name -> '%s'", false,
-						   entry.id.ToCStr ().Get (),
-						   entry.projectName.ToCStr ().Get ());
-		LogUseProject (xmlFilePath, entry.id, entry.serverName, entry.projectName);
-	} else {
-		ACAPI_WriteReport ("ClassSync: Failed to update XML for '%s'", false,
-						   entry.id.ToCStr ().Get ());
+	if (conflicts > kAlertMaxConflictIds)
+		conflictIds += "\n  ... and " + std::to_string (conflicts - kAlertMaxConflictIds) + " more";
+
+	if (conflicts > 0) {
+		DGAlert (DG_WARNING, "ClassSync", "Master changed",
+			"These items were changed in the XML by another session since the last refresh:" + FromUtf8 (conflictIds) +
+			"\nTheir edits were not applied - check the refreshed differences and try again.", "OK");
+	} else if (result == CommitResult::Busy) {
+		DGAlert (DG_INFORMATION, "ClassSync", "Master busy",
+			"Another session is saving the XML right now. Please try again in a moment.", "OK");
 	}
 
-	RefreshData ();
+	return written;
 }
 
 
 // ---------------------------------------------------------------------------
-// Use Server: update project item name to match server
+// Use Server: rename the selected conflicts in the project to their server
+// names, all in one undoable command
 // ---------------------------------------------------------------------------
 
 void ClassSyncPalette::DoUseServer ()
 {
-	Int32 selected = treeConflicts.GetSelectedItem ();
-	UInt32 diffIdx;
-	if (!conflictItemToDiffIndex.Get (selected, &diffIdx)) return;
-
-	const DiffEntry& entry = diffEntries[diffIdx];
-	if (entry.status != DiffStatus::Conflict) return;
-	if (entry.projectItemGuid == APINULLGuid) return;
+	GS::Array<UInt32> indices = GetSelectedDiffIndices (DiffStatus::Conflict);
+
+	GS::Array<UInt32>                  changed;
+	GS::Array<API_ClassificationItem>  items;
+	for (UInt32 diffIdx : indices) {
+		const DiffEntry& entry = diffEntries[diffIdx];
+		if (entry.projectItemGuid.IsNull ())
+			continue;
+
+		API_ClassificationItem item;
+		item.guid = ToApiGuid (entry.projectItemGuid);
+		AddCounter (Counter::AcapiClassificationCalls);
+		if (ACAPI_Classification_GetClassificationItem (item) != NoError) {
+			CS_LOG_WARNING ("ClassSync: Cannot find project item '%s'",
+							entry.id.c_str ());
+			continue;
+		}
 
-	API_ClassificationItem item;
-	item.guid = entry.projectItemGuid;
-	if (ACAPI_Classification_GetClassificationItem (item) != NoError) {
-		ACAPI_WriteReport ("ClassSync: Cannot find project item '%s'", false,
-						   entry.id.ToCStr ().Get ());
-		return;
+		item.name = FromUtf8 (entry.serverName);
+		items.Push (item);
+		changed.Push (diffIdx);
 	}
 
-	item.name = entry.serverName;
+	if (items.IsEmpty ()) return;
 
+	// One undo step; an item that fails is reported and the rest are kept
+	GS::Array<GSErrCode> errors;
 	GSErrCode err = ACAPI_CallUndoableCommand (
 		GS::UniString ("ClassSync: Use Server name"),
 		[&] () -> GSErrCode {
-			return ACAPI_Classification_ChangeClassificationItem (item);
+			AddCounter (Counter::AcapiClassificationCalls, items.GetSize ());
+			for (API_ClassificationItem& item : items)
+				errors.Push (ACAPI_Classification_ChangeClassificationItem (item));
+			return NoError;
 		});
 
-	if (err == NoError) {
-		ACAPI_WriteReport ("ClassSync: Project item '%s' name -> '%s'", false,
-						   entry.id.ToCStr ().Get (),
-						   entry.serverName.ToCStr ().Get ());
-		LogUseServer (xmlFilePath, entry.id, entry.projectName, entry.serverName);
-	} else {
-		ACAPI_WriteReport ("ClassSync: Failed to change project item '%s', error %d", false,
-						   entry.id.ToCStr ().Get (), (int)err);
+	{
+		ChangeLogBatch logBatch;
+		for (UInt32 k = 0; k < changed.GetSize (); k++) {
+			const DiffEntry& entry = diffEntries[changed[k]];
+			GSErrCode itemErr = (err == NoError && k < errors.GetSize ()) ? errors[k] : err;
+
+			if (itemErr == NoError) {
+				CS_LOG_DEBUG ("ClassSync: Project item '%s' name -> '%s'",
+							  entry.id.c_str (),
+							  entry.serverName.c_str ());
+				LogUseServer (xmlFilePath, entry.id, entry.projectName, entry.serverName);
+			} else {
+				CS_LOG_ERROR ("ClassSync: Failed to change project item '%s', error %d",
+							  entry.id.c_str (), (int)itemErr);
+			}
+		}
 	}
 
 	RefreshData ();
@@ -638,15 +923,14 @@ void ClassSyncPalette::LoadPreferences ()
 		ClassSyncPrefs prefs = {};
 		ACAPI_GetPreferences (&version, &nByte, &prefs);
 		if (prefs.xmlPath[0] != '\0')
-			xmlFilePath = GS::UniString (prefs.xmlPath, CC_UTF8);
+			xmlFilePath = prefs.xmlPath;
 	}
 
 	// Fallback to default path (master XML in repo)
-	if (xmlFilePath.IsEmpty ())
+	if (xmlFilePath.empty ())
 		xmlFilePath = "C:\\Users\\Green\\claude\\PlantSyncAddon\\Green Accent PLANTS.xml";
 
-	ACAPI_WriteReport ("ClassSync: Loaded prefs, XML path = %s", false,
-					   xmlFilePath.ToCStr (0, MaxUSize, CC_UTF8).Get ());
+	CS_LOG_DEBUG ("ClassSync: Loaded prefs, XML path = %s", xmlFilePath.c_str ());
 }
 
 
@@ -659,8 +943,7 @@ void ClassSyncPalette::SavePreferences ()
 	ClassSyncPrefs prefs = {};
 	prefs.platform = GS::Win_Platform_Sign;
 
-	std::string pathUtf8 (xmlFilePath.ToCStr (0, MaxUSize, CC_UTF8).Get ());
-	strncpy (prefs.xmlPath, pathUtf8.c_str (), sizeof (prefs.xmlPath) - 1);
+	strncpy (prefs.xmlPath, xmlFilePath.c_str (), sizeof (prefs.xmlPath) - 1);
 
 	ACAPI_SetPreferences (kPrefsVersion, sizeof (ClassSyncPrefs), &prefs);
 }
@@ -670,255 +953,582 @@ void ClassSyncPalette::SavePreferences ()
 // Helper: find diff status for a given classification ID
 // ---------------------------------------------------------------------------
 
-DiffStatus ClassSyncPalette::FindDiffStatus (const GS::Array<DiffEntry>& diffs,
-											  const GS::UniString& id)
+DiffStatus ClassSyncPalette::FindDiffStatus (const std::string& id) const
 {
-	for (UInt32 i = 0; i < diffs.GetSize (); i++) {
-		if (diffs[i].id == id)
-			return diffs[i].status;
-	}
-	return DiffStatus::Match;
+	auto it = diffStatusById.find (id);
+	return it != diffStatusById.end () ? it->second : DiffStatus::Match;
 }
 
 
 // ---------------------------------------------------------------------------
-// Helper: recursively fill tree with nodes + context-sensitive colors
+// Side tree summary: one bottom-up pass. Every branch gets the conflict and
+// only-here counts of its descendants, every item its top-level category.
 // ---------------------------------------------------------------------------
 
-void ClassSyncPalette::FillTreeWithNodes (DG::SingleSelTreeView& tree,
-										   const GS::Array<ClassificationNode>& nodes,
-										   Int32 parentItem,
-										   UInt32& count,
-										   const GS::Array<DiffEntry>& diffs,
-										   TreeSide side,
-										   GS::HashTable<GS::UniString, Int32>* idMap)
+SubtreeCounts ClassSyncPalette::SummarizeNodes (const std::vector<ClassificationNode>& nodes,
+												TreeSide side,
+												UInt32 category,
+												SideSummary& summary) const
 {
-	for (UInt32 i = 0; i < nodes.GetSize (); i++) {
-		const ClassificationNode& node = nodes[i];
+	DiffStatus onlyHere = (side == SideProject) ? DiffStatus::OnlyInProject : DiffStatus::OnlyInServer;
+
+	SubtreeCounts total;
+	for (const ClassificationNode& node : nodes) {
+		summary.category[node.id] = category;
 
-		GS::UniString label = node.id + "  -  " + node.name;
+		SubtreeCounts below = SummarizeNodes (node.children, side, category, summary);
+		if (below.conflicts + below.onlyHere > 0)
+			summary.counts[node.id] = below;
 
-		Int32 treeItem = tree.AppendItem (parentItem);
-		tree.SetItemText (treeItem, label);
-		count++;
+		DiffStatus status = FindDiffStatus (node.id);
+		total.conflicts += below.conflicts + (status == DiffStatus::Conflict ? 1 : 0);
+		total.onlyHere  += below.onlyHere  + (status == onlyHere ? 1 : 0);
+	}
+	return total;
+}
 
-		// Store mapping for selection sync
-		if (idMap != nullptr)
-			idMap->Add (node.id, treeItem);
 
-		// Apply color based on diff status and which tree we're in
-		if (diffs.GetSize () > 0) {
-			DiffStatus st = FindDiffStatus (diffs, node.id);
-			switch (st) {
-				case DiffStatus::OnlyInProject:
-					if (side == SideProject)
-						tree.SetItemTextColor (treeItem, kColorNew);       // green: unique to project
-					break;
-				case DiffStatus::OnlyInServer:
-					if (side == SideServer)
-						tree.SetItemTextColor (treeItem, kColorNew);       // green: unique to server
-					break;
-				case DiffStatus::Conflict:
-					tree.SetItemTextColor (treeItem, kColorConflict);      // brick red: conflict
-					break;
-				default:
-					break;
-			}
+void ClassSyncPalette::SummarizeSide (TreeSide side)
+{
+	const std::vector<ClassificationTree>& data = (side == SideProject) ? projectData : serverData;
+	SideSummary& summary = (side == SideProject) ? projectSummary : serverSummary;
+
+	summary = SideSummary ();
+	for (const ClassificationTree& tree : data) {
+		for (const ClassificationNode& root : tree.rootItems) {
+			UInt32 category = (UInt32)summary.categoryIds.size ();
+			summary.categoryIds.push_back (root.id);
+			summary.categoryLabels.push_back (root.id + "  -  " + root.name);
+
+			summary.category[root.id] = category;
+
+			SubtreeCounts below = SummarizeNodes (root.children, side, category, summary);
+			if (below.conflicts + below.onlyHere > 0)
+				summary.counts[root.id] = below;
 		}
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+// Helpers: view model keys and labels
+//
+// Side trees: system node key = system name, item key = ID (unique among
+// siblings); a lazy branch has one placeholder child. Expanded branches are
+// remembered as "system<US>ID" so they stay materialized across refreshes.
+// ---------------------------------------------------------------------------
+
+static const char* kPlaceholderKey = "\x1f*";
 
-		// Recurse into children
-		FillTreeWithNodes (tree, node.children, treeItem, count, diffs, side, idMap);
+static std::string BranchKey (const std::string& systemKey, const std::string& itemKey)
+{
+	return systemKey + "\x1f" + itemKey;
+}
+
+
+static ViewNode MakeViewNode (const std::string& key, const std::string& text, std::uint32_t color)
+{
+	ViewNode node;
+	node.key   = key;
+	node.text  = text;
+	node.color = color;
+	return node;
+}
+
+
+// " (1 conflict, 2 new)" for a branch label
+static std::string FormatSubtreeCounts (const SubtreeCounts& counts)
+{
+	std::string text;
+	if (counts.conflicts > 0)
+		text = std::to_string (counts.conflicts) + (counts.conflicts == 1 ? " conflict" : " conflicts");
+	if (counts.onlyHere > 0) {
+		if (!text.empty ())
+			text += ", ";
+		text += std::to_string (counts.onlyHere) + " new";
 	}
+	return " (" + text + ")";
+}
+
+
+static UInt32 CountNodes (const std::vector<ClassificationNode>& nodes)
+{
+	UInt32 count = (UInt32)nodes.size ();
+	for (const ClassificationNode& node : nodes)
+		count += CountNodes (node.children);
+	return count;
 }
 
 
 // ---------------------------------------------------------------------------
-// Clear a tree by deleting tracked root items
+// Build the side tree model: labels + context-sensitive colors. Branches with
+// differences are filled and expanded; others get a placeholder child.
 // ---------------------------------------------------------------------------
 
-static void ClearTree (DG::SingleSelTreeView& tree, GS::Array<Int32>& rootItems)
+void ClassSyncPalette::BuildSideNodes (const std::vector<ClassificationNode>& nodes,
+									   const std::string& systemKey,
+									   TreeSide side,
+									   ViewNode& parent) const
 {
-	tree.DisableDraw ();
-	for (UInt32 i = 0; i < rootItems.GetSize (); i++)
-		tree.DeleteItem (rootItems[i]);
-	rootItems.Clear ();
-	tree.EnableDraw ();
+	const std::set<std::string>& expanded = (side == SideProject) ? projectExpanded : serverExpanded;
+	const SideSummary&           summary  = (side == SideProject) ? projectSummary  : serverSummary;
+
+	parent.children.reserve (nodes.size ());
+	for (const ClassificationNode& node : nodes) {
+
+		// Color based on diff status and which tree we're in
+		std::uint32_t color = kViewDefaultColor;
+		switch (FindDiffStatus (node.id)) {
+			case DiffStatus::OnlyInProject:
+				if (side == SideProject)
+					color = kColorNew;          // green: unique to project
+				break;
+			case DiffStatus::OnlyInServer:
+				if (side == SideServer)
+					color = kColorNew;          // green: unique to server
+				break;
+			case DiffStatus::Conflict:
+				color = kColorConflict;         // brick red: conflict
+				break;
+			default:
+				break;
+		}
+
+		// Branches with differences below carry their counts
+		std::string label = node.id + "  -  " + node.name;
+		const SubtreeCounts* counts = nullptr;
+		if (!node.children.empty ()) {
+			auto found = summary.counts.find (node.id);
+			if (found != summary.counts.end ())
+				counts = &found->second;
+		}
+		if (counts != nullptr)
+			label += FormatSubtreeCounts (*counts);
+
+		parent.children.push_back (MakeViewNode (node.id, label, color));
+		ViewNode& item = parent.children.back ();
+
+		if (node.children.empty ())
+			continue;
+
+		bool hasDiff = counts != nullptr;
+		if (hasDiff || expanded.count (BranchKey (systemKey, item.key)) > 0) {
+			item.expand = hasDiff;
+			BuildSideNodes (node.children, systemKey, side, item);
+		} else {
+			ViewNode placeholder;
+			placeholder.key = kPlaceholderKey;
+			item.children.push_back (placeholder);
+		}
+	}
+}
+
+
+void ClassSyncPalette::BuildSideView (const std::vector<ClassificationTree>& data,
+									  TreeSide side,
+									  ViewNode& root) const
+{
+	for (const ClassificationTree& tree : data) {
+		root.children.push_back (MakeViewNode (tree.systemName,
+											   tree.systemName + "  (v" + tree.version + ")",
+											   kViewDefaultColor));
+		ViewNode& sysNode = root.children.back ();
+		sysNode.expand = true;
+		BuildSideNodes (tree.rootItems, sysNode.key, side, sysNode);
+	}
 }
 
 
 // ---------------------------------------------------------------------------
-// Populate Project tree (left panel)
+// Build the Differences model: one section per status, items keyed by ID,
+// optionally grouped by top-level category
 // ---------------------------------------------------------------------------
 
-void ClassSyncPalette::PopulateProjectTree ()
+void ClassSyncPalette::BuildConflictsView (ViewNode& root) const
 {
-	ClearTree (treeProject, projectRootItems);
-	projectIdToTreeItem.Clear ();
-	treeProject.DisableDraw ();
+	struct Section {
+		DiffStatus     status;
+		const char*    key;
+		const char*    title;
+		std::uint32_t  color;
+	};
+
+	static const Section kSections[] = {
+		{ DiffStatus::Conflict,      "conflicts",    "Conflicts (%d)",      kColorConflict },	// same ID, different name
+		{ DiffStatus::OnlyInProject, "only-project", "Only in Project (%d)", kColorNew },
+		{ DiffStatus::OnlyInServer,  "only-server",  "Only on Server (%d)",  kColorMissing }
+	};
+
+	for (const Section& section : kSections) {
+		ViewNode secNode;
+		secNode.key    = section.key;
+		secNode.color  = section.color;
+		secNode.expand = true;
+
+		auto makeEntryNode = [&] (UInt32 i) {
+			const DiffEntry& entry = diffEntries[i];
+
+			std::string label;
+			if (entry.status == DiffStatus::Conflict)
+				label = entry.id + "  P:\"" + entry.projectName + "\"  S:\"" + entry.serverName + "\"";
+			else if (entry.status == DiffStatus::OnlyInProject)
+				label = entry.id + "  -  " + entry.projectName;
+			else
+				label = entry.id + "  -  " + entry.serverName;
+
+			ViewNode node = MakeViewNode (entry.id, label, section.color);
+			node.tag = (std::int32_t)i;
+			return node;
+		};
+
+		size_t entryCount = 0;
+		if (!groupByCategory) {
+			for (UInt32 i = 0; i < diffEntries.size (); i++) {
+				if (diffEntries[i].status == section.status)
+					secNode.children.push_back (makeEntryNode (i));
+			}
+			entryCount = secNode.children.size ();
+		} else {
+			// Bucket by the top-level item on the side where the entry exists
+			const SideSummary& summary = (section.status == DiffStatus::OnlyInServer) ? serverSummary : projectSummary;
+			UInt32 uncategorized = (UInt32)summary.categoryIds.size ();
+
+			std::vector<std::vector<UInt32>> buckets (uncategorized + 1);
+			for (UInt32 i = 0; i < diffEntries.size (); i++) {
+				if (diffEntries[i].status != section.status)
+					continue;
+				auto found = summary.category.find (diffEntries[i].id);
+				buckets[found != summary.category.end () ? found->second : uncategorized].push_back (i);
+			}
 
-	UInt32 itemCount = 0;
-	UInt32 sysCount  = 0;
+			for (UInt32 c = 0; c < buckets.size (); c++) {
+				if (buckets[c].empty ())
+					continue;
 
-	for (UInt32 s = 0; s < projectData.GetSize (); s++) {
-		const ClassificationTree& tree = projectData[s];
-		sysCount++;
+				std::string groupLabel = (c < uncategorized) ? summary.categoryLabels[c] : std::string ("Other");
+				ViewNode group = MakeViewNode (c < uncategorized ? "cat\x1f" + summary.categoryIds[c] : "cat\x1f",
+											   groupLabel + " (" + std::to_string (buckets[c].size ()) + ")",
+											   section.color);
+				group.expand = buckets[c].size () <= kGroupExpandEntries;
+				for (UInt32 i : buckets[c])
+					group.children.push_back (makeEntryNode (i));
 
-		GS::UniString sysLabel = tree.systemName + "  (v" + tree.version + ")";
-		Int32 sysNode = treeProject.AppendItem (DG_TVI_ROOT);
-		treeProject.SetItemText (sysNode, sysLabel);
-		projectRootItems.Push (sysNode);
+				entryCount += buckets[c].size ();
+				secNode.children.push_back (std::move (group));
+			}
+		}
 
-		FillTreeWithNodes (treeProject, tree.rootItems, sysNode, itemCount, diffEntries, SideProject, &projectIdToTreeItem);
-		treeProject.ExpandItem (sysNode);
+		if (entryCount == 0)
+			continue;
+
+		char title[64];
+		snprintf (title, sizeof (title), section.title, (int)entryCount);
+		secNode.text = title;
+		root.children.push_back (std::move (secNode));
 	}
 
-	treeProject.EnableDraw ();
-	treeProject.Redraw ();
+	// Property applicability: whole definitions first, then one branch per
+	// item with the definitions that apply on one side only, then enumeration
+	// values that one side lacks (no actions)
+	if (!propertyDrift.empty ()) {
+		ViewNode secNode;
+		secNode.key    = "properties";
+		secNode.color  = kColorProperty;
+		secNode.expand = true;
+
+		std::unordered_map<std::string, size_t> itemNodes;
+		for (const PropertyDrift& drift : propertyDrift) {
+			std::string label = drift.group + " / " + drift.name + (drift.inProject ? "  (project only)" : "  (master only)");
+			ViewNode node = MakeViewNode (drift.group + "\x1f" + drift.name, label, kColorProperty);
+			if (!drift.value.empty ()) {
+				node.key  = "val\x1f" + node.key + "\x1f" + drift.value;
+				node.text = "Value " + drift.group + " / " + drift.name + " = \"" + drift.value + "\"" +
+							(drift.inProject ? "  (project only)" : "  (master only)");
+				secNode.children.push_back (std::move (node));
+				continue;
+			}
+			if (drift.itemId.empty ()) {
+				node.key  = "def\x1f" + node.key;
+				node.text = "Definition " + label;
+				secNode.children.push_back (std::move (node));
+				continue;
+			}
 
-	GS::UniString status = GS::UniString::Printf ("%d systems, %d items",
-		sysCount, itemCount);
-	countProject.SetText (status);
+			auto found = itemNodes.emplace (drift.itemId, secNode.children.size ());
+			if (found.second)
+				secNode.children.push_back (MakeViewNode ("item\x1f" + drift.itemId, drift.itemId, kColorProperty));
+			secNode.children[found.first->second].children.push_back (std::move (node));
+		}
+
+		for (ViewNode& item : secNode.children) {
+			if (item.children.empty ())
+				continue;
+			item.text  += "  (" + std::to_string (item.children.size ()) + ")";
+			item.expand = item.children.size () <= kGroupExpandEntries && secNode.children.size () <= kGroupExpandEntries;
+		}
+
+		char title[64];
+		snprintf (title, sizeof (title), "Property applicability (%d)", (int)propertyDrift.size ());
+		secNode.text = title;
+		root.children.push_back (std::move (secNode));
+	}
+
+	if (root.children.empty ()) {
+		ViewNode matchNode;
+		matchNode.key  = "all-match";
+		matchNode.text = "All items match";
+		root.children.push_back (matchNode);
+	}
 }
 
 
 // ---------------------------------------------------------------------------
-// Populate Server tree (right panel)
+// Reconcile the displayed tree with a new model; only changes touch DG
 // ---------------------------------------------------------------------------
 
-void ClassSyncPalette::PopulateServerTree ()
+static Gfx::Color ToGfxColor (std::uint32_t rgb)
 {
-	ClearTree (treeServer, serverRootItems);
-	serverIdToTreeItem.Clear ();
-	treeServer.DisableDraw ();
-
-	UInt32 itemCount = 0;
-	UInt32 sysCount  = 0;
+	if (rgb == kViewDefaultColor)
+		return Gfx::Color (0, 0, 0);
+	return Gfx::Color ((unsigned char)(rgb >> 16), (unsigned char)(rgb >> 8), (unsigned char)rgb);
+}
 
-	for (UInt32 s = 0; s < serverData.GetSize (); s++) {
-		const ClassificationTree& tree = serverData[s];
-		sysCount++;
 
-		GS::UniString sysLabel = tree.systemName + "  (v" + tree.version + ")";
-		Int32 sysNode = treeServer.AppendItem (DG_TVI_ROOT);
-		treeServer.SetItemText (sysNode, sysLabel);
-		serverRootItems.Push (sysNode);
+void ClassSyncPalette::UpdateTree (DG::TreeView& tree,
+								   ViewNode& displayed,
+								   ViewNode& next,
+								   const char* name)
+{
+	std::vector<TreeMutation> mutations;
+	ReconcileStats            stats;
+
+	next.item = DG_TVI_ROOT;
+	ReconcileViews (displayed, next, mutations, stats);
+
+	updatingTrees = true;
+	if (!mutations.empty ())
+		tree.DisableDraw ();
+
+	for (TreeMutation& m : mutations) {
+		switch (m.kind) {
+			case TreeMutationKind::Append:
+				m.node->item = tree.InsertItem (m.parent->item, m.after != nullptr ? m.after->item : DG_TVI_TOP);
+				tree.SetItemText (m.node->item, FromUtf8 (m.node->text));
+				if (m.node->color != kViewDefaultColor)
+					tree.SetItemTextColor (m.node->item, ToGfxColor (m.node->color));
+				break;
+			case TreeMutationKind::Delete:
+				tree.DeleteItem (m.item);
+				break;
+			case TreeMutationKind::SetText:
+				tree.SetItemText (m.node->item, FromUtf8 (m.node->text));
+				break;
+			case TreeMutationKind::SetColor:
+				tree.SetItemTextColor (m.node->item, ToGfxColor (m.node->color));
+				break;
+			case TreeMutationKind::Expand:
+				tree.ExpandItem (m.node->item);
+				break;
+		}
+	}
 
-		FillTreeWithNodes (treeServer, tree.rootItems, sysNode, itemCount, diffEntries, SideServer, &serverIdToTreeItem);
-		treeServer.ExpandItem (sysNode);
+	if (!mutations.empty ()) {
+		tree.EnableDraw ();
+		tree.Redraw ();
 	}
+	updatingTrees = false;
 
-	treeServer.EnableDraw ();
-	treeServer.Redraw ();
+	displayed = std::move (next);
 
-	GS::UniString status = GS::UniString::Printf ("%d systems, %d items",
-		sysCount, itemCount);
-	countServer.SetText (status);
+	if (!mutations.empty ())
+		CS_LOG_DEBUG ("ClassSync: %s tree: %u added, %u deleted, %u relabeled, %u recolored, %u subtrees unchanged",
+					  name, stats.appended, stats.deleted, stats.textChanged, stats.colorChanged,
+					  stats.subtreesReused);
 }
 
 
 // ---------------------------------------------------------------------------
-// Populate Conflicts tree (center panel)
+// Rebuild ID -> item and placeholder maps from the displayed side model
 // ---------------------------------------------------------------------------
 
-void ClassSyncPalette::PopulateConflictsTree ()
+static void CollectSideItems (const ViewNode& parent,
+							  const std::string& systemKey,
+							  std::unordered_map<std::string, Int32>& idMap,
+							  GS::HashTable<Int32, std::string>& lazy)
 {
-	ClearTree (treeConflicts, conflictRootItems);
-	conflictItemToDiffIndex.Clear ();
-	treeConflicts.DisableDraw ();
-
-	// Count by status
-	UInt32 conflictCount  = 0;
-	UInt32 onlyProjCount  = 0;
-	UInt32 onlyServCount  = 0;
-
-	for (UInt32 i = 0; i < diffEntries.GetSize (); i++) {
-		switch (diffEntries[i].status) {
-			case DiffStatus::Conflict:      conflictCount++;  break;
-			case DiffStatus::OnlyInProject: onlyProjCount++;  break;
-			case DiffStatus::OnlyInServer:  onlyServCount++;  break;
-			default: break;
-		}
+	for (const ViewNode& node : parent.children) {
+		if (node.key == kPlaceholderKey)
+			continue;
+		idMap[node.key] = node.item;
+		if (node.children.size () == 1 && node.children[0].key == kPlaceholderKey)
+			lazy.Put (node.item, BranchKey (systemKey, node.key));
+		else
+			CollectSideItems (node, systemKey, idMap, lazy);
 	}
+}
+
+
+void ClassSyncPalette::UpdateSideTree (TreeSide side)
+{
+	const std::vector<ClassificationTree>& data = (side == SideProject) ? projectData : serverData;
+	DG::SingleSelTreeView& tree      = (side == SideProject) ? treeProject : treeServer;
+	ViewNode&              displayed = (side == SideProject) ? projectView : serverView;
+
+	ViewNode next;
+	BuildSideView (data, side, next);
+	UpdateTree (tree, displayed, next, side == SideProject ? "Project" : "Server");
+
+	std::unordered_map<std::string, Int32>& idMap = (side == SideProject) ? projectIdToTreeItem : serverIdToTreeItem;
+	GS::HashTable<Int32, std::string>&      lazy  = (side == SideProject) ? projectLazyBranches : serverLazyBranches;
+	idMap.clear ();
+	lazy.Clear ();
+	for (const ViewNode& sysNode : displayed.children)
+		CollectSideItems (sysNode, sysNode.key, idMap, lazy);
+}
 
-	UInt32 totalDiffs = conflictCount + onlyProjCount + onlyServCount;
 
-	if (totalDiffs == 0) {
-		Int32 item = treeConflicts.AppendItem (DG_TVI_ROOT);
-		treeConflicts.SetItemText (item, "All items match");
-		conflictRootItems.Push (item);
-		treeConflicts.EnableDraw ();
-		treeConflicts.Redraw ();
-		countConflicts.SetText ("0 differences");
+// ---------------------------------------------------------------------------
+// Create the children of a lazy branch (first expand)
+// ---------------------------------------------------------------------------
+
+void ClassSyncPalette::MaterializeBranch (TreeSide side, Int32 item)
+{
+	GS::HashTable<Int32, std::string>& lazy = (side == SideProject) ? projectLazyBranches : serverLazyBranches;
+
+	std::string key;
+	if (updatingTrees || !lazy.Get (item, &key))
 		return;
-	}
 
-	// Conflicts section (same ID, different name)
-	if (conflictCount > 0) {
-		Int32 secItem = treeConflicts.AppendItem (DG_TVI_ROOT);
-		treeConflicts.SetItemText (secItem,
-			GS::UniString::Printf ("Conflicts (%d)", conflictCount));
-		treeConflicts.SetItemTextColor (secItem, kColorConflict);
-		conflictRootItems.Push (secItem);
-
-		for (UInt32 i = 0; i < diffEntries.GetSize (); i++) {
-			if (diffEntries[i].status == DiffStatus::Conflict) {
-				Int32 child = treeConflicts.AppendItem (secItem);
-				GS::UniString label = diffEntries[i].id
-					+ "  P:\"" + diffEntries[i].projectName
-					+ "\"  S:\"" + diffEntries[i].serverName + "\"";
-				treeConflicts.SetItemText (child, label);
-				treeConflicts.SetItemTextColor (child, kColorConflict);
-				conflictItemToDiffIndex.Add (child, i);
-			}
-		}
-		treeConflicts.ExpandItem (secItem);
+	((side == SideProject) ? projectExpanded : serverExpanded).insert (key);
+	UpdateSideTree (side);
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: path of nodes from a root item down to the item with the given ID
+// ---------------------------------------------------------------------------
+
+static bool FindNodePath (const std::vector<ClassificationNode>& nodes,
+						  const std::string& id,
+						  std::vector<const ClassificationNode*>& path)
+{
+	for (const ClassificationNode& node : nodes) {
+		path.push_back (&node);
+		if (node.id == id || FindNodePath (node.children, id, path))
+			return true;
+		path.pop_back ();
 	}
+	return false;
+}
 
-	// Only in Project section
-	if (onlyProjCount > 0) {
-		Int32 secItem = treeConflicts.AppendItem (DG_TVI_ROOT);
-		treeConflicts.SetItemText (secItem,
-			GS::UniString::Printf ("Only in Project (%d)", onlyProjCount));
-		treeConflicts.SetItemTextColor (secItem, kColorNew);
-		conflictRootItems.Push (secItem);
-
-		for (UInt32 i = 0; i < diffEntries.GetSize (); i++) {
-			if (diffEntries[i].status == DiffStatus::OnlyInProject) {
-				Int32 child = treeConflicts.AppendItem (secItem);
-				GS::UniString label = diffEntries[i].id + "  -  " + diffEntries[i].projectName;
-				treeConflicts.SetItemText (child, label);
-				treeConflicts.SetItemTextColor (child, kColorNew);
-				conflictItemToDiffIndex.Add (child, i);
-			}
-		}
-		treeConflicts.ExpandItem (secItem);
+
+// ---------------------------------------------------------------------------
+// Materialize and expand the ancestors of an item; returns its tree item
+// ---------------------------------------------------------------------------
+
+Int32 ClassSyncPalette::RevealItem (const std::string& id, TreeSide side)
+{
+	const std::vector<ClassificationTree>&  data  = (side == SideProject) ? projectData : serverData;
+	std::unordered_map<std::string, Int32>& idMap = (side == SideProject) ? projectIdToTreeItem : serverIdToTreeItem;
+	std::set<std::string>& expanded = (side == SideProject) ? projectExpanded : serverExpanded;
+	DG::SingleSelTreeView& tree     = (side == SideProject) ? treeProject : treeServer;
+
+	auto found = idMap.find (id);
+	if (found != idMap.end ())
+		return found->second;
+
+	std::vector<const ClassificationNode*> path;
+	std::string systemKey;
+	for (size_t s = 0; s < data.size () && path.empty (); s++) {
+		if (FindNodePath (data[s].rootItems, id, path))
+			systemKey = data[s].systemName;
+	}
+	if (path.empty ())
+		return 0;
+
+	// One update materializes the whole path
+	for (size_t i = 0; i + 1 < path.size (); i++)
+		expanded.insert (BranchKey (systemKey, path[i]->id));
+	UpdateSideTree (side);
+
+	for (size_t i = 0; i + 1 < path.size (); i++) {
+		auto ancestor = idMap.find (path[i]->id);
+		if (ancestor != idMap.end ())
+			tree.ExpandItem (ancestor->second);
 	}
 
-	// Only on Server section
-	if (onlyServCount > 0) {
-		Int32 secItem = treeConflicts.AppendItem (DG_TVI_ROOT);
-		treeConflicts.SetItemText (secItem,
-			GS::UniString::Printf ("Only on Server (%d)", onlyServCount));
-		treeConflicts.SetItemTextColor (secItem, kColorMissing);
-		conflictRootItems.Push (secItem);
-
-		for (UInt32 i = 0; i < diffEntries.GetSize (); i++) {
-			if (diffEntries[i].status == DiffStatus::OnlyInServer) {
-				Int32 child = treeConflicts.AppendItem (secItem);
-				GS::UniString label = diffEntries[i].id + "  -  " + diffEntries[i].serverName;
-				treeConflicts.SetItemText (child, label);
-				treeConflicts.SetItemTextColor (child, kColorMissing);
-				conflictItemToDiffIndex.Add (child, i);
-			}
-		}
-		treeConflicts.ExpandItem (secItem);
+	found = idMap.find (id);
+	return found != idMap.end () ? found->second : 0;
+}
+
+
+// ---------------------------------------------------------------------------
+// Populate Project tree (left panel)
+// ---------------------------------------------------------------------------
+
+void ClassSyncPalette::PopulateProjectTree ()
+{
+	TraceScope trace ("PopulateProjectTree");
+	SummarizeSide (SideProject);
+	UpdateSideTree (SideProject);
+
+	UInt32 itemCount = 0;
+	for (const ClassificationTree& tree : projectData)
+		itemCount += CountNodes (tree.rootItems);
+	SetCounter (Counter::ProjectItems, itemCount);
+
+	GS::UniString status = GS::UniString::Printf ("%d systems, %d items",
+		(int)projectData.size (), itemCount);
+	countProject.SetText (status);
+}
+
+
+// ---------------------------------------------------------------------------
+// Populate Server tree (right panel)
+// ---------------------------------------------------------------------------
+
+void ClassSyncPalette::PopulateServerTree ()
+{
+	TraceScope trace ("PopulateServerTree");
+	SummarizeSide (SideServer);
+	UpdateSideTree (SideServer);
+
+	UInt32 itemCount = 0;
+	for (const ClassificationTree& tree : serverData)
+		itemCount += CountNodes (tree.rootItems);
+	SetCounter (Counter::ServerItems, itemCount);
+
+	GS::UniString status = GS::UniString::Printf ("%d systems, %d items",
+		(int)serverData.size (), itemCount);
+	countServer.SetText (status);
+}
+
+
+// ---------------------------------------------------------------------------
+// Populate Conflicts tree (center panel)
+// ---------------------------------------------------------------------------
+
+// Entry nodes carry their diff index as tag; sections and groups have none
+static void CollectDiffItems (const ViewNode& parent, GS::HashTable<Int32, UInt32>& itemToDiffIndex)
+{
+	for (const ViewNode& node : parent.children) {
+		if (node.tag >= 0)
+			itemToDiffIndex.Put (node.item, (UInt32)node.tag);
+		else
+			CollectDiffItems (node, itemToDiffIndex);
 	}
+}
 
-	treeConflicts.EnableDraw ();
-	treeConflicts.Redraw ();
 
-	GS::UniString status = GS::UniString::Printf ("%d differences", totalDiffs);
-	countConflicts.SetText (status);
+void ClassSyncPalette::PopulateConflictsTree ()
+{
+	TraceScope trace ("PopulateConflictsTree");
+	ViewNode next;
+	BuildConflictsView (next);
+	UpdateTree (treeConflicts, conflictsView, next, "Differences");
+
+	conflictItemToDiffIndex.Clear ();
+	CollectDiffItems (conflictsView, conflictItemToDiffIndex);
 }
 
 
@@ -936,54 +1546,685 @@ void ClassSyncPalette::SetStatus (const GS::UniString& text)
 
 void ClassSyncPalette::RefreshData ()
 {
-	if (xmlFilePath.IsEmpty ()) {
-		ACAPI_WriteReport ("ClassSync: No XML path set", false);
+	if (xmlFilePath.empty ()) {
+		CS_LOG_WARNING ("ClassSync: No XML path set");
 		countServer.SetText ("No XML file");
 		return;
 	}
 
-	std::string pathUtf8 (xmlFilePath.ToCStr (0, MaxUSize, CC_UTF8).Get ());
+	TraceScope trace ("RefreshData");
+	CS_LOG_DEBUG ("ClassSync v%s: RefreshData starting...", kClassSyncVersion);
+	CS_LOG_DEBUG ("ClassSync: XML path = %s", xmlFilePath.c_str ());
+	AddCounter (Counter::Refreshes);
+	refreshCounters = TakeCounterSnapshot ();
 
-	ACAPI_WriteReport ("ClassSync v%s: RefreshData starting...", false, kClassSyncVersion);
-	ACAPI_WriteReport ("ClassSync: XML path = %s", false, pathUtf8.c_str ());
+	ConnectSyncService ();
 
-	// Read project data
+	// Read project data (ACAPI: UI thread only)
 	SetStatus ("Reading project...");
-	projectData = ReadProjectClassifications ();
-	ACAPI_WriteReport ("ClassSync: Project: %d systems", false, (int)projectData.GetSize ());
+	RefreshRequest request;
+	request.masterPath  = xmlFilePath;
+	{
+		MemoryStage memory ("read project");
+		request.projectData = ReadProjectClassifications ();
+		projectProperties   = ReadProjectPropertyDefinitions (request.projectData);
+	}
+	request.projectProperties = projectProperties;
+	SetCounter (Counter::AcapiCallsLastRefresh,
+				GetCounter (Counter::AcapiClassificationCalls) - refreshCounters.Get (Counter::AcapiClassificationCalls) +
+				GetCounter (Counter::AcapiPropertyCalls) - refreshCounters.Get (Counter::AcapiPropertyCalls));
+	request.shardCache  = shardCache;
+	request.catalogCache = catalogCache;
+	request.syncClient  = syncClient;
+	request.shownProjectHash  = projectHash;
+	request.shownServerHash   = serverHash;
+	request.shownPropertyHash = propertyHash;
+	CS_LOG_DEBUG ("ClassSync: Project: %d systems", (int)request.projectData.size ());
+
+	// Master read + diff run on the worker; the result arrives in PanelIdle
+	fullRefreshPending = true;
+	refreshWorker.Submit (std::move (request));
+	ShowRefreshProgress ();
+}
+
 
-	// Read server data
-	SetStatus ("Reading XML...");
-	serverData  = ReadXmlClassifications (pathUtf8.c_str ());
-	ACAPI_WriteReport ("ClassSync: Server: %d systems", false, (int)serverData.GetSize ());
+// ---------------------------------------------------------------------------
+// Background refresh: progress while running, results on completion
+// ---------------------------------------------------------------------------
+
+void ClassSyncPalette::ShowRefreshProgress ()
+{
+	unsigned percent = refreshWorker.GetProgress () / 10;
+	bool comparing   = refreshWorker.GetStage () == RefreshStage::Comparing;
+
+	unsigned shown = (comparing ? 1000 : 0) + percent;
+	if (shown == shownRefreshProgress)
+		return;
+	shownRefreshProgress = shown;
+
+	SetStatus (GS::UniString::Printf ("%s... %u%%", comparing ? "Comparing" : "Reading master", percent));
+}
+
+
+void ClassSyncPalette::ApplyRefreshResult (RefreshResult& result)
+{
+	TraceScope trace ("ApplyRefreshResult");
+	MemoryStage memory ("apply refresh result");
+	shownRefreshProgress = kNoRefreshProgress;
+
+	// Worker lines that passed the echo level (already in the log)
+	for (const std::string& note : result.notes)
+		WriteReportLine (note);
+
+	if (!result.serverOnly) {
+		// Back to the live master after a point-in-time compare
+		historicalKey.clear ();
+		labelServer.SetText ("Server (XML)");
+		fullRefreshPending = false;
+	}
+
+	if (result.projectChanged) {
+		projectData = std::move (result.projectData);
+		projectHash = result.projectHash;
+	}
+
+	// The version always follows the file (optimistic commits compare it)
+	if (result.serverOnly && result.serverVersion != serverVersion)
+		CS_LOG_INFO ("ClassSync: Master changed on disk, version %s -> %s",
+					 MasterVersionToString (serverVersion).c_str (),
+					 MasterVersionToString (result.serverVersion).c_str ());
+	serverVersion = result.serverVersion;
+	shardCache    = std::move (result.shardCache);
+	catalogCache  = std::move (result.catalogCache);
+
+	if (result.serverChanged) {
+		serverData = std::move (result.serverData);
+		serverHash = result.serverHash;
+		if (!result.serverOnly)
+			CS_LOG_DEBUG ("ClassSync: Server: %d systems, version %s",
+						  (int)serverData.size (), MasterVersionToString (serverVersion).c_str ());
+		SnapshotMasterIfDue ();
+	}
 
+	if (result.diffChanged)
+		diffEntries = std::move (result.diffEntries);
+	if (result.propertiesChanged) {
+		propertyDrift = std::move (result.propertyDrift);
+		propertyHash  = result.propertyHash;
+	}
+	ApplyDiff ();
+
+	// Lock changes are pushed by the watcher; re-read only without one
+	if (!result.serverOnly && !masterWatcher.IsRunning ())
+		CheckLockStatus ();
+	UpdateActionButtons ();
+
+	CS_LOG_DEBUG ("ClassSync: %s done in %.1f ms (project %s, master %s%s, diff %s, property drift %s).",
+				  result.serverOnly ? "Master reload" : "RefreshData", result.seconds * 1000.0,
+				  result.serverOnly ? "not read" : (result.projectChanged ? "changed" : "unchanged"),
+				  result.masterReread ? (result.serverChanged ? "changed" : "re-read, unchanged") : "unchanged",
+				  result.fromService ? " via service" : "",
+				  result.diffChanged ? "recomputed" : "reused",
+				  result.propertiesChanged ? "changed" : "unchanged");
+
+	// What the refresh cost in file and ACAPI round trips (includes
+	// changelog writes that landed meanwhile)
+	if (IsLogged (LogLevel::Debug)) {
+		std::string activity = FormatCounterActivity (SubtractCounterSnapshot (TakeCounterSnapshot (), refreshCounters));
+		if (!activity.empty ())
+			CS_LOG_DEBUG ("ClassSync: I/O: %s", activity.c_str ());
+	}
+
+	memory.End ();
+	if (IsAllocationCounting () && IsLogged (LogLevel::Debug))
+		CS_LOG_DEBUG ("ClassSync: Memory by stage:\n%s", FormatStageMemory (GetStageMemory ()).c_str ());
+
+	trace.End ();
+	std::string tracePath = GetTraceFilePath ();
+	if (!tracePath.empty ())
+		WriteTraceJson (tracePath);
+}
+
+
+// ---------------------------------------------------------------------------
+// Diff both sides and repopulate the trees (project tree colors depend on it)
+// ---------------------------------------------------------------------------
+
+void ClassSyncPalette::RecomputeDiff ()
+{
 	// Run diff
 	SetStatus ("Comparing...");
 	diffEntries = CompareClassifications (projectData, serverData);
 
+	ApplyDiff ();
+}
+
+
+// Fingerprint of the statuses that color one side tree (items present on it)
+static std::uint64_t HashSideStatuses (const std::vector<DiffEntry>& entries, TreeSide side)
+{
+	DiffStatus onlyHere = (side == SideProject) ? DiffStatus::OnlyInProject : DiffStatus::OnlyInServer;
+
+	std::vector<DiffEntry> visible;
+	for (const DiffEntry& source : entries) {
+		if (source.status == onlyHere || source.status == DiffStatus::Conflict) {
+			DiffEntry entry;
+			entry.id     = source.id;
+			entry.status = source.status;
+			visible.push_back (entry);
+		}
+	}
+	return HashDiffEntries (visible);
+}
+
+
+static std::uint64_t CombineHashes (std::uint64_t a, std::uint64_t b)
+{
+	return (a ^ (b + 0x9E3779B97F4A7C15ULL + (a << 6) + (a >> 2))) | 1;
+}
+
+
+// Grouping takes the categories from both models
+std::uint64_t ClassSyncPalette::GetConflictsTreeKey () const
+{
+	std::uint64_t key = CombineHashes (diffHash, propertyHash);
+	if (!groupByCategory)
+		return key;
+	return CombineHashes (CombineHashes (key, projectHash), serverHash);
+}
+
+
+// ---------------------------------------------------------------------------
+// Tree update for the current diffEntries. Each tree is rebuilt only when the
+// fingerprints of its inputs changed: side trees depend on their model and
+// on the statuses of their items, the Differences tree on the whole diff.
+// ---------------------------------------------------------------------------
+
+void ClassSyncPalette::ApplyDiff ()
+{
+	TraceScope trace ("ApplyDiff");
+	MemoryStage memory ("apply diff");
 	UInt32 matches = 0, conflicts = 0, onlyProj = 0, onlyServ = 0;
-	for (UInt32 i = 0; i < diffEntries.GetSize (); i++) {
-		switch (diffEntries[i].status) {
+	for (const DiffEntry& entry : diffEntries) {
+		switch (entry.status) {
 			case DiffStatus::Match:         matches++;   break;
 			case DiffStatus::Conflict:      conflicts++; break;
 			case DiffStatus::OnlyInProject: onlyProj++;  break;
 			case DiffStatus::OnlyInServer:  onlyServ++;  break;
 		}
 	}
-	ACAPI_WriteReport ("ClassSync: Diff: %d match, %d conflict, %d only-project, %d only-server",
-		false, matches, conflicts, onlyProj, onlyServ);
+	SetCounter (Counter::DiffMatches,       matches);
+	SetCounter (Counter::DiffConflicts,     conflicts);
+	SetCounter (Counter::DiffOnlyInProject, onlyProj);
+	SetCounter (Counter::DiffOnlyInServer,  onlyServ);
+	SetCounter (Counter::PropertyDrift,     propertyDrift.size ());
+
+	std::uint64_t newDiffHash = HashDiffEntries (diffEntries);
+	if (newDiffHash != diffHash) {
+		diffStatusById.clear ();
+		for (const DiffEntry& entry : diffEntries) {
+			if (entry.status != DiffStatus::Match)
+				diffStatusById[entry.id] = entry.status;
+		}
+		CS_LOG_DEBUG ("ClassSync: Diff: %d match, %d conflict, %d only-project, %d only-server",
+					  matches, conflicts, onlyProj, onlyServ);
+
+		diffHash          = newDiffHash;
+		projectStatusHash = HashSideStatuses (diffEntries, SideProject);
+		serverStatusHash  = HashSideStatuses (diffEntries, SideServer);
+	}
+
+	std::uint64_t projectKey = CombineHashes (projectHash, projectStatusHash);
+	std::uint64_t serverKey  = CombineHashes (serverHash, serverStatusHash);
 
 	// Populate trees
-	SetStatus ("Updating trees...");
-	PopulateProjectTree ();
-	PopulateServerTree ();
-	PopulateConflictsTree ();
+	if (projectKey != projectTreeKey || serverKey != serverTreeKey || GetConflictsTreeKey () != conflictsTreeKey)
+		SetStatus ("Updating trees...");
+
+	if (projectKey != projectTreeKey) {
+		PopulateProjectTree ();
+		projectTreeKey = projectKey;
+	}
+	if (serverKey != serverTreeKey) {
+		PopulateServerTree ();
+		serverTreeKey = serverKey;
+	}
+	if (GetConflictsTreeKey () != conflictsTreeKey) {
+		PopulateConflictsTree ();
+		conflictsTreeKey = GetConflictsTreeKey ();
+	}
+
+	if (propertyDrift.empty ())
+		countConflicts.SetText (GS::UniString::Printf ("%d differences", conflicts + onlyProj + onlyServ));
+	else
+		countConflicts.SetText (GS::UniString::Printf ("%d differences, %d property mappings", conflicts + onlyProj + onlyServ,
+													   (int)propertyDrift.size ()));
+}
+
+
+// ---------------------------------------------------------------------------
+// Server-only refresh: master content changed, project unchanged
+// ---------------------------------------------------------------------------
+
+void ClassSyncPalette::RefreshServerData ()
+{
+	// A reconstructed master stays on screen until Refresh
+	if (xmlFilePath.empty () || !historicalKey.empty ())
+		return;
+
+	// A full refresh in flight may have read the old master: redo it
+	if (fullRefreshPending) {
+		RefreshData ();
+		return;
+	}
+
+	RefreshRequest request;
+	request.masterPath   = xmlFilePath;
+	request.projectData  = projectData;
+	request.projectProperties = projectProperties;
+	request.shardCache   = shardCache;
+	request.catalogCache = catalogCache;
+	request.syncClient   = syncClient;
+	request.serverOnly   = true;
+	request.shownProjectHash  = projectHash;
+	request.shownServerHash   = serverHash;
+	request.shownPropertyHash = propertyHash;
+	refreshCounters = TakeCounterSnapshot ();
+	refreshWorker.Submit (std::move (request));
+}
+
+
+// ---------------------------------------------------------------------------
+// Point-in-time compare: snapshots + changelog replay
+// ---------------------------------------------------------------------------
+
+void ClassSyncPalette::SnapshotMasterIfDue ()
+{
+	if (WriteMasterSnapshotIfDue (GetChangeLogDirectory (xmlFilePath), serverData, serverVersion, kSnapshotIntervalSec))
+		CS_LOG_DEBUG ("ClassSync: Master snapshot written, version %s",
+					  MasterVersionToString (serverVersion).c_str ());
+}
+
+
+void ClassSyncPalette::ShowMasterAt (const std::string& atKey)
+{
+	if (xmlFilePath.empty ()) return;
+
+	// A background refresh would replace the reconstructed master
+	refreshWorker.Cancel ();
+	fullRefreshPending   = false;
+	shownRefreshProgress = kNoRefreshProgress;
+
+	// Records of our own recent edits may still be queued
+	FlushChangeLog ();
+
+	std::vector<ClassificationTree> past;
+	std::string  error;
+
+	// Exact bytes from the version store when it has a version by then,
+	// otherwise snapshot + changelog replay
+	std::string   storeDir = GetMasterStoreDir (GetChangeLogDirectory (xmlFilePath));
+	StoredVersion stored;
+	std::string   content;
+	if (FindStoredVersionAt (storeDir, atKey, stored) &&
+		MaterializeStoredVersion (storeDir, stored.number, content, error) &&
+		ParseXmlClassifications (content, past))
+	{
+		CS_LOG_INFO ("ClassSync: Master at %s = stored version %u of %s",
+					 atKey.c_str (), stored.number, stored.time.c_str ());
+	} else {
+		if (!error.empty ())
+			CS_LOG_WARNING ("ClassSync: Stored version unusable, replaying the changelog: %s", error.c_str ());
+
+		ReplayResult result;
+		if (!ReconstructMasterAt (GetChangeLogDirectory (xmlFilePath), atKey, past, result, error)) {
+			CS_LOG_WARNING ("ClassSync: Cannot reconstruct master at %s: %s", atKey.c_str (), error.c_str ());
+			DGAlert (DG_WARNING, "ClassSync", "Cannot reconstruct master",
+					 FromUtf8 (error), "OK");
+			return;
+		}
+
+		CS_LOG_INFO ("ClassSync: Master at %s = snapshot %s + %u records (%u skipped)",
+					 atKey.c_str (), result.snapshotKey.c_str (), result.recordsApplied, result.recordsSkipped);
+	}
+
+	serverData    = std::move (past);
+	serverHash    = HashClassifications (serverData);
+	historicalKey = atKey;
+	labelServer.SetText (GS::UniString ("Server (XML) as of ") + FromUtf8 (atKey));
 
-	// Check lock status (may have changed since last refresh)
-	CheckLockStatus ();
+	RecomputeDiff ();
 	UpdateActionButtons ();
+}
+
+
+// ---------------------------------------------------------------------------
+// Watcher: (re)start watching the directory of the current master
+// ---------------------------------------------------------------------------
+
+void ClassSyncPalette::StartWatching ()
+{
+	masterWatcher.Stop ();
+	pendingChanges = MasterChangeNone;
+
+	if (xmlFilePath.empty ())
+		return;
+
+	// Shards and the masters of a catalog in its folder are watched with it;
+	// others are picked up on Refresh
+	std::vector<std::string> contentFiles;
+	std::vector<std::string> catalogMasters;
+	if (IsShardedMaster (xmlFilePath.c_str ())) {
+		ReadShardFileNames (xmlFilePath.c_str (), contentFiles);
+	} else if (IsMasterCatalog (xmlFilePath.c_str ()) && ReadMasterCatalog (xmlFilePath.c_str (), catalogMasters)) {
+		std::string dir = xmlFilePath.substr (0, xmlFilePath.find_last_of ("/\\") + 1);
+		for (const std::string& path : catalogMasters) {
+			if (path.size () > dir.size () && path.compare (0, dir.size (), dir) == 0 &&
+				path.find_first_of ("/\\", dir.size ()) == std::string::npos)
+			{
+				contentFiles.push_back (path.substr (dir.size ()));
+			}
+		}
+	}
+
+	bool started = masterWatcher.Start (xmlFilePath, kWatcherDebounceMs,
+		[this] (unsigned changes) {
+			pendingChanges.fetch_or (changes);
+		},
+		contentFiles);
+
+	if (!started)
+		CS_LOG_WARNING ("ClassSync: Cannot watch XML folder, use Refresh to update");
+}
+
+
+// ---------------------------------------------------------------------------
+// Watcher: targeted reload of whatever changed on disk
+// ---------------------------------------------------------------------------
+
+void ClassSyncPalette::ApplyMasterChanges (unsigned changes)
+{
+	if (changes & MasterChangeContent)
+		RefreshServerData ();
+
+	if (changes & MasterChangeLock) {
+		CheckLockStatus ();
+		UpdateActionButtons ();
+	}
+
+	// MasterChangeChangelog: nothing to do here - the history index picks up
+	// appended records on the next History query
+}
+
+
+// ---------------------------------------------------------------------------
+// ID of the selected item: Differences tree first, then Project, then Server
+// ---------------------------------------------------------------------------
+
+std::string ClassSyncPalette::GetSelectedItemId () const
+{
+	Int32 selected = treeConflicts.GetSelectedItem ();
+	UInt32 diffIdx;
+	if (selected != 0 && conflictItemToDiffIndex.Get (selected, &diffIdx))
+		return diffEntries[diffIdx].id;
+
+	// Side tree labels are "ID  -  Name"; system rows have no separator
+	const DG::SingleSelTreeView* sideTrees[] = { &treeProject, &treeServer };
+	for (const DG::SingleSelTreeView* tree : sideTrees) {
+		selected = tree->GetSelectedItem ();
+		if (selected == 0 || selected == DG::TreeView::RootItem)
+			continue;
+		std::string label = ToUtf8 (tree->GetItemText (selected));
+		size_t sep = label.find ("  -  ");
+		if (sep != std::string::npos)
+			return label.substr (0, sep);
+	}
+
+	return std::string ();
+}
+
+
+// ---------------------------------------------------------------------------
+// Show the changelog history of the selected item
+// ---------------------------------------------------------------------------
+
+static std::string FormatHistoryEntry (const HistoryEntry& e)
+{
+	std::string line = e.date + " " + e.time + "  " + e.user + "  ";
+	if (e.action == "export")
+		line += "Export \"" + e.newValue + "\"" + (e.parentId.empty () ? "" : " under " + e.parentId);
+	else if (e.action == "use-project")
+		line += "Use Project \"" + e.oldValue + "\" -> \"" + e.newValue + "\"";
+	else if (e.action == "use-server")
+		line += "Use Server \"" + e.oldValue + "\" -> \"" + e.newValue + "\"";
+	else
+		line += e.action;
+	return line;
+}
+
+
+void ClassSyncPalette::DoShowHistory ()
+{
+	if (xmlFilePath.empty ()) return;
+
+	std::string itemId = GetSelectedItemId ();
+	if (itemId.empty ()) {
+		DGAlert (DG_INFORMATION, "ClassSync", "No item selected",
+				 "Select a classification item to see its history.", "OK");
+		return;
+	}
+
+	// Our own records may still be queued
+	FlushChangeLog ();
+
+	std::string logDir = GetChangeLogDirectory (xmlFilePath);
+
+	auto start = std::chrono::steady_clock::now ();
+	historyIndex.Update (logDir);
+	std::vector<HistoryEntry> entries = historyIndex.Query (itemId);
+	long long elapsedMs = (long long)std::chrono::duration_cast<std::chrono::milliseconds> (
+		std::chrono::steady_clock::now () - start).count ();
+
+	CS_LOG_INFO ("ClassSync: History of %s - %d entries (%d day files, %d items indexed, %lld ms)",
+				 itemId.c_str (), (int)entries.size (), (int)historyIndex.GetFileCount (),
+				 (int)historyIndex.GetItemCount (), elapsedMs);
+	for (const HistoryEntry& e : entries)
+		CS_LOG_INFO ("  %s", FormatHistoryEntry (e).c_str ());
+
+	std::string text;
+	if (entries.empty ()) {
+		text = "No changelog entries for this item.";
+	} else {
+		size_t first = entries.size () > kHistoryAlertEntries ? entries.size () - kHistoryAlertEntries : 0;
+		if (first > 0)
+			text += std::to_string (first) + " older entries in the report window\n";
+		for (size_t i = first; i < entries.size (); i++)
+			text += FormatHistoryEntry (entries[i]) + "\n";
+	}
+
+	DGAlert (DG_INFORMATION, "ClassSync", FromUtf8 ("History of " + itemId), FromUtf8 (text), "OK");
+}
+
+
+// ---------------------------------------------------------------------------
+// Diagnostics: counters (I/O, ACAPI calls, data sizes), refresh spans and the
+// session log, shown and dumped to files
+// ---------------------------------------------------------------------------
+
+void ClassSyncPalette::StartLogging ()
+{
+	const char* value = std::getenv ("CLASSSYNC_LOG");
+	LogLevel level = LogLevel::Info;
+	if (value != nullptr && !ParseLogLevel (value, level))
+		CS_LOG_WARNING ("ClassSync: Unknown CLASSSYNC_LOG level '%s' (debug, info, warning, error, off)", value);
+	SetLogEchoLevel (level);
+
+	const char* path = std::getenv ("CLASSSYNC_LOG_FILE");
+	if (path == nullptr || *path == '\0')
+		return;
+	if (StartLogFile (path))
+		CS_LOG_INFO ("ClassSync: Log is written to %s", path);
+	else
+		CS_LOG_WARNING ("ClassSync: Cannot open log file %s", path);
+}
+
+
+void ClassSyncPalette::StartTracing ()
+{
+	const char* value = std::getenv ("CLASSSYNC_TRACE");
+	std::string setting = value != nullptr ? value : "";
+	if (setting == "0" || setting == "off")
+		return;
 
-	ACAPI_WriteReport ("ClassSync: RefreshData done.", false);
+	SetTraceEnabled (true);
+	SetTraceThreadName ("UI");
+	if (!GetTraceFilePath ().empty ())
+		CS_LOG_INFO ("ClassSync: Trace is written to %s after every refresh", setting.c_str ());
+}
+
+
+std::string ClassSyncPalette::GetTraceFilePath ()
+{
+	const char* value = std::getenv ("CLASSSYNC_TRACE");
+	std::string setting = value != nullptr ? value : "";
+	if (setting == "0" || setting == "off" || setting == "1" || setting == "on")
+		return "";
+	return setting;
+}
+
+
+void ClassSyncPalette::StartMemoryAccounting ()
+{
+	const char* value = std::getenv ("CLASSSYNC_MEMORY");
+	std::string setting = value != nullptr ? value : "";
+	if (setting != "1" && setting != "on")
+		return;
+
+	SetAllocationCounting (true);
+	CS_LOG_INFO ("ClassSync: Allocation counting is on");
+}
+
+
+std::string ClassSyncPalette::GetSyncServiceAddress ()
+{
+	const char* value = std::getenv ("CLASSSYNC_SERVICE");
+	std::string setting = value != nullptr ? value : "";
+	if (setting.empty () || setting == "0" || setting == "off")
+		return "";
+	if (setting == "1" || setting == "on")
+		return "127.0.0.1:" + std::to_string (kSyncDefaultPort);
+	return setting;
+}
+
+
+// (Re)connect before a full refresh; the worker and the commits fall back
+// to the file while there is no connection
+void ClassSyncPalette::ConnectSyncService ()
+{
+	std::string address = GetSyncServiceAddress ();
+	if (address.empty () || IsShardedMaster (xmlFilePath.c_str ()) || IsMasterCatalog (xmlFilePath.c_str ())) {
+		syncClient.reset ();
+		return;
+	}
+	if (syncClient != nullptr && syncClient->IsConnected () && syncClient->GetMasterPath () == xmlFilePath)
+		return;
+
+	if (syncClient == nullptr)
+		syncClient = std::make_shared<SyncClient> ();
+	if (syncClient->Connect (address, xmlFilePath))
+		CS_LOG_INFO ("ClassSync: Master is synced through the service at %s", address.c_str ());
+	else
+		CS_LOG_DEBUG ("ClassSync: No sync service at %s - using the master file", address.c_str ());
+}
+
+
+// Heap held by the palette's data (estimates, see MemoryStats.hpp)
+std::string ClassSyncPalette::FormatResidentSizes () const
+{
+	struct Row {
+		const char*    name;
+		std::uint64_t  bytes;
+	};
+	const Row rows[] = {
+		{ "project model",     EstimateModelBytes (projectData) },
+		{ "server model",      EstimateModelBytes (serverData) },
+		{ "diff entries",      EstimateDiffBytes (diffEntries) },
+		{ "shard cache",       EstimateShardCacheBytes (shardCache) },
+		{ "catalog cache",     EstimateCatalogCacheBytes (catalogCache) },
+		{ "tree views",        EstimateViewBytes (projectView) + EstimateViewBytes (serverView) + EstimateViewBytes (conflictsView) },
+		{ "item maps",         EstimateMapBytes (projectIdToTreeItem) + EstimateMapBytes (serverIdToTreeItem) + EstimateMapBytes (diffStatusById) },
+		{ "side summaries",    EstimateMapBytes (projectSummary.counts) + EstimateMapBytes (projectSummary.category) +
+							   EstimateMapBytes (serverSummary.counts) + EstimateMapBytes (serverSummary.category) },
+		{ "expanded branches", EstimateSetBytes (projectExpanded) + EstimateSetBytes (serverExpanded) }
+	};
+
+	std::string text;
+	std::uint64_t total = 0;
+	for (const Row& row : rows) {
+		text += std::string (row.name) + ": " + FormatByteSize ((std::int64_t)row.bytes) + "\n";
+		total += row.bytes;
+	}
+	return text + "total: " + FormatByteSize ((std::int64_t)total) + "\n";
+}
+
+
+void ClassSyncPalette::DoShowDiagnostics ()
+{
+	CounterSnapshot counters = TakeCounterSnapshot ();
+	std::string lines = FormatCounterLines (counters);
+	CS_LOG_INFO ("ClassSync: Diagnostics\n%s", lines.c_str ());
+
+	std::string memory = "\nResident (estimated):\n" + FormatResidentSizes ();
+	if (IsAllocationCounting ()) {
+		AllocationStats heap = GetHeapTotals ();
+		memory += "\nAllocations by stage:\n" + FormatStageMemory (GetStageMemory ());
+		memory += "heap: " + FormatByteSize (heap.netBytes) + " held, " + FormatByteSize (heap.peakBytes) + " peak\n";
+	} else {
+		memory += "(allocation counting is off: CLASSSYNC_MEMORY=1)\n";
+	}
+	CS_LOG_INFO ("ClassSync: Memory%s", memory.c_str ());
+	lines += memory;
+
+	std::string service = "\nSync service: ";
+	if (syncClient != nullptr && syncClient->IsConnected ())
+		service += "connected to " + syncClient->GetAddress () + "\n";
+	else if (syncClient != nullptr)
+		service += "not reachable at " + syncClient->GetAddress () + ", using the master file\n";
+	else
+		service += "off (CLASSSYNC_SERVICE)\n";
+	lines += service;
+
+	std::string stamp = FormatTimeKey ((std::int64_t)std::time (nullptr));
+	std::replace (stamp.begin (), stamp.end (), ':', '-');
+
+	std::error_code ec;
+	std::filesystem::path dir = std::filesystem::temp_directory_path (ec);
+	std::string countersPath = (dir / ("ClassSync-counters-" + stamp + ".json")).u8string ();
+	std::string tracePath    = (dir / ("ClassSync-trace-" + stamp + ".json")).u8string ();
+	std::string logPath      = (dir / ("ClassSync-log-" + stamp + ".txt")).u8string ();
+
+	std::string saved;
+	if (!ec && WriteCountersJson (countersPath, counters))
+		saved += "\n" + countersPath;
+	else
+		CS_LOG_WARNING ("ClassSync: Cannot write counters to %s", countersPath.c_str ());
+
+	if (!ec && WriteLogLines (logPath))
+		saved += "\n" + logPath;
+	else
+		CS_LOG_WARNING ("ClassSync: Cannot write log to %s", logPath.c_str ());
+
+	if (!IsTraceEnabled ())
+		saved += "\n(tracing is off: CLASSSYNC_TRACE=0)";
+	else if (!ec && WriteTraceJson (tracePath))
+		saved += "\n" + tracePath + "\nOpen the trace in ui.perfetto.dev or chrome://tracing.";
+	else
+		CS_LOG_WARNING ("ClassSync: Cannot write trace to %s", tracePath.c_str ());
+
+	if (!saved.empty ())
+		CS_LOG_INFO ("ClassSync: Diagnostics saved:%s", saved.c_str ());
+	DGAlert (DG_INFORMATION, "ClassSync", "Diagnostics",
+			 FromUtf8 (lines + (saved.empty () ? "" : "\nSaved:" + saved)), "OK");
 }
 
 
@@ -993,7 +2234,7 @@ void ClassSyncPalette::RefreshData ()
 
 void ClassSyncPalette::DoToggleLock ()
 {
-	if (xmlFilePath.IsEmpty ()) return;
+	if (xmlFilePath.empty ()) return;
 
 	if (writeMode) {
 		// Release our lock
@@ -1001,7 +2242,7 @@ void ClassSyncPalette::DoToggleLock ()
 		writeMode = false;
 		buttonLock.SetText ("Open for write");
 		labelWriteMode.Hide ();
-		ACAPI_WriteReport ("ClassSync: Write lock released", false);
+		CS_LOG_INFO ("ClassSync: Write lock released");
 		UpdateActionButtons ();
 		return;
 	}
@@ -1010,10 +2251,11 @@ void ClassSyncPalette::DoToggleLock ()
 	LockInfo info = GetLockInfo (xmlFilePath);
 	if (info.locked) {
 		// Someone else holds the lock - show alert
-		GS::UniString msg = "Database is locked by " + info.user
+		lockedByOther = true;
+		std::string msg = "Database is locked by " + info.user
 			+ " since " + info.time
-			+ "\nClick Refresh to check if it becomes available.";
-		DGAlert (DG_INFORMATION, "ClassSync", "Database is locked", msg, "OK");
+			+ "\nThe palette will update when it is released.";
+		DGAlert (DG_INFORMATION, "ClassSync", "Database is locked", FromUtf8 (msg), "OK");
 		return;
 	}
 
@@ -1021,10 +2263,10 @@ void ClassSyncPalette::DoToggleLock ()
 		writeMode = true;
 		buttonLock.SetText ("Close write");
 		labelWriteMode.Show ();
-		ACAPI_WriteReport ("ClassSync: Write lock acquired", false);
+		CS_LOG_INFO ("ClassSync: Write lock acquired");
 		UpdateActionButtons ();
 	} else {
-		ACAPI_WriteReport ("ClassSync: Failed to acquire write lock", false);
+		CS_LOG_WARNING ("ClassSync: Failed to acquire write lock");
 	}
 }
 
@@ -1035,15 +2277,19 @@ void ClassSyncPalette::DoToggleLock ()
 
 void ClassSyncPalette::CheckLockStatus ()
 {
-	if (xmlFilePath.IsEmpty ()) {
-		writeMode = false;
+	if (xmlFilePath.empty ()) {
+		writeMode     = false;
+		lockedByOther = false;
 		buttonLock.Disable ();
 		return;
 	}
 
 	buttonLock.Enable ();
 
-	if (IsLockedByUs (xmlFilePath)) {
+	LockInfo info = GetLockInfo (xmlFilePath);
+	lockedByOther = info.locked && !IsOwnLock (info);
+
+	if (IsOwnLock (info)) {
 		writeMode = true;
 		buttonLock.SetText ("Close write");
 		labelWriteMode.Show ();
@@ -1064,6 +2310,6 @@ void ClassSyncPalette::ReleaseLockIfHeld ()
 	if (instance != nullptr && instance->writeMode) {
 		ReleaseLock (xmlFilePath);
 		instance->writeMode = false;
-		ACAPI_WriteReport ("ClassSync: Write lock auto-released", false);
+		CS_LOG_INFO ("ClassSync: Write lock auto-released");
 	}
 }
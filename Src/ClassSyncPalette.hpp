@@ -7,6 +7,23 @@
 #include "Color.hpp"
 #include "HashTable.hpp"
 #include "ClassificationData.hpp"
+#include "Counters.hpp"
+#include "MasterVersion.hpp"
+#include "XmlWriter.hpp"
+#include "MasterWatcher.hpp"
+#include "ShardedMaster.hpp"
+#include "MasterCatalog.hpp"
+#include "ChangeLogIndex.hpp"
+#include "TreeReconcile.hpp"
+#include "RefreshWorker.hpp"
+#include "SyncClient.hpp"
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 
 // ---------------------------------------------------------------------------
@@ -54,7 +71,10 @@ enum {
 	ItemButtonUseServer  = 17,
 	ItemLabelVersion     = 18,
 	ItemButtonLock       = 19,
-	ItemLabelWriteMode   = 20
+	ItemLabelWriteMode   = 20,
+	ItemButtonHistory    = 21,
+	ItemCheckGroup       = 22,
+	ItemButtonDiagnostics = 23
 };
 
 
@@ -68,6 +88,26 @@ enum TreeSide {
 };
 
 
+// ---------------------------------------------------------------------------
+// Differences below one side tree branch (descendants, not the branch itself)
+// ---------------------------------------------------------------------------
+
+struct SubtreeCounts {
+	UInt32  conflicts;
+	UInt32  onlyHere;		// only in Project (Project tree) / only on Server (Server tree)
+
+	SubtreeCounts () : conflicts (0), onlyHere (0) {}
+};
+
+// One bottom-up pass over a side tree: branch counts and item categories
+struct SideSummary {
+	std::unordered_map<std::string, SubtreeCounts>  counts;		// branches with differences only
+	std::unordered_map<std::string, UInt32>         category;		// item ID -> top-level item index
+	std::vector<std::string>                        categoryIds;
+	std::vector<std::string>                        categoryLabels;
+};
+
+
 // ---------------------------------------------------------------------------
 // Palette class
 // ---------------------------------------------------------------------------
@@ -75,6 +115,7 @@ enum TreeSide {
 class ClassSyncPalette : public DG::Palette,
 						 public DG::PanelObserver,
 						 public DG::ButtonItemObserver,
+						 public DG::CheckItemObserver,
 						 public DG::TreeViewObserver
 {
 public:
@@ -95,9 +136,15 @@ public:
 	static Int32      GetRefId ()        { return 'CSYN'; }
 	static GS::Guid   GetPaletteGuid ();
 
-	// Refresh all data
+	// Refresh all data (project read now, master read + diff in the background)
 	void  RefreshData ();
 
+	// Reload only the master side in the background (project read skipped)
+	void  RefreshServerData ();
+
+	// Compare against the master as it was at a time key (Refresh returns to live)
+	void  ShowMasterAt (const std::string& atKey);
+
 	// Preferences
 	static void  LoadPreferences ();
 	static void  SavePreferences ();
@@ -105,40 +152,98 @@ public:
 	// Lock management (called from FreeData)
 	static void  ReleaseLockIfHeld ();
 
+	// Session log: CLASSSYNC_LOG is the lowest level shown in the Report
+	// window (debug, info, warning, error, off; default info), and
+	// CLASSSYNC_LOG_FILE a file every logged line is appended to
+	static void  StartLogging ();
+
+	// Tracing: on unless CLASSSYNC_TRACE is "0"/"off"; any other value except
+	// "1"/"on" is a file the trace is written to after every refresh and on
+	// unload (empty = dump only with Diagnostics)
+	static void         StartTracing ();
+	static std::string  GetTraceFilePath ();
+
+	// Allocation counting per refresh stage: on when CLASSSYNC_MEMORY is
+	// "1"/"on" (Diagnostics and the debug log show the stage table)
+	static void  StartMemoryAccounting ();
+
+	// Sync service address from CLASSSYNC_SERVICE ("1"/"on" = this machine
+	// on the default port, or "host:port"); empty = the master file only
+	static std::string  GetSyncServiceAddress ();
+
 private:
 	// DG::PanelObserver
 	virtual void  PanelCloseRequested (const DG::PanelCloseRequestEvent& ev, bool* accepted) override;
 	virtual void  PanelResized (const DG::PanelResizeEvent& ev) override;
+	virtual void  PanelIdle (const DG::PanelIdleEvent& ev) override;
 
 	// DG::ButtonItemObserver
 	virtual void  ButtonClicked (const DG::ButtonClickEvent& ev) override;
 
+	// DG::CheckItemObserver
+	virtual void  CheckItemChanged (const DG::CheckItemChangeEvent& ev) override;
+
 	// DG::TreeViewObserver
 	virtual void  TreeViewSelectionChanged (const DG::TreeViewSelectionEvent& ev) override;
 	virtual void  TreeViewItemClicked (const DG::TreeViewItemClickEvent& ev, bool* denySelectionChange) override;
+	virtual void  TreeViewItemExpanded (const DG::TreeViewExpandEvent& ev) override;
 
 	// Tree population
 	void  PopulateProjectTree ();
 	void  PopulateServerTree ();
 	void  PopulateConflictsTree ();
 
-	static void  FillTreeWithNodes (DG::SingleSelTreeView& tree,
-									const GS::Array<ClassificationNode>& nodes,
-									Int32 parentItem,
-									UInt32& count,
-									const GS::Array<DiffEntry>& diffs,
-									TreeSide side,
-									GS::HashTable<GS::UniString, Int32>* idMap);
-
-	static DiffStatus  FindDiffStatus (const GS::Array<DiffEntry>& diffs,
-									   const GS::UniString& id);
+	// Trees are updated by reconciling a new view model with the displayed
+	// one. Side trees are lazy: a collapsed branch gets one placeholder child
+	// and its real children are created on first expand.
+	void   BuildSideNodes (const std::vector<ClassificationNode>& nodes,
+						   const std::string& systemKey,
+						   TreeSide side,
+						   ViewNode& parent) const;
+	void   BuildSideView (const std::vector<ClassificationTree>& data, TreeSide side, ViewNode& root) const;
+	void   BuildConflictsView (ViewNode& root) const;
+	void   UpdateTree (DG::TreeView& tree, ViewNode& displayed, ViewNode& next, const char* name);
+	void   UpdateSideTree (TreeSide side);
+	void   MaterializeBranch (TreeSide side, Int32 item);
+	Int32  RevealItem (const std::string& id, TreeSide side);
+
+	// Per-branch diff counts and top-level categories, linear in the tree size
+	void           SummarizeSide (TreeSide side);
+	SubtreeCounts  SummarizeNodes (const std::vector<ClassificationNode>& nodes,
+								   TreeSide side,
+								   UInt32 category,
+								   SideSummary& summary) const;
+	std::uint64_t  GetConflictsTreeKey () const;
+
+	DiffStatus  FindDiffStatus (const std::string& id) const;
 
 	void  SyncSideTreeSelection (const DiffEntry& entry);
 
 	// Status
 	void  SetStatus (const GS::UniString& text);
 
-	// Actions
+	// Background refresh: status line while running, install results when done
+	void  ShowRefreshProgress ();
+	void  ApplyRefreshResult (RefreshResult& result);
+
+	// Diff on the UI thread (point-in-time compare, local edits)
+	void  RecomputeDiff ();
+
+	// Tree update for the current diffEntries (unchanged trees are skipped)
+	void  ApplyDiff ();
+
+	// Snapshots for point-in-time compare live in the changelog/ next to the master
+	void  SnapshotMasterIfDue ();
+
+	// File-system watcher over the master's directory
+	void  StartWatching ();
+	void  ApplyMasterChanges (unsigned changes);
+
+	// Selected Differences entries of one status (sections and groups
+	// select everything below them), in diff order
+	GS::Array<UInt32>  GetSelectedDiffIndices (DiffStatus status) const;
+
+	// Actions (bulk: each applies to all selected entries of its status)
 	void  BrowseForXml ();
 	void  DoImportFromServer ();
 	void  DoExportToServer ();
@@ -147,13 +252,20 @@ private:
 	void  UpdateActionButtons ();
 	void  DoToggleLock ();
 	void  CheckLockStatus ();
+	UInt32  ReportEditResults (const char* action, const std::vector<MasterEdit>& edits, CommitResult result);
+	CommitResult  CommitMasterEdits (std::vector<MasterEdit>& edits);
+	void  ConnectSyncService ();
+	void  DoShowHistory ();
+	void  DoShowDiagnostics ();
+	std::string    FormatResidentSizes () const;
+	std::string    GetSelectedItemId () const;
 
 	// Controls (items 1-11, existing)
 	DG::LeftText            labelProject;
 	DG::LeftText            labelConflicts;
 	DG::LeftText            labelServer;
 	DG::SingleSelTreeView   treeProject;
-	DG::SingleSelTreeView   treeConflicts;
+	DG::MultiSelTreeView    treeConflicts;
 	DG::SingleSelTreeView   treeServer;
 	DG::LeftText            countProject;
 	DG::LeftText            countConflicts;
@@ -174,28 +286,105 @@ private:
 	DG::Button              buttonLock;
 	DG::LeftText            labelWriteMode;
 
+	// Controls (item 21, changelog history)
+	DG::Button              buttonHistory;
+
+	// Controls (item 22, Differences grouping)
+	DG::CheckBox            checkGroup;
+
+	// Controls (item 23, counters and trace dump)
+	DG::Button              buttonDiagnostics;
+
 	// Write mode (true = we hold the .lock file)
 	bool                    writeMode;
 
-	// Data
-	GS::Array<ClassificationTree>   projectData;
-	GS::Array<ClassificationTree>   serverData;
-	GS::Array<DiffEntry>            diffEntries;
+	// Another session holds the .lock file - master edits are refused
+	bool                    lockedByOther;
 
-	// Root items for clearing trees
-	GS::Array<Int32>  projectRootItems;
-	GS::Array<Int32>  serverRootItems;
-	GS::Array<Int32>  conflictRootItems;
+	// Data
+	std::vector<ClassificationTree> projectData;
+	std::vector<ClassificationTree> serverData;
+	std::vector<DiffEntry>          diffEntries;
+
+	// Custom property definitions of the project (read with projectData) and
+	// where their applicability differs from the master
+	std::vector<PropertyDefinitionInfo>  projectProperties;
+	std::vector<PropertyDrift>           propertyDrift;
+
+	// Version of the master that serverData/diffEntries were computed from
+	MasterVersion                   serverVersion;
+
+	// Non-empty while serverData is a reconstructed past master (no XML edits)
+	std::string                     historicalKey;
+
+	// Parsed shards of a sharded master (unchanged shards are not re-read)
+	ShardedMasterCache              shardCache;
+
+	// Parsed masters of a catalog (unchanged masters are not re-read)
+	MasterCatalogCache              catalogCache;
+
+	// Fingerprints of the shown models, diff and trees (0 = unknown); a
+	// refresh stage whose inputs match is skipped
+	std::uint64_t  projectHash;
+	std::uint64_t  serverHash;
+	std::uint64_t  diffHash;
+	std::uint64_t  propertyHash;
+	std::uint64_t  projectStatusHash;
+	std::uint64_t  serverStatusHash;
+	std::uint64_t  projectTreeKey;
+	std::uint64_t  serverTreeKey;
+	std::uint64_t  conflictsTreeKey;
+
+	// Displayed tree models (items assigned), reconciled on every update
+	ViewNode  projectView;
+	ViewNode  serverView;
+	ViewNode  conflictsView;
+	bool      updatingTrees;
+
+	// Side tree branches the user expanded ("system<US>ID"); kept across refreshes
+	std::set<std::string>  projectExpanded;
+	std::set<std::string>  serverExpanded;
 
 	// Mapping: conflicts tree item ID -> index in diffEntries
 	GS::HashTable<Int32, UInt32>  conflictItemToDiffIndex;
 
-	// Mapping: classification ID string -> tree item ID (for selection sync)
-	GS::HashTable<GS::UniString, Int32>  projectIdToTreeItem;
-	GS::HashTable<GS::UniString, Int32>  serverIdToTreeItem;
+	// Mapping: classification ID string -> tree item ID (materialized items only)
+	std::unordered_map<std::string, Int32>  projectIdToTreeItem;
+	std::unordered_map<std::string, Int32>  serverIdToTreeItem;
+
+	// Side tree branches showing a placeholder (tree item -> branch key)
+	GS::HashTable<Int32, std::string>  projectLazyBranches;
+	GS::HashTable<Int32, std::string>  serverLazyBranches;
+
+	// Diff status by ID (built once per diff; items not listed are Match)
+	std::unordered_map<std::string, DiffStatus>  diffStatusById;
+
+	// Built with each side tree; feeds branch labels, lazy expansion and grouping
+	SideSummary  projectSummary;
+	SideSummary  serverSummary;
+
+	// Differences grouped by top-level category (check box)
+	bool         groupByCategory;
+
+	// Changes reported by the watcher thread, drained on the UI thread (PanelIdle)
+	std::atomic<unsigned>           pendingChanges;
+	MasterWatcher                   masterWatcher;
+
+	// Master read + diff off the UI thread; results are taken in PanelIdle
+	RefreshWorker                   refreshWorker;
+	bool                            fullRefreshPending;		// a full refresh is queued or running
+	unsigned                        shownRefreshProgress;	// last progress shown in the status line
+	CounterSnapshot                 refreshCounters;		// counters when the last refresh started
+
+	// Connection to the sync service hosting the master, shared with the
+	// worker (null when CLASSSYNC_SERVICE is unset)
+	std::shared_ptr<SyncClient>     syncClient;
+
+	// Per-item index over changelog/ (updated incrementally on each query)
+	ChangeLogIndex                  historyIndex;
 
-	// XML file path (loaded from preferences)
-	static GS::UniString  xmlFilePath;
+	// XML file path, UTF-8 (loaded from preferences)
+	static std::string    xmlFilePath;
 
 	// Singleton
 	static ClassSyncPalette*  instance;
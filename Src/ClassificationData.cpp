@@ -1,4 +1,9 @@
 #include "ClassificationData.hpp"
+#include "CoreAdapters.hpp"
+#include "Counters.hpp"
+#include "Trace.hpp"
+
+#include <unordered_map>
 
 
 // ---------------------------------------------------------------------------
@@ -6,26 +11,28 @@
 // ---------------------------------------------------------------------------
 
 static void ReadChildrenRecursive (const API_Guid& parentGuid,
-								   GS::Array<ClassificationNode>& result)
+								   std::vector<ClassificationNode>& result)
 {
 	GS::Array<API_ClassificationItem> children;
+	AddCounter (Counter::AcapiClassificationCalls);
 	if (ACAPI_Classification_GetClassificationItemChildren (parentGuid, children) != NoError)
 		return;
 
 	for (const auto& child : children) {
 		API_ClassificationItem fullItem = {};
 		fullItem.guid = child.guid;
+		AddCounter (Counter::AcapiClassificationCalls);
 		if (ACAPI_Classification_GetClassificationItem (fullItem) != NoError)
 			continue;
 
 		ClassificationNode node;
-		node.id          = fullItem.id;
-		node.name        = fullItem.name;
-		node.description = fullItem.description;
-		node.guid        = fullItem.guid;
+		node.id          = ToUtf8 (fullItem.id);
+		node.name        = ToUtf8 (fullItem.name);
+		node.description = ToUtf8 (fullItem.description);
+		node.guid        = ToItemGuid (fullItem.guid);
 
 		ReadChildrenRecursive (fullItem.guid, node.children);
-		result.Push (node);
+		result.push_back (std::move (node));
 	}
 }
 
@@ -34,41 +41,46 @@ static void ReadChildrenRecursive (const API_Guid& parentGuid,
 // Read classification trees from current ArchiCAD project
 // ---------------------------------------------------------------------------
 
-GS::Array<ClassificationTree> ReadProjectClassifications ()
+std::vector<ClassificationTree> ReadProjectClassifications ()
 {
-	GS::Array<ClassificationTree> result;
+	TraceScope trace ("ReadProjectClassifications");
+	std::vector<ClassificationTree> result;
 
 	GS::Array<API_ClassificationSystem> systems;
+	AddCounter (Counter::AcapiClassificationCalls);
 	if (ACAPI_Classification_GetClassificationSystems (systems) != NoError)
 		return result;
 
 	for (const auto& system : systems) {
 		ClassificationTree tree;
-		tree.systemName = system.name;
-		tree.version    = system.editionVersion;
-		tree.systemGuid = system.guid;
+		tree.systemName = ToUtf8 (system.name);
+		TraceScope systemTrace ("read project system", tree.systemName);
+		tree.version    = ToUtf8 (system.editionVersion);
+		tree.systemGuid = ToItemGuid (system.guid);
 
 		GS::Array<API_ClassificationItem> rootItems;
+		AddCounter (Counter::AcapiClassificationCalls);
 		if (ACAPI_Classification_GetClassificationSystemRootItems (system.guid, rootItems) != NoError)
 			continue;
 
 		for (const auto& rootItem : rootItems) {
 			API_ClassificationItem fullItem = {};
 			fullItem.guid = rootItem.guid;
+			AddCounter (Counter::AcapiClassificationCalls);
 			if (ACAPI_Classification_GetClassificationItem (fullItem) != NoError)
 				continue;
 
 			ClassificationNode node;
-			node.id          = fullItem.id;
-			node.name        = fullItem.name;
-			node.description = fullItem.description;
-			node.guid        = fullItem.guid;
+			node.id          = ToUtf8 (fullItem.id);
+			node.name        = ToUtf8 (fullItem.name);
+			node.description = ToUtf8 (fullItem.description);
+			node.guid        = ToItemGuid (fullItem.guid);
 
 			ReadChildrenRecursive (fullItem.guid, node.children);
-			tree.rootItems.Push (node);
+			tree.rootItems.push_back (std::move (node));
 		}
 
-		result.Push (tree);
+		result.push_back (std::move (tree));
 	}
 
 	return result;
@@ -76,97 +88,87 @@ GS::Array<ClassificationTree> ReadProjectClassifications ()
 
 
 // ---------------------------------------------------------------------------
-// Helper: flatten tree into an array for comparison
+// Read custom property definitions; availability GUIDs become item IDs,
+// enumeration values keep their (project specific) key GUIDs
 // ---------------------------------------------------------------------------
 
-struct FlatItem {
-	GS::UniString  id;
-	GS::UniString  name;
-	GS::UniString  description;
-	API_Guid       guid;
-	API_Guid       systemGuid;
-};
-
-static void FlattenHelper (const GS::Array<ClassificationNode>& nodes,
-						   GS::Array<FlatItem>& result,
-						   const API_Guid& systemGuid)
+static std::string GuidKey (const ItemGuid& guid)
 {
-	for (UInt32 i = 0; i < nodes.GetSize (); i++) {
-		FlatItem fi;
-		fi.id          = nodes[i].id;
-		fi.name        = nodes[i].name;
-		fi.description = nodes[i].description;
-		fi.guid        = nodes[i].guid;
-		fi.systemGuid  = systemGuid;
-		result.Push (fi);
-		FlattenHelper (nodes[i].children, result, systemGuid);
-	}
+	return std::string ((const char*)guid.bytes, sizeof (guid.bytes));
 }
 
 
-// ---------------------------------------------------------------------------
-// Compare project and server classification trees
-// ---------------------------------------------------------------------------
+static void IndexItemGuids (const std::vector<ClassificationNode>& nodes,
+							std::unordered_map<std::string, const std::string*>& idByGuid)
+{
+	for (const ClassificationNode& node : nodes) {
+		idByGuid.emplace (GuidKey (node.guid), &node.id);
+		IndexItemGuids (node.children, idByGuid);
+	}
+}
+
 
-GS::Array<DiffEntry> CompareClassifications (
-	const GS::Array<ClassificationTree>& project,
-	const GS::Array<ClassificationTree>& server)
+// Display text of an enumeration value as the master XML writes it
+static std::string VariantToText (const API_Variant& variant)
 {
-	GS::Array<DiffEntry> result;
-
-	// Flatten both sides
-	GS::Array<FlatItem> projectItems;
-	for (UInt32 s = 0; s < project.GetSize (); s++)
-		FlattenHelper (project[s].rootItems, projectItems, project[s].systemGuid);
-
-	GS::Array<FlatItem> serverItems;
-	for (UInt32 s = 0; s < server.GetSize (); s++)
-		FlattenHelper (server[s].rootItems, serverItems, server[s].systemGuid);
-
-	// For each project item, check if it exists in server
-	for (UInt32 i = 0; i < projectItems.GetSize (); i++) {
-		DiffEntry entry;
-		entry.id                = projectItems[i].id;
-		entry.projectName       = projectItems[i].name;
-		entry.description       = projectItems[i].description;
-		entry.projectItemGuid   = projectItems[i].guid;
-		entry.projectSystemGuid = projectItems[i].systemGuid;
-
-		bool found = false;
-		for (UInt32 j = 0; j < serverItems.GetSize (); j++) {
-			if (serverItems[j].id == projectItems[i].id) {
-				entry.serverName = serverItems[j].name;
-				entry.status = (projectItems[i].name == serverItems[j].name)
-					? DiffStatus::Match
-					: DiffStatus::Conflict;
-				found = true;
-				break;
-			}
+	switch (variant.type) {
+		case API_PropertyStringValueType:	return ToUtf8 (variant.uniStringValue);
+		case API_PropertyIntegerValueType:	return std::to_string (variant.intValue);
+		case API_PropertyBooleanValueType:	return variant.boolValue ? "true" : "false";
+		case API_PropertyRealValueType: {
+			char text[32];
+			snprintf (text, sizeof (text), "%g", variant.doubleValue);
+			return text;
 		}
-		if (!found)
-			entry.status = DiffStatus::OnlyInProject;
-
-		result.Push (entry);
+		default:							return std::string ();
 	}
+}
+
 
-	// Find items only in server
-	for (UInt32 j = 0; j < serverItems.GetSize (); j++) {
-		bool found = false;
-		for (UInt32 i = 0; i < projectItems.GetSize (); i++) {
-			if (projectItems[i].id == serverItems[j].id) {
-				found = true;
-				break;
+std::vector<PropertyDefinitionInfo> ReadProjectPropertyDefinitions (const std::vector<ClassificationTree>& projectData)
+{
+	TraceScope trace ("ReadProjectPropertyDefinitions");
+	std::vector<PropertyDefinitionInfo> result;
+
+	std::unordered_map<std::string, const std::string*> idByGuid;
+	for (const ClassificationTree& tree : projectData)
+		IndexItemGuids (tree.rootItems, idByGuid);
+
+	GS::Array<API_PropertyGroup> groups;
+	AddCounter (Counter::AcapiPropertyCalls);
+	if (ACAPI_Property_GetPropertyGroups (groups) != NoError)
+		return result;
+
+	for (const auto& group : groups) {
+		// Built-in groups are the same in every project and have no mapping
+		if (group.groupType != API_PropertyCustomGroupType)
+			continue;
+
+		GS::Array<API_PropertyDefinition> definitions;
+		AddCounter (Counter::AcapiPropertyCalls);
+		if (ACAPI_Property_GetPropertyDefinitions (group.guid, definitions) != NoError)
+			continue;
+
+		for (const auto& definition : definitions) {
+			PropertyDefinitionInfo info;
+			info.group = ToUtf8 (group.name);
+			info.name  = ToUtf8 (definition.name);
+			for (const API_Guid& itemGuid : definition.availability) {
+				auto found = idByGuid.find (GuidKey (ToItemGuid (itemGuid)));
+				if (found != idByGuid.end ())
+					info.itemIds.push_back (*found->second);
 			}
-		}
-		if (!found) {
-			DiffEntry entry;
-			entry.id                = serverItems[j].id;
-			entry.serverName        = serverItems[j].name;
-			entry.description       = serverItems[j].description;
-			entry.status            = DiffStatus::OnlyInServer;
-			entry.projectItemGuid   = APINULLGuid;
-			entry.projectSystemGuid = APINULLGuid;
-			result.Push (entry);
+			if (definition.collectionType == API_PropertySingleChoiceEnumerationCollectionType ||
+				definition.collectionType == API_PropertyMultipleChoiceEnumerationCollectionType)
+			{
+				for (const auto& enumValue : definition.possibleEnumValues) {
+					EnumValueInfo value;
+					value.key  = ToUtf8 (APIGuidToString (enumValue.keyVariant.guidValue));
+					value.text = VariantToText (enumValue.displayVariant);
+					info.enumValues.push_back (std::move (value));
+				}
+			}
+			result.push_back (std::move (info));
 		}
 	}
 
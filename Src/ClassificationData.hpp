@@ -1,56 +1,24 @@
 #ifndef CLASSIFICATIONDATA_HPP
 #define CLASSIFICATIONDATA_HPP
 
-#include "APIEnvir.h"
-#include "ACAPinc.h"
+#include "ClassificationModel.hpp"
+#include "PropertyApplicability.hpp"
 
-
-// ---------------------------------------------------------------------------
-// Data structures
-// ---------------------------------------------------------------------------
-
-struct ClassificationNode {
-	GS::UniString  id;
-	GS::UniString  name;
-	GS::UniString  description;
-	API_Guid       guid;		// APINULLGuid for XML-sourced items
-	GS::Array<ClassificationNode>  children;
-};
-
-struct ClassificationTree {
-	GS::UniString  systemName;
-	GS::UniString  version;
-	API_Guid       systemGuid;	// APINULLGuid for XML-sourced trees
-	GS::Array<ClassificationNode>  rootItems;
-};
-
-enum class DiffStatus {
-	Match,
-	Conflict,
-	OnlyInProject,
-	OnlyInServer
-};
-
-struct DiffEntry {
-	GS::UniString  id;
-	GS::UniString  projectName;
-	GS::UniString  serverName;
-	GS::UniString  description;
-	DiffStatus     status;
-	API_Guid       projectItemGuid;		// GUID of item in project
-	API_Guid       projectSystemGuid;	// GUID of system in project
-};
+#include <vector>
 
 
 // ---------------------------------------------------------------------------
-// Functions
+// Project side of the model. The structures, the diff and the fingerprints
+// live in the core library (ClassificationModel.hpp); only the read through
+// the classification API stays in the add-on. Must run on the UI thread.
 // ---------------------------------------------------------------------------
 
-GS::Array<ClassificationTree>  ReadProjectClassifications ();
+std::vector<ClassificationTree>  ReadProjectClassifications ();
 
-GS::Array<DiffEntry>  CompareClassifications (
-	const GS::Array<ClassificationTree>& project,
-	const GS::Array<ClassificationTree>& server);
+// Custom property definitions with the items they are available for, IDs
+// taken from projectData (ReadProjectClassifications of the same state),
+// and their enumeration values.
+std::vector<PropertyDefinitionInfo>  ReadProjectPropertyDefinitions (const std::vector<ClassificationTree>& projectData);
 
 
 #endif // CLASSIFICATIONDATA_HPP
@@ -0,0 +1,483 @@
+#include "ChangeLog.hpp"
+#include "Counters.hpp"
+#include "FileLock.hpp"
+#include "FileSystem.hpp"
+#include "Log.hpp"
+#include "Trace.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined (_WIN32)
+#include <unistd.h>
+#endif
+
+
+// Records queued within this window are written together
+static const int kBatchDelayMs = 250;
+
+
+// ---------------------------------------------------------------------------
+// Helper: format a timestamp (thread-safe localtime)
+// ---------------------------------------------------------------------------
+
+static std::string FormatTime (std::int64_t t, const char* format)
+{
+	std::time_t tt = (std::time_t)t;
+	std::tm lt = {};
+#if defined (_WIN32)
+	localtime_s (&lt, &tt);
+#else
+	localtime_r (&tt, &lt);
+#endif
+	char buf[32];
+	std::strftime (buf, sizeof (buf), format, &lt);
+	return buf;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: get user display string "USERNAME (COMPUTERNAME)", read once
+// ---------------------------------------------------------------------------
+
+static const std::string& GetUserDisplay ()
+{
+	static const std::string cached = [] () {
+#if defined (_WIN32)
+		const char* user = std::getenv ("USERNAME");
+		const char* comp = std::getenv ("COMPUTERNAME");
+#else
+		char host[256] = {};
+		const char* user = std::getenv ("USER");
+		const char* comp = gethostname (host, sizeof (host) - 1) == 0 ? host : nullptr;
+#endif
+
+		std::string result;
+		if (user != nullptr)
+			result += user;
+		else
+			result += "unknown";
+
+		if (comp != nullptr) {
+			result += " (";
+			result += comp;
+			result += ")";
+		}
+
+		return result;
+	} ();
+
+	return cached;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: escape a string for a JSON value
+// ---------------------------------------------------------------------------
+
+static std::string JsonEscape (const std::string& s)
+{
+	std::string out;
+	out.reserve (s.size () + 2);
+	for (unsigned char c : s) {
+		switch (c) {
+			case '"':  out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\n': out += "\\n";  break;
+			case '\r': out += "\\r";  break;
+			case '\t': out += "\\t";  break;
+			default:
+				if (c < 0x20) {
+					char buf[8];
+					snprintf (buf, sizeof (buf), "\\u%04x", c);
+					out += buf;
+				} else {
+					out += (char)c;
+				}
+				break;
+		}
+	}
+	return out;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: one JSON line for a record
+// ---------------------------------------------------------------------------
+
+static std::string FormatJsonLine (const ChangeRecord& r, const std::string& session)
+{
+	std::string line;
+	line += "{\"seq\":" + std::to_string ((unsigned long long)r.sequence);
+	line += ",\"ts\":\"" + FormatTime (r.time, "%Y-%m-%dT%H:%M:%S") + "\"";
+	line += ",\"session\":\"" + JsonEscape (session) + "\"";
+	line += ",\"user\":\"" + JsonEscape (GetUserDisplay ()) + "\"";
+	line += ",\"action\":\"" + JsonEscape (r.action) + "\"";
+	line += ",\"item\":\"" + JsonEscape (r.itemId) + "\"";
+	line += ",\"parent\":\"" + JsonEscape (r.parentId) + "\"";
+	line += ",\"old\":\"" + JsonEscape (r.oldValue) + "\"";
+	line += ",\"new\":\"" + JsonEscape (r.newValue) + "\"";
+	line += "}\n";
+	return line;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: human-readable entry (same layout as before structured logging)
+// ---------------------------------------------------------------------------
+
+static std::string FormatTextEntry (const ChangeRecord& r)
+{
+	std::string entry;
+	entry += "[" + FormatTime (r.time, "%H:%M:%S") + "] " + GetUserDisplay () + "\n";
+
+	if (r.action == "export") {
+		entry += "  Export: " + r.itemId + " \"" + r.newValue + "\"\n";
+		if (!r.parentId.empty ())
+			entry += "  Parent: " + r.parentId + "\n";
+	} else if (r.action == "use-project") {
+		entry += "  Use Project (resolve conflict): " + r.itemId + "\n";
+		entry += "  Server name: \"" + r.oldValue + "\"\n";
+		entry += "  Project name: \"" + r.newValue + "\"\n";
+	} else if (r.action == "use-server") {
+		entry += "  Use Server (resolve conflict): " + r.itemId + "\n";
+		entry += "  Project name: \"" + r.oldValue + "\"\n";
+		entry += "  Server name: \"" + r.newValue + "\"\n";
+	} else if (r.action == "import" && r.itemId.empty ()) {
+		entry += "  Import: all missing items from server XML\n";
+	} else if (r.action == "import") {
+		entry += "  Import: " + r.itemId + " \"" + r.newValue + "\"\n";
+	} else {
+		entry += "  " + r.action + ": " + r.itemId + "\n";
+	}
+
+	entry += "\n";
+	return entry;
+}
+
+
+// ---------------------------------------------------------------------------
+// Background writer: queue + batch flush
+// ---------------------------------------------------------------------------
+
+namespace {
+
+struct PendingRecord {
+	std::string   logDir;
+	ChangeRecord  record;
+};
+
+class ChangeLogWriter {
+public:
+	ChangeLogWriter () : nextSequence (1), holds (0), stopping (false), flushRequested (false), written (0), queued (0) {}
+
+	void Enqueue (const std::string& logDir, ChangeRecord record)
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		record.sequence = nextSequence++;
+		record.time     = (std::int64_t)std::time (nullptr);
+		queue.push_back ({ logDir, record });
+		queued++;
+		EnsureThread ();
+		wake.notify_one ();
+	}
+
+	void Hold ()
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		holds++;
+	}
+
+	void Release ()
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		if (holds > 0 && --holds == 0)
+			wake.notify_one ();
+	}
+
+	void Flush ()
+	{
+		std::unique_lock<std::mutex> lock (mutex);
+		if (!worker.joinable ())
+			return;
+		std::uint64_t target = queued;
+		flushRequested = true;
+		wake.notify_one ();
+		done.wait (lock, [&] { return written >= target; });
+	}
+
+	void Shutdown ()
+	{
+		{
+			std::lock_guard<std::mutex> lock (mutex);
+			if (!worker.joinable ())
+				return;
+			stopping = true;
+			wake.notify_one ();
+		}
+		worker.join ();
+
+		std::lock_guard<std::mutex> lock (mutex);
+		stopping = false;
+	}
+
+	~ChangeLogWriter ()
+	{
+		Shutdown ();
+	}
+
+private:
+	void EnsureThread ()
+	{
+		if (!worker.joinable ())
+			worker = std::thread (&ChangeLogWriter::Run, this);
+	}
+
+	void Run ()
+	{
+		SetTraceThreadName ("changelog writer");
+		std::unique_lock<std::mutex> lock (mutex);
+		while (true) {
+			// Held records wait for the end of the bulk action (or a flush)
+			wake.wait (lock, [&] { return stopping || flushRequested || (!queue.empty () && holds == 0); });
+
+			// Let a burst (bulk export) accumulate unless a flush is waiting
+			if (!stopping && !flushRequested)
+				wake.wait_for (lock, std::chrono::milliseconds (kBatchDelayMs),
+							   [&] { return stopping || flushRequested; });
+
+			std::deque<PendingRecord> batch;
+			batch.swap (queue);
+			flushRequested = false;
+
+			lock.unlock ();
+			WriteBatch (batch);
+			lock.lock ();
+
+			written += batch.size ();
+			done.notify_all ();
+
+			if (stopping && queue.empty ())
+				break;
+		}
+	}
+
+	// Create the changelog directory once per session; remembered only after
+	// it exists, so a failed or deleted directory is tried again
+	bool EnsureDirectory (const std::string& logDir)
+	{
+		if (createdDirs.count (logDir) > 0)
+			return true;
+		bool ok = MakeDirectory (logDir);
+		if (ok)
+			createdDirs.insert (logDir);
+		else
+			CS_LOG_WARNING ("ClassSync: Cannot create changelog directory %s", logDir.c_str ());
+		return ok;
+	}
+
+	bool AppendFile (const std::string& path, const std::string& content, std::ios::openmode mode)
+	{
+		std::ofstream file (path, std::ios::app | mode);
+		if (!file.is_open ())
+			return false;
+		file << content;
+		file.close ();
+		if (file.fail ())
+			return false;
+
+		AddCounter (Counter::ChangeLogAppends);
+		AddCounter (Counter::ChangeLogBytesWritten, content.size ());
+		return true;
+	}
+
+	void WriteBatch (const std::deque<PendingRecord>& batch)
+	{
+		if (batch.empty ())
+			return;
+
+		TraceScope trace ("write changelog batch");
+		const std::string& session = GetSessionId ();
+
+		struct BatchFile {
+			std::string  logDir;
+			std::string  text;
+			std::string  json;
+		};
+
+		// Group by changelog directory + day: one append per file per batch
+		std::map<std::string, BatchFile> files;		// by base path
+		for (const PendingRecord& p : batch) {
+			std::string base = JoinPath (p.logDir, FormatTime (p.record.time, "%Y-%m-%d"));
+			BatchFile& out = files[base];
+			out.logDir  = p.logDir;
+			out.text   += FormatTextEntry (p.record);
+			out.json   += FormatJsonLine (p.record, session);
+		}
+
+		AddCounter (Counter::ChangeLogRecords, batch.size ());
+		for (const auto& f : files) {
+			AppendRecords (f.second.logDir, f.first + ".txt", f.second.text, std::ios::out);
+			AppendRecords (f.second.logDir, f.first + ".jsonl", f.second.json, std::ios::binary);
+		}
+	}
+
+	// A failed append is tried once more after creating the directory again
+	// (it may have been deleted during the session)
+	void AppendRecords (const std::string& logDir, const std::string& path, const std::string& content,
+						std::ios::openmode mode)
+	{
+		if (EnsureDirectory (logDir) && AppendFile (path, content, mode))
+			return;
+
+		createdDirs.erase (logDir);
+		if (!EnsureDirectory (logDir) || !AppendFile (path, content, mode))
+			CS_LOG_WARNING ("ClassSync: Cannot append to changelog %s", path.c_str ());
+	}
+
+	std::mutex                 mutex;
+	std::condition_variable    wake;
+	std::condition_variable    done;
+	std::thread                worker;
+	std::deque<PendingRecord>  queue;
+	std::set<std::string>      createdDirs;		// touched only by the worker
+	std::uint64_t              nextSequence;
+	unsigned                   holds;			// open ChangeLogBatch scopes
+	bool                       stopping;
+	bool                       flushRequested;
+	std::uint64_t              written;
+	std::uint64_t              queued;
+};
+
+ChangeLogWriter& GetWriter ()
+{
+	static ChangeLogWriter writer;
+	return writer;
+}
+
+}
+
+
+// ---------------------------------------------------------------------------
+// Queue a record for the changelog next to the given XML
+// ---------------------------------------------------------------------------
+
+std::string GetChangeLogDirectory (const std::string& xmlPath)
+{
+	return JoinPath (GetDirectory (xmlPath), "changelog");
+}
+
+
+void LogRecord (const std::string& xmlPath, const ChangeRecord& record)
+{
+	GetWriter ().Enqueue (GetChangeLogDirectory (xmlPath), record);
+}
+
+
+ChangeLogBatch::ChangeLogBatch ()
+{
+	GetWriter ().Hold ();
+}
+
+
+ChangeLogBatch::~ChangeLogBatch ()
+{
+	GetWriter ().Release ();
+}
+
+
+void FlushChangeLog ()
+{
+	GetWriter ().Flush ();
+}
+
+
+void ShutdownChangeLog ()
+{
+	GetWriter ().Shutdown ();
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: build a record with the common fields
+// ---------------------------------------------------------------------------
+
+static ChangeRecord MakeRecord (const char* action,
+								const std::string& itemId,
+								const std::string& oldValue,
+								const std::string& newValue)
+{
+	ChangeRecord r;
+	r.action   = action;
+	r.itemId   = itemId;
+	r.oldValue = oldValue;
+	r.newValue = newValue;
+	r.sequence = 0;
+	r.time     = 0;
+	return r;
+}
+
+
+// ---------------------------------------------------------------------------
+// Log an export action (project item added to XML)
+// ---------------------------------------------------------------------------
+
+void LogExport (const std::string& xmlPath,
+				const std::string& itemId,
+				const std::string& itemName,
+				const std::string& parentId)
+{
+	ChangeRecord r = MakeRecord ("export", itemId, std::string (), itemName);
+	r.parentId = parentId;
+	LogRecord (xmlPath, r);
+}
+
+
+// ---------------------------------------------------------------------------
+// Log a "Use Project" action (XML name changed to match project)
+// ---------------------------------------------------------------------------
+
+void LogUseProject (const std::string& xmlPath,
+					const std::string& itemId,
+					const std::string& serverName,
+					const std::string& projectName)
+{
+	LogRecord (xmlPath, MakeRecord ("use-project", itemId, serverName, projectName));
+}
+
+
+// ---------------------------------------------------------------------------
+// Log a "Use Server" action (project name changed to match XML)
+// ---------------------------------------------------------------------------
+
+void LogUseServer (const std::string& xmlPath,
+				   const std::string& itemId,
+				   const std::string& projectName,
+				   const std::string& serverName)
+{
+	LogRecord (xmlPath, MakeRecord ("use-server", itemId, projectName, serverName));
+}
+
+
+// ---------------------------------------------------------------------------
+// Log an import action (server item added to the project)
+// ---------------------------------------------------------------------------
+
+void LogImport (const std::string& xmlPath,
+				const std::string& itemId,
+				const std::string& itemName)
+{
+	LogRecord (xmlPath, MakeRecord ("import", itemId, std::string (), itemName));
+}
@@ -0,0 +1,76 @@
+#ifndef CHANGELOG_HPP
+#define CHANGELOG_HPP
+
+#include <cstdint>
+#include <string>
+
+
+// ---------------------------------------------------------------------------
+// Structured changelog record. Written as one JSON line to
+// changelog/YYYY-MM-DD.jsonl and as a human-readable entry to
+// changelog/YYYY-MM-DD.txt next to the XML file.
+// ---------------------------------------------------------------------------
+
+struct ChangeRecord {
+	std::string    action;		// "export", "use-project", "use-server", "import"
+	std::string    itemId;
+	std::string    parentId;
+	std::string    oldValue;	// value before the change (empty for export/import)
+	std::string    newValue;	// value after the change
+
+	// Stamped when the record is queued
+	std::uint64_t  sequence;	// per-session, monotonically increasing
+	std::int64_t   time;		// seconds since epoch
+};
+
+
+// ---------------------------------------------------------------------------
+// Changelog API - records are queued and appended in batches by a background
+// thread (one open/append/close per day file per batch, off the UI thread).
+// ---------------------------------------------------------------------------
+
+void LogExport     (const std::string& xmlPath,
+					const std::string& itemId,
+					const std::string& itemName,
+					const std::string& parentId);
+
+void LogUseProject (const std::string& xmlPath,
+					const std::string& itemId,
+					const std::string& serverName,
+					const std::string& projectName);
+
+void LogUseServer  (const std::string& xmlPath,
+					const std::string& itemId,
+					const std::string& projectName,
+					const std::string& serverName);
+
+void LogImport     (const std::string& xmlPath,
+					const std::string& itemId,
+					const std::string& itemName);
+
+// The changelog directory next to the given XML.
+std::string  GetChangeLogDirectory (const std::string& xmlPath);
+
+// Queue an already-built record (sequence/time are filled in here).
+void LogRecord     (const std::string& xmlPath, const ChangeRecord& record);
+
+// Records queued while a ChangeLogBatch is alive are written together, as
+// one append per day file, once the last batch scope ends (bulk actions).
+class ChangeLogBatch {
+public:
+	ChangeLogBatch ();
+	~ChangeLogBatch ();
+
+private:
+	ChangeLogBatch (const ChangeLogBatch&) = delete;
+	ChangeLogBatch& operator= (const ChangeLogBatch&) = delete;
+};
+
+// Block until every queued record is on disk (palette close).
+void FlushChangeLog ();
+
+// Flush and stop the writer thread (FreeData). Later calls restart it.
+void ShutdownChangeLog ();
+
+
+#endif // CHANGELOG_HPP
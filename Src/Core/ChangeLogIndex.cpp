@@ -0,0 +1,706 @@
+#include "ChangeLogIndex.hpp"
+#include "FileSystem.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+
+#if defined (_WIN32)
+	#include <windows.h>
+#else
+	#include <dirent.h>
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+
+static const char* kIndexHeader   = "ClassSync changelog index 1";
+static const char* kIndexFileName = "history.idx";
+
+// Unscanned tails at least this large are memory-mapped instead of read
+static const uint64_t kDefaultMapThreshold = 256 * 1024;
+
+
+// ---------------------------------------------------------------------------
+// Helper: path pieces
+// ---------------------------------------------------------------------------
+
+static bool EndsWith (const std::string& s, const char* suffix)
+{
+	size_t n = std::strlen (suffix);
+	return s.size () >= n && s.compare (s.size () - n, n, suffix) == 0;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: file size (false if the file does not exist)
+// ---------------------------------------------------------------------------
+
+static bool GetFileSize (const std::string& path, uint64_t& size)
+{
+#if defined (_WIN32)
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA (path.c_str (), GetFileExInfoStandard, &data))
+		return false;
+	size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+#else
+	struct stat st;
+	if (stat (path.c_str (), &st) != 0)
+		return false;
+	size = (uint64_t)st.st_size;
+#endif
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: list day files ("YYYY-MM-DD.txt" / "YYYY-MM-DD.jsonl") with sizes
+// ---------------------------------------------------------------------------
+
+static bool IsDayFileName (const std::string& name)
+{
+	if (!EndsWith (name, ".txt") && !EndsWith (name, ".jsonl"))
+		return false;
+	if (name.size () < 10 || name[4] != '-' || name[7] != '-')
+		return false;
+	for (int i : { 0, 1, 2, 3, 5, 6, 8, 9 })
+		if (name[i] < '0' || name[i] > '9')
+			return false;
+	return true;
+}
+
+
+static bool ListDayFiles (const std::string& logDir, std::map<std::string, uint64_t>& out)
+{
+#if defined (_WIN32)
+	WIN32_FIND_DATAA fd;
+	HANDLE h = FindFirstFileA (JoinPath (logDir, "*").c_str (), &fd);
+	if (h == INVALID_HANDLE_VALUE)
+		return false;
+	do {
+		if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			continue;
+		std::string name = fd.cFileName;
+		if (IsDayFileName (name))
+			out[name] = ((uint64_t)fd.nFileSizeHigh << 32) | fd.nFileSizeLow;
+	} while (FindNextFileA (h, &fd));
+	FindClose (h);
+#else
+	DIR* dir = opendir (logDir.c_str ());
+	if (dir == nullptr)
+		return false;
+	while (struct dirent* ent = readdir (dir)) {
+		std::string name = ent->d_name;
+		uint64_t size;
+		if (IsDayFileName (name) && GetFileSize (JoinPath (logDir, name), size))
+			out[name] = size;
+	}
+	closedir (dir);
+#endif
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Read-only view of a file range: memory-mapped, or read into a buffer
+// ---------------------------------------------------------------------------
+
+namespace {
+
+class FileRange {
+public:
+	FileRange () : data (nullptr), size (0), mapBase (nullptr), mapSize (0)
+#if defined (_WIN32)
+		, fileHandle (INVALID_HANDLE_VALUE), mapHandle (nullptr)
+#endif
+	{}
+
+	~FileRange ()
+	{
+#if defined (_WIN32)
+		if (mapBase != nullptr)
+			UnmapViewOfFile (mapBase);
+		if (mapHandle != nullptr)
+			CloseHandle (mapHandle);
+		if (fileHandle != INVALID_HANDLE_VALUE)
+			CloseHandle (fileHandle);
+#else
+		if (mapBase != nullptr)
+			munmap (mapBase, mapSize);
+#endif
+	}
+
+	bool Open (const std::string& path, uint64_t offset, uint64_t end, bool useMapping)
+	{
+		if (end <= offset)
+			return false;
+		if (useMapping && Map (path, offset, end))
+			return true;
+
+		std::ifstream file (path, std::ios::binary);
+		if (!file.is_open ())
+			return false;
+		file.seekg ((std::streamoff)offset);
+		buffer.resize ((size_t)(end - offset));
+		file.read (&buffer[0], (std::streamsize)buffer.size ());
+		buffer.resize ((size_t)file.gcount ());
+		data = buffer.data ();
+		size = buffer.size ();
+		return size > 0;
+	}
+
+	const char*  Data () const { return data; }
+	size_t       Size () const { return size; }
+
+private:
+	// The whole file is mapped; data points at the requested offset
+	bool Map (const std::string& path, uint64_t offset, uint64_t end)
+	{
+#if defined (_WIN32)
+		fileHandle = CreateFileA (path.c_str (), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+								  nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (fileHandle == INVALID_HANDLE_VALUE)
+			return false;
+		mapHandle = CreateFileMappingA (fileHandle, nullptr, PAGE_READONLY,
+										(DWORD)(end >> 32), (DWORD)end, nullptr);
+		if (mapHandle == nullptr)
+			return false;
+		mapBase = MapViewOfFile (mapHandle, FILE_MAP_READ, 0, 0, (SIZE_T)end);
+		if (mapBase == nullptr)
+			return false;
+#else
+		int fd = open (path.c_str (), O_RDONLY);
+		if (fd < 0)
+			return false;
+		void* p = mmap (nullptr, (size_t)end, PROT_READ, MAP_PRIVATE, fd, 0);
+		close (fd);
+		if (p == MAP_FAILED)
+			return false;
+		mapBase = p;
+#endif
+		mapSize = (size_t)end;
+		data    = static_cast<const char*> (mapBase) + offset;
+		size    = (size_t)(end - offset);
+		return true;
+	}
+
+	const char*  data;
+	size_t       size;
+	std::string  buffer;
+	void*        mapBase;
+	size_t       mapSize;
+#if defined (_WIN32)
+	HANDLE       fileHandle;
+	HANDLE       mapHandle;
+#endif
+};
+
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: entry parsing
+// ---------------------------------------------------------------------------
+
+// Value of "key":"..." in one of our JSON lines (flat object, string values)
+static std::string JsonField (const char* line, size_t len, const char* key)
+{
+	std::string pattern = std::string ("\"") + key + "\":\"";
+	const char* end = line + len;
+	const char* p = std::search (line, end, pattern.begin (), pattern.end ());
+	if (p == end)
+		return "";
+	p += pattern.size ();
+
+	std::string value;
+	while (p < end && *p != '"') {
+		if (*p == '\\' && p + 1 < end) {
+			p++;
+			switch (*p) {
+				case 'n': value += '\n'; break;
+				case 'r': value += '\r'; break;
+				case 't': value += '\t'; break;
+				case 'u':
+					if (p + 4 < end) {
+						value += (char)std::strtol (std::string (p + 1, 4).c_str (), nullptr, 16);
+						p += 4;
+					}
+					break;
+				default:  value += *p; break;
+			}
+		} else {
+			value += *p;
+		}
+		p++;
+	}
+	return value;
+}
+
+
+static std::string TrimLine (const char* begin, const char* end)
+{
+	while (end > begin && (end[-1] == '\r' || end[-1] == '\n'))
+		end--;
+	return std::string (begin, end);
+}
+
+
+// Text after prefix, up to the first space (item IDs contain no spaces)
+static bool TakeIdAfter (const std::string& line, const char* prefix, std::string& id)
+{
+	size_t n = std::strlen (prefix);
+	if (line.compare (0, n, prefix) != 0)
+		return false;
+	size_t end = line.find (' ', n);
+	id = line.substr (n, end == std::string::npos ? std::string::npos : end - n);
+	return true;
+}
+
+
+static std::string QuotedAfter (const std::string& line, const char* prefix)
+{
+	size_t pos = line.find (prefix);
+	if (pos == std::string::npos)
+		return "";
+	size_t open = line.find ('"', pos + std::strlen (prefix));
+	size_t close = line.rfind ('"');
+	if (open == std::string::npos || close <= open)
+		return "";
+	return line.substr (open + 1, close - open - 1);
+}
+
+
+// Legacy .txt entry: "[HH:MM:SS] user" followed by indented detail lines
+static HistoryEntry ParseTextEntry (const std::string& block, const std::string& date)
+{
+	HistoryEntry e;
+	e.date = date;
+
+	std::istringstream ss (block);
+	std::string line;
+	bool first = true;
+	while (std::getline (ss, line)) {
+		if (!line.empty () && line.back () == '\r')
+			line.pop_back ();
+
+		if (first) {
+			first = false;
+			size_t close = line.find ("] ");
+			if (!line.empty () && line[0] == '[' && close != std::string::npos) {
+				e.time = line.substr (1, close - 1);
+				e.user = line.substr (close + 2);
+			}
+			continue;
+		}
+
+		if (TakeIdAfter (line, "  Export: ", e.itemId)) {
+			e.action   = "export";
+			e.newValue = QuotedAfter (line, e.itemId.c_str ());
+		} else if (TakeIdAfter (line, "  Use Project (resolve conflict): ", e.itemId)) {
+			e.action = "use-project";
+		} else if (TakeIdAfter (line, "  Use Server (resolve conflict): ", e.itemId)) {
+			e.action = "use-server";
+		} else if (line.compare (0, 10, "  Parent: ") == 0) {
+			e.parentId = line.substr (10);
+		} else if (line.compare (0, 15, "  Server name: ") == 0) {
+			(e.action == "use-project" ? e.oldValue : e.newValue) = QuotedAfter (line, "Server name:");
+		} else if (line.compare (0, 16, "  Project name: ") == 0) {
+			(e.action == "use-project" ? e.newValue : e.oldValue) = QuotedAfter (line, "Project name:");
+		}
+	}
+	return e;
+}
+
+
+HistoryEntry ParseChangeLogJsonLine (const std::string& line, const std::string& date)
+{
+	HistoryEntry e;
+	e.date = date;
+
+	std::string ts = JsonField (line.data (), line.size (), "ts");
+	size_t t = ts.find ('T');
+	e.time     = (t == std::string::npos) ? ts : ts.substr (t + 1);
+	e.user     = JsonField (line.data (), line.size (), "user");
+	e.action   = JsonField (line.data (), line.size (), "action");
+	e.itemId   = JsonField (line.data (), line.size (), "item");
+	e.parentId = JsonField (line.data (), line.size (), "parent");
+	e.oldValue = JsonField (line.data (), line.size (), "old");
+	e.newValue = JsonField (line.data (), line.size (), "new");
+	return e;
+}
+
+
+// ---------------------------------------------------------------------------
+// ChangeLogIndex
+// ---------------------------------------------------------------------------
+
+ChangeLogIndex::ChangeLogIndex () :
+	sidecarSize  (0),
+	mapThreshold (kDefaultMapThreshold)
+{
+}
+
+
+void ChangeLogIndex::Reset (const std::string& newLogDir)
+{
+	logDir = newLogDir;
+	files.clear ();
+	fileByName.clear ();
+	postings.clear ();
+	sidecarSize = 0;
+}
+
+
+uint32_t ChangeLogIndex::FindOrAddFile (const std::string& name)
+{
+	auto it = fileByName.find (name);
+	if (it != fileByName.end ())
+		return it->second;
+
+	uint32_t file = (uint32_t)files.size ();
+	files.push_back ({ name, 0 });
+	fileByName[name] = file;
+	return file;
+}
+
+
+void ChangeLogIndex::DropFile (uint32_t file)
+{
+	for (auto it = postings.begin (); it != postings.end ();) {
+		std::vector<Posting>& list = it->second;
+		list.erase (std::remove_if (list.begin (), list.end (),
+									[file] (const Posting& p) { return p.file == file; }),
+					list.end ());
+		if (list.empty ())
+			it = postings.erase (it);
+		else
+			++it;
+	}
+	files[file].indexedSize = 0;
+}
+
+
+// ---------------------------------------------------------------------------
+// Sidecar: header line, then append-only records
+//   post=<day file>\t<offset>\t<length>\t<item ID>
+//   file=<day file>\t<indexed size>
+// A post below the file's indexed size is a duplicate from a concurrent
+// update and is skipped, so two sessions may append the same delta.
+// ---------------------------------------------------------------------------
+
+bool ChangeLogIndex::LoadSidecar (uint64_t fromOffset)
+{
+	std::string path = JoinPath (logDir, kIndexFileName);
+	std::ifstream file (path, std::ios::binary);
+	if (!file.is_open ())
+		return false;
+	file.seekg ((std::streamoff)fromOffset);
+	std::ostringstream ss;
+	ss << file.rdbuf ();
+	std::string content = ss.str ();
+
+	size_t      pos        = 0;
+	bool        ok         = true;
+	bool        headerLine = (fromOffset == 0);
+	std::string lastName;
+	uint32_t    lastFile   = 0;
+	while (pos < content.size ()) {
+		size_t eol = content.find ('\n', pos);
+		if (eol == std::string::npos) {
+			ok = false;		// torn final line - rewrite the sidecar
+			break;
+		}
+		const char* line    = content.data () + pos;
+		const char* lineEnd = content.data () + eol;
+		pos = eol + 1;
+
+		if (headerLine) {
+			headerLine = false;
+			if (std::string (line, lineEnd) != kIndexHeader)
+				return false;
+			continue;
+		}
+
+		// Split "tag=f0\tf1\t..." in place; the item ID is the last field
+		const char* eq = static_cast<const char*> (std::memchr (line, '=', lineEnd - line));
+		if (eq == nullptr)
+			continue;
+		const char* fields[4];
+		size_t      lengths[4];
+		size_t      count = 0;
+		const char* p = eq + 1;
+		while (count < 4) {
+			const char* tab = (count == 3) ? nullptr : static_cast<const char*> (std::memchr (p, '\t', lineEnd - p));
+			const char* fieldEnd = (tab != nullptr) ? tab : lineEnd;
+			fields[count]  = p;
+			lengths[count] = (size_t)(fieldEnd - p);
+			count++;
+			if (tab == nullptr)
+				break;
+			p = tab + 1;
+		}
+
+		if (count < 2)
+			continue;
+		if (lastName.size () != lengths[0] || lastName.compare (0, lengths[0], fields[0], lengths[0]) != 0) {
+			lastName.assign (fields[0], lengths[0]);
+			lastFile = FindOrAddFile (lastName);
+		}
+
+		std::string tag (line, eq);
+		if (tag == "post" && count == 4) {
+			uint64_t offset = std::strtoull (fields[1], nullptr, 10);
+			if (offset < files[lastFile].indexedSize)
+				continue;
+			postings[std::string (fields[3], lengths[3])].push_back ({ lastFile, offset, (uint32_t)std::strtoul (fields[2], nullptr, 10) });
+		} else if (tag == "file" && count == 2) {
+			uint64_t size = std::strtoull (fields[1], nullptr, 10);
+			if (size > files[lastFile].indexedSize)
+				files[lastFile].indexedSize = size;
+		}
+	}
+
+	sidecarSize = fromOffset + pos;
+	return ok;
+}
+
+
+bool ChangeLogIndex::RewriteSidecar () const
+{
+	std::string content = std::string (kIndexHeader) + "\n";
+	for (const auto& item : postings) {
+		for (const Posting& p : item.second) {
+			content += "post=" + files[p.file].name + "\t" + std::to_string ((unsigned long long)p.offset) +
+					   "\t" + std::to_string (p.length) + "\t" + item.first + "\n";
+		}
+	}
+	for (const DayFile& f : files) {
+		if (f.indexedSize > 0)
+			content += "file=" + f.name + "\t" + std::to_string ((unsigned long long)f.indexedSize) + "\n";
+	}
+
+	return WriteFileAtomic (JoinPath (logDir, kIndexFileName), content);
+}
+
+
+// ---------------------------------------------------------------------------
+// Scan the unindexed tail of one day file; only complete entries are taken
+// (the writer may be mid-append), so indexedSize always ends on a boundary.
+// ---------------------------------------------------------------------------
+
+void ChangeLogIndex::ScanFile (uint32_t file, uint64_t fileSize, std::string& sidecarAppend)
+{
+	DayFile& day   = files[file];
+	uint64_t start = day.indexedSize;
+
+	FileRange range;
+	bool useMapping = mapThreshold > 0 && fileSize - start >= mapThreshold;
+	if (!range.Open (JoinPath (logDir, day.name), start, fileSize, useMapping))
+		return;
+
+	const char* data = range.Data ();
+	size_t      size = range.Size ();
+	bool        json = EndsWith (day.name, ".jsonl");
+
+	size_t consumed   = 0;
+	size_t entryStart = std::string::npos;
+	size_t entryEnd   = 0;
+	std::string entryId;
+
+	auto addPosting = [&] (const std::string& id, size_t begin, size_t end) {
+		if (id.empty ())
+			return;
+		Posting p = { file, start + begin, (uint32_t)(end - begin) };
+		postings[id].push_back (p);
+		sidecarAppend += "post=" + day.name + "\t" + std::to_string ((unsigned long long)p.offset) +
+						 "\t" + std::to_string (p.length) + "\t" + id + "\n";
+	};
+
+	size_t pos = 0;
+	while (pos < size) {
+		const char* nl = static_cast<const char*> (std::memchr (data + pos, '\n', size - pos));
+		if (nl == nullptr)
+			break;
+		size_t lineEnd = (size_t)(nl - data);
+		size_t next    = lineEnd + 1;
+
+		if (json) {
+			addPosting (JsonField (data + pos, lineEnd - pos, "item"), pos, lineEnd);
+			consumed = next;
+		} else {
+			std::string line = TrimLine (data + pos, data + lineEnd);
+			if (line.empty ()) {
+				// Blank line closes an entry
+				if (entryStart != std::string::npos)
+					addPosting (entryId, entryStart, entryEnd);
+				entryStart = std::string::npos;
+				entryId.clear ();
+				consumed = next;
+			} else if (line[0] == '[' && entryStart == std::string::npos) {
+				entryStart = pos;
+				entryEnd   = next;
+			} else if (entryStart != std::string::npos) {
+				entryEnd = next;
+				if (entryId.empty () &&
+					!TakeIdAfter (line, "  Export: ", entryId) &&
+					!TakeIdAfter (line, "  Use Project (resolve conflict): ", entryId))
+					TakeIdAfter (line, "  Use Server (resolve conflict): ", entryId);
+			}
+		}
+		pos = next;
+	}
+
+	if (consumed > 0) {
+		day.indexedSize = start + consumed;
+		sidecarAppend += "file=" + day.name + "\t" + std::to_string ((unsigned long long)day.indexedSize) + "\n";
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+// Update: pick up sidecar records from other sessions, then index new bytes
+// ---------------------------------------------------------------------------
+
+bool ChangeLogIndex::Update (const std::string& dir)
+{
+	if (dir != logDir)
+		Reset (dir);
+
+	std::map<std::string, uint64_t> dayFiles;
+	if (!ListDayFiles (logDir, dayFiles)) {
+		Reset (dir);
+		return false;
+	}
+
+	// Sidecar written by us or another session since the last update
+	bool     rewrite = false;
+	uint64_t onDisk  = 0;
+	std::string sidecarPath = JoinPath (logDir, kIndexFileName);
+	if (!GetFileSize (sidecarPath, onDisk) || onDisk < sidecarSize) {
+		Reset (dir);	// deleted or compacted - start over from what is on disk
+		if (onDisk > 0 && !LoadSidecar (0))
+			rewrite = true;
+	} else if (onDisk > sidecarSize) {
+		if (!LoadSidecar (sidecarSize))
+			rewrite = true;
+	}
+	if (onDisk == 0)
+		rewrite = true;
+
+	// Both files of a date are indexed: the .txt also holds what was logged
+	// before the .jsonl existed (Query drops the copies it shares)
+	std::set<std::string> chosen;
+	for (const auto& f : dayFiles)
+		chosen.insert (f.first);
+
+	for (uint32_t i = 0; i < files.size (); i++) {
+		if (files[i].indexedSize > 0 && chosen.count (files[i].name) == 0) {
+			DropFile (i);
+			rewrite = true;
+		}
+	}
+
+	std::string sidecarAppend;
+	for (const std::string& name : chosen) {
+		uint32_t file = FindOrAddFile (name);
+		uint64_t size = dayFiles[name];
+		if (size < files[file].indexedSize) {
+			DropFile (file);	// day file was rewritten - index it again
+			rewrite = true;
+		}
+		if (size > files[file].indexedSize)
+			ScanFile (file, size, sidecarAppend);
+	}
+
+	if (rewrite) {
+		if (RewriteSidecar ())
+			GetFileSize (sidecarPath, sidecarSize);
+	} else if (!sidecarAppend.empty ()) {
+		std::ofstream file (sidecarPath, std::ios::binary | std::ios::app);
+		if (file.is_open ()) {
+			file << sidecarAppend;
+			file.close ();
+			GetFileSize (sidecarPath, sidecarSize);
+		}
+	}
+
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Query: read just the indexed entries of one item, oldest first
+// ---------------------------------------------------------------------------
+
+std::vector<HistoryEntry> ChangeLogIndex::Query (const std::string& itemId) const
+{
+	std::vector<HistoryEntry> result;
+
+	auto it = postings.find (itemId);
+	if (it == postings.end ())
+		return result;
+
+	std::vector<Posting> list = it->second;
+	std::sort (list.begin (), list.end (), [this] (const Posting& a, const Posting& b) {
+		if (a.file != b.file)
+			return files[a.file].name < files[b.file].name;
+		return a.offset < b.offset;
+	});
+
+	std::vector<HistoryEntry> legacy;		// from .txt day files
+	std::ifstream file;
+	uint32_t openFile = (uint32_t)-1;
+	for (const Posting& p : list) {
+		const DayFile& day = files[p.file];
+		if (p.file != openFile) {
+			file.close ();
+			file.clear ();
+			file.open (JoinPath (logDir, day.name), std::ios::binary);
+			openFile = p.file;
+		}
+		if (!file.is_open ())
+			continue;
+
+		std::string text (p.length, '\0');
+		file.seekg ((std::streamoff)p.offset);
+		file.read (&text[0], p.length);
+		if ((uint32_t)file.gcount () != p.length) {
+			file.clear ();
+			continue;
+		}
+
+		std::string date = day.name.substr (0, 10);
+		bool        json = EndsWith (day.name, ".jsonl");
+		HistoryEntry e = json ? ParseChangeLogJsonLine (text, date) : ParseTextEntry (text, date);
+		if (e.itemId == itemId)
+			(json ? result : legacy).push_back (e);
+	}
+
+	// Every record is written to both day files: each .jsonl record cancels
+	// one .txt entry with the same time, user and action
+	if (!legacy.empty ()) {
+		auto key = [] (const HistoryEntry& e) { return e.date + "T" + e.time + "\t" + e.user + "\t" + e.action; };
+		std::map<std::string, unsigned> structured;
+		for (const HistoryEntry& e : result)
+			structured[key (e)]++;
+		for (const HistoryEntry& e : legacy) {
+			auto match = structured.find (key (e));
+			if (match != structured.end () && match->second > 0)
+				match->second--;
+			else
+				result.push_back (e);
+		}
+		std::stable_sort (result.begin (), result.end (), [] (const HistoryEntry& a, const HistoryEntry& b) {
+			return a.date != b.date ? a.date < b.date : a.time < b.time;
+		});
+	}
+
+	return result;
+}
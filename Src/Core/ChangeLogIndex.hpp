@@ -0,0 +1,88 @@
+#ifndef CHANGELOGINDEX_HPP
+#define CHANGELOGINDEX_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// One changelog entry for an item, parsed from a .jsonl record or a legacy
+// human-readable .txt entry
+// ---------------------------------------------------------------------------
+
+struct HistoryEntry {
+	std::string  date;			// YYYY-MM-DD (from the day file name)
+	std::string  time;			// HH:MM:SS
+	std::string  user;
+	std::string  action;		// "export", "use-project", "use-server"
+	std::string  itemId;
+	std::string  parentId;
+	std::string  oldValue;
+	std::string  newValue;
+};
+
+
+// Parse one .jsonl record; date comes from the day file name.
+HistoryEntry  ParseChangeLogJsonLine (const std::string& line, const std::string& date);
+
+
+// ---------------------------------------------------------------------------
+// Per-item index over the changelog/ directory
+//
+// The index maps item IDs to (day file, offset, length) of their entries and
+// is kept in the sidecar changelog/history.idx. Day files are append-only, so
+// Update () scans only the bytes added since the last scan (memory-mapped
+// for large tails) and appends the new postings to the sidecar. Both day
+// files are indexed; Query () drops the .txt copies of .jsonl records, so
+// entries logged before the .jsonl existed still show up.
+// ---------------------------------------------------------------------------
+
+class ChangeLogIndex {
+public:
+	ChangeLogIndex ();
+
+	// Bring the index up to date with logDir. Returns false if the directory
+	// cannot be listed (no changelog yet).
+	bool  Update (const std::string& logDir);
+
+	// History of one item, oldest first (reads only the indexed entries).
+	std::vector<HistoryEntry>  Query (const std::string& itemId) const;
+
+	size_t  GetFileCount () const  { return files.size (); }
+	size_t  GetItemCount () const  { return postings.size (); }
+
+	// Memory-map day files whose unscanned tail is at least this large
+	// (0 disables mapping; tails are then read with a plain file read).
+	void  SetMapThreshold (uint64_t bytes)  { mapThreshold = bytes; }
+
+private:
+	struct DayFile {
+		std::string  name;			// e.g. "2025-03-14.jsonl"
+		uint64_t     indexedSize;	// bytes scanned so far (ends on an entry boundary)
+	};
+
+	struct Posting {
+		uint32_t  file;				// index into files
+		uint64_t  offset;
+		uint32_t  length;
+	};
+
+	void      Reset (const std::string& newLogDir);
+	uint32_t  FindOrAddFile (const std::string& name);
+	void      DropFile (uint32_t file);
+	bool      LoadSidecar (uint64_t fromOffset);
+	bool      RewriteSidecar () const;
+	void      ScanFile (uint32_t file, uint64_t fileSize, std::string& sidecarAppend);
+
+	std::string                                          logDir;
+	std::vector<DayFile>                                 files;
+	std::unordered_map<std::string, uint32_t>            fileByName;
+	std::unordered_map<std::string, std::vector<Posting>> postings;	// item ID -> entries
+	uint64_t                                             sidecarSize;
+	uint64_t                                             mapThreshold;
+};
+
+
+#endif // CHANGELOGINDEX_HPP
@@ -0,0 +1,181 @@
+#include "ClassificationModel.hpp"
+#include "ItemIndex.hpp"
+#include "Trace.hpp"
+
+
+// Items compared between progress steps (and cancellation checks)
+static const size_t kCompareStepItems = 256;
+
+
+// ---------------------------------------------------------------------------
+// Helper: flatten tree into an array for comparison
+// ---------------------------------------------------------------------------
+
+struct FlatItem {
+	std::string  id;
+	std::string  name;
+	std::string  description;
+	ItemGuid     guid;
+	ItemGuid     systemGuid;
+};
+
+static void FlattenHelper (const std::vector<ClassificationNode>& nodes,
+						   std::vector<FlatItem>& result,
+						   const ItemGuid& systemGuid)
+{
+	for (size_t i = 0; i < nodes.size (); i++) {
+		FlatItem fi;
+		fi.id          = nodes[i].id;
+		fi.name        = nodes[i].name;
+		fi.description = nodes[i].description;
+		fi.guid        = nodes[i].guid;
+		fi.systemGuid  = systemGuid;
+		result.push_back (fi);
+		FlattenHelper (nodes[i].children, result, systemGuid);
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+// Compare project and server classification trees
+// ---------------------------------------------------------------------------
+
+std::vector<DiffEntry> CompareClassifications (
+	const std::vector<ClassificationTree>& project,
+	const std::vector<ClassificationTree>& server,
+	WorkProgress* progress)
+{
+	TraceScope trace ("CompareClassifications");
+	std::vector<DiffEntry> result;
+
+	// Flatten the project; index both sides (interned IDs, O(1) lookups)
+	TraceScope flattenTrace ("FlattenHelper", "project");
+	std::vector<FlatItem> projectItems;
+	for (size_t s = 0; s < project.size (); s++)
+		FlattenHelper (project[s].rootItems, projectItems, project[s].systemGuid);
+	flattenTrace.End ();
+
+	ItemIndex projectIndex (project);
+	ItemIndex serverIndex (server);
+
+	size_t total = projectItems.size () + serverIndex.Size ();
+
+	// For each project item, check if it exists in server
+	TraceScope matchTrace ("match project items");
+	for (size_t i = 0; i < projectItems.size (); i++) {
+		if (progress != nullptr && i % kCompareStepItems == 0 && !progress->Step (i, total))
+			return result;
+
+		DiffEntry entry;
+		entry.id                = projectItems[i].id;
+		entry.projectName       = projectItems[i].name;
+		entry.description       = projectItems[i].description;
+		entry.projectItemGuid   = projectItems[i].guid;
+		entry.projectSystemGuid = projectItems[i].systemGuid;
+
+		ItemIndex::Ref match = serverIndex.Find (projectItems[i].id);
+		if (match != ItemIndex::kNoItem) {
+			entry.serverName = serverIndex.GetNode (match).name;
+			entry.status = (projectItems[i].name == entry.serverName)
+				? DiffStatus::Match
+				: DiffStatus::Conflict;
+		} else {
+			entry.status = DiffStatus::OnlyInProject;
+		}
+
+		result.push_back (entry);
+	}
+
+	matchTrace.End ();
+
+	// Find items only in server (Refs are in document order)
+	TraceScope serverOnlyTrace ("find server-only items");
+	for (ItemIndex::Ref j = 0; j < (ItemIndex::Ref)serverIndex.Size (); j++) {
+		if (progress != nullptr && j % kCompareStepItems == 0 && !progress->Step (projectItems.size () + j, total))
+			return result;
+
+		const ClassificationNode& node = serverIndex.GetNode (j);
+		if (projectIndex.Find (node.id) == ItemIndex::kNoItem) {
+			DiffEntry entry;
+			entry.id          = node.id;
+			entry.serverName  = node.name;
+			entry.description = node.description;
+			entry.status      = DiffStatus::OnlyInServer;
+			result.push_back (entry);
+		}
+	}
+
+	if (progress != nullptr)
+		progress->Step (total, total);
+
+	return result;
+}
+
+
+// ---------------------------------------------------------------------------
+// Fingerprints (FNV-1a 64 over the UTF-8 fields, GUIDs and the tree structure)
+// ---------------------------------------------------------------------------
+
+static void HashBytes (std::uint64_t& hash, const char* data, size_t size)
+{
+	for (size_t i = 0; i < size; i++) {
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ULL;
+	}
+}
+
+
+static void HashString (std::uint64_t& hash, const std::string& text)
+{
+	HashBytes (hash, text.c_str (), text.size () + 1);		// with the terminator as separator
+}
+
+
+static void HashGuid (std::uint64_t& hash, const ItemGuid& guid)
+{
+	HashBytes (hash, (const char*)guid.bytes, sizeof (guid.bytes));
+}
+
+
+static void HashNodes (std::uint64_t& hash, const std::vector<ClassificationNode>& nodes)
+{
+	char open = '(', close = ')';
+	HashBytes (hash, &open, 1);
+	for (const ClassificationNode& node : nodes) {
+		HashString (hash, node.id);
+		HashString (hash, node.name);
+		HashString (hash, node.description);
+		HashGuid (hash, node.guid);		// actions address project items by GUID
+		HashNodes (hash, node.children);
+	}
+	HashBytes (hash, &close, 1);
+}
+
+
+std::uint64_t HashClassifications (const std::vector<ClassificationTree>& trees)
+{
+	TraceScope trace ("HashClassifications");
+	std::uint64_t hash = 14695981039346656037ULL;
+	for (const ClassificationTree& tree : trees) {
+		HashString (hash, tree.systemName);
+		HashString (hash, tree.version);
+		HashGuid (hash, tree.systemGuid);
+		HashNodes (hash, tree.rootItems);
+	}
+	return hash != 0 ? hash : 1;
+}
+
+
+std::uint64_t HashDiffEntries (const std::vector<DiffEntry>& entries)
+{
+	std::uint64_t hash = 14695981039346656037ULL;
+	for (const DiffEntry& entry : entries) {
+		char status = (char)entry.status;
+		HashBytes (hash, &status, 1);
+		HashString (hash, entry.id);
+		HashString (hash, entry.projectName);
+		HashString (hash, entry.serverName);
+		HashGuid (hash, entry.projectItemGuid);
+	}
+	return hash != 0 ? hash : 1;
+}
@@ -0,0 +1,84 @@
+#ifndef CLASSIFICATIONMODEL_HPP
+#define CLASSIFICATIONMODEL_HPP
+
+#include "WorkProgress.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// Project GUID carried through the model (API_Guid in the add-on, converted
+// by its adapters). All zero for XML-sourced items.
+// ---------------------------------------------------------------------------
+
+struct ItemGuid {
+	unsigned char  bytes[16];
+
+	ItemGuid () { std::memset (bytes, 0, sizeof (bytes)); }
+
+	bool  IsNull () const { return *this == ItemGuid (); }
+
+	bool operator== (const ItemGuid& other) const { return std::memcmp (bytes, other.bytes, sizeof (bytes)) == 0; }
+	bool operator!= (const ItemGuid& other) const { return !(*this == other); }
+};
+
+
+// ---------------------------------------------------------------------------
+// Data structures (all text is UTF-8)
+// ---------------------------------------------------------------------------
+
+struct ClassificationNode {
+	std::string    id;
+	std::string    name;
+	std::string    description;
+	ItemGuid       guid;		// null for XML-sourced items
+	std::vector<ClassificationNode>  children;
+};
+
+struct ClassificationTree {
+	std::string    systemName;
+	std::string    version;
+	ItemGuid       systemGuid;	// null for XML-sourced trees
+	std::vector<ClassificationNode>  rootItems;
+};
+
+enum class DiffStatus {
+	Match,
+	Conflict,
+	OnlyInProject,
+	OnlyInServer
+};
+
+struct DiffEntry {
+	std::string    id;
+	std::string    projectName;
+	std::string    serverName;
+	std::string    description;
+	DiffStatus     status;
+	ItemGuid       projectItemGuid;		// GUID of item in project
+	ItemGuid       projectSystemGuid;	// GUID of system in project
+
+	DiffEntry () : status (DiffStatus::Match) {}
+};
+
+
+// ---------------------------------------------------------------------------
+// Functions
+// ---------------------------------------------------------------------------
+
+// Safe to call from a worker. With progress, steps count compared items
+// (project items, then server items).
+std::vector<DiffEntry>  CompareClassifications (
+	const std::vector<ClassificationTree>& project,
+	const std::vector<ClassificationTree>& server,
+	WorkProgress* progress = nullptr);
+
+// Content fingerprints for refresh memoization (never 0, which means unknown).
+std::uint64_t  HashClassifications (const std::vector<ClassificationTree>& trees);
+std::uint64_t  HashDiffEntries (const std::vector<DiffEntry>& entries);
+
+
+#endif // CLASSIFICATIONMODEL_HPP
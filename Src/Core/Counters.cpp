@@ -0,0 +1,155 @@
+#include "Counters.hpp"
+
+#include <atomic>
+#include <fstream>
+
+
+// ---------------------------------------------------------------------------
+// Registry
+// ---------------------------------------------------------------------------
+
+struct CounterInfo {
+	const char*  name;
+	bool         gauge;
+};
+
+static const CounterInfo  kCounterInfo[kCounterCount] = {
+	{ "master_reads",                false },
+	{ "master_bytes_read",           false },
+	{ "master_writes",               false },
+	{ "master_bytes_written",        false },
+	{ "master_stats",                false },
+	{ "lock_file_reads",             false },
+	{ "lock_file_writes",            false },
+	{ "commit_guard_attempts",       false },
+	{ "changelog_appends",           false },
+	{ "changelog_records",           false },
+	{ "changelog_bytes_written",     false },
+	{ "store_versions",              false },
+	{ "store_blobs_written",         false },
+	{ "store_bytes_written",         false },
+	{ "sync_requests",               false },
+	{ "sync_bytes_sent",             false },
+	{ "sync_bytes_received",         false },
+	{ "acapi_classification_calls",  false },
+	{ "acapi_property_calls",        false },
+	{ "acapi_calls_last_refresh",    true },
+	{ "refreshes",                   false },
+	{ "project_items",               true },
+	{ "server_items",                true },
+	{ "diff_matches",                true },
+	{ "diff_conflicts",              true },
+	{ "diff_only_in_project",        true },
+	{ "diff_only_in_server",         true },
+	{ "property_drift",              true }
+};
+
+static std::atomic<std::uint64_t>  counterValues[kCounterCount];
+
+
+void AddCounter (Counter counter, std::uint64_t amount)
+{
+	counterValues[(size_t)counter].fetch_add (amount, std::memory_order_relaxed);
+}
+
+
+void SetCounter (Counter counter, std::uint64_t value)
+{
+	counterValues[(size_t)counter].store (value, std::memory_order_relaxed);
+}
+
+
+std::uint64_t GetCounter (Counter counter)
+{
+	return counterValues[(size_t)counter].load (std::memory_order_relaxed);
+}
+
+
+void ResetCounters ()
+{
+	for (std::atomic<std::uint64_t>& value : counterValues)
+		value.store (0, std::memory_order_relaxed);
+}
+
+
+const char* CounterName (Counter counter)
+{
+	return kCounterInfo[(size_t)counter].name;
+}
+
+
+bool IsGauge (Counter counter)
+{
+	return kCounterInfo[(size_t)counter].gauge;
+}
+
+
+// ---------------------------------------------------------------------------
+// Snapshots
+// ---------------------------------------------------------------------------
+
+CounterSnapshot TakeCounterSnapshot ()
+{
+	CounterSnapshot snapshot;
+	for (size_t i = 0; i < kCounterCount; i++)
+		snapshot.values[i] = counterValues[i].load (std::memory_order_relaxed);
+	return snapshot;
+}
+
+
+CounterSnapshot SubtractCounterSnapshot (const CounterSnapshot& after, const CounterSnapshot& before)
+{
+	CounterSnapshot delta;
+	for (size_t i = 0; i < kCounterCount; i++) {
+		if (kCounterInfo[i].gauge || after.values[i] < before.values[i])
+			delta.values[i] = after.values[i];		// gauge, or reset in between
+		else
+			delta.values[i] = after.values[i] - before.values[i];
+	}
+	return delta;
+}
+
+
+std::string FormatCountersJson (const CounterSnapshot& snapshot)
+{
+	std::string json = "{\"counters\": {\n";
+	for (size_t i = 0; i < kCounterCount; i++) {
+		json += "\t\"" + std::string (kCounterInfo[i].name) + "\": " + std::to_string ((unsigned long long)snapshot.values[i]);
+		json += i + 1 < kCounterCount ? ",\n" : "\n";
+	}
+	json += "}}\n";
+	return json;
+}
+
+
+bool WriteCountersJson (const std::string& path, const CounterSnapshot& snapshot)
+{
+	std::string json = FormatCountersJson (snapshot);
+	std::ofstream file (path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open ())
+		return false;
+	file.write (json.data (), json.size ());
+	return file.good ();
+}
+
+
+std::string FormatCounterLines (const CounterSnapshot& snapshot)
+{
+	std::string lines;
+	for (size_t i = 0; i < kCounterCount; i++)
+		lines += std::string (kCounterInfo[i].name) + " " + std::to_string ((unsigned long long)snapshot.values[i]) + "\n";
+	return lines;
+}
+
+
+std::string FormatCounterActivity (const CounterSnapshot& delta)
+{
+	std::string text;
+	for (size_t i = 0; i < kCounterCount; i++) {
+		if (kCounterInfo[i].gauge || delta.values[i] == 0)
+			continue;
+		text += text.empty () ? "" : ", ";
+		text += std::string (kCounterInfo[i].name) + " " + std::to_string ((unsigned long long)delta.values[i]);
+	}
+	return text;
+}
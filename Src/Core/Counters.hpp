@@ -0,0 +1,98 @@
+#ifndef COUNTERS_HPP
+#define COUNTERS_HPP
+
+#include <cstdint>
+#include <string>
+
+
+// ---------------------------------------------------------------------------
+// Process-wide diagnostic counters
+//
+// Every master/lock/changelog file access and ACAPI classification or
+// property call bumps a relaxed atomic (no lock, no allocation); gauges hold
+// the latest value (item and diff counts of the shown data). Readers take a
+// snapshot; the difference of two snapshots tells what one action cost.
+// ---------------------------------------------------------------------------
+
+enum class Counter {
+	// Master (single XML, shards and manifest)
+	MasterReads,				// whole-file reads
+	MasterBytesRead,
+	MasterWrites,				// full-file rewrites
+	MasterBytesWritten,
+	MasterStats,				// size/mtime checks
+
+	// Locks
+	LockFileReads,				// .lock file opens
+	LockFileWrites,
+	CommitGuardAttempts,		// commit guard create attempts (incl. retries)
+
+	// Changelog
+	ChangeLogAppends,			// day file appends (.txt and .jsonl)
+	ChangeLogRecords,
+	ChangeLogBytesWritten,
+
+	// Version store (changelog/store)
+	StoreVersions,				// versions added
+	StoreBlobsWritten,			// new blobs (shared ones are not rewritten)
+	StoreBytesWritten,
+
+	// Sync service (this process, either end)
+	SyncRequests,				// request/reply round trips
+	SyncBytesSent,
+	SyncBytesReceived,
+
+	// ArchiCAD
+	AcapiClassificationCalls,
+	AcapiPropertyCalls,
+	AcapiCallsLastRefresh,		// gauge
+	Refreshes,
+
+	// Shown data (gauges)
+	ProjectItems,
+	ServerItems,
+	DiffMatches,
+	DiffConflicts,
+	DiffOnlyInProject,
+	DiffOnlyInServer,
+	PropertyDrift,				// items and definitions whose applicability differs
+
+	Count
+};
+
+static const size_t kCounterCount = (size_t)Counter::Count;
+
+struct CounterSnapshot {
+	std::uint64_t  values[kCounterCount];
+
+	std::uint64_t  Get (Counter counter) const  { return values[(size_t)counter]; }
+};
+
+void           AddCounter (Counter counter, std::uint64_t amount = 1);
+void           SetCounter (Counter counter, std::uint64_t value);		// gauges
+std::uint64_t  GetCounter (Counter counter);
+void           ResetCounters ();
+
+const char*    CounterName (Counter counter);		// e.g. "master_bytes_read"
+bool           IsGauge (Counter counter);
+
+CounterSnapshot  TakeCounterSnapshot ();
+
+// after - before for counters, after for gauges.
+CounterSnapshot  SubtractCounterSnapshot (const CounterSnapshot& after, const CounterSnapshot& before);
+
+// {"counters": {"master_reads": 3, ...}} with every counter.
+std::string  FormatCountersJson (const CounterSnapshot& snapshot);
+
+// False if the file cannot be written.
+bool  WriteCountersJson (const std::string& path, const CounterSnapshot& snapshot);
+
+// One "name value" line per counter.
+std::string  FormatCounterLines (const CounterSnapshot& snapshot);
+
+// "master_reads 1, master_bytes_read 52311" for the counters (not gauges)
+// that moved in a delta; empty if none did.
+std::string  FormatCounterActivity (const CounterSnapshot& delta);
+
+
+#endif // COUNTERS_HPP
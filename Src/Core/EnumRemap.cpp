@@ -0,0 +1,219 @@
+#include "EnumRemap.hpp"
+#include "Trace.hpp"
+
+#include <map>
+
+
+// ---------------------------------------------------------------------------
+// Text normalization
+// ---------------------------------------------------------------------------
+
+static bool IsSpace (char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+
+// Lowercase of a code point in the Latin ranges, others unchanged
+static unsigned ToLowerLatin (unsigned cp)
+{
+	if (cp >= 'A' && cp <= 'Z')
+		return cp + 0x20;
+	if (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7)
+		return cp + 0x20;
+	// Latin Extended-A: pairs start on even code points, except 0139-0148 and 0179-017E
+	if ((cp >= 0x100 && cp <= 0x137) || (cp >= 0x14A && cp <= 0x177))
+		return (cp % 2 == 0) ? cp + 1 : cp;
+	if ((cp >= 0x139 && cp <= 0x148) || (cp >= 0x179 && cp <= 0x17E))
+		return (cp % 2 == 1) ? cp + 1 : cp;
+	return cp;
+}
+
+
+std::string NormalizeEnumText (const std::string& text)
+{
+	std::string result;
+	result.reserve (text.size ());
+
+	bool pendingSpace = false;
+	for (size_t i = 0; i < text.size (); i++) {
+		unsigned char c = (unsigned char)text[i];
+		if (IsSpace ((char)c)) {
+			pendingSpace = !result.empty ();
+			continue;
+		}
+		if (pendingSpace) {
+			result += ' ';
+			pendingSpace = false;
+		}
+
+		// Two-byte UTF-8 sequences cover U+0080-U+07FF, which holds every
+		// letter folded here; longer sequences are copied as they are
+		if ((c & 0xE0) == 0xC0 && i + 1 < text.size () && ((unsigned char)text[i + 1] & 0xC0) == 0x80) {
+			unsigned cp = ((c & 0x1F) << 6) | ((unsigned char)text[i + 1] & 0x3F);
+			cp = ToLowerLatin (cp);
+			result += (char)(0xC0 | (cp >> 6));
+			result += (char)(0x80 | (cp & 0x3F));
+			i++;
+		} else {
+			result += (char)(c < 0x80 ? ToLowerLatin (c) : c);
+		}
+	}
+	return result;
+}
+
+
+// ---------------------------------------------------------------------------
+// Table
+// ---------------------------------------------------------------------------
+
+std::string EnumRemapTable::MakeKey (const std::string& group, const std::string& name, const std::string& key)
+{
+	return group + '\x1f' + name + '\x1f' + key;
+}
+
+
+void EnumRemapTable::Build (const std::vector<PropertyDefinitionInfo>& project,
+							const std::vector<PropertyDefinitionInfo>& master)
+{
+	TraceScope trace ("build enum remap");
+	toProject.clear ();
+	toMaster.clear ();
+	unmatched.clear ();
+	matched = 0;
+
+	std::map<std::pair<std::string, std::string>, const PropertyDefinitionInfo*> projectByKey;
+	for (const PropertyDefinitionInfo& definition : project) {
+		if (!definition.enumValues.empty ())
+			projectByKey.emplace (std::make_pair (definition.group, definition.name), &definition);
+	}
+
+	for (const PropertyDefinitionInfo& masterDefinition : master) {
+		if (masterDefinition.enumValues.empty ())
+			continue;
+		auto found = projectByKey.find (std::make_pair (masterDefinition.group, masterDefinition.name));
+		if (found == projectByKey.end ())
+			continue;		// the definition itself is missing, reported as such
+		const PropertyDefinitionInfo& projectDefinition = *found->second;
+		projectByKey.erase (found);
+
+		// Project values by normalized text; equal texts are taken in order
+		std::unordered_map<std::string, std::vector<size_t>> byText;
+		for (size_t v = projectDefinition.enumValues.size (); v-- > 0;)
+			byText[NormalizeEnumText (projectDefinition.enumValues[v].text)].push_back (v);
+
+		std::vector<bool> projectUsed (projectDefinition.enumValues.size (), false);
+		for (const EnumValueInfo& value : masterDefinition.enumValues) {
+			auto candidates = byText.find (NormalizeEnumText (value.text));
+			if (candidates == byText.end () || candidates->second.empty ()) {
+				PropertyDrift entry;
+				entry.group = masterDefinition.group;
+				entry.name  = masterDefinition.name;
+				entry.value = value.text;
+				unmatched.push_back (entry);
+				continue;
+			}
+
+			size_t v = candidates->second.back ();
+			candidates->second.pop_back ();
+			projectUsed[v] = true;
+
+			const std::string& projectKey = projectDefinition.enumValues[v].key;
+			toProject[MakeKey (masterDefinition.group, masterDefinition.name, value.key)] = projectKey;
+			toMaster[MakeKey (masterDefinition.group, masterDefinition.name, projectKey)]  = value.key;
+			matched++;
+		}
+
+		for (size_t v = 0; v < projectDefinition.enumValues.size (); v++) {
+			if (projectUsed[v])
+				continue;
+			PropertyDrift entry;
+			entry.group     = projectDefinition.group;
+			entry.name      = projectDefinition.name;
+			entry.value     = projectDefinition.enumValues[v].text;
+			entry.inProject = true;
+			unmatched.push_back (entry);
+		}
+	}
+}
+
+
+std::string EnumRemapTable::ToProject (const std::string& group, const std::string& name, const std::string& masterKey) const
+{
+	auto found = toProject.find (MakeKey (group, name, masterKey));
+	return found != toProject.end () ? found->second : std::string ();
+}
+
+
+std::string EnumRemapTable::ToMaster (const std::string& group, const std::string& name, const std::string& projectKey) const
+{
+	auto found = toMaster.find (MakeKey (group, name, projectKey));
+	return found != toMaster.end () ? found->second : std::string ();
+}
+
+
+// ---------------------------------------------------------------------------
+// Fingerprint (FNV-1a 64, fields separated by their terminators)
+// ---------------------------------------------------------------------------
+
+static void HashString (std::uint64_t& hash, const std::string& text)
+{
+	for (size_t i = 0; i <= text.size (); i++) {
+		hash ^= (unsigned char)text.c_str ()[i];
+		hash *= 1099511628211ULL;
+	}
+}
+
+
+std::uint64_t HashEnumValues (const std::vector<PropertyDefinitionInfo>& definitions)
+{
+	std::uint64_t hash = 14695981039346656037ULL;
+	for (const PropertyDefinitionInfo& definition : definitions) {
+		if (definition.enumValues.empty ())
+			continue;
+		HashString (hash, definition.group);
+		HashString (hash, definition.name);
+		for (const EnumValueInfo& value : definition.enumValues) {
+			HashString (hash, value.key);
+			HashString (hash, value.text);
+		}
+	}
+	return hash != 0 ? hash : 1;
+}
+
+
+// ---------------------------------------------------------------------------
+// Cache
+// ---------------------------------------------------------------------------
+
+std::shared_ptr<const EnumRemapTable> EnumRemapCache::Get (const std::vector<PropertyDefinitionInfo>& project,
+														   const std::vector<PropertyDefinitionInfo>& master,
+														   bool* rebuilt)
+{
+	std::uint64_t projectHash = HashEnumValues (project);
+	std::uint64_t masterHash  = HashEnumValues (master);
+
+	size_t index = 0;
+	while (index < entries.size () && entries[index].projectHash != projectHash)
+		index++;
+
+	if (index == entries.size ()) {
+		if (entries.size () >= kMaxProjects)
+			entries.pop_back ();
+		entries.insert (entries.begin (), Entry { projectHash, 0, nullptr });
+	} else if (index != 0) {
+		Entry entry = entries[index];
+		entries.erase (entries.begin () + index);
+		entries.insert (entries.begin (), entry);
+	}
+
+	Entry& entry = entries.front ();
+	bool build = entry.table == nullptr || entry.masterHash != masterHash;
+	if (build) {
+		entry.table      = std::make_shared<const EnumRemapTable> (project, master);
+		entry.masterHash = masterHash;
+	}
+	if (rebuilt != nullptr)
+		*rebuilt = build;
+	return entry.table;
+}
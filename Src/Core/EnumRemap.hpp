@@ -0,0 +1,91 @@
+#ifndef ENUMREMAP_HPP
+#define ENUMREMAP_HPP
+
+#include "PropertyApplicability.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// Enumeration value GUIDs across projects
+//
+// ArchiCAD keys enumeration values by GUIDs that differ in every project, so
+// the same value ("Czosnek główkowaty") has one key on the master and another
+// in each project. Values are matched by normalized display text within the
+// same definition (group + name); equal texts pair up in order. The table
+// answers a translation in one hash lookup.
+// ---------------------------------------------------------------------------
+
+// Trimmed, inner whitespace collapsed to one space, Latin letters (ASCII,
+// Latin-1 and Latin Extended-A, so Polish too) lowercased.
+std::string  NormalizeEnumText (const std::string& text);
+
+class EnumRemapTable {
+public:
+	EnumRemapTable () : matched (0) {}
+	EnumRemapTable (const std::vector<PropertyDefinitionInfo>& project,
+					const std::vector<PropertyDefinitionInfo>& master)		{ Build (project, master); }
+
+	void  Build (const std::vector<PropertyDefinitionInfo>& project,
+				 const std::vector<PropertyDefinitionInfo>& master);
+
+	// Key of the same value on the other side ("" if it has none).
+	std::string  ToProject (const std::string& group, const std::string& name, const std::string& masterKey) const;
+	std::string  ToMaster (const std::string& group, const std::string& name, const std::string& projectKey) const;
+
+	size_t  GetMatchedCount () const						{ return matched; }
+
+	// Values of shared definitions that only one side has (itemId empty).
+	const std::vector<PropertyDrift>&  GetUnmatched () const	{ return unmatched; }
+
+private:
+	static std::string  MakeKey (const std::string& group, const std::string& name, const std::string& key);
+
+	std::unordered_map<std::string, std::string>  toProject;	// group, name, master key -> project key
+	std::unordered_map<std::string, std::string>  toMaster;
+	std::vector<PropertyDrift>                    unmatched;
+	size_t                                        matched;
+};
+
+
+// Fingerprint of the enumeration values only (never 0): the value GUIDs make
+// it differ between projects.
+std::uint64_t  HashEnumValues (const std::vector<PropertyDefinitionInfo>& definitions);
+
+
+// ---------------------------------------------------------------------------
+// Tables of the projects seen recently
+//
+// A project is recognized by the hash of its enumeration values, so switching
+// between open projects reuses each one's table. An entry is rebuilt when the
+// master's values changed; a project whose values changed gets a new entry
+// and the least recently used one is dropped.
+// ---------------------------------------------------------------------------
+
+class EnumRemapCache {
+public:
+	static constexpr size_t kMaxProjects = 4;
+
+	// rebuilt, if given, tells whether the table had to be built.
+	std::shared_ptr<const EnumRemapTable>  Get (const std::vector<PropertyDefinitionInfo>& project,
+												const std::vector<PropertyDefinitionInfo>& master,
+												bool* rebuilt = nullptr);
+
+	size_t  GetSize () const		{ return entries.size (); }
+
+private:
+	struct Entry {
+		std::uint64_t                          projectHash;
+		std::uint64_t                          masterHash;
+		std::shared_ptr<const EnumRemapTable>  table;
+	};
+
+	std::vector<Entry>  entries;		// most recently used first
+};
+
+
+#endif // ENUMREMAP_HPP
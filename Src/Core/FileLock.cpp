@@ -1,4 +1,5 @@
 #include "FileLock.hpp"
+#include "Counters.hpp"
 
 #include <fstream>
 #include <string>
@@ -6,28 +7,22 @@
 #include <cstdio>
 #include <ctime>
 
+#if defined (_WIN32)
 #include <windows.h>
-
-
-// ---------------------------------------------------------------------------
-// Helper: convert GS::UniString to UTF-8 std::string
-// ---------------------------------------------------------------------------
-
-static std::string ToUtf8 (const GS::UniString& us)
-{
-	if (us.IsEmpty ())
-		return "";
-	return std::string (us.ToCStr (0, MaxUSize, CC_UTF8).Get ());
-}
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
 
 
 // ---------------------------------------------------------------------------
 // Helper: get lock file path from XML path
 // ---------------------------------------------------------------------------
 
-static std::string GetLockPath (const GS::UniString& xmlPath)
+static std::string GetLockPath (const std::string& xmlPath)
 {
-	return ToUtf8 (xmlPath) + ".lock";
+	return xmlPath + ".lock";
 }
 
 
@@ -49,19 +44,30 @@ static std::string GetTimestamp ()
 // Get "COMPUTERNAME\USERNAME" for the current session
 // ---------------------------------------------------------------------------
 
-GS::UniString GetCurrentUser ()
+std::string GetCurrentUser ()
 {
-	const char* comp = std::getenv ("COMPUTERNAME");
-	const char* user = std::getenv ("USERNAME");
-
-	std::string result;
-	if (comp != nullptr)
-		result += comp;
-	result += "\\";
-	if (user != nullptr)
-		result += user;
-
-	return GS::UniString (result.c_str (), CC_UTF8);
+	// Environment doesn't change during the session - read it once
+	static const std::string cached = [] () {
+#if defined (_WIN32)
+		const char* comp = std::getenv ("COMPUTERNAME");
+		const char* user = std::getenv ("USERNAME");
+#else
+		char host[256] = {};
+		const char* comp = gethostname (host, sizeof (host) - 1) == 0 ? host : nullptr;
+		const char* user = std::getenv ("USER");
+#endif
+
+		std::string result;
+		if (comp != nullptr)
+			result += comp;
+		result += "\\";
+		if (user != nullptr)
+			result += user;
+
+		return result;
+	} ();
+
+	return cached;
 }
 
 
@@ -69,12 +75,20 @@ GS::UniString GetCurrentUser ()
 // Get unique session ID (process ID) for this ArchiCAD instance
 // ---------------------------------------------------------------------------
 
-GS::UniString GetSessionId ()
+std::string GetSessionId ()
 {
-	DWORD pid = GetCurrentProcessId ();
-	char buf[16];
-	snprintf (buf, sizeof (buf), "%lu", (unsigned long)pid);
-	return GS::UniString (buf, CC_UTF8);
+	static const std::string cached = [] () {
+#if defined (_WIN32)
+		unsigned long pid = (unsigned long)GetCurrentProcessId ();
+#else
+		unsigned long pid = (unsigned long)getpid ();
+#endif
+		char buf[16];
+		snprintf (buf, sizeof (buf), "%lu", pid);
+		return std::string (buf);
+	} ();
+
+	return cached;
 }
 
 
@@ -82,12 +96,13 @@ GS::UniString GetSessionId ()
 // Read .lock file contents
 // ---------------------------------------------------------------------------
 
-LockInfo GetLockInfo (const GS::UniString& xmlPath)
+LockInfo GetLockInfo (const std::string& xmlPath)
 {
 	LockInfo info;
 	info.locked = false;
 
 	std::string lockPath = GetLockPath (xmlPath);
+	AddCounter (Counter::LockFileReads);		// a round trip even when there is no lock
 	std::ifstream file (lockPath);
 	if (!file.is_open ())
 		return info;
@@ -101,11 +116,11 @@ LockInfo GetLockInfo (const GS::UniString& xmlPath)
 			line.pop_back ();
 
 		if (line.compare (0, 5, "user=") == 0)
-			info.user = GS::UniString (line.c_str () + 5, CC_UTF8);
+			info.user = line.substr (5);
 		else if (line.compare (0, 5, "time=") == 0)
-			info.time = GS::UniString (line.c_str () + 5, CC_UTF8);
+			info.time = line.substr (5);
 		else if (line.compare (0, 8, "session=") == 0)
-			info.session = GS::UniString (line.c_str () + 8, CC_UTF8);
+			info.session = line.substr (8);
 	}
 
 	return info;
@@ -116,9 +131,18 @@ LockInfo GetLockInfo (const GS::UniString& xmlPath)
 // Check if the current user holds the lock
 // ---------------------------------------------------------------------------
 
-bool IsLockedByUs (const GS::UniString& xmlPath)
+bool IsLockedByUs (const std::string& xmlPath)
+{
+	return IsOwnLock (GetLockInfo (xmlPath));
+}
+
+
+// ---------------------------------------------------------------------------
+// Check if already-read lock info belongs to this session
+// ---------------------------------------------------------------------------
+
+bool IsOwnLock (const LockInfo& info)
 {
-	LockInfo info = GetLockInfo (xmlPath);
 	if (!info.locked)
 		return false;
 	return info.user == GetCurrentUser () && info.session == GetSessionId ();
@@ -129,11 +153,12 @@ bool IsLockedByUs (const GS::UniString& xmlPath)
 // Create a .lock file next to the XML
 // ---------------------------------------------------------------------------
 
-bool AcquireLock (const GS::UniString& xmlPath)
+bool AcquireLock (const std::string& xmlPath)
 {
 	std::string lockPath = GetLockPath (xmlPath);
 
 	// Check if already locked
+	AddCounter (Counter::LockFileReads);
 	std::ifstream check (lockPath);
 	if (check.is_open ()) {
 		check.close ();
@@ -145,12 +170,11 @@ bool AcquireLock (const GS::UniString& xmlPath)
 	if (!file.is_open ())
 		return false;
 
-	std::string user = ToUtf8 (GetCurrentUser ());
-	std::string session = ToUtf8 (GetSessionId ());
-	file << "user=" << user << "\n";
+	file << "user=" << GetCurrentUser () << "\n";
 	file << "time=" << GetTimestamp () << "\n";
-	file << "session=" << session << "\n";
+	file << "session=" << GetSessionId () << "\n";
 	file.close ();
+	AddCounter (Counter::LockFileWrites);
 
 	return true;
 }
@@ -160,7 +184,7 @@ bool AcquireLock (const GS::UniString& xmlPath)
 // Remove the .lock file (only if locked by us)
 // ---------------------------------------------------------------------------
 
-bool ReleaseLock (const GS::UniString& xmlPath)
+bool ReleaseLock (const std::string& xmlPath)
 {
 	if (!IsLockedByUs (xmlPath))
 		return false;
@@ -168,3 +192,55 @@ bool ReleaseLock (const GS::UniString& xmlPath)
 	std::string lockPath = GetLockPath (xmlPath);
 	return std::remove (lockPath.c_str ()) == 0;
 }
+
+
+// ---------------------------------------------------------------------------
+// Commit guard: retry for up to ~2 s while another session commits
+// ---------------------------------------------------------------------------
+
+static const int kCommitGuardAttempts = 40;
+static const int kCommitGuardRetryMs  = 50;
+
+CommitGuard::CommitGuard (const char* xmlPath) :
+	handle (0),
+	acquired (false)
+{
+	std::string guardPath = std::string (xmlPath) + ".commit";
+
+	for (int attempt = 0; attempt < kCommitGuardAttempts; attempt++) {
+		AddCounter (Counter::CommitGuardAttempts);
+#if defined (_WIN32)
+		HANDLE h = CreateFileA (guardPath.c_str (), GENERIC_WRITE, 0, nullptr, CREATE_NEW,
+								FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+		if (h != INVALID_HANDLE_VALUE) {
+			handle   = (intptr_t)h;
+			acquired = true;
+			return;
+		}
+		Sleep (kCommitGuardRetryMs);
+#else
+		int fd = open (guardPath.c_str (), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+		if (fd >= 0) {
+			if (flock (fd, LOCK_EX | LOCK_NB) == 0) {
+				handle   = fd;
+				acquired = true;
+				return;
+			}
+			close (fd);
+		}
+		usleep (kCommitGuardRetryMs * 1000);
+#endif
+	}
+}
+
+
+CommitGuard::~CommitGuard ()
+{
+	if (!acquired)
+		return;
+#if defined (_WIN32)
+	CloseHandle ((HANDLE)handle);
+#else
+	close ((int)handle);
+#endif
+}
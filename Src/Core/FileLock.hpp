@@ -0,0 +1,69 @@
+#ifndef FILELOCK_HPP
+#define FILELOCK_HPP
+
+#include <string>
+#include <cstdint>
+
+
+// ---------------------------------------------------------------------------
+// Lock information read from the .lock file
+// ---------------------------------------------------------------------------
+
+struct LockInfo {
+	std::string user;         // "COMPUTERNAME\USERNAME" (UTF-8)
+	std::string time;         // "2026-03-01 12:34:56"
+	std::string session;      // process ID (unique per ArchiCAD instance)
+	bool locked;              // true if .lock file exists
+};
+
+
+// ---------------------------------------------------------------------------
+// Lock file API
+// ---------------------------------------------------------------------------
+
+// Create a .lock file next to the XML. Returns false if already locked.
+bool          AcquireLock   (const std::string& xmlPath);
+
+// Remove the .lock file (only if locked by us). Returns true on success.
+bool          ReleaseLock   (const std::string& xmlPath);
+
+// Read .lock file contents. locked=false if file doesn't exist.
+LockInfo      GetLockInfo   (const std::string& xmlPath);
+
+// Check if the current user holds the lock.
+bool          IsLockedByUs  (const std::string& xmlPath);
+
+// Check if already-read lock info belongs to this session.
+bool          IsOwnLock     (const LockInfo& info);
+
+// Get "COMPUTERNAME\USERNAME" for the current session ("host\user" on POSIX).
+std::string   GetCurrentUser ();
+
+// Get unique session ID (process ID) for this ArchiCAD instance.
+std::string   GetSessionId ();
+
+
+// ---------------------------------------------------------------------------
+// Commit guard - short exclusive hold on "<xml>.commit" for the duration of
+// one read-check-write of the master. Unlike the .lock file it is never held
+// across user actions, and the OS releases it if the process dies (on POSIX
+// the file stays behind; only the flock on it matters).
+// ---------------------------------------------------------------------------
+
+class CommitGuard {
+public:
+	explicit CommitGuard (const char* xmlPath);
+	~CommitGuard ();
+
+	bool  IsAcquired () const { return acquired; }
+
+private:
+	CommitGuard (const CommitGuard&) = delete;
+	CommitGuard& operator= (const CommitGuard&) = delete;
+
+	intptr_t  handle;	// HANDLE on Windows, file descriptor on POSIX
+	bool      acquired;
+};
+
+
+#endif // FILELOCK_HPP
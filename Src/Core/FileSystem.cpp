@@ -0,0 +1,166 @@
+#include "FileSystem.hpp"
+#include "Counters.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#if defined (_WIN32)
+	#include <windows.h>
+#else
+	#include <cerrno>
+	#include <dirent.h>
+	#include <sys/stat.h>
+#endif
+
+
+// ---------------------------------------------------------------------------
+// Path pieces
+// ---------------------------------------------------------------------------
+
+std::string GetDirectory (const std::string& filePath)
+{
+	auto lastSlash = filePath.find_last_of ("/\\");
+	if (lastSlash == std::string::npos)
+		return ".";
+	return filePath.substr (0, lastSlash);
+}
+
+
+std::string JoinPath (const std::string& dir, const std::string& name)
+{
+#if defined (_WIN32)
+	return dir + "\\" + name;
+#else
+	return dir + "/" + name;
+#endif
+}
+
+
+// ---------------------------------------------------------------------------
+// Files and directories
+// ---------------------------------------------------------------------------
+
+bool FileExists (const std::string& path)
+{
+#if defined (_WIN32)
+	return GetFileAttributesA (path.c_str ()) != INVALID_FILE_ATTRIBUTES;
+#else
+	struct stat st;
+	return stat (path.c_str (), &st) == 0;
+#endif
+}
+
+
+bool MakeDirectory (const std::string& path)
+{
+#if defined (_WIN32)
+	return CreateDirectoryA (path.c_str (), nullptr) || GetLastError () == ERROR_ALREADY_EXISTS;
+#else
+	return mkdir (path.c_str (), 0777) == 0 || errno == EEXIST;
+#endif
+}
+
+
+bool MakeDirectories (const std::string& path)
+{
+	if (path.empty () || FileExists (path))
+		return true;
+	size_t slash = path.find_last_of ("/\\");
+	if (slash != std::string::npos && slash > 0)
+		MakeDirectories (path.substr (0, slash));
+	return MakeDirectory (path);
+}
+
+
+std::vector<std::string> ListFiles (const std::string& dir, const std::string& ext)
+{
+	std::vector<std::string> names;
+#if defined (_WIN32)
+	WIN32_FIND_DATAA fd;
+	HANDLE h = FindFirstFileA (JoinPath (dir, "*" + ext).c_str (), &fd);
+	if (h != INVALID_HANDLE_VALUE) {
+		do {
+			if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+				names.push_back (fd.cFileName);
+		} while (FindNextFileA (h, &fd));
+		FindClose (h);
+	}
+#else
+	if (DIR* d = opendir (dir.c_str ())) {
+		while (struct dirent* ent = readdir (d)) {
+			std::string name = ent->d_name;
+			if (name.size () > ext.size () && name.compare (name.size () - ext.size (), ext.size (), ext) == 0)
+				names.push_back (name);
+		}
+		closedir (d);
+	}
+#endif
+	std::sort (names.begin (), names.end ());
+	return names;
+}
+
+
+bool ReadFile (const std::string& filePath, std::string& content)
+{
+	std::ifstream file (filePath, std::ios::binary);
+	if (!file.is_open ())
+		return false;
+	std::ostringstream ss;
+	ss << file.rdbuf ();
+	content = ss.str ();
+	return true;
+}
+
+
+bool WriteFileAtomic (const std::string& filePath, const std::string& content)
+{
+	std::string tmpPath = filePath + ".tmp";
+	{
+		std::ofstream file (tmpPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open ())
+			return false;
+		file << content;
+		file.close ();
+		if (file.fail ()) {
+			std::remove (tmpPath.c_str ());
+			return false;
+		}
+	}
+
+#if defined (_WIN32)
+	bool moved = MoveFileExA (tmpPath.c_str (), filePath.c_str (), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	bool moved = std::rename (tmpPath.c_str (), filePath.c_str ()) == 0;
+#endif
+	if (!moved) {
+		std::remove (tmpPath.c_str ());
+		return false;
+	}
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Master I/O (counted)
+// ---------------------------------------------------------------------------
+
+bool ReadMasterFile (const std::string& filePath, std::string& content)
+{
+	if (!ReadFile (filePath, content))
+		return false;
+	AddCounter (Counter::MasterReads);
+	AddCounter (Counter::MasterBytesRead, content.size ());
+	return true;
+}
+
+
+bool WriteMasterFileAtomic (const std::string& filePath, const std::string& content)
+{
+	if (!WriteFileAtomic (filePath, content))
+		return false;
+	AddCounter (Counter::MasterWrites);
+	AddCounter (Counter::MasterBytesWritten, content.size ());
+	return true;
+}
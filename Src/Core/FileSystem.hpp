@@ -0,0 +1,45 @@
+#ifndef FILESYSTEM_HPP
+#define FILESYSTEM_HPP
+
+#include <string>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// Path pieces (UTF-8 / ANSI paths, "\" on Windows, "/" elsewhere)
+// ---------------------------------------------------------------------------
+
+// Directory part of a file path ("." if it has none).
+std::string  GetDirectory (const std::string& filePath);
+
+std::string  JoinPath (const std::string& dir, const std::string& name);
+
+
+// ---------------------------------------------------------------------------
+// Files and directories
+// ---------------------------------------------------------------------------
+
+bool  FileExists (const std::string& path);
+
+// True if the directory was created or already exists.
+bool  MakeDirectory (const std::string& path);
+
+// The directory and any missing parents.
+bool  MakeDirectories (const std::string& path);
+
+// File names in dir ending with ext, sorted.
+std::vector<std::string>  ListFiles (const std::string& dir, const std::string& ext);
+
+// Whole file into content. False if it cannot be opened.
+bool  ReadFile (const std::string& filePath, std::string& content);
+
+// Write to "<file>.tmp" and swap it in (write-through on Windows), so readers
+// on the share never see a half-written file.
+bool  WriteFileAtomic (const std::string& filePath, const std::string& content);
+
+// The same for the master and its shards, counted as master I/O.
+bool  ReadMasterFile (const std::string& filePath, std::string& content);
+bool  WriteMasterFileAtomic (const std::string& filePath, const std::string& content);
+
+
+#endif // FILESYSTEM_HPP
@@ -0,0 +1,147 @@
+#include "ItemIndex.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+
+
+// ---------------------------------------------------------------------------
+// ID codec
+// ---------------------------------------------------------------------------
+
+static bool IsDigit (char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+
+std::string EncodeItemIdKey (const std::string& id)
+{
+	std::string key;
+	key.reserve (id.size () + 8);
+
+	size_t i = 0;
+	while (i < id.size ()) {
+		char c = id[i];
+		if (c == '.') {
+			key += '\0';
+			i++;
+		} else if (IsDigit (c)) {
+			size_t end = i;
+			while (end < id.size () && IsDigit (id[end]))
+				end++;
+			size_t first = i;
+			while (first + 1 < end && id[first] == '0')
+				first++;
+
+			size_t digits = std::min<size_t> (end - first, 255);
+			key += '\x01';
+			key += (char)digits;
+			key.append (id, first, digits);
+			key += (char)std::min<size_t> (first - i, 255);
+			i = end;
+		} else {
+			key += c;
+			i++;
+		}
+	}
+	key += '\0';
+	return key;
+}
+
+
+int CompareItemIds (const std::string& a, const std::string& b)
+{
+	if (a == b)
+		return 0;
+	return EncodeItemIdKey (a).compare (EncodeItemIdKey (b));
+}
+
+
+bool IsItemIdPrefix (const std::string& prefix, const std::string& id)
+{
+	return id.size () > prefix.size () + 1 && id[prefix.size ()] == '.' &&
+		   id.compare (0, prefix.size (), prefix) == 0;
+}
+
+
+// ---------------------------------------------------------------------------
+// ItemIndex
+// ---------------------------------------------------------------------------
+
+void ItemIndex::Build (const std::vector<ClassificationTree>& trees)
+{
+	TraceScope trace ("build item index");
+	items.clear ();
+	roots.clear ();
+	byId.clear ();
+	sorted.clear ();
+
+	for (size_t s = 0; s < trees.size (); s++)
+		Add (trees[s].rootItems, (unsigned)s, kNoItem);
+
+	sorted.reserve (items.size ());
+	for (Ref ref = 0; ref < (Ref)items.size (); ref++)
+		sorted.emplace_back (EncodeItemIdKey (items[ref].node->id), ref);
+	std::sort (sorted.begin (), sorted.end ());
+	for (std::uint32_t rank = 0; rank < (std::uint32_t)sorted.size (); rank++)
+		items[sorted[rank].second].rank = rank;
+
+	auto byRank = [this] (Ref a, Ref b) { return Less (a, b); };
+	std::sort (roots.begin (), roots.end (), byRank);
+	for (Entry& entry : items)
+		std::sort (entry.children.begin (), entry.children.end (), byRank);
+}
+
+
+void ItemIndex::Add (const std::vector<ClassificationNode>& nodes, unsigned system, Ref parent)
+{
+	for (const ClassificationNode& node : nodes) {
+		Ref ref = (Ref)items.size ();
+		Entry entry;
+		entry.node   = &node;
+		entry.system = system;
+		entry.parent = parent;
+		entry.rank   = 0;
+		items.push_back (entry);
+		byId.emplace (node.id, ref);
+
+		if (parent == kNoItem)
+			roots.push_back (ref);
+		else
+			items[parent].children.push_back (ref);
+
+		Add (node.children, system, ref);
+	}
+}
+
+
+ItemIndex::Ref ItemIndex::Find (const std::string& id) const
+{
+	auto it = byId.find (id);
+	return it != byId.end () ? it->second : kNoItem;
+}
+
+
+std::string ItemIndex::FindParentId (const std::string& id) const
+{
+	Ref ref = Find (id);
+	if (ref == kNoItem || items[ref].parent == kNoItem)
+		return std::string ();
+	return GetId (items[ref].parent);
+}
+
+
+std::vector<ItemIndex::Ref> ItemIndex::FindByPrefix (const std::string& prefix) const
+{
+	// A key ends in the segment separator, so the keys of the extending IDs
+	// start with the prefix's whole key and sort right after it
+	std::string start = EncodeItemIdKey (prefix);
+
+	std::vector<Ref> result;
+	auto it = std::lower_bound (sorted.begin (), sorted.end (), std::make_pair (start, Ref (0)));
+	for (; it != sorted.end () && it->first.compare (0, start.size (), start) == 0; ++it) {
+		if (it->first.size () > start.size ())
+			result.push_back (it->second);
+	}
+	return result;
+}
@@ -0,0 +1,94 @@
+#ifndef ITEMINDEX_HPP
+#define ITEMINDEX_HPP
+
+#include "ClassificationModel.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// Hierarchical item IDs ("DR.L.01.03")
+//
+// IDs are compared segment by segment ('.' separates segments) and digit
+// runs by their value, so "DR.L.9" sorts before "DR.L.10" and an ID sorts
+// before every ID that extends it. Equal values with different leading
+// zeros ("1", "01") are ordered by the number of zeros, so the order is
+// total. The ID alone does not tell the parent ("DR.L.01" is a child of
+// "DRZ.L"); ask an ItemIndex built from the tree.
+// ---------------------------------------------------------------------------
+
+// <0, 0, >0 as for std::string::compare
+int          CompareItemIds (const std::string& a, const std::string& b);
+
+// Byte key whose plain byte order is the CompareItemIds order: segments
+// end in 0x00, digit runs are 0x01, their length without leading zeros,
+// those digits and the number of leading zeros.
+std::string  EncodeItemIdKey (const std::string& id);
+
+// True if id extends prefix by whole segments ("DR.L" -> "DR.L.01").
+bool         IsItemIdPrefix (const std::string& prefix, const std::string& id);
+
+
+// ---------------------------------------------------------------------------
+// Index of the items of one side (project or master)
+//
+// Every item gets a dense Ref in document order. IDs are interned (one
+// lookup entry per distinct ID, the first item wins) and ranked by their
+// encoded keys, so two Refs compare in O(1). Parents and children come from
+// the tree itself. The encoded keys, kept sorted, act as a flattened trie:
+// all IDs under a prefix form one contiguous run.
+//
+// The index points into the trees it was built from; rebuild it when they
+// change.
+// ---------------------------------------------------------------------------
+
+class ItemIndex {
+public:
+	typedef std::uint32_t Ref;
+	static const Ref kNoItem = 0xFFFFFFFFu;
+
+	ItemIndex () {}
+	explicit ItemIndex (const std::vector<ClassificationTree>& trees) { Build (trees); }
+
+	void  Build (const std::vector<ClassificationTree>& trees);
+
+	size_t                     Size () const							{ return items.size (); }
+	Ref                        Find (const std::string& id) const;		// kNoItem if missing
+	const std::string&         GetId (Ref ref) const					{ return items[ref].node->id; }
+	const ClassificationNode&  GetNode (Ref ref) const					{ return *items[ref].node; }
+	unsigned                   GetSystem (Ref ref) const				{ return items[ref].system; }
+	Ref                        GetParent (Ref ref) const				{ return items[ref].parent; }
+	const std::vector<Ref>&    GetChildren (Ref ref) const				{ return items[ref].children; }
+	const std::vector<Ref>&    GetRoots () const						{ return roots; }
+
+	// Natural ID order in O(1)
+	bool  Less (Ref a, Ref b) const										{ return items[a].rank < items[b].rank; }
+
+	// Parent's ID in the tree ("" for a root item or an unknown ID).
+	std::string  FindParentId (const std::string& id) const;
+
+	// Items whose IDs extend prefix by whole segments, in natural order.
+	std::vector<Ref>  FindByPrefix (const std::string& prefix) const;
+
+private:
+	struct Entry {
+		const ClassificationNode*  node;
+		unsigned                   system;
+		Ref                        parent;
+		std::uint32_t              rank;		// position in sorted
+		std::vector<Ref>           children;	// natural order
+	};
+
+	void  Add (const std::vector<ClassificationNode>& nodes, unsigned system, Ref parent);
+
+	std::vector<Entry>                    items;
+	std::vector<Ref>                      roots;
+	std::unordered_map<std::string, Ref>  byId;
+	std::vector<std::pair<std::string, Ref>>  sorted;		// encoded key, item
+};
+
+
+#endif // ITEMINDEX_HPP
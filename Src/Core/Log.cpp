@@ -0,0 +1,321 @@
+#include "Log.hpp"
+#include "Report.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+
+// ---------------------------------------------------------------------------
+// Ring buffer (same publication scheme as the trace: a writer claims a slot
+// with one fetch_add and publishes it with its sequence number, claim index
+// + 1; readers keep a copy only if the sequence held still)
+// ---------------------------------------------------------------------------
+
+struct LogSlot {
+	std::atomic<std::uint64_t>  sequence;	// 0 = being written
+	std::int64_t                time;		// ms since 1970
+	std::uint32_t               thread;
+	LogLevel                    level;
+	char                        text[kLogLineSize];
+};
+
+struct LogLineCopy {
+	std::int64_t   time;
+	std::uint32_t  thread;
+	LogLevel       level;
+	char           text[kLogLineSize];
+};
+
+static LogSlot                     logSlots[kLogCapacity];
+static std::atomic<std::uint64_t>  logNext (0);
+static std::atomic<int>            logRecordLevel ((int)LogLevel::Debug);
+static std::atomic<int>            logEchoLevel ((int)LogLevel::Info);
+static std::atomic<std::uint32_t>  logThreadCount (0);
+
+
+static std::uint32_t LogThreadId ()
+{
+	thread_local std::uint32_t id = ++logThreadCount;
+	return id;
+}
+
+
+static bool CopyLogLine (std::uint64_t index, LogLineCopy& copy)
+{
+	const LogSlot& slot = logSlots[index % kLogCapacity];
+	if (slot.sequence.load (std::memory_order_acquire) != index + 1)
+		return false;
+
+	copy.time   = slot.time;
+	copy.thread = slot.thread;
+	copy.level  = slot.level;
+	std::memcpy (copy.text, slot.text, sizeof (copy.text));
+	copy.text[sizeof (copy.text) - 1] = '\0';
+	std::atomic_thread_fence (std::memory_order_acquire);
+	return slot.sequence.load (std::memory_order_relaxed) == index + 1;
+}
+
+
+static std::string FormatLogLine (const LogLineCopy& line)
+{
+	std::time_t seconds = (std::time_t)(line.time / 1000);
+	std::tm lt = {};
+#if defined (_WIN32)
+	localtime_s (&lt, &seconds);
+#else
+	localtime_r (&seconds, &lt);
+#endif
+	char stamp[32];
+	std::strftime (stamp, sizeof (stamp), "%Y-%m-%d %H:%M:%S", &lt);
+
+	char prefix[64];
+	std::snprintf (prefix, sizeof (prefix), "%s.%03d %-7s %u ", stamp, (int)(line.time % 1000),
+				   LogLevelName (line.level), (unsigned)line.thread);
+	return prefix + std::string (line.text) + "\n";
+}
+
+
+// ---------------------------------------------------------------------------
+// Levels
+// ---------------------------------------------------------------------------
+
+void SetLogLevel (LogLevel level)
+{
+	logRecordLevel.store ((int)level, std::memory_order_relaxed);
+}
+
+
+void SetLogEchoLevel (LogLevel level)
+{
+	logEchoLevel.store ((int)level, std::memory_order_relaxed);
+}
+
+
+LogLevel GetLogEchoLevel ()
+{
+	return (LogLevel)logEchoLevel.load (std::memory_order_relaxed);
+}
+
+
+bool IsLogged (LogLevel level)
+{
+	return (int)level >= logRecordLevel.load (std::memory_order_relaxed) ||
+		   (int)level >= logEchoLevel.load (std::memory_order_relaxed);
+}
+
+
+const char* LogLevelName (LogLevel level)
+{
+	switch (level) {
+		case LogLevel::Debug:   return "debug";
+		case LogLevel::Info:    return "info";
+		case LogLevel::Warning: return "warning";
+		case LogLevel::Error:   return "error";
+		case LogLevel::Off:     return "off";
+	}
+	return "off";
+}
+
+
+bool ParseLogLevel (const std::string& name, LogLevel& level)
+{
+	for (int i = (int)LogLevel::Debug; i <= (int)LogLevel::Off; i++) {
+		if (name == LogLevelName ((LogLevel)i)) {
+			level = (LogLevel)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+// ---------------------------------------------------------------------------
+// Recording
+// ---------------------------------------------------------------------------
+
+bool RecordLogLine (LogLevel level, const char* line)
+{
+	if ((int)level >= logRecordLevel.load (std::memory_order_relaxed)) {
+		std::int64_t now = std::chrono::duration_cast<std::chrono::milliseconds> (
+			std::chrono::system_clock::now ().time_since_epoch ()).count ();
+		std::uint64_t index = logNext.fetch_add (1, std::memory_order_relaxed);
+		LogSlot& slot = logSlots[index % kLogCapacity];
+
+		// Cut a long line without splitting a UTF-8 sequence
+		size_t length = std::strlen (line);
+		if (length >= kLogLineSize) {
+			length = kLogLineSize - 1;
+			while (length > 0 && ((unsigned char)line[length] & 0xC0) == 0x80)
+				length--;
+		}
+
+		slot.sequence.store (0, std::memory_order_relaxed);
+		std::atomic_thread_fence (std::memory_order_release);
+		slot.time   = now;
+		slot.thread = LogThreadId ();
+		slot.level  = level;
+		std::memcpy (slot.text, line, length);
+		slot.text[length] = '\0';
+		slot.sequence.store (index + 1, std::memory_order_release);
+	}
+	return (int)level >= logEchoLevel.load (std::memory_order_relaxed);
+}
+
+
+void LogMessage (LogLevel level, const char* format, ...)
+{
+	char line[1024];
+
+	va_list args;
+	va_start (args, format);
+	vsnprintf (line, sizeof (line), format, args);
+	va_end (args);
+
+	if (RecordLogLine (level, line))
+		WriteReportLine (line);
+}
+
+
+void ClearLog ()
+{
+	for (LogSlot& slot : logSlots)
+		slot.sequence.store (0, std::memory_order_relaxed);
+	logNext.store (0, std::memory_order_release);
+}
+
+
+std::string FormatLogLines (size_t maxLines)
+{
+	std::uint64_t next  = logNext.load (std::memory_order_acquire);
+	std::uint64_t count = maxLines < kLogCapacity ? maxLines : kLogCapacity;
+	std::uint64_t begin = next > count ? next - count : 0;
+
+	std::string text;
+	LogLineCopy line;
+	for (std::uint64_t index = begin; index < next; index++) {
+		if (CopyLogLine (index, line))
+			text += FormatLogLine (line);
+	}
+	return text;
+}
+
+
+bool WriteLogLines (const std::string& path)
+{
+	std::string text = FormatLogLines ();
+	std::ofstream file (path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open ())
+		return false;
+	file.write (text.data (), text.size ());
+	return file.good ();
+}
+
+
+// ---------------------------------------------------------------------------
+// File sink: a thread that appends new ring lines a few times a second
+// ---------------------------------------------------------------------------
+
+static const int kLogFileIntervalMs = 250;
+
+namespace {
+
+class LogFileSink {
+public:
+	LogFileSink () : next (0), stopping (false) {}
+	~LogFileSink () { Stop (); }
+
+	bool Start (const std::string& path)
+	{
+		Stop ();
+		file.open (path, std::ios::binary | std::ios::app);
+		if (!file.is_open ())
+			return false;
+
+		next     = logNext.load (std::memory_order_acquire);
+		next     = next > kLogCapacity ? next - kLogCapacity : 0;		// what the ring still holds
+		stopping = false;
+		worker   = std::thread ([this] { Run (); });
+		return true;
+	}
+
+	void Stop ()
+	{
+		if (!worker.joinable ())
+			return;
+		{
+			std::lock_guard<std::mutex> lock (mutex);
+			stopping = true;
+		}
+		wake.notify_all ();
+		worker.join ();
+		file.close ();
+	}
+
+private:
+	void Run ()
+	{
+		std::unique_lock<std::mutex> lock (mutex);
+		for (;;) {
+			wake.wait_for (lock, std::chrono::milliseconds (kLogFileIntervalMs), [this] { return stopping; });
+			WritePending ();
+			if (stopping)
+				break;
+		}
+	}
+
+	void WritePending ()
+	{
+		std::uint64_t end = logNext.load (std::memory_order_acquire);
+		if (end > next + kLogCapacity) {
+			file << "... " << (unsigned long long)(end - kLogCapacity - next) << " lines lost\n";
+			next = end - kLogCapacity;
+		}
+
+		std::string text;
+		LogLineCopy line;
+		for (; next < end; next++) {
+			if (CopyLogLine (next, line))
+				text += FormatLogLine (line);
+		}
+		if (!text.empty ()) {
+			file.write (text.data (), text.size ());
+			file.flush ();
+		}
+	}
+
+	std::ofstream            file;
+	std::thread              worker;
+	std::mutex               mutex;
+	std::condition_variable  wake;
+	std::uint64_t            next;		// next ring index to write (file thread only)
+	bool                     stopping;
+};
+
+LogFileSink& GetFileSink ()
+{
+	static LogFileSink sink;
+	return sink;
+}
+
+}
+
+
+bool StartLogFile (const std::string& path)
+{
+	return GetFileSink ().Start (path);
+}
+
+
+void StopLogFile ()
+{
+	GetFileSink ().Stop ();
+}
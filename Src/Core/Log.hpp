@@ -0,0 +1,97 @@
+#ifndef LOG_HPP
+#define LOG_HPP
+
+#include <cstddef>
+#include <string>
+
+
+// ---------------------------------------------------------------------------
+// Leveled session log
+//
+// Every line at or above the log level is formatted once into a fixed-size
+// ring buffer (no lock, no allocation; the oldest lines are overwritten) and
+// optionally appended to a file by a background thread. Lines at or above
+// the echo level also go to the report sink (ACAPI_WriteReport in the
+// add-on). The CS_LOG_* macros check the levels before evaluating their
+// arguments, and levels below CLASSSYNC_LOG_LEVEL are compiled out.
+//
+// The echo runs on the calling thread: log from the UI thread, or from a
+// worker through ReportWork.
+// ---------------------------------------------------------------------------
+
+enum class LogLevel {
+	Debug,
+	Info,
+	Warning,
+	Error,
+	Off
+};
+
+// Lowest level compiled in (0 = Debug, 1 = Info, 2 = Warning, 3 = Error)
+#ifndef CLASSSYNC_LOG_LEVEL
+	#define CLASSSYNC_LOG_LEVEL 0
+#endif
+
+// Lines kept in the ring buffer, and their size including the terminator
+static const size_t kLogCapacity = 8192;
+static const size_t kLogLineSize = 240;
+
+// Lowest level recorded (default Debug) and shown (default Info).
+void      SetLogLevel (LogLevel level);
+void      SetLogEchoLevel (LogLevel level);
+LogLevel  GetLogEchoLevel ();
+
+// True if a line of this level is recorded or shown.
+bool  IsLogged (LogLevel level);
+
+const char*  LogLevelName (LogLevel level);			// "debug", "info", ...
+bool         ParseLogLevel (const std::string& name, LogLevel& level);
+
+// Format and record a line; shown if at the echo level.
+void  LogMessage (LogLevel level, const char* format, ...);
+
+// Record an already formatted line; true if it should also be shown.
+bool  RecordLogLine (LogLevel level, const char* line);
+
+// Drop all recorded lines.
+void  ClearLog ();
+
+// "2026-10-19 14:03:12.345 info  2 text" lines, oldest first; at most the
+// newest maxLines.
+std::string  FormatLogLines (size_t maxLines = kLogCapacity);
+
+// False if the file cannot be written.
+bool  WriteLogLines (const std::string& path);
+
+// Append every recorded line to a file from a background thread (checked
+// a few times a second). False if the file cannot be opened.
+bool  StartLogFile (const std::string& path);
+
+// Write what is left and stop the file thread.
+void  StopLogFile ();
+
+
+#define CS_LOG(level, ...)			do { if (IsLogged (level)) LogMessage (level, __VA_ARGS__); } while (false)
+
+#if CLASSSYNC_LOG_LEVEL <= 0
+	#define CS_LOG_DEBUG(...)		CS_LOG (LogLevel::Debug, __VA_ARGS__)
+#else
+	#define CS_LOG_DEBUG(...)		((void)0)
+#endif
+
+#if CLASSSYNC_LOG_LEVEL <= 1
+	#define CS_LOG_INFO(...)		CS_LOG (LogLevel::Info, __VA_ARGS__)
+#else
+	#define CS_LOG_INFO(...)		((void)0)
+#endif
+
+#if CLASSSYNC_LOG_LEVEL <= 2
+	#define CS_LOG_WARNING(...)		CS_LOG (LogLevel::Warning, __VA_ARGS__)
+#else
+	#define CS_LOG_WARNING(...)		((void)0)
+#endif
+
+#define CS_LOG_ERROR(...)			CS_LOG (LogLevel::Error, __VA_ARGS__)
+
+
+#endif // LOG_HPP
@@ -0,0 +1,278 @@
+#include "MasterCatalog.hpp"
+#include "XmlReader.hpp"
+#include "FileSystem.hpp"
+#include "Log.hpp"
+#include "Trace.hpp"
+
+#include <future>
+#include <set>
+#include <sstream>
+
+
+static const char* kCatalogHeader = "ClassSync master catalog 1";
+static const char* kCatalogExt    = ".catalog";
+
+
+// ---------------------------------------------------------------------------
+// Helper: path pieces
+// ---------------------------------------------------------------------------
+
+// "/x", "\\server\x", "C:\x" and "C:/x"
+static bool IsAbsolutePath (const std::string& path)
+{
+	if (!path.empty () && (path[0] == '/' || path[0] == '\\'))
+		return true;
+	return path.size () > 2 && path[1] == ':' && (path[2] == '\\' || path[2] == '/');
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: read the catalog file (raw receives its bytes for the version)
+// ---------------------------------------------------------------------------
+
+static bool LoadCatalog (const std::string& catalogPath, std::vector<std::string>& masterPaths, std::string* raw)
+{
+	std::string content;
+	if (!ReadFile (catalogPath, content))
+		return false;
+
+	std::string dir = GetDirectory (catalogPath);
+	std::set<std::string> seen;
+	std::istringstream in (content);
+	std::string line;
+	bool headerSeen = false;
+
+	masterPaths.clear ();
+	while (std::getline (in, line)) {
+		if (!line.empty () && line.back () == '\r')
+			line.pop_back ();
+		if (line.empty () || line[0] == '#')
+			continue;
+
+		if (!headerSeen) {
+			if (line != kCatalogHeader)
+				return false;
+			headerSeen = true;
+			continue;
+		}
+
+		std::string path = IsAbsolutePath (line) ? line : JoinPath (dir, line);
+		if (seen.insert (path).second)
+			masterPaths.push_back (path);
+	}
+
+	if (raw != nullptr)
+		*raw = std::move (content);
+	return headerSeen;
+}
+
+
+static void IndexItems (const std::vector<ClassificationNode>& nodes,
+						const std::string& masterPath,
+						std::map<std::string, std::string>& itemToMaster)
+{
+	for (const ClassificationNode& node : nodes) {
+		itemToMaster.emplace (node.id, masterPath);
+		IndexItems (node.children, masterPath, itemToMaster);
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+// Catalog detection and listing
+// ---------------------------------------------------------------------------
+
+bool IsMasterCatalog (const char* path)
+{
+	std::string p (path);
+	std::string ext (kCatalogExt);
+	return p.size () > ext.size () && p.compare (p.size () - ext.size (), ext.size (), ext) == 0;
+}
+
+
+bool ReadMasterCatalog (const char* catalogPath, std::vector<std::string>& masterPaths)
+{
+	return LoadCatalog (catalogPath, masterPaths, nullptr);
+}
+
+
+// ---------------------------------------------------------------------------
+// Read a catalog, re-reading only masters whose size or time changed
+// ---------------------------------------------------------------------------
+
+std::vector<ClassificationTree> ReadCatalogClassifications (const char* catalogPath,
+															MasterCatalogCache& cache,
+															MasterVersion* version,
+															WorkProgress* progress)
+{
+	TraceScope trace ("ReadCatalogClassifications");
+	std::vector<ClassificationTree> result;
+
+	std::vector<std::string> paths;
+	std::string raw;
+	if (!LoadCatalog (catalogPath, paths, &raw)) {
+		ReportWork (progress, LogLevel::Warning, "ClassSync: Cannot read master catalog: %s", catalogPath);
+		return result;
+	}
+
+	if (cache.catalogPath != catalogPath) {
+		cache.masters.clear ();
+		cache.catalogPath = catalogPath;
+	}
+
+	// Start a reader for every master that is new or changed. The stamp is
+	// taken before the read, so a write during the read is read again later.
+	struct Load {
+		std::string                                path;
+		MasterStamp                                stamp;
+		std::future<MasterCatalogCache::Master>    master;
+	};
+	std::vector<Load> loads;
+	for (const std::string& path : paths) {
+		MasterStamp stamp = ReadMasterStamp (path);
+		auto cached = cache.masters.find (path);
+		if (cached != cache.masters.end () && cached->second.stamp == stamp)
+			continue;
+
+		loads.push_back ({ path, stamp, std::async (std::launch::async, [path] () {
+			MasterCatalogCache::Master master;
+			master.systems = ReadXmlClassifications (path.c_str (), &master.version);
+			return master;
+		}) });
+	}
+
+	// Collect every read before a cancelled read returns (the futures block)
+	std::vector<std::pair<std::string, MasterCatalogCache::Master>> loaded;
+	unsigned failed    = 0;
+	bool     cancelled = false;
+	for (size_t i = 0; i < loads.size (); i++) {
+		MasterCatalogCache::Master master = loads[i].master.get ();
+		if (master.version.valid) {
+			master.stamp = loads[i].stamp;
+			loaded.emplace_back (loads[i].path, std::move (master));
+		} else {
+			failed++;
+		}
+		if (progress != nullptr && !cancelled && !progress->Step (i + 1, loads.size ()))
+			cancelled = true;
+	}
+	if (cancelled)
+		return result;
+
+	for (auto& master : loaded)
+		cache.masters[master.first] = std::move (master.second);
+
+	// Drop masters that are no longer listed
+	std::map<std::string, MasterCatalogCache::Master> kept;
+	for (const std::string& path : paths) {
+		auto it = cache.masters.find (path);
+		if (it != cache.masters.end ())
+			kept[path] = std::move (it->second);
+	}
+	cache.masters.swap (kept);
+	cache.masterPaths = paths;
+
+	ReportWork (progress, LogLevel::Debug, "ClassSync: Catalog: %d masters listed, %d re-read, %d failed",
+				(int)paths.size (), (int)loads.size (), (int)failed);
+
+	// Merge in catalog order; a system name belongs to the first master
+	TraceScope mergeTrace ("merge catalog");
+	cache.systemToMaster.clear ();
+	cache.itemToMaster.clear ();
+	std::string versionText = raw;
+	for (const std::string& path : paths) {
+		auto it = cache.masters.find (path);
+		if (it == cache.masters.end ())
+			continue;
+
+		versionText += path + "\t" + MasterVersionToString (it->second.version) + "\n";
+		for (const ClassificationTree& tree : it->second.systems) {
+			auto owner = cache.systemToMaster.emplace (tree.systemName, path);
+			if (!owner.second) {
+				ReportWork (progress, LogLevel::Warning, "ClassSync: System '%s' of %s is already in %s, skipped",
+							tree.systemName.c_str (), path.c_str (), owner.first->second.c_str ());
+				continue;
+			}
+			IndexItems (tree.rootItems, path, cache.itemToMaster);
+			result.push_back (tree);
+		}
+	}
+
+	if (version != nullptr)
+		*version = ComputeMasterVersion (versionText);
+
+	return result;
+}
+
+
+// ---------------------------------------------------------------------------
+// Apply a batch of edits: grouped by owning master, one commit per master
+// ---------------------------------------------------------------------------
+
+CommitResult ApplyEditsToCatalog (const MasterCatalogCache& cache,
+								  std::vector<MasterEdit>& edits)
+{
+	// Items added by this batch are owned by the master of their parent
+	std::map<std::string, std::string>          addedOwner;
+	std::map<std::string, std::vector<size_t>>  batches;
+	std::vector<std::string>                    batchOrder;
+	bool                                        anyWritten = false;
+	bool                                        anyBusy    = false;
+
+	std::string firstMaster;
+	for (const std::string& path : cache.masterPaths) {
+		if (cache.masters.count (path) != 0) {
+			firstMaster = path;
+			break;
+		}
+	}
+
+	for (size_t i = 0; i < edits.size (); i++) {
+		MasterEdit& edit = edits[i];
+
+		std::string path;
+		if (edit.kind == MasterEditKind::AddItem && edit.parentId.empty ()) {
+			auto owner = cache.systemToMaster.find (edit.systemName);
+			path = owner != cache.systemToMaster.end () ? owner->second : firstMaster;
+		} else {
+			std::string ownerId = edit.kind == MasterEditKind::AddItem ? edit.parentId : edit.itemId;
+			auto added = addedOwner.find (ownerId);
+			auto owner = cache.itemToMaster.find (ownerId);
+			if (added != addedOwner.end ())
+				path = added->second;
+			else if (owner != cache.itemToMaster.end ())
+				path = owner->second;
+		}
+		if (path.empty ()) {
+			edit.result = CommitResult::Failed;
+			continue;
+		}
+
+		if (edit.kind == MasterEditKind::AddItem)
+			addedOwner[edit.node.id] = path;
+
+		std::vector<size_t>& batch = batches[path];
+		if (batch.empty ())
+			batchOrder.push_back (path);
+		batch.push_back (i);
+	}
+
+	for (const std::string& path : batchOrder) {
+		const std::vector<size_t>& batch = batches[path];
+
+		std::vector<MasterEdit> masterEdits;
+		for (size_t i : batch)
+			masterEdits.push_back (edits[i]);
+
+		CommitResult result = ApplyEditsToXml (path.c_str (), cache.masters.at (path).version, masterEdits, false);
+		for (size_t k = 0; k < masterEdits.size (); k++)
+			edits[batch[k]].result = masterEdits[k].result;
+
+		anyWritten |= IsCommitSuccess (result);
+		anyBusy    |= result == CommitResult::Busy;
+	}
+
+	if (anyWritten)
+		return CommitResult::Committed;
+	return anyBusy ? CommitResult::Busy : CommitResult::AlreadyApplied;
+}
@@ -0,0 +1,67 @@
+#ifndef MASTERCATALOG_HPP
+#define MASTERCATALOG_HPP
+
+#include "ClassificationModel.hpp"
+#include "MasterVersion.hpp"
+#include "XmlWriter.hpp"
+#include "WorkProgress.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// Master catalog: several classification XMLs shown as one master
+//
+//   Masters.catalog:
+//     ClassSync master catalog 1
+//     # one master XML per line, relative to the catalog or absolute
+//     Green Accent PLANTS.xml
+//     INST INSTALACJE.xml
+//
+// The catalog is selected in the palette like a single XML. Its systems
+// are merged into one server view keyed by system name (the first master
+// listed wins a name both define). Masters whose size and modification
+// time are unchanged are not re-read; changed ones are read in parallel.
+// Edits are committed to the master that owns the target item or system.
+// ---------------------------------------------------------------------------
+
+// Parsed masters kept between refreshes
+struct MasterCatalogCache {
+	struct Master {
+		MasterStamp                      stamp;
+		MasterVersion                    version;
+		std::vector<ClassificationTree>  systems;
+	};
+
+	std::string                         catalogPath;
+	std::vector<std::string>            masterPaths;		// as listed, resolved
+	std::map<std::string, Master>       masters;			// by path
+	std::map<std::string, std::string>  systemToMaster;		// system name -> path
+	std::map<std::string, std::string>  itemToMaster;		// item ID -> path
+};
+
+
+// True if the path points at a master catalog instead of a single XML.
+bool  IsMasterCatalog (const char* path);
+
+// The master paths listed in a catalog, resolved against its directory.
+bool  ReadMasterCatalog (const char* catalogPath, std::vector<std::string>& masterPaths);
+
+// Read all systems of all listed masters, re-reading only masters whose
+// stamp changed. version covers the catalog and every master's version.
+// With progress, steps count read masters; a cancelled read keeps the cache.
+std::vector<ClassificationTree>  ReadCatalogClassifications (const char* catalogPath,
+															 MasterCatalogCache& cache,
+															 MasterVersion* version = nullptr,
+															 WorkProgress* progress = nullptr);
+
+// Batch of edits: one ApplyEditsToXml per touched master, each against the
+// version it was read at. Root items go to the master of edit.systemName
+// (the first master if none owns it). Per-edit results as in ApplyEditsToXml.
+CommitResult  ApplyEditsToCatalog (const MasterCatalogCache& cache,
+								   std::vector<MasterEdit>& edits);
+
+
+#endif // MASTERCATALOG_HPP
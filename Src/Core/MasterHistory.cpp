@@ -0,0 +1,412 @@
+#include "MasterHistory.hpp"
+#include "ChangeLogIndex.hpp"
+#include "FileSystem.hpp"
+#include "ItemIndex.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+
+static const char* kSnapshotHeader = "ClassSync master snapshot 1";
+static const char* kSnapshotDir    = "snapshots";
+static const char* kSnapshotExt    = ".snap";
+
+
+// ---------------------------------------------------------------------------
+// Time keys
+// ---------------------------------------------------------------------------
+
+std::string FormatTimeKey (std::int64_t time)
+{
+	std::time_t tt = (std::time_t)time;
+	std::tm lt = {};
+#if defined (_WIN32)
+	localtime_s (&lt, &tt);
+#else
+	localtime_r (&tt, &lt);
+#endif
+	char buf[32];
+	std::strftime (buf, sizeof (buf), "%Y-%m-%dT%H:%M:%S", &lt);
+	return buf;
+}
+
+
+bool ParseTimeKey (const std::string& text, std::string& key)
+{
+	int y, mo, d, h = 23, mi = 59, s = 59;
+	char sep;
+	int fields = std::sscanf (text.c_str (), "%4d-%2d-%2d%c%2d:%2d:%2d", &y, &mo, &d, &sep, &h, &mi, &s);
+	if (fields < 3 || (fields > 3 && fields < 6) || (fields > 3 && sep != ' ' && sep != 'T'))
+		return false;
+	if (fields == 6)
+		s = 0;
+	if (mo < 1 || mo > 12 || d < 1 || d > 31 || h > 23 || mi > 59 || s > 59)
+		return false;
+
+	char buf[32];
+	std::snprintf (buf, sizeof (buf), "%04d-%02d-%02dT%02d:%02d:%02d", y, mo, d, h, mi, s);
+	key = buf;
+	return true;
+}
+
+
+// "2025-03-14T12:00:00" <-> "2025-03-14_12-00-00.snap" (no ':' in Windows names)
+static std::string SnapshotFileName (const std::string& key)
+{
+	std::string name = key;
+	std::replace (name.begin (), name.end (), ':', '-');
+	std::replace (name.begin (), name.end (), 'T', '_');
+	return name + kSnapshotExt;
+}
+
+
+static std::string SnapshotKey (const std::string& fileName)
+{
+	std::string key = fileName.substr (0, fileName.size () - std::string (kSnapshotExt).size ());
+	if (key.size () != 19)
+		return "";
+	key[10] = 'T';
+	key[13] = ':';
+	key[16] = ':';
+	return key;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: escaping for tab-separated snapshot fields
+// ---------------------------------------------------------------------------
+
+static void AppendEscaped (std::string& out, const std::string& s)
+{
+	for (char c : s) {
+		switch (c) {
+			case '\\': out += "\\\\"; break;
+			case '\t': out += "\\t";  break;
+			case '\n': out += "\\n";  break;
+			case '\r': out += "\\r";  break;
+			default:   out += c;      break;
+		}
+	}
+}
+
+
+static std::string Unescape (const std::string& s)
+{
+	std::string out;
+	out.reserve (s.size ());
+	for (size_t i = 0; i < s.size (); i++) {
+		if (s[i] == '\\' && i + 1 < s.size ()) {
+			char c = s[++i];
+			out += (c == 't') ? '\t' : (c == 'n') ? '\n' : (c == 'r') ? '\r' : c;
+		} else {
+			out += s[i];
+		}
+	}
+	return out;
+}
+
+
+static std::vector<std::string> SplitTabs (const std::string& s)
+{
+	std::vector<std::string> fields;
+	size_t start = 0;
+	while (true) {
+		size_t tab = s.find ('\t', start);
+		fields.push_back (s.substr (start, tab == std::string::npos ? std::string::npos : tab - start));
+		if (tab == std::string::npos)
+			break;
+		start = tab + 1;
+	}
+	return fields;
+}
+
+
+// ---------------------------------------------------------------------------
+// Snapshot writing
+// ---------------------------------------------------------------------------
+
+static void AppendSnapshotItems (std::string& out, const std::vector<ClassificationNode>& nodes, unsigned depth)
+{
+	for (const ClassificationNode& node : nodes) {
+		out += "item=" + std::to_string (depth) + "\t";
+		AppendEscaped (out, node.id);
+		out += "\t";
+		AppendEscaped (out, node.name);
+		out += "\t";
+		AppendEscaped (out, node.description);
+		out += "\n";
+		AppendSnapshotItems (out, node.children, depth + 1);
+	}
+}
+
+
+// Header fields of a snapshot ("time", "version") without reading the items
+static bool ReadSnapshotHeader (const std::string& path, std::string& version)
+{
+	std::ifstream file (path, std::ios::binary);
+	std::string line;
+	if (!std::getline (file, line) || line != kSnapshotHeader)
+		return false;
+	while (std::getline (file, line)) {
+		if (line.compare (0, 8, "version=") == 0) {
+			version = line.substr (8);
+			return true;
+		}
+		if (line.compare (0, 7, "system=") == 0)
+			break;
+	}
+	return false;
+}
+
+
+bool WriteMasterSnapshotIfDue (const std::string& logDir,
+							   const std::vector<ClassificationTree>& master,
+							   const MasterVersion& version,
+							   std::int64_t minIntervalSec)
+{
+	if (!version.valid || master.empty ())
+		return false;
+
+	std::int64_t now    = (std::int64_t)std::time (nullptr);
+	std::string  nowKey = FormatTimeKey (now);
+	std::string  dir    = JoinPath (logDir, kSnapshotDir);
+
+	std::vector<std::string> existing = ListFiles (dir, kSnapshotExt);
+	if (!existing.empty ()) {
+		std::string newest = SnapshotKey (existing.back ());
+		std::string dueKey = FormatTimeKey (now - minIntervalSec);
+		if (newest > dueKey)
+			return false;
+
+		std::string newestVersion;
+		if (ReadSnapshotHeader (JoinPath (dir, existing.back ()), newestVersion) &&
+			newestVersion == MasterVersionToString (version))
+			return false;
+	}
+
+	std::string content = std::string (kSnapshotHeader) + "\n";
+	content += "time=" + nowKey + "\n";
+	content += "version=" + MasterVersionToString (version) + "\n";
+	for (const ClassificationTree& tree : master) {
+		content += "system=";
+		AppendEscaped (content, tree.systemName);
+		content += "\t";
+		AppendEscaped (content, tree.version);
+		content += "\n";
+		AppendSnapshotItems (content, tree.rootItems, 0);
+	}
+
+	MakeDirectory (logDir);
+	MakeDirectory (dir);
+	return WriteFileAtomic (JoinPath (dir, SnapshotFileName (nowKey)), content);
+}
+
+
+// ---------------------------------------------------------------------------
+// Replay model: flat items keyed by ID, turned back into trees at the end
+// ---------------------------------------------------------------------------
+
+namespace {
+
+struct ReplayItem {
+	unsigned                  system;
+	std::string               name;
+	std::string               description;
+	std::vector<std::string>  children;
+};
+
+struct ReplaySystem {
+	std::string               name;
+	std::string               version;
+	std::vector<std::string>  roots;
+};
+
+struct ReplayModel {
+	std::vector<ReplaySystem>                    systems;
+	std::unordered_map<std::string, ReplayItem>  items;
+};
+
+}
+
+
+static bool LoadSnapshot (const std::string& path, ReplayModel& model)
+{
+	std::ifstream file (path, std::ios::binary);
+	std::string line;
+	if (!std::getline (file, line) || line != kSnapshotHeader)
+		return false;
+
+	std::vector<std::string> parents;		// ID at each depth of the current path
+	while (std::getline (file, line)) {
+		if (!line.empty () && line.back () == '\r')
+			line.pop_back ();
+
+		if (line.compare (0, 7, "system=") == 0) {
+			std::vector<std::string> f = SplitTabs (line.substr (7));
+			model.systems.push_back ({ Unescape (f[0]), f.size () > 1 ? Unescape (f[1]) : "", {} });
+			parents.clear ();
+		} else if (line.compare (0, 5, "item=") == 0 && !model.systems.empty ()) {
+			std::vector<std::string> f = SplitTabs (line.substr (5));
+			if (f.size () < 4)
+				continue;
+			size_t depth = (size_t)std::strtoul (f[0].c_str (), nullptr, 10);
+			if (depth > parents.size ())
+				continue;
+
+			std::string id = Unescape (f[1]);
+			unsigned system = (unsigned)model.systems.size () - 1;
+			model.items[id] = { system, Unescape (f[2]), Unescape (f[3]), {} };
+
+			parents.resize (depth);
+			if (depth == 0)
+				model.systems.back ().roots.push_back (id);
+			else
+				model.items[parents.back ()].children.push_back (id);
+			parents.push_back (id);
+		}
+	}
+	return !model.systems.empty ();
+}
+
+
+// Insert before the first sibling with a greater ID (natural order, as Export)
+static void InsertSorted (std::vector<std::string>& siblings, const std::string& id)
+{
+	auto it = std::find_if (siblings.begin (), siblings.end (),
+							[&id] (const std::string& s) { return CompareItemIds (s, id) > 0; });
+	siblings.insert (it, id);
+}
+
+
+static bool ApplyRecord (ReplayModel& model, const HistoryEntry& e)
+{
+	if (e.action == "use-project") {
+		auto it = model.items.find (e.itemId);
+		if (it == model.items.end ())
+			return false;
+		it->second.name = e.newValue;
+		return true;
+	}
+
+	// export
+	if (model.items.count (e.itemId) > 0)
+		return true;		// already in the snapshot
+
+	if (e.parentId.empty ()) {
+		model.items[e.itemId] = { 0, e.newValue, "", {} };
+		InsertSorted (model.systems[0].roots, e.itemId);
+		return true;
+	}
+
+	auto parent = model.items.find (e.parentId);
+	if (parent == model.items.end ())
+		return false;
+	unsigned system = parent->second.system;
+	InsertSorted (parent->second.children, e.itemId);
+	model.items[e.itemId] = { system, e.newValue, "", {} };
+	return true;
+}
+
+
+static void BuildNodes (const ReplayModel& model, const std::vector<std::string>& ids,
+						std::vector<ClassificationNode>& nodes)
+{
+	for (const std::string& id : ids) {
+		auto it = model.items.find (id);
+		if (it == model.items.end ())
+			continue;
+
+		ClassificationNode node;
+		node.id          = id;
+		node.name        = it->second.name;
+		node.description = it->second.description;
+		BuildNodes (model, it->second.children, node.children);
+		nodes.push_back (std::move (node));
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+// Reconstruct: nearest snapshot at or before atKey + replay of later records
+// ---------------------------------------------------------------------------
+
+bool ReconstructMasterAt (const std::string& logDir,
+						  const std::string& atKey,
+						  std::vector<ClassificationTree>& master,
+						  ReplayResult& result,
+						  std::string& error)
+{
+	result.snapshotKey.clear ();
+	result.recordsApplied = 0;
+	result.recordsSkipped = 0;
+
+	std::string dir = JoinPath (logDir, kSnapshotDir);
+	std::vector<std::string> snapshots = ListFiles (dir, kSnapshotExt);
+
+	std::string snapshotFile;
+	for (const std::string& name : snapshots) {
+		std::string key = SnapshotKey (name);
+		if (!key.empty () && key <= atKey) {
+			snapshotFile       = name;
+			result.snapshotKey = key;
+		}
+	}
+	if (snapshotFile.empty ()) {
+		error = "No master snapshot at or before " + atKey;
+		return false;
+	}
+
+	ReplayModel model;
+	if (!LoadSnapshot (JoinPath (dir, snapshotFile), model)) {
+		error = "Cannot read snapshot " + snapshotFile;
+		return false;
+	}
+
+	// Records between the snapshot and atKey; only their day files are read
+	std::string firstDay = result.snapshotKey.substr (0, 10);
+	std::string lastDay  = atKey.substr (0, 10);
+	std::vector<HistoryEntry> records;
+	for (const std::string& name : ListFiles (logDir, ".jsonl")) {
+		std::string day = name.substr (0, 10);
+		if (day < firstDay || day > lastDay)
+			continue;
+
+		std::ifstream file (JoinPath (logDir, name), std::ios::binary);
+		std::string line;
+		while (std::getline (file, line)) {
+			HistoryEntry e = ParseChangeLogJsonLine (line, day);
+			if (e.action != "export" && e.action != "use-project")
+				continue;
+			std::string key = e.date + "T" + e.time;
+			if (key >= result.snapshotKey && key <= atKey)
+				records.push_back (e);
+		}
+	}
+
+	// Several sessions append to one day file - order by time, keep file order on ties
+	std::stable_sort (records.begin (), records.end (), [] (const HistoryEntry& a, const HistoryEntry& b) {
+		return a.date != b.date ? a.date < b.date : a.time < b.time;
+	});
+
+	for (const HistoryEntry& e : records) {
+		if (ApplyRecord (model, e))
+			result.recordsApplied++;
+		else
+			result.recordsSkipped++;
+	}
+
+	master.clear ();
+	for (const ReplaySystem& system : model.systems) {
+		ClassificationTree tree;
+		tree.systemName = system.name;
+		tree.version    = system.version;
+		BuildNodes (model, system.roots, tree.rootItems);
+		master.push_back (std::move (tree));
+	}
+
+	return true;
+}
@@ -0,0 +1,57 @@
+#ifndef MASTERHISTORY_HPP
+#define MASTERHISTORY_HPP
+
+#include "ClassificationModel.hpp"
+#include "MasterVersion.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// Point-in-time master reconstruction
+//
+// Snapshots of the parsed master are kept in changelog/snapshots/ (one small
+// text file per snapshot, named by local time). The master at time T is the
+// newest snapshot taken at or before T, with the structured .jsonl records
+// from the snapshot time up to T replayed on top:
+//
+//   export       add the item under its parent (sorted by ID, like Export)
+//   use-project  rename the master item
+//
+// use-server and import only change projects and are skipped. Edits made to
+// the XML outside ClassSync are not in the changelog; they appear at the
+// next snapshot.
+// ---------------------------------------------------------------------------
+
+// Time keys are local time "YYYY-MM-DDTHH:MM:SS" (the changelog "ts" format),
+// so they compare correctly as strings.
+std::string  FormatTimeKey (std::int64_t time);
+
+// Accept "YYYY-MM-DD", "YYYY-MM-DD HH:MM" or "YYYY-MM-DD HH:MM:SS" (a date
+// alone means the end of that day).
+bool  ParseTimeKey (const std::string& text, std::string& key);
+
+// Snapshot the master unless the newest snapshot is younger than
+// minIntervalSec or has the same version. Returns true if one was written.
+bool  WriteMasterSnapshotIfDue (const std::string& logDir,
+								const std::vector<ClassificationTree>& master,
+								const MasterVersion& version,
+								std::int64_t minIntervalSec);
+
+struct ReplayResult {
+	std::string  snapshotKey;		// time of the snapshot replay started from
+	unsigned     recordsApplied;
+	unsigned     recordsSkipped;	// unknown item or parent
+};
+
+// Rebuild the master as it was at the given time key.
+bool  ReconstructMasterAt (const std::string& logDir,
+						   const std::string& atKey,
+						   std::vector<ClassificationTree>& master,
+						   ReplayResult& result,
+						   std::string& error);
+
+
+#endif // MASTERHISTORY_HPP
@@ -0,0 +1,547 @@
+#include "MasterStore.hpp"
+#include "Counters.hpp"
+#include "FileLock.hpp"
+#include "FileSystem.hpp"
+#include "MasterHistory.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <unordered_map>
+
+
+static const char* kVersionHeader = "ClassSync master version 1";
+static const char* kStoreDir      = "store";
+static const char* kObjectsDir    = "objects";
+static const char* kVersionsDir   = "versions";
+static const char* kVersionExt    = ".ver";
+
+// Blob reference: marker byte + 16 hex digits of the blob hash
+static const char   kRefMarker  = '\x01';
+static const size_t kRefLength  = 17;
+
+// Elements stored as blobs of their own (nested ones become references)
+static const char* const kChunkTags[] = { "Item", "PropertyDefinitionGroup", "PropertyDefinition" };
+
+
+// ---------------------------------------------------------------------------
+// Helper: hashes and names
+// ---------------------------------------------------------------------------
+
+static std::string HashToHex (std::uint64_t hash)
+{
+	char buf[20];
+	std::snprintf (buf, sizeof (buf), "%016llx", (unsigned long long)hash);
+	return buf;
+}
+
+
+static bool HexToHash (const std::string& text, size_t pos, std::uint64_t& hash)
+{
+	if (pos + 16 > text.size ())
+		return false;
+	hash = 0;
+	for (size_t i = pos; i < pos + 16; i++) {
+		char c = text[i];
+		int  digit = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+		if (digit < 0)
+			return false;
+		hash = (hash << 4) | (std::uint64_t)digit;
+	}
+	return true;
+}
+
+
+static std::string BlobPath (const std::string& storeDir, std::uint64_t hash)
+{
+	std::string hex = HashToHex (hash);
+	return JoinPath (JoinPath (JoinPath (storeDir, kObjectsDir), hex.substr (0, 2)), hex);
+}
+
+
+static std::string VersionFileName (unsigned number)
+{
+	char buf[32];
+	std::snprintf (buf, sizeof (buf), "%06u%s", number, kVersionExt);
+	return buf;
+}
+
+
+// Text of the first <tag>...</tag> (raw, not unescaped)
+static std::string ExtractFirstText (const std::string& xml, const char* tag)
+{
+	std::string open  = std::string ("<") + tag + ">";
+	std::string close = std::string ("</") + tag + ">";
+	size_t start = xml.find (open);
+	if (start == std::string::npos)
+		return "";
+	start += open.size ();
+	size_t end = xml.find (close, start);
+	return end == std::string::npos ? "" : xml.substr (start, end - start);
+}
+
+
+// ---------------------------------------------------------------------------
+// Splitting the XML into blobs
+// ---------------------------------------------------------------------------
+
+// Next "<tag>" of a chunk tag in [pos, end); tagIndex receives which one
+static size_t FindChunkStart (const std::string& xml, size_t pos, size_t end, size_t& tagIndex)
+{
+	while ((pos = xml.find ('<', pos)) != std::string::npos && pos < end) {
+		for (size_t i = 0; i < sizeof (kChunkTags) / sizeof (kChunkTags[0]); i++) {
+			size_t length = std::strlen (kChunkTags[i]);
+			if (xml.compare (pos + 1, length, kChunkTags[i]) == 0 && pos + 1 + length < end && xml[pos + 1 + length] == '>') {
+				tagIndex = i;
+				return pos;
+			}
+		}
+		pos++;
+	}
+	return std::string::npos;
+}
+
+
+// End (one past "</tag>") of the element opened at openPos, nesting included
+static size_t FindChunkEnd (const std::string& xml, size_t openPos, size_t end, const char* tag)
+{
+	std::string open  = std::string ("<") + tag + ">";
+	std::string close = std::string ("</") + tag + ">";
+	int    depth    = 0;
+	size_t pos      = openPos;
+	size_t nextOpen = xml.find (open, pos);
+	while (pos < end) {
+		if (nextOpen != std::string::npos && nextOpen < pos)
+			nextOpen = xml.find (open, pos);
+		size_t nextClose = xml.find (close, pos);
+		if (nextClose == std::string::npos || nextClose >= end)
+			return std::string::npos;
+		if (nextOpen != std::string::npos && nextOpen < nextClose) {
+			depth++;
+			pos = nextOpen + open.size ();
+		} else {
+			depth--;
+			pos = nextClose + close.size ();
+			if (depth == 0)
+				return pos;
+		}
+	}
+	return std::string::npos;
+}
+
+
+namespace {
+
+struct BlobWriter {
+	std::string    storeDir;
+	std::uint64_t  blobsWritten = 0;
+	std::uint64_t  bytesWritten = 0;
+	bool           failed = false;
+
+	std::uint64_t  Put (const std::string& blob)
+	{
+		std::uint64_t hash = ComputeMasterVersion (blob).hash;
+		std::string   path = BlobPath (storeDir, hash);
+		if (FileExists (path))
+			return hash;
+
+		std::string hex = HashToHex (hash);
+		MakeDirectory (JoinPath (JoinPath (storeDir, kObjectsDir), hex.substr (0, 2)));
+		if (!WriteFileAtomic (path, blob)) {
+			failed = true;
+			return hash;
+		}
+		blobsWritten++;
+		bytesWritten += blob.size ();
+		return hash;
+	}
+};
+
+}
+
+
+// Blob of [begin, end) with every chunk inside (past skip bytes) replaced
+// by a reference to its own blob
+static std::uint64_t PutBlob (const std::string& xml, size_t begin, size_t end, size_t skip, BlobWriter& writer)
+{
+	std::string blob;
+	size_t pos = begin;
+	size_t tagIndex = 0;
+	size_t chunk;
+	while ((chunk = FindChunkStart (xml, std::max (pos, begin + skip), end, tagIndex)) != std::string::npos) {
+		const char* tag = kChunkTags[tagIndex];
+		size_t chunkEnd = FindChunkEnd (xml, chunk, end, tag);
+		if (chunkEnd == std::string::npos)
+			break;		// unbalanced: kept as text
+
+		blob.append (xml, pos, chunk - pos);
+		std::uint64_t child = PutBlob (xml, chunk, chunkEnd, std::strlen (tag) + 2, writer);
+		blob += kRefMarker;
+		blob += HashToHex (child);
+		pos = chunkEnd;
+	}
+	blob.append (xml, pos, end - pos);
+	return writer.Put (blob);
+}
+
+
+// ---------------------------------------------------------------------------
+// Reading blobs back
+// ---------------------------------------------------------------------------
+
+namespace {
+
+class BlobReader {
+public:
+	explicit BlobReader (const std::string& storeDir) : storeDir (storeDir) {}
+
+	const std::string*  Get (std::uint64_t hash, std::string& error)
+	{
+		auto it = blobs.find (hash);
+		if (it != blobs.end ())
+			return &it->second;
+
+		std::string blob;
+		if (!ReadFile (BlobPath (storeDir, hash), blob)) {
+			error = "Missing blob " + HashToHex (hash);
+			return nullptr;
+		}
+		if (ComputeMasterVersion (blob).hash != hash) {
+			error = "Damaged blob " + HashToHex (hash);
+			return nullptr;
+		}
+		return &(blobs[hash] = std::move (blob));
+	}
+
+private:
+	std::string                                     storeDir;
+	std::unordered_map<std::uint64_t, std::string>  blobs;
+};
+
+}
+
+
+static bool ExpandBlob (BlobReader& reader, std::uint64_t hash, std::string& out, std::string& error)
+{
+	const std::string* blob = reader.Get (hash, error);
+	if (blob == nullptr)
+		return false;
+
+	size_t pos = 0;
+	size_t ref;
+	while ((ref = blob->find (kRefMarker, pos)) != std::string::npos) {
+		out.append (*blob, pos, ref - pos);
+		std::uint64_t child;
+		if (!HexToHash (*blob, ref + 1, child)) {
+			error = "Bad reference in blob " + HashToHex (hash);
+			return false;
+		}
+		if (!ExpandBlob (reader, child, out, error))
+			return false;
+		pos = ref + kRefLength;
+	}
+	out.append (*blob, pos, std::string::npos);
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Version manifests
+// ---------------------------------------------------------------------------
+
+static bool ReadVersionFile (const std::string& path, StoredVersion& stored)
+{
+	std::ifstream file (path, std::ios::binary);
+	std::string line;
+	if (!std::getline (file, line) || line != kVersionHeader)
+		return false;
+
+	bool hasRoot = false;
+	while (std::getline (file, line)) {
+		if (!line.empty () && line.back () == '\r')
+			line.pop_back ();
+		if (line.compare (0, 7, "number=") == 0) {
+			stored.number = (unsigned)std::strtoul (line.c_str () + 7, nullptr, 10);
+		} else if (line.compare (0, 5, "time=") == 0) {
+			stored.time = line.substr (5);
+		} else if (line.compare (0, 5, "size=") == 0) {
+			stored.version.size = std::strtoull (line.c_str () + 5, nullptr, 10);
+		} else if (line.compare (0, 5, "hash=") == 0) {
+			stored.version.valid = HexToHash (line, 5, stored.version.hash);
+		} else if (line.compare (0, 5, "root=") == 0) {
+			hasRoot = HexToHash (line, 5, stored.root);
+		}
+	}
+	return stored.number > 0 && stored.version.valid && hasRoot;
+}
+
+
+std::string GetMasterStoreDir (const std::string& logDir)
+{
+	return JoinPath (logDir, kStoreDir);
+}
+
+
+std::vector<StoredVersion> ListStoredVersions (const std::string& storeDir)
+{
+	std::vector<StoredVersion> versions;
+	std::string dir = JoinPath (storeDir, kVersionsDir);
+	for (const std::string& name : ListFiles (dir, kVersionExt)) {
+		StoredVersion stored;
+		if (ReadVersionFile (JoinPath (dir, name), stored))
+			versions.push_back (stored);
+	}
+	return versions;
+}
+
+
+bool FindStoredVersionAt (const std::string& storeDir, const std::string& atKey, StoredVersion& found)
+{
+	bool any = false;
+	for (const StoredVersion& stored : ListStoredVersions (storeDir)) {
+		if (stored.time > atKey)
+			break;
+		found = stored;
+		any   = true;
+	}
+	return any;
+}
+
+
+// ---------------------------------------------------------------------------
+// Store / materialize
+// ---------------------------------------------------------------------------
+
+bool StoreMasterVersion (const std::string& storeDir, const std::string& content, StoredVersion* stored)
+{
+	MasterVersion version = ComputeMasterVersion (content);
+	std::string   versionsDir = JoinPath (storeDir, kVersionsDir);
+	MakeDirectories (storeDir);
+	MakeDirectory (JoinPath (storeDir, kObjectsDir));
+	MakeDirectory (versionsDir);
+
+	// Numbers are handed out one session at a time
+	CommitGuard guard (versionsDir.c_str ());
+	if (!guard.IsAcquired ())
+		return false;
+
+	StoredVersion newest;
+	std::vector<std::string> names = ListFiles (versionsDir, kVersionExt);
+	for (auto it = names.rbegin (); it != names.rend (); ++it) {
+		if (ReadVersionFile (JoinPath (versionsDir, *it), newest))
+			break;
+	}
+	if (newest.number > 0 && newest.version == version) {
+		if (stored != nullptr)
+			*stored = newest;
+		return true;
+	}
+
+	BlobWriter writer;
+	writer.storeDir = storeDir;
+	StoredVersion added;
+	added.root = PutBlob (content, 0, content.size (), 0, writer);
+	if (writer.failed)
+		return false;
+
+	added.number  = newest.number + 1;
+	added.time    = FormatTimeKey ((std::int64_t)std::time (nullptr));
+	added.version = version;
+
+	std::string manifest = std::string (kVersionHeader) + "\n";
+	manifest += "number=" + std::to_string (added.number) + "\n";
+	manifest += "time=" + added.time + "\n";
+	manifest += "size=" + std::to_string ((unsigned long long)version.size) + "\n";
+	manifest += "hash=" + HashToHex (version.hash) + "\n";
+	manifest += "root=" + HashToHex (added.root) + "\n";
+	if (!WriteFileAtomic (JoinPath (versionsDir, VersionFileName (added.number)), manifest))
+		return false;
+
+	AddCounter (Counter::StoreVersions);
+	AddCounter (Counter::StoreBlobsWritten, writer.blobsWritten);
+	AddCounter (Counter::StoreBytesWritten, writer.bytesWritten + manifest.size ());
+	if (stored != nullptr)
+		*stored = added;
+	return true;
+}
+
+
+static bool FindVersion (const std::string& storeDir, unsigned number, StoredVersion& stored, std::string& error)
+{
+	if (ReadVersionFile (JoinPath (JoinPath (storeDir, kVersionsDir), VersionFileName (number)), stored) && stored.number == number)
+		return true;
+	error = "No stored version " + std::to_string (number);
+	return false;
+}
+
+
+bool MaterializeStoredVersion (const std::string& storeDir, unsigned number, std::string& content, std::string& error)
+{
+	StoredVersion stored;
+	if (!FindVersion (storeDir, number, stored, error))
+		return false;
+
+	BlobReader reader (storeDir);
+	content.clear ();
+	content.reserve ((size_t)stored.version.size);
+	if (!ExpandBlob (reader, stored.root, content, error))
+		return false;
+
+	if (ComputeMasterVersion (content) != stored.version) {
+		error = "Version " + std::to_string (number) + " does not match its recorded hash";
+		return false;
+	}
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Diff: walk both trees, skipping equal hashes
+// ---------------------------------------------------------------------------
+
+namespace {
+
+struct BlobInfo {
+	std::string                 tag;		// "" for the root
+	std::string                 id;
+	std::string                 name;
+	std::string                 ownText;	// without references and whitespace
+	std::vector<std::uint64_t>  children;
+};
+
+}
+
+
+static bool DescribeBlob (BlobReader& reader, std::uint64_t hash, BlobInfo& info, std::string& error)
+{
+	const std::string* blob = reader.Get (hash, error);
+	if (blob == nullptr)
+		return false;
+
+	info = BlobInfo ();
+	for (const char* tag : kChunkTags) {
+		std::string open = std::string ("<") + tag + ">";
+		if (blob->compare (0, open.size (), open) == 0) {
+			info.tag = tag;
+			break;
+		}
+	}
+
+	for (size_t i = 0; i < blob->size (); i++) {
+		char c = (*blob)[i];
+		if (c == kRefMarker) {
+			std::uint64_t child;
+			if (!HexToHash (*blob, i + 1, child)) {
+				error = "Bad reference in blob " + HashToHex (hash);
+				return false;
+			}
+			info.children.push_back (child);
+			i += kRefLength - 1;
+		} else if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+			info.ownText += c;
+		}
+	}
+
+	// Own fields come before the first reference
+	size_t firstRef = blob->find (kRefMarker);
+	std::string head = blob->substr (0, firstRef);
+	info.id   = ExtractFirstText (head, info.tag == "Item" ? "ID" : "Name");
+	info.name = ExtractFirstText (head, "Name");
+	return true;
+}
+
+
+static bool DiffBlobs (BlobReader& reader, std::uint64_t from, std::uint64_t to,
+					   std::vector<StoredChange>& changes, std::string& error)
+{
+	if (from == to)
+		return true;
+
+	BlobInfo a, b;
+	if (!DescribeBlob (reader, from, a, error) || !DescribeBlob (reader, to, b, error))
+		return false;
+
+	if (a.ownText != b.ownText)
+		changes.push_back ({ StoredChangeKind::Changed, b.tag, b.id, a.name, b.name });
+
+	// Children with the same hash on both sides need no look
+	std::unordered_map<std::uint64_t, int> inA, inB;
+	for (std::uint64_t h : a.children)
+		inA[h]++;
+	for (std::uint64_t h : b.children)
+		inB[h]++;
+
+	std::vector<std::uint64_t> onlyA, onlyB;
+	for (std::uint64_t h : a.children) {
+		if (inB[h] > 0)
+			inB[h]--;
+		else
+			onlyA.push_back (h);
+	}
+	for (std::uint64_t h : b.children) {
+		if (inA[h] > 0)
+			inA[h]--;
+		else
+			onlyB.push_back (h);
+	}
+
+	// The rest are matched by tag and ID
+	std::vector<BlobInfo> infoA (onlyA.size ()), infoB (onlyB.size ());
+	for (size_t i = 0; i < onlyA.size (); i++) {
+		if (!DescribeBlob (reader, onlyA[i], infoA[i], error))
+			return false;
+	}
+	for (size_t i = 0; i < onlyB.size (); i++) {
+		if (!DescribeBlob (reader, onlyB[i], infoB[i], error))
+			return false;
+	}
+
+	std::vector<bool> matchedB (onlyB.size (), false);
+	for (size_t i = 0; i < onlyA.size (); i++) {
+		size_t match = onlyB.size ();
+		for (size_t j = 0; j < onlyB.size (); j++) {
+			if (!matchedB[j] && infoB[j].tag == infoA[i].tag && infoB[j].id == infoA[i].id) {
+				match = j;
+				break;
+			}
+		}
+		if (match == onlyB.size ()) {
+			changes.push_back ({ StoredChangeKind::Removed, infoA[i].tag, infoA[i].id, infoA[i].name, "" });
+			continue;
+		}
+		matchedB[match] = true;
+		if (!DiffBlobs (reader, onlyA[i], onlyB[match], changes, error))
+			return false;
+	}
+	for (size_t j = 0; j < onlyB.size (); j++) {
+		if (!matchedB[j])
+			changes.push_back ({ StoredChangeKind::Added, infoB[j].tag, infoB[j].id, "", infoB[j].name });
+	}
+	return true;
+}
+
+
+bool DiffStoredVersions (const std::string& storeDir, unsigned from, unsigned to,
+						 std::vector<StoredChange>& changes, std::string& error)
+{
+	StoredVersion a, b;
+	if (!FindVersion (storeDir, from, a, error) || !FindVersion (storeDir, to, b, error))
+		return false;
+
+	BlobReader reader (storeDir);
+	changes.clear ();
+	return DiffBlobs (reader, a.root, b.root, changes, error);
+}
+
+
+const char* StoredChangeKindName (StoredChangeKind kind)
+{
+	switch (kind) {
+		case StoredChangeKind::Added:   return "added";
+		case StoredChangeKind::Removed: return "removed";
+		case StoredChangeKind::Changed: return "changed";
+	}
+	return "unknown";
+}
@@ -0,0 +1,89 @@
+#ifndef MASTERSTORE_HPP
+#define MASTERSTORE_HPP
+
+#include "MasterVersion.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// Content-addressed version history of the master XML
+//
+//   changelog/store/objects/3f/3f2a9c01d4e5b6a7   blobs, named by their hash
+//   changelog/store/versions/000012.ver            root manifest of version 12
+//
+// Every version is a tree of blobs. Each <Item> subtree, <PropertyDefinition>
+// and <PropertyDefinitionGroup> is one blob in which the nested ones are
+// replaced by references (byte 0x01 and 16 hex digits; XML does not allow
+// 0x01), and the document around them is the root blob. A blob's hash
+// (FNV-1a 64, as MasterVersion) covers everything below it, so branches
+// that did not change are shared by all versions, and a new version adds
+// only the blobs on the paths to what changed.
+//
+// Materializing a version gives back the exact bytes that were stored
+// (checked against the recorded master version). Diffs descend only where
+// the hashes of the two versions differ.
+// ---------------------------------------------------------------------------
+
+struct StoredVersion {
+	unsigned       number;		// 1, 2, ... in the order stored
+	std::string    time;		// local time key (MasterHistory.hpp)
+	MasterVersion  version;		// of the whole XML
+	std::uint64_t  root;		// root blob
+
+	StoredVersion () : number (0), root (0) {}
+};
+
+// changelog/store next to the changelog day files.
+std::string  GetMasterStoreDir (const std::string& logDir);
+
+// Store the content as the next version unless the newest version has the
+// same bytes. stored receives the new version or that newest one.
+bool  StoreMasterVersion (const std::string& storeDir,
+						  const std::string& content,
+						  StoredVersion* stored = nullptr);
+
+// All versions, oldest first.
+std::vector<StoredVersion>  ListStoredVersions (const std::string& storeDir);
+
+// Newest version stored at or before the time key; false if none.
+bool  FindStoredVersionAt (const std::string& storeDir, const std::string& atKey, StoredVersion& found);
+
+// The exact XML of a version.
+bool  MaterializeStoredVersion (const std::string& storeDir,
+								unsigned number,
+								std::string& content,
+								std::string& error);
+
+
+// ---------------------------------------------------------------------------
+// Differences between two stored versions
+// ---------------------------------------------------------------------------
+
+enum class StoredChangeKind {
+	Added,			// subtree only in the newer version (its children are not listed)
+	Removed,		// subtree only in the older version
+	Changed			// own text differs (name, description, values, ...)
+};
+
+struct StoredChange {
+	StoredChangeKind  kind;
+	std::string       tag;		// "Item", "PropertyDefinition", ... ("" = the document around them)
+	std::string       id;		// <ID> of an item, <Name> of a property (group)
+	std::string       oldName;	// <Name> in the older / newer version
+	std::string       newName;
+};
+
+// Parents come before their children.
+bool  DiffStoredVersions (const std::string& storeDir,
+						  unsigned from,
+						  unsigned to,
+						  std::vector<StoredChange>& changes,
+						  std::string& error);
+
+const char*  StoredChangeKindName (StoredChangeKind kind);		// "added", "removed", "changed"
+
+
+#endif // MASTERSTORE_HPP
@@ -0,0 +1,79 @@
+#include "MasterVersion.hpp"
+#include "Counters.hpp"
+
+#include <cstdio>
+
+#if defined (_WIN32)
+	#include <windows.h>
+#else
+	#include <sys/stat.h>
+#endif
+
+
+// ---------------------------------------------------------------------------
+// Compute size + FNV-1a 64 hash of the master content
+// ---------------------------------------------------------------------------
+
+MasterVersion ComputeMasterVersion (const std::string& content)
+{
+	std::uint64_t hash = 14695981039346656037ULL;
+	for (unsigned char c : content) {
+		hash ^= c;
+		hash *= 1099511628211ULL;
+	}
+
+	MasterVersion version;
+	version.size  = content.size ();
+	version.hash  = hash;
+	version.valid = true;
+	return version;
+}
+
+
+// ---------------------------------------------------------------------------
+// Format a version for diagnostics
+// ---------------------------------------------------------------------------
+
+std::string MasterVersionToString (const MasterVersion& version)
+{
+	if (!version.valid)
+		return "none";
+
+	char buf[48];
+	snprintf (buf, sizeof (buf), "%016llx/%llu",
+			  (unsigned long long)version.hash, (unsigned long long)version.size);
+	return buf;
+}
+
+
+// ---------------------------------------------------------------------------
+// Stat the master for the refresh pre-check
+// ---------------------------------------------------------------------------
+
+MasterStamp ReadMasterStamp (const std::string& path)
+{
+	MasterStamp stamp;
+	AddCounter (Counter::MasterStats);
+
+#if defined (_WIN32)
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA (path.c_str (), GetFileExInfoStandard, &data))
+		return stamp;
+	stamp.size     = ((std::uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+	stamp.modified = (std::int64_t)(((std::uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) |
+									data.ftLastWriteTime.dwLowDateTime);
+#else
+	struct stat st;
+	if (stat (path.c_str (), &st) != 0)
+		return stamp;
+	stamp.size = (std::uint64_t)st.st_size;
+	#if defined (__APPLE__)
+		stamp.modified = (std::int64_t)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+	#else
+		stamp.modified = (std::int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+	#endif
+#endif
+
+	stamp.valid = true;
+	return stamp;
+}
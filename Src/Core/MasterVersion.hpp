@@ -0,0 +1,61 @@
+#ifndef MASTERVERSION_HPP
+#define MASTERVERSION_HPP
+
+#include <cstdint>
+#include <string>
+
+
+// ---------------------------------------------------------------------------
+// Version of the master XML content an edit was computed against.
+// Two versions are equal only if size and content hash both match.
+// ---------------------------------------------------------------------------
+
+struct MasterVersion {
+	std::uint64_t  size;
+	std::uint64_t  hash;		// FNV-1a 64 of the raw file bytes
+	bool           valid;		// false if the file could not be read
+
+	MasterVersion () : size (0), hash (0), valid (false) {}
+
+	bool operator== (const MasterVersion& other) const
+	{
+		return valid && other.valid && size == other.size && hash == other.hash;
+	}
+
+	bool operator!= (const MasterVersion& other) const { return !(*this == other); }
+};
+
+
+// ---------------------------------------------------------------------------
+// Size + modification time of the master file: a cheap check before reading
+// it. Equal stamps are taken to mean unchanged content (the version hash of
+// the bytes is still what optimistic commits compare).
+// ---------------------------------------------------------------------------
+
+struct MasterStamp {
+	std::uint64_t  size;
+	std::int64_t   modified;	// FILETIME ticks or nanoseconds since the epoch
+	bool           valid;		// false if the file does not exist
+
+	MasterStamp () : size (0), modified (0), valid (false) {}
+
+	bool operator== (const MasterStamp& other) const
+	{
+		return valid && other.valid && size == other.size && modified == other.modified;
+	}
+
+	bool operator!= (const MasterStamp& other) const { return !(*this == other); }
+};
+
+
+// Compute the version of an in-memory copy of the master.
+MasterVersion  ComputeMasterVersion (const std::string& content);
+
+// Stat the master file (UTF-8 path).
+MasterStamp    ReadMasterStamp (const std::string& path);
+
+// Short hex form for logs, e.g. "3f2a9c01d4e5b6a7/2394522".
+std::string    MasterVersionToString (const MasterVersion& version);
+
+
+#endif // MASTERVERSION_HPP
@@ -0,0 +1,428 @@
+#include "MasterWatcher.hpp"
+
+#include <chrono>
+#include <vector>
+
+#if defined (_WIN32)
+	#include <windows.h>
+#else
+	#include <poll.h>
+	#include <unistd.h>
+	#include <fcntl.h>
+	#include <sys/inotify.h>
+#endif
+
+
+// Notify at the latest after this many debounce periods of continuous activity
+static const unsigned kMaxDebounceFactor = 10;
+
+
+// ---------------------------------------------------------------------------
+// Helper: ASCII case-insensitive string equality (Windows file names)
+// ---------------------------------------------------------------------------
+
+static bool EqualsNoCase (const std::string& a, const std::string& b)
+{
+	if (a.size () != b.size ())
+		return false;
+	for (size_t i = 0; i < a.size (); i++) {
+		char ca = a[i], cb = b[i];
+		if (ca >= 'A' && ca <= 'Z') ca = (char)(ca - 'A' + 'a');
+		if (cb >= 'A' && cb <= 'Z') cb = (char)(cb - 'A' + 'a');
+		if (ca != cb)
+			return false;
+	}
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: split "dir/name.xml" into directory and file name
+// ---------------------------------------------------------------------------
+
+static void SplitPath (const std::string& path, std::string& dir, std::string& name)
+{
+	auto lastSlash = path.find_last_of ("/\\");
+	if (lastSlash == std::string::npos) {
+		dir  = ".";
+		name = path;
+	} else {
+		dir  = path.substr (0, lastSlash);
+		name = path.substr (lastSlash + 1);
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+// Classify a path (relative to the watched directory)
+// ---------------------------------------------------------------------------
+
+unsigned MasterWatcher::ClassifyChange (const std::string& masterFileName,
+										const std::string& relativePath)
+{
+	static const std::string kChangelogDir = "changelog";
+
+	if (relativePath.size () >= kChangelogDir.size () &&
+		EqualsNoCase (relativePath.substr (0, kChangelogDir.size ()), kChangelogDir) &&
+		(relativePath.size () == kChangelogDir.size () ||
+		 relativePath[kChangelogDir.size ()] == '/' ||
+		 relativePath[kChangelogDir.size ()] == '\\'))
+	{
+		return MasterChangeChangelog;
+	}
+
+	if (EqualsNoCase (relativePath, masterFileName))
+		return MasterChangeContent;
+
+	if (EqualsNoCase (relativePath, masterFileName + ".lock"))
+		return MasterChangeLock;
+
+	// .tmp and .commit are transient - the final rename reports the master itself
+	return MasterChangeNone;
+}
+
+
+unsigned MasterWatcher::Classify (const std::string& relativePath) const
+{
+	unsigned change = ClassifyChange (masterFileName, relativePath);
+	if (change != MasterChangeNone)
+		return change;
+
+	for (const std::string& name : contentFileNames) {
+		if (EqualsNoCase (relativePath, name))
+			return MasterChangeContent;
+	}
+	return MasterChangeNone;
+}
+
+
+// ---------------------------------------------------------------------------
+// Construction / destruction
+// ---------------------------------------------------------------------------
+
+MasterWatcher::MasterWatcher () :
+	debounceMs      (0),
+	running         (false),
+	stopRequested   (false),
+	watchHandle     (-1),
+	wakeHandle      (-1),
+	wakeHandleWrite (-1)
+{
+}
+
+
+MasterWatcher::~MasterWatcher ()
+{
+	Stop ();
+}
+
+
+#if defined (_WIN32)
+
+// ===========================================================================
+// Windows: ReadDirectoryChangesW (overlapped) + stop event
+// ===========================================================================
+
+static std::wstring Utf8ToWide (const std::string& s)
+{
+	if (s.empty ())
+		return std::wstring ();
+	int len = MultiByteToWideChar (CP_UTF8, 0, s.c_str (), (int)s.size (), nullptr, 0);
+	std::wstring result (len, L'\0');
+	MultiByteToWideChar (CP_UTF8, 0, s.c_str (), (int)s.size (), &result[0], len);
+	return result;
+}
+
+
+static std::string WideToUtf8 (const wchar_t* s, int count)
+{
+	if (count <= 0)
+		return std::string ();
+	int len = WideCharToMultiByte (CP_UTF8, 0, s, count, nullptr, 0, nullptr, nullptr);
+	std::string result (len, '\0');
+	WideCharToMultiByte (CP_UTF8, 0, s, count, &result[0], len, nullptr, nullptr);
+	return result;
+}
+
+
+bool MasterWatcher::Start (const std::string& masterPath, unsigned debounce, const Callback& cb,
+						   const std::vector<std::string>& contentFiles)
+{
+	Stop ();
+
+	SplitPath (masterPath, directory, masterFileName);
+	contentFileNames = contentFiles;
+	debounceMs = debounce;
+	callback   = cb;
+
+	HANDLE dir = CreateFileW (Utf8ToWide (directory).c_str (), FILE_LIST_DIRECTORY,
+							  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+							  OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	if (dir == INVALID_HANDLE_VALUE)
+		return false;
+
+	HANDLE stopEvent = CreateEventW (nullptr, TRUE, FALSE, nullptr);
+	if (stopEvent == nullptr) {
+		CloseHandle (dir);
+		return false;
+	}
+
+	watchHandle = (intptr_t)dir;
+	wakeHandle  = (intptr_t)stopEvent;
+
+	stopRequested = false;
+	running       = true;
+	worker = std::thread (&MasterWatcher::Run, this);
+	return true;
+}
+
+
+void MasterWatcher::Stop ()
+{
+	if (!running)
+		return;
+
+	stopRequested = true;
+	SetEvent ((HANDLE)wakeHandle);
+	if (worker.joinable ())
+		worker.join ();
+
+	CloseHandle ((HANDLE)watchHandle);
+	CloseHandle ((HANDLE)wakeHandle);
+	watchHandle = -1;
+	wakeHandle  = -1;
+	running     = false;
+}
+
+
+void MasterWatcher::Run ()
+{
+	HANDLE dir       = (HANDLE)watchHandle;
+	HANDLE stopEvent = (HANDLE)wakeHandle;
+
+	const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME |
+						 FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+
+	std::vector<DWORD> buffer (16 * 1024);	// DWORD-aligned, 64 KB (SMB limit)
+	OVERLAPPED overlapped = {};
+	overlapped.hEvent = CreateEventW (nullptr, TRUE, FALSE, nullptr);
+
+	unsigned pending = MasterChangeNone;
+	auto firstEvent  = std::chrono::steady_clock::now ();
+	auto lastEvent   = firstEvent;
+
+	while (!stopRequested) {
+		ResetEvent (overlapped.hEvent);
+		if (!ReadDirectoryChangesW (dir, buffer.data (), (DWORD)(buffer.size () * sizeof (DWORD)),
+									TRUE, filter, nullptr, &overlapped, nullptr))
+			break;
+
+		bool readDone = false;
+		while (!readDone && !stopRequested) {
+			DWORD timeout = INFINITE;
+			if (pending != MasterChangeNone) {
+				auto now = std::chrono::steady_clock::now ();
+				auto quietEnd = lastEvent + std::chrono::milliseconds (debounceMs);
+				auto hardEnd  = firstEvent + std::chrono::milliseconds (debounceMs * kMaxDebounceFactor);
+				auto due = quietEnd < hardEnd ? quietEnd : hardEnd;
+				timeout = (due <= now) ? 0 :
+					(DWORD)std::chrono::duration_cast<std::chrono::milliseconds> (due - now).count ();
+			}
+
+			HANDLE handles[2] = { stopEvent, overlapped.hEvent };
+			DWORD r = WaitForMultipleObjects (2, handles, FALSE, timeout);
+
+			if (r == WAIT_OBJECT_0) {
+				break;
+			} else if (r == WAIT_TIMEOUT) {
+				callback (pending);
+				pending = MasterChangeNone;
+			} else if (r == WAIT_OBJECT_0 + 1) {
+				DWORD bytes = 0;
+				readDone = true;
+				if (!GetOverlappedResult (dir, &overlapped, &bytes, FALSE))
+					continue;
+
+				auto now = std::chrono::steady_clock::now ();
+				if (pending == MasterChangeNone)
+					firstEvent = now;
+				lastEvent = now;
+
+				if (bytes == 0) {
+					// Buffer overflow - we don't know what changed
+					pending |= MasterChangeAll;
+					continue;
+				}
+
+				const char* p = reinterpret_cast<const char*> (buffer.data ());
+				while (true) {
+					const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*> (p);
+					std::string name = WideToUtf8 (info->FileName, (int)(info->FileNameLength / sizeof (WCHAR)));
+					pending |= Classify (name);
+					if (info->NextEntryOffset == 0)
+						break;
+					p += info->NextEntryOffset;
+				}
+			} else {
+				stopRequested = true;
+			}
+		}
+	}
+
+	CancelIo (dir);
+	DWORD ignored = 0;
+	GetOverlappedResult (dir, &overlapped, &ignored, TRUE);
+	CloseHandle (overlapped.hEvent);
+}
+
+#else
+
+// ===========================================================================
+// POSIX: inotify + self-pipe for stop
+// ===========================================================================
+
+static const uint32_t kInotifyMask = IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_DELETE |
+									 IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB;
+
+
+bool MasterWatcher::Start (const std::string& masterPath, unsigned debounce, const Callback& cb,
+						   const std::vector<std::string>& contentFiles)
+{
+	Stop ();
+
+	SplitPath (masterPath, directory, masterFileName);
+	contentFileNames = contentFiles;
+	debounceMs = debounce;
+	callback   = cb;
+
+	int fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	if (inotify_add_watch (fd, directory.c_str (), kInotifyMask) < 0) {
+		close (fd);
+		return false;
+	}
+
+	int pipeFds[2];
+	if (pipe (pipeFds) != 0) {
+		close (fd);
+		return false;
+	}
+	fcntl (pipeFds[0], F_SETFD, FD_CLOEXEC);
+	fcntl (pipeFds[1], F_SETFD, FD_CLOEXEC);
+
+	watchHandle     = fd;
+	wakeHandle      = pipeFds[0];
+	wakeHandleWrite = pipeFds[1];
+
+	stopRequested = false;
+	running       = true;
+	worker = std::thread (&MasterWatcher::Run, this);
+	return true;
+}
+
+
+void MasterWatcher::Stop ()
+{
+	if (!running)
+		return;
+
+	stopRequested = true;
+	char b = 0;
+	if (write ((int)wakeHandleWrite, &b, 1) < 0) {
+		// Thread still observes stopRequested on its next wake-up
+	}
+	if (worker.joinable ())
+		worker.join ();
+
+	close ((int)watchHandle);
+	close ((int)wakeHandle);
+	close ((int)wakeHandleWrite);
+	watchHandle     = -1;
+	wakeHandle      = -1;
+	wakeHandleWrite = -1;
+	running         = false;
+}
+
+
+void MasterWatcher::Run ()
+{
+	int fd = (int)watchHandle;
+
+	// changelog/ lives in a subdirectory - inotify is not recursive
+	std::string changelogDir = directory + "/changelog";
+	int changelogWd = inotify_add_watch (fd, changelogDir.c_str (), kInotifyMask);
+
+	alignas (struct inotify_event) char buffer[16 * 1024];
+
+	unsigned pending = MasterChangeNone;
+	auto firstEvent  = std::chrono::steady_clock::now ();
+	auto lastEvent   = firstEvent;
+
+	while (!stopRequested) {
+		int timeout = -1;
+		if (pending != MasterChangeNone) {
+			auto now = std::chrono::steady_clock::now ();
+			auto quietEnd = lastEvent + std::chrono::milliseconds (debounceMs);
+			auto hardEnd  = firstEvent + std::chrono::milliseconds (debounceMs * kMaxDebounceFactor);
+			auto due = quietEnd < hardEnd ? quietEnd : hardEnd;
+			timeout = (due <= now) ? 0 :
+				(int)std::chrono::duration_cast<std::chrono::milliseconds> (due - now).count ();
+		}
+
+		struct pollfd fds[2];
+		fds[0].fd = fd;               fds[0].events = POLLIN; fds[0].revents = 0;
+		fds[1].fd = (int)wakeHandle;  fds[1].events = POLLIN; fds[1].revents = 0;
+
+		int r = poll (fds, 2, timeout);
+		if (r < 0)
+			continue;	// EINTR
+
+		if (fds[1].revents != 0)
+			break;
+
+		if (r == 0) {
+			callback (pending);
+			pending = MasterChangeNone;
+			continue;
+		}
+
+		ssize_t len = read (fd, buffer, sizeof (buffer));
+		if (len <= 0)
+			continue;
+
+		auto now = std::chrono::steady_clock::now ();
+		if (pending == MasterChangeNone)
+			firstEvent = now;
+		lastEvent = now;
+
+		for (char* p = buffer; p < buffer + len; ) {
+			const struct inotify_event* ev = reinterpret_cast<const struct inotify_event*> (p);
+			p += sizeof (struct inotify_event) + ev->len;
+
+			if (ev->mask & IN_Q_OVERFLOW) {
+				pending |= MasterChangeAll;
+				continue;
+			}
+
+			std::string name = (ev->len > 0) ? std::string (ev->name) : std::string ();
+
+			if (ev->wd == changelogWd) {
+				pending |= MasterChangeChangelog;
+				continue;
+			}
+
+			// changelog/ created after we started - start watching it
+			if ((ev->mask & IN_ISDIR) && (ev->mask & (IN_CREATE | IN_MOVED_TO)) &&
+				ClassifyChange (masterFileName, name) == MasterChangeChangelog)
+			{
+				changelogWd = inotify_add_watch (fd, changelogDir.c_str (), kInotifyMask);
+			}
+
+			pending |= Classify (name);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef MASTERWATCHER_HPP
+#define MASTERWATCHER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// What changed in the master's directory (bit mask)
+// ---------------------------------------------------------------------------
+
+enum MasterChange : unsigned {
+	MasterChangeNone      = 0,
+	MasterChangeContent   = 1 << 0,		// the master XML itself was replaced/written
+	MasterChangeLock      = 1 << 1,		// "<xml>.lock" created, rewritten or removed
+	MasterChangeChangelog = 1 << 2,		// anything under changelog/
+	MasterChangeAll       = MasterChangeContent | MasterChangeLock | MasterChangeChangelog
+};
+
+
+// ---------------------------------------------------------------------------
+// Directory watcher for the master XML
+//
+// Watches the directory containing the master (ReadDirectoryChangesW on
+// Windows, inotify elsewhere) on a background thread. Bursts of events are
+// coalesced: the callback fires once the directory has been quiet for
+// debounceMs, with the OR of all changes seen. The callback runs on the
+// watcher thread - it must only hand the mask over to the UI thread.
+// ---------------------------------------------------------------------------
+
+class MasterWatcher {
+public:
+	typedef std::function<void (unsigned changes)> Callback;
+
+	MasterWatcher ();
+	~MasterWatcher ();
+
+	// Start watching the directory of masterPath (UTF-8). Stops any previous watch.
+	// contentFileNames are further files in that directory whose changes count
+	// as MasterChangeContent (the masters listed in a catalog).
+	bool  Start (const std::string& masterPath, unsigned debounceMs, const Callback& callback,
+				 const std::vector<std::string>& contentFileNames = std::vector<std::string> ());
+	void  Stop ();
+	bool  IsRunning () const { return running; }
+
+	// Map a path relative to the watched directory to a MasterChange bit.
+	static unsigned  ClassifyChange (const std::string& masterFileName,
+									 const std::string& relativePath);
+
+private:
+	MasterWatcher (const MasterWatcher&) = delete;
+	MasterWatcher& operator= (const MasterWatcher&) = delete;
+
+	void      Run ();
+	unsigned  Classify (const std::string& relativePath) const;
+
+	std::string        directory;
+	std::string        masterFileName;
+	std::vector<std::string>  contentFileNames;
+	unsigned           debounceMs;
+	Callback           callback;
+
+	std::thread        worker;
+	std::atomic<bool>  running;
+	std::atomic<bool>  stopRequested;
+
+	// Platform handles: inotify + wake pipe, or directory handle + stop event
+	intptr_t           watchHandle;
+	intptr_t           wakeHandle;
+	intptr_t           wakeHandleWrite;
+};
+
+
+#endif // MASTERWATCHER_HPP
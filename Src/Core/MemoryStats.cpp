@@ -0,0 +1,387 @@
+#include "MemoryStats.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+#if defined (_WIN32)
+	#include <malloc.h>
+#elif defined (__APPLE__)
+	#include <malloc/malloc.h>
+#else
+	#include <malloc.h>
+#endif
+
+
+// ---------------------------------------------------------------------------
+// Counters: per thread (plain, no atomics) and per process
+// ---------------------------------------------------------------------------
+
+struct ThreadHeap {
+	std::uint64_t  allocations;
+	std::uint64_t  bytes;
+	std::uint64_t  frees;
+	std::int64_t   netBytes;
+	std::int64_t   peakBytes;
+};
+
+static thread_local ThreadHeap     threadHeap = { 0, 0, 0, 0, 0 };
+
+static std::atomic<bool>           countingEnabled (false);
+static std::atomic<std::uint64_t>  heapAllocations (0);
+static std::atomic<std::uint64_t>  heapBytes (0);
+static std::atomic<std::uint64_t>  heapFrees (0);
+static std::atomic<std::int64_t>   heapNetBytes (0);
+static std::atomic<std::int64_t>   heapPeakBytes (0);
+
+
+#if CLASSSYNC_HEAP_COUNTING
+
+static size_t BlockSize (void* block)
+{
+#if defined (_WIN32)
+	return _msize (block);
+#elif defined (__APPLE__)
+	return malloc_size (block);
+#else
+	return malloc_usable_size (block);
+#endif
+}
+
+
+static void CountAllocation (void* block)
+{
+	std::int64_t size = (std::int64_t)BlockSize (block);
+
+	ThreadHeap& thread = threadHeap;
+	thread.allocations++;
+	thread.bytes    += (std::uint64_t)size;
+	thread.netBytes += size;
+	if (thread.netBytes > thread.peakBytes)
+		thread.peakBytes = thread.netBytes;
+
+	heapAllocations.fetch_add (1, std::memory_order_relaxed);
+	heapBytes.fetch_add ((std::uint64_t)size, std::memory_order_relaxed);
+	std::int64_t net  = heapNetBytes.fetch_add (size, std::memory_order_relaxed) + size;
+	std::int64_t peak = heapPeakBytes.load (std::memory_order_relaxed);
+	while (net > peak && !heapPeakBytes.compare_exchange_weak (peak, net, std::memory_order_relaxed)) {}
+}
+
+
+static void CountFree (void* block)
+{
+	std::int64_t size = (std::int64_t)BlockSize (block);
+
+	ThreadHeap& thread = threadHeap;
+	thread.frees++;
+	thread.netBytes -= size;
+
+	heapFrees.fetch_add (1, std::memory_order_relaxed);
+	heapNetBytes.fetch_sub (size, std::memory_order_relaxed);
+}
+
+
+// ---------------------------------------------------------------------------
+// Global operator new/delete (replaced for the whole binary unless the build
+// turns it off with CLASSSYNC_HEAP_COUNTING=0)
+// ---------------------------------------------------------------------------
+
+static void* Allocate (std::size_t size) noexcept
+{
+	void* block = std::malloc (size == 0 ? 1 : size);
+	if (block != nullptr && countingEnabled.load (std::memory_order_relaxed))
+		CountAllocation (block);
+	return block;
+}
+
+
+static void Free (void* block) noexcept
+{
+	if (block == nullptr)
+		return;
+	if (countingEnabled.load (std::memory_order_relaxed))
+		CountFree (block);
+	std::free (block);
+}
+
+
+void* operator new (std::size_t size)
+{
+	if (void* block = Allocate (size))
+		return block;
+	throw std::bad_alloc ();
+}
+
+void* operator new[] (std::size_t size)
+{
+	return operator new (size);
+}
+
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept    { return Allocate (size); }
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept  { return Allocate (size); }
+
+void operator delete (void* block) noexcept                                { Free (block); }
+void operator delete[] (void* block) noexcept                              { Free (block); }
+void operator delete (void* block, std::size_t) noexcept                   { Free (block); }
+void operator delete[] (void* block, std::size_t) noexcept                 { Free (block); }
+void operator delete (void* block, const std::nothrow_t&) noexcept         { Free (block); }
+void operator delete[] (void* block, const std::nothrow_t&) noexcept       { Free (block); }
+#endif
+
+
+// ---------------------------------------------------------------------------
+// Control and totals
+// ---------------------------------------------------------------------------
+
+void SetAllocationCounting (bool enabled)
+{
+	countingEnabled.store (enabled && CLASSSYNC_HEAP_COUNTING, std::memory_order_relaxed);
+}
+
+
+bool IsAllocationCounting ()
+{
+	return countingEnabled.load (std::memory_order_relaxed);
+}
+
+
+AllocationStats GetHeapTotals ()
+{
+	AllocationStats stats;
+	stats.allocations = heapAllocations.load (std::memory_order_relaxed);
+	stats.bytes       = heapBytes.load (std::memory_order_relaxed);
+	stats.frees       = heapFrees.load (std::memory_order_relaxed);
+	stats.netBytes    = heapNetBytes.load (std::memory_order_relaxed);
+	stats.peakBytes   = heapPeakBytes.load (std::memory_order_relaxed);
+	return stats;
+}
+
+
+void ResetHeapPeak ()
+{
+	heapPeakBytes.store (heapNetBytes.load (std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+
+// ---------------------------------------------------------------------------
+// Scopes
+// ---------------------------------------------------------------------------
+
+AllocationScope::AllocationScope ()
+{
+	ThreadHeap& thread = threadHeap;
+	allocations = thread.allocations;
+	bytes       = thread.bytes;
+	frees       = thread.frees;
+	netBytes    = thread.netBytes;
+	outerPeak   = thread.peakBytes;
+	thread.peakBytes = thread.netBytes;
+}
+
+
+AllocationScope::~AllocationScope ()
+{
+	ThreadHeap& thread = threadHeap;
+	if (outerPeak > thread.peakBytes)
+		thread.peakBytes = outerPeak;
+}
+
+
+AllocationStats AllocationScope::Get () const
+{
+	const ThreadHeap& thread = threadHeap;
+	AllocationStats stats;
+	stats.allocations = thread.allocations - allocations;
+	stats.bytes       = thread.bytes - bytes;
+	stats.frees       = thread.frees - frees;
+	stats.netBytes    = thread.netBytes - netBytes;
+	stats.peakBytes   = thread.peakBytes - netBytes;
+	return stats;
+}
+
+
+static std::mutex                stageMutex;
+static std::vector<StageMemory>  stageRows;
+
+
+MemoryStage::MemoryStage (const char* name) :
+	name (IsAllocationCounting () ? name : nullptr)
+{
+}
+
+
+MemoryStage::~MemoryStage ()
+{
+	End ();
+}
+
+
+void MemoryStage::End ()
+{
+	if (name == nullptr)
+		return;
+
+	AllocationStats stats = scope.Get ();
+	std::lock_guard<std::mutex> lock (stageMutex);
+	StageMemory* row = nullptr;
+	for (StageMemory& existing : stageRows) {
+		if (existing.name == name)
+			row = &existing;
+	}
+	if (row == nullptr) {
+		stageRows.emplace_back ();
+		row = &stageRows.back ();
+		row->name = name;
+	}
+
+	row->runs++;
+	row->last = stats;
+	row->total.allocations += stats.allocations;
+	row->total.bytes       += stats.bytes;
+	row->total.frees       += stats.frees;
+	row->total.netBytes    += stats.netBytes;
+	if (stats.peakBytes > row->total.peakBytes)
+		row->total.peakBytes = stats.peakBytes;
+	name = nullptr;
+}
+
+
+std::vector<StageMemory> GetStageMemory ()
+{
+	std::lock_guard<std::mutex> lock (stageMutex);
+	return stageRows;
+}
+
+
+void ClearStageMemory ()
+{
+	std::lock_guard<std::mutex> lock (stageMutex);
+	stageRows.clear ();
+}
+
+
+std::string FormatByteSize (std::int64_t bytes)
+{
+	char text[32];
+	std::int64_t magnitude = bytes < 0 ? -bytes : bytes;
+	if (magnitude >= 1024 * 1024)
+		std::snprintf (text, sizeof (text), "%.1f MB", bytes / 1048576.0);
+	else if (magnitude >= 1024)
+		std::snprintf (text, sizeof (text), "%lld KB", (long long)(bytes / 1024));
+	else
+		std::snprintf (text, sizeof (text), "%lld B", (long long)bytes);
+	return text;
+}
+
+
+std::string FormatStageMemory (const std::vector<StageMemory>& stages)
+{
+	std::string text;
+	for (const StageMemory& stage : stages) {
+		char line[160];
+		std::snprintf (line, sizeof (line), "%s: %llu run(s), last %llu allocs, %s allocated, %s peak, %s kept\n",
+					   stage.name, (unsigned long long)stage.runs, (unsigned long long)stage.last.allocations,
+					   FormatByteSize ((std::int64_t)stage.last.bytes).c_str (),
+					   FormatByteSize (stage.last.peakBytes).c_str (),
+					   FormatByteSize (stage.last.netBytes).c_str ());
+		text += line;
+	}
+	return text;
+}
+
+
+// ---------------------------------------------------------------------------
+// Resident size estimates
+// ---------------------------------------------------------------------------
+
+std::uint64_t EstimateStringBytes (const std::string& text)
+{
+	// Short strings live inside the object
+	const char* data   = text.data ();
+	const char* object = reinterpret_cast<const char*> (&text);
+	if (data >= object && data < object + sizeof (text))
+		return 0;
+	return text.capacity () + 1;
+}
+
+
+std::uint64_t EstimateNodesBytes (const std::vector<ClassificationNode>& nodes)
+{
+	std::uint64_t bytes = nodes.capacity () * sizeof (ClassificationNode);
+	for (const ClassificationNode& node : nodes) {
+		bytes += EstimateStringBytes (node.id) + EstimateStringBytes (node.name) +
+				 EstimateStringBytes (node.description);
+		bytes += EstimateNodesBytes (node.children);
+	}
+	return bytes;
+}
+
+
+std::uint64_t EstimateModelBytes (const std::vector<ClassificationTree>& trees)
+{
+	std::uint64_t bytes = trees.capacity () * sizeof (ClassificationTree);
+	for (const ClassificationTree& tree : trees) {
+		bytes += EstimateStringBytes (tree.systemName) + EstimateStringBytes (tree.version);
+		bytes += EstimateNodesBytes (tree.rootItems);
+	}
+	return bytes;
+}
+
+
+std::uint64_t EstimateDiffBytes (const std::vector<DiffEntry>& entries)
+{
+	std::uint64_t bytes = entries.capacity () * sizeof (DiffEntry);
+	for (const DiffEntry& entry : entries) {
+		bytes += EstimateStringBytes (entry.id) + EstimateStringBytes (entry.projectName) +
+				 EstimateStringBytes (entry.serverName) + EstimateStringBytes (entry.description);
+	}
+	return bytes;
+}
+
+
+static std::uint64_t EstimateViewChildrenBytes (const std::vector<ViewNode>& nodes)
+{
+	std::uint64_t bytes = nodes.capacity () * sizeof (ViewNode);
+	for (const ViewNode& node : nodes)
+		bytes += EstimateStringBytes (node.key) + EstimateStringBytes (node.text) + EstimateViewChildrenBytes (node.children);
+	return bytes;
+}
+
+
+std::uint64_t EstimateViewBytes (const ViewNode& root)
+{
+	return EstimateStringBytes (root.key) + EstimateStringBytes (root.text) + EstimateViewChildrenBytes (root.children);
+}
+
+
+std::uint64_t EstimateShardCacheBytes (const ShardedMasterCache& cache)
+{
+	std::uint64_t bytes = EstimateStringBytes (cache.manifestPath);
+	for (const auto& shard : cache.shards) {
+		bytes += kNodeOverheadBytes + sizeof (shard) + EstimateStringBytes (shard.first);
+		bytes += EstimateStringBytes (shard.second.header.systemName) + EstimateStringBytes (shard.second.header.version);
+		bytes += EstimateNodesBytes (shard.second.header.rootItems) + EstimateNodesBytes (shard.second.items);
+	}
+	for (const auto& entry : cache.itemToShard)
+		bytes += kNodeOverheadBytes + sizeof (entry) + EstimateStringBytes (entry.first) + EstimateStringBytes (entry.second);
+	return bytes;
+}
+
+
+std::uint64_t EstimateCatalogCacheBytes (const MasterCatalogCache& cache)
+{
+	std::uint64_t bytes = EstimateStringBytes (cache.catalogPath);
+	for (const std::string& path : cache.masterPaths)
+		bytes += sizeof (path) + EstimateStringBytes (path);
+	for (const auto& master : cache.masters) {
+		bytes += kNodeOverheadBytes + sizeof (master) + EstimateStringBytes (master.first);
+		bytes += EstimateModelBytes (master.second.systems);
+	}
+	for (const auto& entry : cache.systemToMaster)
+		bytes += kNodeOverheadBytes + sizeof (entry) + EstimateStringBytes (entry.first) + EstimateStringBytes (entry.second);
+	for (const auto& entry : cache.itemToMaster)
+		bytes += kNodeOverheadBytes + sizeof (entry) + EstimateStringBytes (entry.first) + EstimateStringBytes (entry.second);
+	return bytes;
+}
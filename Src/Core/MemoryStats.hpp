@@ -0,0 +1,144 @@
+#ifndef MEMORYSTATS_HPP
+#define MEMORYSTATS_HPP
+
+#include "ClassificationModel.hpp"
+#include "MasterCatalog.hpp"
+#include "ShardedMaster.hpp"
+#include "TreeReconcile.hpp"
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// Heap accounting (opt-in)
+//
+// Linking this module replaces the global operator new/delete of the binary
+// (malloc/free underneath). While counting is off each call costs one
+// relaxed atomic load; while it is on, allocations and freed bytes (the
+// block's usable size) are counted per thread and for the whole process.
+// Byte figures are net of frees since counting started, so blocks that
+// existed before can make them go below zero. Built with
+// CLASSSYNC_HEAP_COUNTING=0 the operators are left alone and counting
+// never turns on.
+// ---------------------------------------------------------------------------
+
+#ifndef CLASSSYNC_HEAP_COUNTING
+#define CLASSSYNC_HEAP_COUNTING 1
+#endif
+
+void  SetAllocationCounting (bool enabled);
+bool  IsAllocationCounting ();
+
+struct AllocationStats {
+	std::uint64_t  allocations;
+	std::uint64_t  bytes;			// allocated
+	std::uint64_t  frees;
+	std::int64_t   netBytes;		// allocated - freed
+	std::int64_t   peakBytes;		// highest netBytes reached
+
+	AllocationStats () : allocations (0), bytes (0), frees (0), netBytes (0), peakBytes (0) {}
+};
+
+// Whole process since counting started (peak since ResetHeapPeak).
+AllocationStats  GetHeapTotals ();
+void             ResetHeapPeak ();
+
+
+// Allocations of the calling thread from construction on; nests.
+class AllocationScope {
+public:
+	AllocationScope ();
+	~AllocationScope ();
+
+	AllocationStats  Get () const;
+
+private:
+	AllocationScope (const AllocationScope&) = delete;
+	AllocationScope& operator= (const AllocationScope&) = delete;
+
+	std::uint64_t  allocations;
+	std::uint64_t  bytes;
+	std::uint64_t  frees;
+	std::int64_t   netBytes;
+	std::int64_t   outerPeak;		// thread peak before this scope, restored after
+};
+
+
+// ---------------------------------------------------------------------------
+// Per-stage table: a MemoryStage adds what its thread allocated to the
+// stage's row when it ends (only while counting is on)
+// ---------------------------------------------------------------------------
+
+struct StageMemory {
+	const char*      name;
+	std::uint64_t    runs;
+	AllocationStats  last;
+	AllocationStats  total;		// peakBytes = highest of all runs
+
+	StageMemory () : name (nullptr), runs (0) {}
+};
+
+class MemoryStage {
+public:
+	explicit MemoryStage (const char* name);		// a string literal
+	~MemoryStage ();
+
+	void  End ();		// record now (the destructor does it otherwise)
+
+private:
+	MemoryStage (const MemoryStage&) = delete;
+	MemoryStage& operator= (const MemoryStage&) = delete;
+
+	const char*      name;		// nullptr while counting is off
+	AllocationScope  scope;
+};
+
+std::vector<StageMemory>  GetStageMemory ();		// in order of first use
+void                      ClearStageMemory ();
+
+// One line per stage: runs, allocations and MB of the last run, peak MB.
+std::string  FormatStageMemory (const std::vector<StageMemory>& stages);
+
+// "12.3 MB" / "456 KB" / "78 B"
+std::string  FormatByteSize (std::int64_t bytes);
+
+
+// ---------------------------------------------------------------------------
+// Resident size estimates: heap bytes held by a structure (element arrays,
+// string buffers beyond the small-string buffer, node overhead)
+// ---------------------------------------------------------------------------
+
+std::uint64_t  EstimateStringBytes (const std::string& text);
+std::uint64_t  EstimateModelBytes (const std::vector<ClassificationTree>& trees);
+std::uint64_t  EstimateNodesBytes (const std::vector<ClassificationNode>& nodes);
+std::uint64_t  EstimateDiffBytes (const std::vector<DiffEntry>& entries);
+std::uint64_t  EstimateViewBytes (const ViewNode& root);
+std::uint64_t  EstimateShardCacheBytes (const ShardedMasterCache& cache);
+std::uint64_t  EstimateCatalogCacheBytes (const MasterCatalogCache& cache);
+
+// Per node of a std::map/set/unordered_map (links, hash, allocator padding)
+static const std::uint64_t kNodeOverheadBytes = 4 * sizeof (void*);
+
+template <typename Value>
+std::uint64_t EstimateMapBytes (const std::unordered_map<std::string, Value>& map)
+{
+	std::uint64_t bytes = map.bucket_count () * sizeof (void*);
+	for (const auto& entry : map)
+		bytes += kNodeOverheadBytes + sizeof (entry) + EstimateStringBytes (entry.first);
+	return bytes;
+}
+
+inline std::uint64_t EstimateSetBytes (const std::set<std::string>& set)
+{
+	std::uint64_t bytes = 0;
+	for (const std::string& key : set)
+		bytes += kNodeOverheadBytes + sizeof (key) + EstimateStringBytes (key);
+	return bytes;
+}
+
+
+#endif // MEMORYSTATS_HPP
@@ -0,0 +1,374 @@
+#include "PropertyApplicability.hpp"
+#include "ItemIndex.hpp"
+#include "MasterCatalog.hpp"
+#include "ShardedMaster.hpp"
+#include "FileSystem.hpp"
+#include "Trace.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+
+
+// Name of the properties shard next to a shard manifest
+static const char* kPropertiesShardName = "properties.xml";
+
+
+// ---------------------------------------------------------------------------
+// Helper: XML text of <tag> between from and limit, entities decoded
+// ---------------------------------------------------------------------------
+
+static std::string DecodeXmlText (const std::string& text)
+{
+	if (text.find ('&') == std::string::npos)
+		return text;
+
+	static const struct { const char* entity; char c; } kEntities[] = {
+		{ "&amp;", '&' }, { "&lt;", '<' }, { "&gt;", '>' }, { "&quot;", '"' }, { "&apos;", '\'' }
+	};
+
+	std::string result;
+	result.reserve (text.size ());
+	for (size_t i = 0; i < text.size (); i++) {
+		bool decoded = false;
+		if (text[i] == '&') {
+			for (const auto& e : kEntities) {
+				if (text.compare (i, strlen (e.entity), e.entity) == 0) {
+					result += e.c;
+					i += strlen (e.entity) - 1;
+					decoded = true;
+					break;
+				}
+			}
+		}
+		if (!decoded)
+			result += text[i];
+	}
+	return result;
+}
+
+
+static std::string ExtractTagBefore (const std::string& xml, const std::string& tag, size_t from, size_t limit)
+{
+	std::string openTag  = "<" + tag + ">";
+	std::string closeTag = "</" + tag + ">";
+	auto start = xml.find (openTag, from);
+	if (start == std::string::npos || start >= limit)
+		return "";
+	start += openTag.size ();
+	auto end = xml.find (closeTag, start);
+	if (end == std::string::npos || end > limit)
+		return "";
+	return DecodeXmlText (xml.substr (start, end - start));
+}
+
+
+// ---------------------------------------------------------------------------
+// Master side: <PropertyDefinitionGroup> / <PropertyDefinition> / <ClassificationIDs>
+// ---------------------------------------------------------------------------
+
+void ParseXmlPropertyDefinitions (const std::string& content, std::vector<PropertyDefinitionInfo>& result)
+{
+	TraceScope trace ("ParseXmlPropertyDefinitions");
+	static const std::string kGroupOpen  = "<PropertyDefinitionGroup>";
+	static const std::string kGroupClose = "</PropertyDefinitionGroup>";
+	static const std::string kDefOpen    = "<PropertyDefinition>";
+	static const std::string kDefClose   = "</PropertyDefinition>";
+	static const std::string kItemOpen   = "<ItemID>";
+	static const std::string kKeyOpen    = "<Key>";
+
+	size_t pos = content.find ("<PropertyDefinitionGroups>");
+	while (pos != std::string::npos) {
+		auto groupStart = content.find (kGroupOpen, pos);
+		if (groupStart == std::string::npos)
+			break;
+		auto groupEnd = content.find (kGroupClose, groupStart);
+		if (groupEnd == std::string::npos)
+			break;
+
+		// The group's own <Name> comes before its definitions
+		auto defsStart = content.find ("<PropertyDefinitions>", groupStart);
+		if (defsStart == std::string::npos || defsStart > groupEnd)
+			defsStart = groupEnd;
+		std::string group = ExtractTagBefore (content, "Name", groupStart, defsStart);
+
+		size_t defPos = defsStart;
+		while (true) {
+			auto defStart = content.find (kDefOpen, defPos);
+			if (defStart == std::string::npos || defStart > groupEnd)
+				break;
+			auto defEnd = content.find (kDefClose, defStart);
+			if (defEnd == std::string::npos || defEnd > groupEnd)
+				break;
+
+			PropertyDefinitionInfo definition;
+			definition.group = group;
+			definition.name  = ExtractTagBefore (content, "Name", defStart, defEnd);
+
+			// Enumeration values: <Key>GUID</Key><Value><Variant><Value>text</Value>
+			auto valuesStart = content.find ("<EnumerationValueDescriptorWithStoredValues>", defStart);
+			if (valuesStart != std::string::npos && valuesStart < defEnd) {
+				auto valuesEnd = content.find ("</Values>", valuesStart);
+				if (valuesEnd == std::string::npos || valuesEnd > defEnd)
+					valuesEnd = defEnd;
+				size_t keyPos = valuesStart;
+				while (true) {
+					auto keyStart = content.find (kKeyOpen, keyPos);
+					if (keyStart == std::string::npos || keyStart > valuesEnd)
+						break;
+					keyStart += kKeyOpen.size ();
+					auto keyEnd = content.find ("</Key>", keyStart);
+					if (keyEnd == std::string::npos || keyEnd > valuesEnd)
+						break;
+					auto nextKey = content.find (kKeyOpen, keyEnd);
+					if (nextKey == std::string::npos || nextKey > valuesEnd)
+						nextKey = valuesEnd;
+
+					EnumValueInfo value;
+					value.key = content.substr (keyStart, keyEnd - keyStart);
+					auto variant = content.find ("<Variant", keyEnd);
+					if (variant != std::string::npos && variant < nextKey)
+						value.text = ExtractTagBefore (content, "Value", variant, nextKey);
+					definition.enumValues.push_back (std::move (value));
+					keyPos = nextKey;
+				}
+			}
+
+			auto idsStart = content.find ("<ClassificationIDs>", defStart);
+			if (idsStart != std::string::npos && idsStart < defEnd) {
+				size_t idPos = idsStart;
+				while (true) {
+					auto idStart = content.find (kItemOpen, idPos);
+					if (idStart == std::string::npos || idStart > defEnd)
+						break;
+					idStart += kItemOpen.size ();
+					auto idEnd = content.find ("</ItemID>", idStart);
+					if (idEnd == std::string::npos || idEnd > defEnd)
+						break;
+					definition.itemIds.push_back (content.substr (idStart, idEnd - idStart));
+					idPos = idEnd;
+				}
+			}
+
+			result.push_back (std::move (definition));
+			defPos = defEnd + kDefClose.size ();
+		}
+
+		pos = groupEnd + kGroupClose.size ();
+	}
+}
+
+
+bool ReadMasterPropertyDefinitions (const char* masterPath, std::vector<PropertyDefinitionInfo>& result)
+{
+	TraceScope trace ("ReadMasterPropertyDefinitions");
+	result.clear ();
+
+	std::vector<std::string> files;
+	if (IsShardedMaster (masterPath)) {
+		files.push_back (JoinPath (GetDirectory (masterPath), kPropertiesShardName));
+	} else if (IsMasterCatalog (masterPath)) {
+		if (!ReadMasterCatalog (masterPath, files))
+			return false;
+	} else {
+		files.push_back (masterPath);
+	}
+
+	// Same definition in several catalog masters: one entry, items of all
+	std::map<std::pair<std::string, std::string>, size_t> byKey;
+	bool anyRead = false;
+	for (const std::string& file : files) {
+		std::string content;
+		if (!ReadMasterFile (file, content))
+			continue;
+		anyRead = true;
+
+		std::vector<PropertyDefinitionInfo> definitions;
+		ParseXmlPropertyDefinitions (content, definitions);
+		for (PropertyDefinitionInfo& definition : definitions) {
+			auto found = byKey.emplace (std::make_pair (definition.group, definition.name), result.size ());
+			if (found.second)
+				result.push_back (std::move (definition));
+			else
+				result[found.first->second].itemIds.insert (result[found.first->second].itemIds.end (),
+															definition.itemIds.begin (), definition.itemIds.end ());
+		}
+	}
+	return anyRead;
+}
+
+
+// ---------------------------------------------------------------------------
+// Fingerprints (FNV-1a 64, fields separated by their terminators)
+// ---------------------------------------------------------------------------
+
+static void HashString (std::uint64_t& hash, const std::string& text)
+{
+	for (size_t i = 0; i <= text.size (); i++) {
+		hash ^= (unsigned char)text.c_str ()[i];
+		hash *= 1099511628211ULL;
+	}
+}
+
+
+std::uint64_t HashPropertyDefinitions (const std::vector<PropertyDefinitionInfo>& definitions)
+{
+	std::uint64_t hash = 14695981039346656037ULL;
+	for (const PropertyDefinitionInfo& definition : definitions) {
+		HashString (hash, definition.group);
+		HashString (hash, definition.name);
+		for (const std::string& id : definition.itemIds)
+			HashString (hash, id);
+		HashString (hash, std::string ());
+		for (const EnumValueInfo& value : definition.enumValues) {
+			HashString (hash, value.key);
+			HashString (hash, value.text);
+		}
+		HashString (hash, std::string ());
+	}
+	return hash != 0 ? hash : 1;
+}
+
+
+std::uint64_t HashPropertyDrift (const std::vector<PropertyDrift>& drift)
+{
+	std::uint64_t hash = 14695981039346656037ULL;
+	for (const PropertyDrift& entry : drift) {
+		HashString (hash, entry.itemId);
+		HashString (hash, entry.group);
+		HashString (hash, entry.name);
+		HashString (hash, entry.value);
+		HashString (hash, entry.inProject ? "P" : "S");
+	}
+	return hash != 0 ? hash : 1;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: fill one side's matrix (column per shared definition)
+// ---------------------------------------------------------------------------
+
+static void CollectItemIds (const std::vector<ClassificationNode>& nodes, std::vector<const std::string*>& ids)
+{
+	for (const ClassificationNode& node : nodes) {
+		ids.push_back (&node.id);
+		CollectItemIds (node.children, ids);
+	}
+}
+
+
+static void FillMatrix (const std::vector<PropertyDefinitionInfo>& definitions,
+						const std::vector<size_t>& columnOf,
+						const std::unordered_map<std::string, size_t>& rowOf,
+						ApplicabilityMatrix& matrix)
+{
+	for (size_t d = 0; d < definitions.size (); d++) {
+		if (columnOf[d] == SIZE_MAX)
+			continue;
+		for (const std::string& id : definitions[d].itemIds) {
+			auto row = rowOf.find (id);
+			if (row != rowOf.end ())
+				matrix.Set (row->second, columnOf[d]);
+		}
+	}
+}
+
+
+static int CountTrailingZeros (std::uint64_t word)
+{
+	int n = 0;
+	while ((word & 1) == 0) {
+		word >>= 1;
+		n++;
+	}
+	return n;
+}
+
+
+// ---------------------------------------------------------------------------
+// Compare: two bit matrices over the same rows and columns, XOR per word
+// ---------------------------------------------------------------------------
+
+std::vector<PropertyDrift> ComparePropertyApplicability (const std::vector<ClassificationTree>& project,
+														 const std::vector<PropertyDefinitionInfo>& projectDefinitions,
+														 const std::vector<ClassificationTree>& master,
+														 const std::vector<PropertyDefinitionInfo>& masterDefinitions)
+{
+	TraceScope trace ("ComparePropertyApplicability");
+	std::vector<PropertyDrift> result;
+
+	// Columns: definitions on both sides, in master order
+	std::map<std::pair<std::string, std::string>, size_t> projectByKey;
+	for (size_t d = 0; d < projectDefinitions.size (); d++)
+		projectByKey.emplace (std::make_pair (projectDefinitions[d].group, projectDefinitions[d].name), d);
+
+	std::vector<size_t> masterColumn (masterDefinitions.size (), SIZE_MAX);
+	std::vector<size_t> projectColumn (projectDefinitions.size (), SIZE_MAX);
+	std::vector<size_t> columnDefinition;		// column -> master definition
+	for (size_t d = 0; d < masterDefinitions.size (); d++) {
+		const PropertyDefinitionInfo& definition = masterDefinitions[d];
+		auto found = projectByKey.find (std::make_pair (definition.group, definition.name));
+		if (found == projectByKey.end ()) {
+			PropertyDrift entry;
+			entry.group = definition.group;
+			entry.name  = definition.name;
+			result.push_back (entry);
+			continue;
+		}
+		if (projectColumn[found->second] != SIZE_MAX)
+			continue;		// listed twice on the master
+		masterColumn[d] = projectColumn[found->second] = columnDefinition.size ();
+		columnDefinition.push_back (d);
+	}
+	for (size_t d = 0; d < projectDefinitions.size (); d++) {
+		if (projectColumn[d] != SIZE_MAX || projectByKey.find (std::make_pair (projectDefinitions[d].group, projectDefinitions[d].name))->second != d)
+			continue;
+		PropertyDrift entry;
+		entry.group     = projectDefinitions[d].group;
+		entry.name      = projectDefinitions[d].name;
+		entry.inProject = true;
+		result.push_back (entry);
+	}
+
+	// Rows: project items that the master has too
+	ItemIndex masterIndex (master);
+	std::vector<const std::string*> projectIds;
+	for (const ClassificationTree& tree : project)
+		CollectItemIds (tree.rootItems, projectIds);
+
+	std::vector<const std::string*>          rowId;
+	std::unordered_map<std::string, size_t>  rowOf;
+	for (const std::string* id : projectIds) {
+		if (masterIndex.Find (*id) != ItemIndex::kNoItem && rowOf.emplace (*id, rowId.size ()).second)
+			rowId.push_back (id);
+	}
+
+	ApplicabilityMatrix projectMatrix (rowId.size (), columnDefinition.size ());
+	ApplicabilityMatrix masterMatrix (rowId.size (), columnDefinition.size ());
+	FillMatrix (projectDefinitions, projectColumn, rowOf, projectMatrix);
+	FillMatrix (masterDefinitions, masterColumn, rowOf, masterMatrix);
+
+	size_t words = projectMatrix.GetWordsPerRow ();
+	for (size_t r = 0; r < rowId.size (); r++) {
+		const std::uint64_t* projectRow = projectMatrix.GetRow (r);
+		const std::uint64_t* masterRow  = masterMatrix.GetRow (r);
+		for (size_t w = 0; w < words; w++) {
+			std::uint64_t differ = projectRow[w] ^ masterRow[w];
+			while (differ != 0) {
+				size_t column = w * 64 + CountTrailingZeros (differ);
+				differ &= differ - 1;
+
+				const PropertyDefinitionInfo& definition = masterDefinitions[columnDefinition[column]];
+				PropertyDrift entry;
+				entry.itemId    = *rowId[r];
+				entry.group     = definition.group;
+				entry.name      = definition.name;
+				entry.inProject = projectMatrix.Get (r, column);
+				result.push_back (entry);
+			}
+		}
+	}
+
+	return result;
+}
@@ -0,0 +1,102 @@
+#ifndef PROPERTYAPPLICABILITY_HPP
+#define PROPERTYAPPLICABILITY_HPP
+
+#include "ClassificationModel.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// Property definitions and the classification items they are available for
+//
+// Definitions are matched between the project and the master by group and
+// name (their GUIDs differ between projects), items by ID. The project side
+// is read through ACAPI by the add-on; the master side comes from the
+// <PropertyDefinitionGroups> block of the classification XML.
+// ---------------------------------------------------------------------------
+
+// One value of an enumeration property: its key GUID ("62382B6E-EE9B-...",
+// different in every project) and its display text
+struct EnumValueInfo {
+	std::string  key;
+	std::string  text;
+};
+
+struct PropertyDefinitionInfo {
+	std::string                 group;
+	std::string                 name;
+	std::vector<std::string>    itemIds;		// items the definition applies to
+	std::vector<EnumValueInfo>  enumValues;		// empty unless an enumeration
+};
+
+// Parse the <PropertyDefinitionGroups> block of master content.
+void  ParseXmlPropertyDefinitions (const std::string& content, std::vector<PropertyDefinitionInfo>& result);
+
+// Definitions of a master: single XML, shard manifest (its properties shard)
+// or catalog (every listed master; a definition in several masters gets the
+// items of all). False if nothing could be read.
+bool  ReadMasterPropertyDefinitions (const char* masterPath, std::vector<PropertyDefinitionInfo>& result);
+
+// Content fingerprint (never 0).
+std::uint64_t  HashPropertyDefinitions (const std::vector<PropertyDefinitionInfo>& definitions);
+
+
+// ---------------------------------------------------------------------------
+// Items x definitions bit matrix, one row of 64-bit words per item
+// ---------------------------------------------------------------------------
+
+class ApplicabilityMatrix {
+public:
+	ApplicabilityMatrix (size_t rows, size_t columns) :
+		rows (rows), columns (columns), wordsPerRow ((columns + 63) / 64), words (rows * ((columns + 63) / 64), 0) {}
+
+	size_t  GetRows () const			{ return rows; }
+	size_t  GetColumns () const			{ return columns; }
+	size_t  GetWordsPerRow () const		{ return wordsPerRow; }
+
+	void  Set (size_t row, size_t column)			{ words[row * wordsPerRow + column / 64] |= 1ULL << (column % 64); }
+	bool  Get (size_t row, size_t column) const		{ return (words[row * wordsPerRow + column / 64] >> (column % 64)) & 1; }
+
+	const std::uint64_t*  GetRow (size_t row) const	{ return words.data () + row * wordsPerRow; }
+
+private:
+	size_t                      rows;
+	size_t                      columns;
+	size_t                      wordsPerRow;
+	std::vector<std::uint64_t>  words;
+};
+
+
+// ---------------------------------------------------------------------------
+// Applicability drift
+//
+// Rows are the items present on both sides (project document order), columns
+// the definitions present on both sides (master order); a cell differs when
+// the definition applies to the item on one side only. A definition missing
+// on one side is one entry with an empty itemId. Items present on one side
+// only are already in the classification diff and are left out. Enumeration
+// values on one side only (EnumRemapTable) are entries with a value.
+// ---------------------------------------------------------------------------
+
+struct PropertyDrift {
+	std::string  itemId;		// "" = the whole definition (or one of its values)
+	std::string  group;
+	std::string  name;
+	std::string  value;			// display text of an enumeration value, "" = applicability
+	bool         inProject;		// applies in the project only (else on the master only)
+
+	PropertyDrift () : inProject (false) {}
+};
+
+std::vector<PropertyDrift>  ComparePropertyApplicability (
+	const std::vector<ClassificationTree>&      project,
+	const std::vector<PropertyDefinitionInfo>&  projectDefinitions,
+	const std::vector<ClassificationTree>&      master,
+	const std::vector<PropertyDefinitionInfo>&  masterDefinitions);
+
+std::uint64_t  HashPropertyDrift (const std::vector<PropertyDrift>& drift);
+
+
+#endif // PROPERTYAPPLICABILITY_HPP
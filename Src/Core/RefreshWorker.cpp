@@ -0,0 +1,347 @@
+#include "RefreshWorker.hpp"
+#include "MemoryStats.hpp"
+#include "Trace.hpp"
+#include "XmlReader.hpp"
+
+#include <chrono>
+
+
+// Overall progress (per mille) at the end of the master read
+static const unsigned kReadShare = 800;
+
+
+static std::uint64_t CombineHashes (std::uint64_t a, std::uint64_t b)
+{
+	return (a ^ (b + 0x9E3779B97F4A7C15ULL + (a << 6) + (a >> 2))) | 1;
+}
+
+
+// ---------------------------------------------------------------------------
+// Progress sink of one job: maps stage steps to overall progress, collects
+// report lines, and stops the job once a newer one was submitted
+// ---------------------------------------------------------------------------
+
+class RefreshWorker::JobProgress : public WorkProgress {
+public:
+	JobProgress (RefreshWorker& owner, std::uint64_t jobGeneration, std::vector<std::string>& notes) :
+		owner (owner), jobGeneration (jobGeneration), notes (notes), from (0), to (0) {}
+
+	void  SetStage (RefreshStage stage, unsigned fromPerMille, unsigned toPerMille)
+	{
+		from = fromPerMille;
+		to   = toPerMille;
+		owner.stage    = stage;
+		owner.progress = from;
+	}
+
+	bool  IsCurrent () const
+	{
+		return owner.generation == jobGeneration;
+	}
+
+	virtual bool  Step (std::uint64_t done, std::uint64_t total) override
+	{
+		if (total > 0 && done <= total)
+			owner.progress = from + (unsigned)((to - from) * done / total);
+		return IsCurrent ();
+	}
+
+	virtual void  Note (const std::string& line) override
+	{
+		notes.push_back (line);
+	}
+
+private:
+	RefreshWorker&             owner;
+	std::uint64_t              jobGeneration;
+	std::vector<std::string>&  notes;
+	unsigned                   from;
+	unsigned                   to;
+};
+
+
+// ---------------------------------------------------------------------------
+// Lifetime
+// ---------------------------------------------------------------------------
+
+RefreshWorker::RefreshWorker () :
+	stopRequested (false),
+	generation (0),
+	busy (false),
+	stage (RefreshStage::Idle),
+	progress (0)
+{
+	masterMemo.hash        = 0;
+	masterMemo.revision    = 0;
+	diffMemo.projectHash   = 0;
+	diffMemo.serverHash    = 0;
+	propertyMemo.masterHash = 0;
+	propertyMemo.driftKey   = 0;
+	propertyMemo.driftHash  = 0;
+}
+
+
+RefreshWorker::~RefreshWorker ()
+{
+	Stop ();
+}
+
+
+void RefreshWorker::Stop ()
+{
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		stopRequested = true;
+		pending.reset ();
+		generation++;
+	}
+	wake.notify_all ();
+
+	if (worker.joinable ())
+		worker.join ();
+
+	std::lock_guard<std::mutex> lock (mutex);
+	stopRequested = false;
+	finished.reset ();
+	busy  = false;
+	stage = RefreshStage::Idle;
+}
+
+
+// ---------------------------------------------------------------------------
+// UI thread: queue, cancel, collect
+// ---------------------------------------------------------------------------
+
+std::uint64_t RefreshWorker::Submit (RefreshRequest&& request)
+{
+	std::uint64_t jobGeneration;
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		jobGeneration = ++generation;
+		pending.reset (new RefreshRequest (std::move (request)));
+		finished.reset ();
+		busy     = true;
+		progress = 0;
+
+		if (!worker.joinable ())
+			worker = std::thread (&RefreshWorker::Run, this);
+	}
+	wake.notify_all ();
+	return jobGeneration;
+}
+
+
+void RefreshWorker::Cancel ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	generation++;
+	pending.reset ();
+	finished.reset ();
+	busy  = false;
+	stage = RefreshStage::Idle;
+}
+
+
+bool RefreshWorker::TakeResult (RefreshResult& result)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	if (finished == nullptr)
+		return false;
+
+	result = std::move (*finished);
+	finished.reset ();
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Worker thread: run the latest queued job
+// ---------------------------------------------------------------------------
+
+void RefreshWorker::Run ()
+{
+	SetTraceThreadName ("refresh worker");
+	std::unique_lock<std::mutex> lock (mutex);
+	while (true) {
+		wake.wait (lock, [this] () { return stopRequested || pending != nullptr; });
+		if (stopRequested)
+			break;
+
+		std::unique_ptr<RefreshRequest> request (std::move (pending));
+		std::uint64_t jobGeneration = generation;
+
+		lock.unlock ();
+		Execute (*request, jobGeneration);
+		request.reset ();
+		lock.lock ();
+	}
+}
+
+
+void RefreshWorker::Execute (RefreshRequest& request, std::uint64_t jobGeneration)
+{
+	auto started = std::chrono::steady_clock::now ();
+	TraceScope trace ("refresh job", request.serverOnly ? "master only" : "full");
+	MemoryStage memory ("refresh job");
+
+	std::unique_ptr<RefreshResult> result (new RefreshResult ());
+	result->generation = jobGeneration;
+	result->serverOnly = request.serverOnly;
+	result->shardCache = std::move (request.shardCache);
+	result->catalogCache = std::move (request.catalogCache);
+
+	JobProgress jobProgress (*this, jobGeneration, result->notes);
+
+	// Project: read by the caller; only its fingerprint is computed here
+	result->projectHash    = HashClassifications (request.projectData);
+	result->projectChanged = result->projectHash != request.shownProjectHash;
+
+	// Master: from the sync service when one is connected (single XML only)
+	bool synced = false;
+	bool sharded = IsShardedMaster (request.masterPath.c_str ());
+	bool catalog = IsMasterCatalog (request.masterPath.c_str ());
+	if (request.syncClient != nullptr && request.syncClient->IsConnected () && !sharded && !catalog) {
+		jobProgress.SetStage (RefreshStage::ReadingMaster, 0, kReadShare);
+		TraceScope syncTrace ("sync master");
+		MemoryStage syncMemory ("sync master");
+
+		if (request.masterPath != masterMemo.path)
+			masterMemo.revision = 0;
+		SyncUpdate update = request.syncClient->Update (masterMemo.revision, masterMemo.data, masterMemo.version,
+														masterMemo.hash, &jobProgress);
+		masterMemo.path  = request.masterPath;
+		masterMemo.stamp = MasterStamp ();
+		if (update == SyncUpdate::Cancelled)
+			return;
+
+		synced = update != SyncUpdate::Failed;
+		if (synced) {
+			result->masterReread  = update != SyncUpdate::Unchanged;
+			result->fromService   = true;
+			result->serverVersion = masterMemo.version;
+		}
+	}
+
+	// Master: otherwise from the file, skipping the read while size and
+	// modification time are unchanged (a catalog checks each of its masters,
+	// a sharded master each shard, as a shard can change behind its manifest)
+	std::string content;		// bytes of a single XML read by this job
+	if (!synced) {
+		MasterStamp stamp = catalog || sharded ? MasterStamp () : ReadMasterStamp (request.masterPath);
+		if (stamp.valid && stamp == masterMemo.stamp && request.masterPath == masterMemo.path) {
+			result->serverVersion = masterMemo.version;
+		} else {
+			jobProgress.SetStage (RefreshStage::ReadingMaster, 0, kReadShare);
+			TraceScope readTrace ("read master");
+			MemoryStage readMemory ("read master");
+
+			std::vector<ClassificationTree> data;
+			MasterVersion                   version;
+			if (sharded)
+				data = ReadShardedClassifications (request.masterPath.c_str (), result->shardCache, &version, &jobProgress);
+			else if (catalog)
+				data = ReadCatalogClassifications (request.masterPath.c_str (), result->catalogCache, &version, &jobProgress);
+			else
+				data = ReadXmlClassifications (request.masterPath.c_str (), &version, &jobProgress, &content);
+			if (!jobProgress.IsCurrent ())
+				return;
+
+			// Catalogs and sharded masters are read on every job and count as
+			// re-read only when something in them changed
+			std::uint64_t hash = HashClassifications (data);
+			result->masterReread  = (!catalog && !sharded) || version != masterMemo.version || hash != masterMemo.hash ||
+									request.masterPath != masterMemo.path;
+			result->serverVersion = version;
+
+			// A touched file or a whitespace-only edit keeps the parsed model
+			if (hash != masterMemo.hash || request.masterPath != masterMemo.path)
+				masterMemo.data = std::move (data);
+			masterMemo.path     = request.masterPath;
+			masterMemo.stamp    = version.valid ? stamp : MasterStamp ();
+			masterMemo.version  = version;
+			masterMemo.hash     = hash;
+			masterMemo.revision = 0;
+		}
+	}
+
+	// Property definitions of the master: parsed again only with a new
+	// version, from the bytes just read when there are any
+	if (masterMemo.path != propertyMemo.path || masterMemo.version != propertyMemo.version) {
+		TraceScope propertiesTrace ("read master properties");
+		std::vector<PropertyDefinitionInfo> definitions;
+		if (!content.empty ())
+			ParseXmlPropertyDefinitions (content, definitions);
+		else if (masterMemo.version.valid)
+			ReadMasterPropertyDefinitions (request.masterPath.c_str (), definitions);
+
+		propertyMemo.path        = masterMemo.path;
+		propertyMemo.version     = masterMemo.version;
+		propertyMemo.masterHash  = HashPropertyDefinitions (definitions);
+		propertyMemo.definitions = std::move (definitions);
+	}
+	std::string ().swap (content);
+
+	result->serverHash    = masterMemo.hash;
+	result->serverChanged = masterMemo.hash != request.shownServerHash;
+	if (result->serverChanged)
+		result->serverData = masterMemo.data;
+
+	// Diff: only when either model differs from the shown or the memoized diff
+	bool shownDiffCurrent = !result->projectChanged && !result->serverChanged;
+	if (!shownDiffCurrent) {
+		if (diffMemo.projectHash != result->projectHash || diffMemo.serverHash != result->serverHash) {
+			jobProgress.SetStage (RefreshStage::Comparing, kReadShare, 1000);
+			MemoryStage compareMemory ("compare");
+			std::vector<DiffEntry> entries = CompareClassifications (request.projectData, masterMemo.data, &jobProgress);
+			if (!jobProgress.IsCurrent ())
+				return;
+
+			diffMemo.projectHash = result->projectHash;
+			diffMemo.serverHash  = result->serverHash;
+			diffMemo.entries     = std::move (entries);
+		}
+		result->diffChanged = true;
+		result->diffEntries = diffMemo.entries;
+	}
+
+	// Property applicability: recomputed only when a model or the definitions
+	// of either side changed
+	std::uint64_t driftKey = CombineHashes (CombineHashes (result->projectHash, result->serverHash),
+											CombineHashes (HashPropertyDefinitions (request.projectProperties),
+														   propertyMemo.masterHash));
+	if (driftKey != propertyMemo.driftKey) {
+		MemoryStage propertiesMemory ("compare properties");
+		propertyMemo.drift     = ComparePropertyApplicability (request.projectData, request.projectProperties,
+															   masterMemo.data, propertyMemo.definitions);
+
+		// Enumeration values that only one side has; the table is kept per
+		// project until either side's values change
+		bool rebuilt = false;
+		std::shared_ptr<const EnumRemapTable> enums = enumCache.Get (request.projectProperties, propertyMemo.definitions, &rebuilt);
+		propertyMemo.drift.insert (propertyMemo.drift.end (), enums->GetUnmatched ().begin (), enums->GetUnmatched ().end ());
+		if (rebuilt)
+			ReportWork (&jobProgress, LogLevel::Debug, "ClassSync: Enumeration values: %d matched, %d on one side only",
+						(int)enums->GetMatchedCount (), (int)enums->GetUnmatched ().size ());
+		propertyMemo.driftHash = HashPropertyDrift (propertyMemo.drift);
+		propertyMemo.driftKey  = driftKey;
+	}
+	result->propertyHash      = propertyMemo.driftHash;
+	result->propertiesChanged = propertyMemo.driftHash != request.shownPropertyHash;
+	if (result->propertiesChanged)
+		result->propertyDrift = propertyMemo.drift;
+
+	if (result->projectChanged)
+		result->projectData = std::move (request.projectData);
+	result->seconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - started).count ();
+	memory.End ();
+
+	// Publish unless superseded in the meantime
+	std::lock_guard<std::mutex> lock (mutex);
+	if (generation != jobGeneration)
+		return;
+
+	finished = std::move (result);
+	busy     = false;
+	stage    = RefreshStage::Idle;
+	progress = 1000;
+}
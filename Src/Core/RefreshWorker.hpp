@@ -0,0 +1,178 @@
+#ifndef REFRESHWORKER_HPP
+#define REFRESHWORKER_HPP
+
+#include "ClassificationModel.hpp"
+#include "EnumRemap.hpp"
+#include "MasterCatalog.hpp"
+#include "MasterVersion.hpp"
+#include "PropertyApplicability.hpp"
+#include "ShardedMaster.hpp"
+#include "SyncClient.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// Background refresh: read + parse the master and diff it against the
+// project on a worker thread
+//
+// The project is read through ACAPI, so the caller reads it on the UI thread
+// and passes a copy. Every Submit supersedes the job before it: the running
+// job stops at its next progress step and its result is never delivered.
+// Results are picked up on the UI thread with TakeResult (from PanelIdle).
+//
+// Stages are memoized on fingerprints of their inputs: the master is not
+// re-read while its size and modification time are unchanged (per listed
+// master for a catalog), its property definitions are re-parsed only with a
+// new master version, and the diffs (items, property applicability and
+// enumeration values) are reused while their input hashes are. A stage whose output equals what
+// the palette already shows returns nothing (the *Changed flags are false).
+// With a connected sync service the master comes from it instead (deltas
+// since the memoized revision); the file is read when the service fails.
+// ---------------------------------------------------------------------------
+
+enum class RefreshStage {
+	Idle,
+	ReadingMaster,
+	Comparing
+};
+
+struct RefreshRequest {
+	std::string                     masterPath;		// UTF-8, single XML, shard manifest or catalog
+	std::vector<ClassificationTree>  projectData;
+	ShardedMasterCache              shardCache;		// copy; the updated cache comes back
+	MasterCatalogCache              catalogCache;		// likewise
+	bool                            serverOnly;		// projectData is the displayed project
+	std::shared_ptr<SyncClient>     syncClient;		// null or disconnected: read the file
+	std::vector<PropertyDefinitionInfo>  projectProperties;	// read by the caller with projectData
+
+	// Fingerprints of what the palette shows (0 = nothing / unknown)
+	std::uint64_t                   shownProjectHash;
+	std::uint64_t                   shownServerHash;
+	std::uint64_t                   shownPropertyHash;
+
+	RefreshRequest () : serverOnly (false), shownProjectHash (0), shownServerHash (0), shownPropertyHash (0) {}
+};
+
+struct RefreshResult {
+	std::uint64_t                   generation;
+	bool                            serverOnly;
+
+	bool                            projectChanged;	// projectData filled
+	std::uint64_t                   projectHash;
+	std::vector<ClassificationTree>  projectData;
+
+	bool                            serverChanged;		// serverData filled
+	bool                            masterReread;		// false: size and time unchanged, not read
+	bool                            fromService;		// master came from the sync service
+	std::uint64_t                   serverHash;
+	std::vector<ClassificationTree>  serverData;
+	MasterVersion                   serverVersion;
+	ShardedMasterCache              shardCache;
+	MasterCatalogCache              catalogCache;
+
+	bool                            diffChanged;		// diffEntries filled
+	std::vector<DiffEntry>           diffEntries;
+
+	bool                            propertiesChanged;	// propertyDrift filled
+	std::uint64_t                   propertyHash;
+	std::vector<PropertyDrift>       propertyDrift;
+
+	std::vector<std::string>        notes;			// report lines, written on the UI thread
+	double                          seconds;
+
+	RefreshResult () :
+		generation (0), serverOnly (false),
+		projectChanged (false), projectHash (0),
+		serverChanged (false), masterReread (false), fromService (false), serverHash (0),
+		diffChanged (false), propertiesChanged (false), propertyHash (0), seconds (0.0) {}
+};
+
+
+class RefreshWorker {
+public:
+	RefreshWorker ();
+	~RefreshWorker ();
+
+	// Queue a refresh, superseding any queued or running one. Returns its generation.
+	std::uint64_t  Submit (RefreshRequest&& request);
+
+	// Drop the queued or running job (e.g. the data it would replace changed).
+	void  Cancel ();
+
+	// Take the finished result of the latest job, if any (UI thread).
+	bool  TakeResult (RefreshResult& result);
+
+	bool          IsBusy () const       { return busy; }
+	RefreshStage  GetStage () const     { return stage; }
+
+	// Progress of the running job in per mille (reading 0-800, comparing 800-1000)
+	unsigned      GetProgress () const  { return progress; }
+
+	// Stop the thread (the running job is cancelled).
+	void  Stop ();
+
+private:
+	RefreshWorker (const RefreshWorker&) = delete;
+	RefreshWorker& operator= (const RefreshWorker&) = delete;
+
+	class JobProgress;
+
+	void  Run ();
+	void  Execute (RefreshRequest& request, std::uint64_t jobGeneration);
+
+	// Last master read and last diff (worker thread only)
+	struct MasterMemo {
+		std::string                     path;
+		MasterStamp                     stamp;
+		MasterVersion                   version;
+		std::uint64_t                   revision;		// sync service revision (0 = read from the file)
+		std::uint64_t                   hash;
+		std::vector<ClassificationTree>  data;
+	};
+
+	struct DiffMemo {
+		std::uint64_t                   projectHash;
+		std::uint64_t                   serverHash;
+		std::vector<DiffEntry>           entries;
+	};
+
+	// Master property definitions (follow the master version) and their drift
+	struct PropertyMemo {
+		std::string                     path;
+		MasterVersion                   version;
+		std::uint64_t                   masterHash;		// of definitions
+		std::vector<PropertyDefinitionInfo>  definitions;
+		std::uint64_t                   driftKey;		// of all drift inputs
+		std::uint64_t                   driftHash;
+		std::vector<PropertyDrift>       drift;
+	};
+
+	MasterMemo                       masterMemo;
+	DiffMemo                         diffMemo;
+	PropertyMemo                     propertyMemo;
+	EnumRemapCache                   enumCache;			// enumeration values matched per project
+
+	std::thread                      worker;
+	std::mutex                       mutex;
+	std::condition_variable          wake;
+	bool                             stopRequested;
+
+	std::unique_ptr<RefreshRequest>  pending;			// queued job (latest only)
+	std::unique_ptr<RefreshResult>   finished;			// result waiting for TakeResult
+
+	std::atomic<std::uint64_t>       generation;		// bumped by Submit and Cancel
+	std::atomic<bool>                busy;
+	std::atomic<RefreshStage>        stage;
+	std::atomic<unsigned>            progress;
+};
+
+
+#endif // REFRESHWORKER_HPP
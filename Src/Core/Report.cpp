@@ -0,0 +1,48 @@
+#include "Report.hpp"
+#include "Log.hpp"
+
+#include <cstdarg>
+#include <cstdio>
+
+
+static ReportSink reportSink = nullptr;
+
+
+// ---------------------------------------------------------------------------
+// Sink selection
+// ---------------------------------------------------------------------------
+
+void SetReportSink (ReportSink sink)
+{
+	reportSink = sink;
+}
+
+
+// ---------------------------------------------------------------------------
+// Format one line and forward it
+// ---------------------------------------------------------------------------
+
+void Report (const char* format, ...)
+{
+	if (!IsLogged (LogLevel::Info))
+		return;
+
+	char line[1024];
+
+	va_list args;
+	va_start (args, format);
+	vsnprintf (line, sizeof (line), format, args);
+	va_end (args);
+
+	if (RecordLogLine (LogLevel::Info, line))
+		WriteReportLine (line);
+}
+
+
+void WriteReportLine (const std::string& line)
+{
+	if (reportSink != nullptr)
+		reportSink (line);
+	else
+		fprintf (stderr, "%s\n", line.c_str ());
+}
@@ -0,0 +1,28 @@
+#ifndef REPORT_HPP
+#define REPORT_HPP
+
+#include <string>
+
+
+// ---------------------------------------------------------------------------
+// Session report for the core library
+//
+// Core code never calls ACAPI. Lines go to the sink installed by the host:
+// the add-on forwards them to ACAPI_WriteReport, tools and tests print them
+// or drop them. Without a sink, lines go to stderr. Report is an Info line
+// of the session log (Log.hpp), which decides what reaches the sink.
+// ---------------------------------------------------------------------------
+
+typedef void (*ReportSink) (const std::string& line);
+
+// Install the sink (nullptr = stderr). Not thread-safe; set it at startup.
+void  SetReportSink (ReportSink sink);
+
+// Format an Info line and log it (UI thread; workers use ReportWork).
+void  Report (const char* format, ...);
+
+// Hand a line to the sink as-is (the log's echo).
+void  WriteReportLine (const std::string& line);
+
+
+#endif // REPORT_HPP
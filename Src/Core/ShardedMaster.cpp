@@ -0,0 +1,935 @@
+#include "ShardedMaster.hpp"
+#include "XmlReader.hpp"
+#include "FileLock.hpp"
+#include "FileSystem.hpp"
+#include "ItemIndex.hpp"
+#include "Log.hpp"
+#include "Trace.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <set>
+#include <sstream>
+
+
+static const char* kManifestHeader   = "ClassSync shard manifest 1";
+static const char* kManifestFileName = "master.manifest";
+static const char* kManifestExt      = ".manifest";
+
+// Indentation of a top-level <Item> inside <BuildingInformation>/<Classification>/<System>/<Items>
+static const char* kBranchIndent     = "\t\t\t\t";
+
+// Manifest updates after a shard commit, each waiting out the commit guard
+static const int   kManifestUpdateAttempts = 3;
+
+
+// ---------------------------------------------------------------------------
+// Helper: XML slicing (same conventions as XmlReader/XmlWriter)
+// ---------------------------------------------------------------------------
+
+static std::string DetectEol (const std::string& xml)
+{
+	auto pos = xml.find ('\n');
+	if (pos != std::string::npos && pos > 0 && xml[pos - 1] == '\r')
+		return "\r\n";
+	return "\n";
+}
+
+
+static size_t FindLineStart (const std::string& xml, size_t pos)
+{
+	while (pos > 0 && xml[pos - 1] != '\n')
+		pos--;
+	return pos;
+}
+
+
+static size_t FindNextLineStart (const std::string& xml, size_t pos)
+{
+	auto nl = xml.find ('\n', pos);
+	return (nl == std::string::npos) ? xml.size () : nl + 1;
+}
+
+
+static size_t FindMatchingClose (const std::string& xml,
+								 const std::string& openTag,
+								 const std::string& closeTag,
+								 size_t openPos)
+{
+	int depth = 1;
+	size_t pos = openPos + openTag.size ();
+
+	while (depth > 0 && pos < xml.size ()) {
+		auto nextOpen  = xml.find (openTag, pos);
+		auto nextClose = xml.find (closeTag, pos);
+
+		if (nextClose == std::string::npos)
+			return std::string::npos;
+
+		if (nextOpen != std::string::npos && nextOpen < nextClose) {
+			depth++;
+			pos = nextOpen + openTag.size ();
+		} else {
+			depth--;
+			if (depth == 0)
+				return nextClose;
+			pos = nextClose + closeTag.size ();
+		}
+	}
+	return std::string::npos;
+}
+
+
+static std::string ExtractFirstId (const std::string& itemXml)
+{
+	auto idOpen  = itemXml.find ("<ID>");
+	auto idClose = itemXml.find ("</ID>");
+	if (idOpen == std::string::npos || idClose == std::string::npos || idClose < idOpen)
+		return "";
+	return itemXml.substr (idOpen + 4, idClose - idOpen - 4);
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: shard file name from an item ID ("BL.PK" -> "BL.PK.xml")
+// ---------------------------------------------------------------------------
+
+static std::string MakeShardFileName (const std::string& id, const ShardManifest& manifest)
+{
+	std::string base;
+	for (char c : id) {
+		bool ok = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+				  (c >= '0' && c <= '9') || c == '.' || c == '_' || c == '-';
+		base += ok ? c : '_';
+	}
+	if (base.empty ())
+		base = "branch";
+
+	std::string name = base + ".xml";
+	for (int n = 2; ; n++) {
+		bool taken = false;
+		for (const ShardEntry& e : manifest.shards) {
+			if (e.file == name) {
+				taken = true;
+				break;
+			}
+		}
+		if (!taken)
+			return name;
+		name = base + "-" + std::to_string (n) + ".xml";
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+// Manifest read / write
+// ---------------------------------------------------------------------------
+
+static const char* ShardKindName (ShardKind kind)
+{
+	switch (kind) {
+		case ShardKind::SystemHeader: return "system";
+		case ShardKind::ItemBranch:   return "items";
+		case ShardKind::Properties:   return "properties";
+	}
+	return "items";
+}
+
+
+static bool ParseManifest (const std::string& content, ShardManifest& manifest)
+{
+	manifest.eol = "\n";
+	manifest.shards.clear ();
+
+	std::istringstream in (content);
+	std::string line;
+	bool headerSeen = false;
+
+	while (std::getline (in, line)) {
+		if (!line.empty () && line.back () == '\r')
+			line.pop_back ();
+		if (line.empty ())
+			continue;
+
+		if (!headerSeen) {
+			if (line != kManifestHeader)
+				return false;
+			headerSeen = true;
+			continue;
+		}
+
+		if (line.compare (0, 4, "eol=") == 0) {
+			manifest.eol = (line.substr (4) == "crlf") ? "\r\n" : "\n";
+			continue;
+		}
+
+		if (line.compare (0, 6, "shard=") != 0)
+			continue;
+
+		// shard=<kind>\t<system>\t<key>\t<file>\t<hash>\t<size>
+		std::vector<std::string> fields;
+		size_t start = 6;
+		while (true) {
+			auto tab = line.find ('\t', start);
+			fields.push_back (line.substr (start, tab == std::string::npos ? std::string::npos : tab - start));
+			if (tab == std::string::npos)
+				break;
+			start = tab + 1;
+		}
+		if (fields.size () != 6)
+			return false;
+
+		ShardEntry entry;
+		if (fields[0] == "system")
+			entry.kind = ShardKind::SystemHeader;
+		else if (fields[0] == "properties")
+			entry.kind = ShardKind::Properties;
+		else
+			entry.kind = ShardKind::ItemBranch;
+
+		entry.systemIndex   = (unsigned)std::strtoul (fields[1].c_str (), nullptr, 10);
+		entry.key           = fields[2];
+		entry.file          = fields[3];
+		entry.version.hash  = std::strtoull (fields[4].c_str (), nullptr, 16);
+		entry.version.size  = std::strtoull (fields[5].c_str (), nullptr, 10);
+		entry.version.valid = true;
+		manifest.shards.push_back (entry);
+	}
+
+	return headerSeen;
+}
+
+
+static std::string FormatManifest (const ShardManifest& manifest)
+{
+	std::string out;
+	out += kManifestHeader;
+	out += "\n";
+	out += (manifest.eol == "\r\n") ? "eol=crlf\n" : "eol=lf\n";
+
+	for (const ShardEntry& e : manifest.shards) {
+		char hash[24];
+		snprintf (hash, sizeof (hash), "%016llx", (unsigned long long)e.version.hash);
+		out += "shard=";
+		out += ShardKindName (e.kind);
+		out += "\t" + std::to_string (e.systemIndex);
+		out += "\t" + e.key;
+		out += "\t" + e.file;
+		out += "\t";
+		out += hash;
+		out += "\t" + std::to_string ((unsigned long long)e.version.size);
+		out += "\n";
+	}
+	return out;
+}
+
+
+static bool LoadManifest (const std::string& manifestPath, ShardManifest& manifest, std::string* raw = nullptr)
+{
+	std::string content;
+	if (!ReadMasterFile (manifestPath, content))
+		return false;
+	if (raw != nullptr)
+		*raw = content;
+	return ParseManifest (content, manifest);
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: write one shard and record it in the manifest
+// ---------------------------------------------------------------------------
+
+static bool WriteShard (const std::string& dir, ShardManifest& manifest,
+						ShardKind kind, unsigned systemIndex,
+						const std::string& key, const std::string& file,
+						const std::string& content)
+{
+	if (!WriteMasterFileAtomic (JoinPath (dir, file), content))
+		return false;
+
+	ShardEntry entry;
+	entry.kind        = kind;
+	entry.systemIndex = systemIndex;
+	entry.key         = key;
+	entry.file        = file;
+	entry.version     = ComputeMasterVersion (content);
+	manifest.shards.push_back (entry);
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Is the path a shard manifest?
+// ---------------------------------------------------------------------------
+
+bool IsShardedMaster (const char* path)
+{
+	std::string p (path);
+	std::string ext (kManifestExt);
+	return p.size () > ext.size () && p.compare (p.size () - ext.size (), ext.size (), ext) == 0;
+}
+
+
+// ---------------------------------------------------------------------------
+// Shard files listed in a manifest
+// ---------------------------------------------------------------------------
+
+bool ReadShardFileNames (const char* manifestPath, std::vector<std::string>& fileNames)
+{
+	ShardManifest manifest;
+	if (!LoadManifest (manifestPath, manifest))
+		return false;
+
+	fileNames.clear ();
+	for (const ShardEntry& e : manifest.shards)
+		fileNames.push_back (e.file);
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Split a single-file master into shards
+// ---------------------------------------------------------------------------
+
+bool SplitMasterIntoShards (const char* xmlPath, std::string& manifestPath, std::string& error)
+{
+	std::string content;
+	if (!ReadMasterFile (xmlPath, content)) {
+		error = "Cannot read XML file";
+		return false;
+	}
+
+	std::string xmlPathStr (xmlPath);
+	std::string dir = xmlPathStr;
+	auto dot = dir.find_last_of ('.');
+	auto slash = dir.find_last_of ("/\\");
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+		dir = dir.substr (0, dot);
+	dir += ".shards";
+	MakeDirectory (dir);
+
+	ShardManifest manifest;
+	manifest.eol = DetectEol (content);
+
+	auto classOpen  = content.find ("<Classification>");
+	auto classClose = content.find ("</Classification>");
+	if (classOpen == std::string::npos || classClose == std::string::npos) {
+		error = "No <Classification> section";
+		return false;
+	}
+
+	// One header shard per <System>, one shard per top-level <Item>
+	unsigned systemIndex = 0;
+	size_t pos = classOpen;
+	while (true) {
+		auto sysOpen = content.find ("<System>", pos);
+		if (sysOpen == std::string::npos || sysOpen > classClose)
+			break;
+		auto sysClose = content.find ("</System>", sysOpen);
+		if (sysClose == std::string::npos) {
+			error = "Unterminated <System>";
+			return false;
+		}
+
+		auto itemsOpen = content.find ("<Items>", sysOpen);
+		auto itemsEmpty = content.find ("<Items/>", sysOpen);
+		size_t itemsTag = (itemsOpen != std::string::npos && itemsOpen < sysClose) ? itemsOpen :
+						  (itemsEmpty != std::string::npos && itemsEmpty < sysClose) ? itemsEmpty :
+						  FindLineStart (content, sysClose);
+
+		size_t headerStart = FindNextLineStart (content, sysOpen);
+		size_t headerEnd   = FindLineStart (content, itemsTag);
+		std::string headerFile = "system-" + std::to_string (systemIndex) + ".xml";
+		if (!WriteShard (dir, manifest, ShardKind::SystemHeader, systemIndex, "", headerFile,
+						 content.substr (headerStart, headerEnd - headerStart)))
+		{
+			error = "Cannot write " + headerFile;
+			return false;
+		}
+
+		if (itemsOpen != std::string::npos && itemsOpen < sysClose) {
+			auto itemsClose = content.rfind ("</Items>", sysClose);
+			size_t p = itemsOpen + 7;  // strlen("<Items>")
+			while (true) {
+				auto itemOpen = content.find ("<Item>", p);
+				if (itemOpen == std::string::npos || itemOpen > itemsClose)
+					break;
+				auto itemClose = FindMatchingClose (content, "<Item>", "</Item>", itemOpen);
+				if (itemClose == std::string::npos) {
+					error = "Unterminated <Item>";
+					return false;
+				}
+
+				size_t sliceStart = FindLineStart (content, itemOpen);
+				size_t sliceEnd   = FindNextLineStart (content, itemClose);
+				std::string branch = content.substr (sliceStart, sliceEnd - sliceStart);
+				std::string id = ExtractFirstId (branch);
+				std::string file = MakeShardFileName (id, manifest);
+
+				if (!WriteShard (dir, manifest, ShardKind::ItemBranch, systemIndex, id, file, branch)) {
+					error = "Cannot write " + file;
+					return false;
+				}
+				p = itemClose + 7;  // strlen("</Item>")
+			}
+		}
+
+		systemIndex++;
+		pos = sysClose + 9;  // strlen("</System>")
+	}
+
+	// Everything between </Classification> and </BuildingInformation>
+	auto rootClose = content.rfind ("</BuildingInformation>");
+	if (rootClose == std::string::npos || rootClose < classClose) {
+		error = "No </BuildingInformation>";
+		return false;
+	}
+	size_t propStart = FindNextLineStart (content, classClose);
+	size_t propEnd   = FindLineStart (content, rootClose);
+	if (!WriteShard (dir, manifest, ShardKind::Properties, 0, "", "properties.xml",
+					 content.substr (propStart, propEnd > propStart ? propEnd - propStart : 0)))
+	{
+		error = "Cannot write properties.xml";
+		return false;
+	}
+
+	manifestPath = JoinPath (dir, kManifestFileName);
+	if (!WriteMasterFileAtomic (manifestPath, FormatManifest (manifest))) {
+		error = "Cannot write manifest";
+		return false;
+	}
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: assemble a standard document from the manifest and shard texts
+// ---------------------------------------------------------------------------
+
+static std::string AssembleDocument (const ShardManifest& manifest,
+									 const std::map<std::string, std::string>& texts)
+{
+	const std::string& eol = manifest.eol;
+
+	unsigned systemCount = 0;
+	for (const ShardEntry& e : manifest.shards) {
+		if (e.kind == ShardKind::SystemHeader && e.systemIndex + 1 > systemCount)
+			systemCount = e.systemIndex + 1;
+	}
+
+	auto textOf = [&] (const ShardEntry& e) -> const std::string& {
+		static const std::string empty;
+		auto it = texts.find (e.file);
+		return it != texts.end () ? it->second : empty;
+	};
+
+	std::string xml;
+	xml += "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\" ?>" + eol;
+	xml += "<BuildingInformation>" + eol;
+	xml += "\t<Classification>" + eol;
+
+	for (unsigned s = 0; s < systemCount; s++) {
+		xml += "\t\t<System>" + eol;
+		for (const ShardEntry& e : manifest.shards) {
+			if (e.kind == ShardKind::SystemHeader && e.systemIndex == s)
+				xml += textOf (e);
+		}
+		xml += "\t\t\t<Items>" + eol;
+		for (const ShardEntry& e : manifest.shards) {
+			if (e.kind == ShardKind::ItemBranch && e.systemIndex == s)
+				xml += textOf (e);
+		}
+		xml += "\t\t\t</Items>" + eol;
+		xml += "\t\t</System>" + eol;
+	}
+
+	xml += "\t</Classification>" + eol;
+	for (const ShardEntry& e : manifest.shards) {
+		if (e.kind == ShardKind::Properties)
+			xml += textOf (e);
+	}
+	xml += "</BuildingInformation>" + eol;
+	return xml;
+}
+
+
+// ---------------------------------------------------------------------------
+// Assemble shards into one standard classification XML
+// ---------------------------------------------------------------------------
+
+bool AssembleShardedXml (const char* manifestPath, std::string& xml)
+{
+	ShardManifest manifest;
+	if (!LoadManifest (manifestPath, manifest))
+		return false;
+
+	std::string dir = GetDirectory (manifestPath);
+	std::map<std::string, std::string> texts;
+	for (const ShardEntry& e : manifest.shards) {
+		std::string text;
+		if (!ReadMasterFile (JoinPath (dir, e.file), text))
+			return false;
+		texts[e.file] = text;
+	}
+
+	xml = AssembleDocument (manifest, texts);
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: load + parse one shard (runs on a worker thread - no reporting)
+// ---------------------------------------------------------------------------
+
+static bool LoadShard (const std::string& path, ShardKind kind, ShardedMasterCache::Shard& shard)
+{
+	TraceScope trace ("load shard", path.substr (path.find_last_of ("/\\") + 1));
+
+	// Stamped before reading: a write in between only causes another read
+	shard.stamp = ReadMasterStamp (path);
+	std::string content;
+	if (!ReadMasterFile (path, content))
+		return false;
+
+	shard.version = ComputeMasterVersion (content);
+
+	if (kind == ShardKind::SystemHeader)
+		ParseXmlSystemHeader (content, shard.header);
+	else if (kind == ShardKind::ItemBranch)
+		ParseXmlItems (content, shard.items);
+
+	return true;
+}
+
+
+static void IndexItems (const std::vector<ClassificationNode>& nodes,
+						const std::string& file,
+						std::map<std::string, std::string>& itemToShard)
+{
+	for (const ClassificationNode& node : nodes) {
+		itemToShard[node.id] = file;
+		IndexItems (node.children, file, itemToShard);
+	}
+}
+
+
+// ---------------------------------------------------------------------------
+// Read a sharded master, re-reading only shards whose hash changed
+// ---------------------------------------------------------------------------
+
+std::vector<ClassificationTree> ReadShardedClassifications (const char* manifestPath,
+															ShardedMasterCache& cache,
+															MasterVersion* version,
+															WorkProgress* progress)
+{
+	TraceScope trace ("ReadShardedClassifications");
+	std::vector<ClassificationTree> result;
+
+	ShardManifest manifest;
+	std::string raw;
+	if (!LoadManifest (manifestPath, manifest, &raw)) {
+		ReportWork (progress, LogLevel::Warning, "ClassSync: Cannot read shard manifest: %s", manifestPath);
+		return result;
+	}
+
+	if (version != nullptr)
+		*version = ComputeMasterVersion (raw);
+
+	if (cache.manifestPath != manifestPath) {
+		cache.shards.clear ();
+		cache.manifestPath = manifestPath;
+	}
+
+	std::string dir = GetDirectory (manifestPath);
+
+	// Start a worker for every shard that is new or changed
+	std::vector<std::pair<std::string, std::future<std::pair<bool, ShardedMasterCache::Shard>>>> loads;
+	for (const ShardEntry& e : manifest.shards) {
+		// Property definitions are only needed for import - read them there
+		if (e.kind == ShardKind::Properties)
+			continue;
+
+		// The stamp catches a shard written whose manifest entry is stale
+		std::string path = JoinPath (dir, e.file);
+		auto cached = cache.shards.find (e.file);
+		if (cached != cache.shards.end () && cached->second.version == e.version &&
+			cached->second.stamp == ReadMasterStamp (path))
+		{
+			continue;
+		}
+
+		ShardKind kind = e.kind;
+		loads.emplace_back (e.file, std::async (std::launch::async, [path, kind] () {
+			ShardedMasterCache::Shard shard;
+			bool ok = LoadShard (path, kind, shard);
+			return std::make_pair (ok, shard);
+		}));
+	}
+
+	// Collect every load before a cancelled read returns (the futures block)
+	std::vector<std::pair<std::string, ShardedMasterCache::Shard>> loaded;
+	unsigned failed    = 0;
+	bool     cancelled = false;
+	for (size_t i = 0; i < loads.size (); i++) {
+		auto shard = loads[i].second.get ();
+		if (shard.first)
+			loaded.emplace_back (loads[i].first, std::move (shard.second));
+		else
+			failed++;
+		if (progress != nullptr && !cancelled && !progress->Step (i + 1, loads.size ()))
+			cancelled = true;
+	}
+	if (cancelled)
+		return result;
+
+	for (auto& shard : loaded)
+		cache.shards[shard.first] = std::move (shard.second);
+
+	// Drop shards that are no longer listed
+	std::map<std::string, ShardedMasterCache::Shard> kept;
+	for (const ShardEntry& e : manifest.shards) {
+		auto it = cache.shards.find (e.file);
+		if (it != cache.shards.end ())
+			kept[e.file] = it->second;
+	}
+	cache.shards.swap (kept);
+
+	ReportWork (progress, LogLevel::Debug, "ClassSync: Shards: %d listed, %d re-read, %d failed",
+				(int)manifest.shards.size (), (int)loads.size (), (int)failed);
+
+	// Assemble trees in manifest order
+	TraceScope assembleTrace ("assemble shards");
+	cache.itemToShard.clear ();
+	unsigned systemCount = 0;
+	for (const ShardEntry& e : manifest.shards) {
+		if (e.kind == ShardKind::SystemHeader && e.systemIndex + 1 > systemCount)
+			systemCount = e.systemIndex + 1;
+	}
+
+	for (unsigned s = 0; s < systemCount; s++) {
+		ClassificationTree tree;
+
+		for (const ShardEntry& e : manifest.shards) {
+			if (e.systemIndex != s)
+				continue;
+			auto it = cache.shards.find (e.file);
+			if (it == cache.shards.end ())
+				continue;
+
+			if (e.kind == ShardKind::SystemHeader) {
+				tree.systemName = it->second.header.systemName;
+				tree.version    = it->second.header.version;
+			} else if (e.kind == ShardKind::ItemBranch) {
+				tree.rootItems.insert (tree.rootItems.end (), it->second.items.begin (), it->second.items.end ());
+				IndexItems (it->second.items, e.file, cache.itemToShard);
+			}
+		}
+
+		result.push_back (std::move (tree));
+	}
+
+	return result;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: refresh the manifest entries of shards after a commit. The shards
+// are re-hashed under the manifest guard, so concurrent writers of the same
+// shard always leave the manifest pointing at the latest content. The
+// manifest is only rewritten when an entry changed.
+// ---------------------------------------------------------------------------
+
+static bool TryUpdateManifestEntries (const std::string& manifestPath, const std::set<std::string>& files)
+{
+	CommitGuard guard (manifestPath.c_str ());
+	if (!guard.IsAcquired ())
+		return false;
+
+	ShardManifest manifest;
+	if (!LoadManifest (manifestPath, manifest))
+		return false;
+
+	std::string dir = GetDirectory (manifestPath);
+	bool changed = false;
+	for (const std::string& file : files) {
+		std::string text;
+		if (!ReadMasterFile (JoinPath (dir, file), text))
+			return false;
+
+		MasterVersion version = ComputeMasterVersion (text);
+		for (ShardEntry& e : manifest.shards) {
+			if (e.file == file && e.version != version) {
+				e.version = version;
+				changed   = true;
+			}
+		}
+	}
+
+	return !changed || WriteMasterFileAtomic (manifestPath, FormatManifest (manifest));
+}
+
+
+static bool UpdateManifestEntries (const std::string& manifestPath, const std::set<std::string>& files)
+{
+	for (int attempt = 0; attempt < kManifestUpdateAttempts; attempt++) {
+		if (TryUpdateManifestEntries (manifestPath, files))
+			return true;
+	}
+	return false;
+}
+
+
+// Shards to re-hash after a commit: also those already holding the edit,
+// so retrying an edit whose manifest update failed repairs the entry
+static bool IsShardWritten (CommitResult result)
+{
+	return IsCommitSuccess (result) || result == CommitResult::AlreadyApplied;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: look up the shard owning an item in the last-read cache
+// ---------------------------------------------------------------------------
+
+static bool FindOwningShard (const ShardedMasterCache& cache, const std::string& itemId,
+							 std::string& file, MasterVersion& baseVersion)
+{
+	auto owner = cache.itemToShard.find (itemId);
+	if (owner == cache.itemToShard.end ())
+		return false;
+
+	auto shard = cache.shards.find (owner->second);
+	if (shard == cache.shards.end ())
+		return false;
+
+	file        = owner->second;
+	baseVersion = shard->second.version;
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Rename an item inside its shard
+// ---------------------------------------------------------------------------
+
+CommitResult ChangeItemNameInShards (const char* manifestPath,
+									 const ShardedMasterCache& cache,
+									 const std::string& itemId,
+									 const std::string& baseName,
+									 const std::string& newName)
+{
+	std::string file;
+	MasterVersion baseVersion;
+	if (!FindOwningShard (cache, itemId, file, baseVersion))
+		return CommitResult::Failed;
+
+	std::string shardPath = JoinPath (GetDirectory (manifestPath), file);
+	CommitResult result = ChangeItemNameInXml (shardPath.c_str (), baseVersion, itemId, baseName, newName, false);
+
+	if (IsShardWritten (result) && !UpdateManifestEntries (manifestPath, { file })) {
+		CS_LOG_WARNING ("ClassSync: Shard %s written but manifest not updated", file.c_str ());
+		return CommitResult::Busy;
+	}
+
+	return result;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: add a new top-level branch as its own shard. file and version
+// receive the branch shard (also when it already existed with this name).
+// ---------------------------------------------------------------------------
+
+static CommitResult AddBranchShard (const std::string& manifestPath, const ClassificationNode& node,
+									std::string* branchFile = nullptr, MasterVersion* branchVersion = nullptr)
+{
+	CommitGuard guard (manifestPath.c_str ());
+	if (!guard.IsAcquired ())
+		return CommitResult::Busy;
+
+	ShardManifest manifest;
+	if (!LoadManifest (manifestPath, manifest))
+		return CommitResult::Failed;
+
+	std::string dir = GetDirectory (manifestPath);
+	std::string id  = node.id;
+
+	// Same branch added concurrently?
+	for (const ShardEntry& e : manifest.shards) {
+		if (e.kind != ShardKind::ItemBranch || e.key != id)
+			continue;
+
+		ShardedMasterCache::Shard existing;
+		if (LoadShard (JoinPath (dir, e.file), e.kind, existing) &&
+			!existing.items.empty () && existing.items[0].name == node.name)
+		{
+			if (branchFile != nullptr)
+				*branchFile = e.file;
+			if (branchVersion != nullptr)
+				*branchVersion = existing.version;
+			return CommitResult::AlreadyApplied;
+		}
+		return CommitResult::Conflict;
+	}
+
+	std::string file = MakeShardFileName (id, manifest);
+	std::string text = FormatItemXml (node, kBranchIndent, manifest.eol);
+	if (!WriteMasterFileAtomic (JoinPath (dir, file), text))
+		return CommitResult::Failed;
+
+	// Keep branches of the first system sorted by ID, like AddItemToXml
+	ShardEntry entry;
+	entry.kind        = ShardKind::ItemBranch;
+	entry.systemIndex = 0;
+	entry.key         = id;
+	entry.file        = file;
+	entry.version     = ComputeMasterVersion (text);
+
+	size_t insertAt = manifest.shards.size ();
+	size_t lastBranch = manifest.shards.size ();
+	for (size_t i = 0; i < manifest.shards.size (); i++) {
+		const ShardEntry& e = manifest.shards[i];
+		if (e.kind != ShardKind::ItemBranch || e.systemIndex != 0)
+			continue;
+		lastBranch = i;
+		if (CompareItemIds (e.key, id) > 0 && insertAt == manifest.shards.size ())
+			insertAt = i;
+	}
+	if (insertAt == manifest.shards.size () && lastBranch != manifest.shards.size ())
+		insertAt = lastBranch + 1;
+	manifest.shards.insert (manifest.shards.begin () + insertAt, entry);
+
+	if (!WriteMasterFileAtomic (manifestPath, FormatManifest (manifest)))
+		return CommitResult::Failed;
+
+	if (branchFile != nullptr)
+		*branchFile = file;
+	if (branchVersion != nullptr)
+		*branchVersion = entry.version;
+	return CommitResult::Committed;
+}
+
+
+// ---------------------------------------------------------------------------
+// Add an item to the shard of its parent (or as a new branch shard)
+// ---------------------------------------------------------------------------
+
+CommitResult AddItemToShards (const char* manifestPath,
+							  const ShardedMasterCache& cache,
+							  const std::string& parentId,
+							  const ClassificationNode& node)
+{
+	if (parentId.empty ())
+		return AddBranchShard (manifestPath, node);
+
+	std::string file;
+	MasterVersion baseVersion;
+	if (!FindOwningShard (cache, parentId, file, baseVersion))
+		return CommitResult::Failed;
+
+	std::string shardPath = JoinPath (GetDirectory (manifestPath), file);
+	CommitResult result = AddItemToXml (shardPath.c_str (), baseVersion, parentId, node, false);
+
+	if (IsShardWritten (result) && !UpdateManifestEntries (manifestPath, { file })) {
+		CS_LOG_WARNING ("ClassSync: Shard %s written but manifest not updated", file.c_str ());
+		return CommitResult::Busy;
+	}
+
+	return result;
+}
+
+
+// ---------------------------------------------------------------------------
+// Apply a batch of edits: new branches become shards, the other edits are
+// grouped by owning shard and committed with one write per shard, then the
+// manifest is updated once for all touched shards
+// ---------------------------------------------------------------------------
+
+CommitResult ApplyEditsToShards (const char* manifestPath,
+								 const ShardedMasterCache& cache,
+								 std::vector<MasterEdit>& edits)
+{
+	struct ShardBatch {
+		MasterVersion          baseVersion;
+		std::vector<size_t>    editIndices;
+	};
+
+	// Items added by this batch are owned by the shard of their parent
+	std::map<std::string, std::string>  addedOwner;
+	std::map<std::string, ShardBatch>   batches;
+	std::vector<std::string>            batchOrder;
+	std::set<std::string>               touched;
+	bool                                anyWritten = false;
+	bool                                anyBusy    = false;
+
+	for (size_t i = 0; i < edits.size (); i++) {
+		MasterEdit& edit = edits[i];
+
+		if (edit.kind == MasterEditKind::AddItem && edit.parentId.empty ()) {
+			std::string   file;
+			MasterVersion version;
+			edit.result = AddBranchShard (manifestPath, edit.node, &file, &version);
+			if (!file.empty ()) {
+				addedOwner[edit.node.id] = file;
+				batches[file].baseVersion = version;
+			}
+			anyWritten |= IsCommitSuccess (edit.result);
+			anyBusy    |= edit.result == CommitResult::Busy;
+			continue;
+		}
+
+		std::string ownerId = edit.kind == MasterEditKind::AddItem ? edit.parentId : edit.itemId;
+		std::string file;
+		MasterVersion baseVersion;
+		auto added = addedOwner.find (ownerId);
+		if (added != addedOwner.end ()) {
+			file        = added->second;
+			baseVersion = batches[file].baseVersion;
+		} else if (!FindOwningShard (cache, ownerId, file, baseVersion)) {
+			edit.result = CommitResult::Failed;
+			continue;
+		}
+
+		if (edit.kind == MasterEditKind::AddItem)
+			addedOwner[edit.node.id] = file;
+
+		auto batch = batches.find (file);
+		if (batch == batches.end ()) {
+			batch = batches.emplace (file, ShardBatch ()).first;
+			batch->second.baseVersion = baseVersion;
+		}
+		if (batch->second.editIndices.empty ())
+			batchOrder.push_back (file);
+		batch->second.editIndices.push_back (i);
+	}
+
+	std::string dir = GetDirectory (manifestPath);
+	for (const std::string& file : batchOrder) {
+		const ShardBatch& batch = batches[file];
+
+		std::vector<MasterEdit> shardEdits;
+		for (size_t i : batch.editIndices)
+			shardEdits.push_back (edits[i]);
+
+		std::string  shardPath = JoinPath (dir, file);
+		CommitResult result    = ApplyEditsToXml (shardPath.c_str (), batch.baseVersion, shardEdits, false);
+
+		for (size_t k = 0; k < shardEdits.size (); k++)
+			edits[batch.editIndices[k]].result = shardEdits[k].result;
+
+		if (IsShardWritten (result))
+			touched.insert (file);
+		anyWritten |= IsCommitSuccess (result);
+		anyBusy    |= result == CommitResult::Busy;
+	}
+
+	if (!touched.empty () && !UpdateManifestEntries (manifestPath, touched)) {
+		CS_LOG_WARNING ("ClassSync: %u shard(s) written but manifest not updated", (unsigned)touched.size ());
+		return CommitResult::Busy;
+	}
+
+	if (anyWritten)
+		return CommitResult::Committed;
+	return anyBusy ? CommitResult::Busy : CommitResult::AlreadyApplied;
+}
@@ -0,0 +1,110 @@
+#ifndef SHARDEDMASTER_HPP
+#define SHARDEDMASTER_HPP
+
+#include "ClassificationModel.hpp"
+#include "MasterVersion.hpp"
+#include "XmlWriter.hpp"
+#include "WorkProgress.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// Sharded master layout
+//
+//   <name>.shards/master.manifest    small index, selected in the palette
+//   <name>.shards/system-0.xml       <System> header (Name, EditionVersion, ...)
+//   <name>.shards/DRZ.xml            one file per top-level <Item> branch
+//   <name>.shards/KRZ.xml            ...
+//   <name>.shards/properties.xml     <PropertyDefinitionGroups> block
+//
+// The manifest lists every shard with its content hash, so readers re-read
+// only shards that changed, and writers hold the commit guard of a single
+// shard (plus the manifest for a few milliseconds). Shards assemble back
+// into a standard ArchiCAD classification XML.
+// ---------------------------------------------------------------------------
+
+enum class ShardKind {
+	SystemHeader,
+	ItemBranch,
+	Properties
+};
+
+struct ShardEntry {
+	ShardKind      kind;
+	unsigned       systemIndex;		// which <System> the shard belongs to
+	std::string    key;				// top-level item ID for ItemBranch shards
+	std::string    file;			// file name relative to the manifest
+	MasterVersion  version;			// content version when last committed
+};
+
+struct ShardManifest {
+	std::string              eol;
+	std::vector<ShardEntry>  shards;
+};
+
+
+// ---------------------------------------------------------------------------
+// Parsed shards kept between refreshes; unchanged shards are not re-read
+// ---------------------------------------------------------------------------
+
+struct ShardedMasterCache {
+	struct Shard {
+		MasterVersion                   version;
+		MasterStamp                     stamp;		// of the file when read
+		ClassificationTree              header;		// SystemHeader shards
+		std::vector<ClassificationNode> items;		// ItemBranch shards
+	};
+
+	std::string                         manifestPath;
+	std::map<std::string, Shard>        shards;			// by file name
+	std::map<std::string, std::string>  itemToShard;	// item ID -> file name
+};
+
+
+// True if the path points at a shard manifest instead of a single XML.
+bool  IsShardedMaster (const char* path);
+
+// File names of the shards listed in a manifest, relative to it.
+bool  ReadShardFileNames (const char* manifestPath, std::vector<std::string>& fileNames);
+
+// Split a single-file master into shards next to it ("<name>.shards/").
+// Returns false and fills error if the XML structure is not recognized.
+bool  SplitMasterIntoShards (const char* xmlPath, std::string& manifestPath, std::string& error);
+
+// Read all systems; shards whose manifest hash and file stamp match the
+// cache are reused.
+// Changed shards are loaded and parsed in parallel. With progress, steps
+// count loaded shards; a cancelled read adds nothing to the cache.
+std::vector<ClassificationTree>  ReadShardedClassifications (const char* manifestPath,
+															 ShardedMasterCache& cache,
+															 MasterVersion* version = nullptr,
+															 WorkProgress* progress = nullptr);
+
+// Assemble the shards into one standard classification XML document.
+bool  AssembleShardedXml (const char* manifestPath, std::string& xml);
+
+// Optimistic edits routed to the shard that owns the target item. A shard
+// written whose manifest entry could not be updated gives Busy, so the
+// caller refreshes; retrying the edit then repairs the manifest.
+CommitResult  ChangeItemNameInShards (const char* manifestPath,
+									  const ShardedMasterCache& cache,
+									  const std::string& itemId,
+									  const std::string& baseName,
+									  const std::string& newName);
+
+CommitResult  AddItemToShards (const char* manifestPath,
+							   const ShardedMasterCache& cache,
+							   const std::string& parentId,
+							   const ClassificationNode& node);
+
+// Batch of edits: one commit per touched shard and one manifest update.
+// Per-edit results as in ApplyEditsToXml.
+CommitResult  ApplyEditsToShards (const char* manifestPath,
+								  const ShardedMasterCache& cache,
+								  std::vector<MasterEdit>& edits);
+
+
+#endif // SHARDEDMASTER_HPP
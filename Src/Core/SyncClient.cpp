@@ -0,0 +1,192 @@
+#include "SyncClient.hpp"
+#include "Counters.hpp"
+#include "Log.hpp"
+#include "XmlReader.hpp"
+
+#include <sstream>
+
+
+// Version of the service's content from a <state> reply
+static MasterVersion StateVersion (const SyncMessage& reply, size_t first)
+{
+	MasterVersion version;
+	version.size  = reply.NumberField (first + 1);
+	version.hash  = reply.NumberField (first + 2);
+	version.valid = true;
+	return version;
+}
+
+
+// ---------------------------------------------------------------------------
+// Connection
+// ---------------------------------------------------------------------------
+
+SyncClient::SyncClient () :
+	connected (false)
+{
+}
+
+
+bool SyncClient::Connect (const std::string& serviceAddress, const std::string& path)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	socket.Close ();
+	connected  = false;
+	address    = serviceAddress;
+	masterPath = path;
+
+	std::string   host;
+	std::uint16_t port;
+	if (!ParseSyncAddress (address, host, port)) {
+		CS_LOG_WARNING ("ClassSync: Invalid sync service address '%s'", address.c_str ());
+		return false;
+	}
+	if (!socket.Connect (host, port, kSyncConnectTimeoutMs))
+		return false;
+
+	connected = true;
+	SyncMessage reply;
+	if (!Request (MakeSyncMessage ({ "hello", std::to_string (kSyncProtocolVersion), masterPath }), reply))
+		return false;
+	if (reply.Field (0) != "hello") {
+		Drop ();
+		return false;
+	}
+
+	CS_LOG_DEBUG ("ClassSync: Connected to sync service at %s, revision %llu",
+				  address.c_str (), (unsigned long long)reply.NumberField (2));
+	return true;
+}
+
+
+void SyncClient::Disconnect ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	Drop ();
+}
+
+
+void SyncClient::Drop ()
+{
+	socket.Close ();
+	connected = false;
+}
+
+
+bool SyncClient::Request (const SyncMessage& request, SyncMessage& reply)
+{
+	if (!connected)
+		return false;
+
+	AddCounter (Counter::SyncRequests);
+	if (SendSyncMessage (socket, request) && ReceiveSyncMessage (socket, reply, kSyncTimeoutMs) && reply.Field (0) != "error")
+		return true;
+
+	if (reply.Field (0) == "error")
+		CS_LOG_WARNING ("ClassSync: Sync service at %s refused: %s", address.c_str (), reply.Field (1).c_str ());
+	else
+		CS_LOG_WARNING ("ClassSync: Sync service at %s stopped responding - using the master file", address.c_str ());
+	Drop ();
+	return false;
+}
+
+
+// ---------------------------------------------------------------------------
+// Master copy
+// ---------------------------------------------------------------------------
+
+SyncUpdate SyncClient::Update (std::uint64_t& revision,
+							   std::vector<ClassificationTree>& data,
+							   MasterVersion& version,
+							   std::uint64_t& hash,
+							   WorkProgress* progress)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	std::uint64_t since     = revision;
+	std::uint64_t knownHash = hash;
+	revision = 0;
+	hash     = 0;
+
+	SyncMessage reply;
+	if (since != 0) {
+		if (!Request (MakeSyncMessage ({ "deltas", std::to_string ((unsigned long long)since) }), reply))
+			return SyncUpdate::Failed;
+
+		// The model hash also catches a copy that went astray
+		std::uint64_t modelHash = reply.NumberField (4);
+		if (reply.Field (0) == "unchanged" && knownHash == modelHash) {
+			revision = since;
+			hash     = modelHash;
+			version  = StateVersion (reply, 1);
+			return SyncUpdate::Unchanged;
+		}
+
+		if (reply.Field (0) == "deltas") {
+			std::vector<MasterEdit> edits;
+			std::istringstream lines (reply.body);
+			std::string line;
+			while (std::getline (lines, line)) {
+				MasterEdit edit;
+				if (ParseSyncEdit (SplitSyncFields (line), 1, edit))
+					edits.push_back (edit);
+			}
+
+			if (ApplyEditsToModel (data, edits) && HashClassifications (data) == modelHash) {
+				revision = reply.NumberField (1);
+				hash     = modelHash;
+				version  = StateVersion (reply, 1);
+				return SyncUpdate::Deltas;
+			}
+			CS_LOG_DEBUG ("ClassSync: Sync deltas since revision %llu did not match, fetching the master",
+						  (unsigned long long)since);
+		}
+	}
+
+	if (!Request (MakeSyncMessage ({ "snapshot" }), reply))
+		return SyncUpdate::Failed;
+
+	std::vector<ClassificationTree> parsed;
+	if (!ParseXmlClassifications (reply.body, parsed, progress))
+		return SyncUpdate::Cancelled;
+
+	data     = std::move (parsed);
+	revision = reply.NumberField (1);
+	hash     = HashClassifications (data);
+	version  = StateVersion (reply, 1);
+	return SyncUpdate::Snapshot;
+}
+
+
+// ---------------------------------------------------------------------------
+// Commit
+// ---------------------------------------------------------------------------
+
+bool SyncClient::Commit (const MasterVersion& baseVersion, std::vector<MasterEdit>& edits, CommitResult& result)
+{
+	std::string body;
+	for (const MasterEdit& edit : edits)
+		body += JoinSyncFields (FormatSyncEdit (edit)) + "\n";
+
+	std::lock_guard<std::mutex> lock (mutex);
+	SyncMessage reply;
+	std::vector<std::string> fields = {
+		"commit",
+		std::to_string ((unsigned long long)baseVersion.size),
+		std::to_string ((unsigned long long)baseVersion.hash)
+	};
+	if (!Request (MakeSyncMessage (fields, body), reply))
+		return false;
+	if (reply.Field (0) != "commit") {
+		Drop ();
+		return false;
+	}
+
+	result = (CommitResult)reply.NumberField (1);
+	std::istringstream lines (reply.body);
+	for (MasterEdit& edit : edits) {
+		int editResult = (int)CommitResult::Failed;
+		lines >> editResult;
+		edit.result = (CommitResult)editResult;
+	}
+	return true;
+}
@@ -0,0 +1,80 @@
+#ifndef SYNCCLIENT_HPP
+#define SYNCCLIENT_HPP
+
+#include "ClassificationModel.hpp"
+#include "MasterVersion.hpp"
+#include "SyncProtocol.hpp"
+#include "WorkProgress.hpp"
+#include "XmlWriter.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// Sync service client: one connection to a SyncServer hosting the master
+//
+// Requests are serialized by a mutex, so the refresh worker and the UI
+// thread can share one client. Any broken or refused request drops the
+// connection; callers then use the master file directly until they
+// Connect again.
+// ---------------------------------------------------------------------------
+
+// How long Connect waits for the service (it usually runs on this machine)
+static const int  kSyncConnectTimeoutMs = 1000;
+
+enum class SyncUpdate {
+	Unchanged,		// the copy is current
+	Deltas,			// edits since the copy's revision were applied to it
+	Snapshot,		// the whole master was received and parsed
+	Cancelled,		// progress stopped the parse; the copy must be fetched again
+	Failed			// no service: the connection is dropped
+};
+
+class SyncClient {
+public:
+	SyncClient ();
+
+	// Connect and check that the service hosts the master of this file name.
+	bool  Connect (const std::string& address, const std::string& masterPath);
+	void  Disconnect ();
+
+	bool                IsConnected () const     { return connected; }
+	const std::string&  GetAddress () const      { return address; }
+	const std::string&  GetMasterPath () const   { return masterPath; }
+
+	// Bring a parsed copy of the master up to the service's revision
+	// (revision 0 = no copy yet; hash is HashClassifications of data). On Unchanged, Deltas and Snapshot all four
+	// describe the service's content; on Cancelled and Failed revision and
+	// hash are 0.
+	SyncUpdate  Update (std::uint64_t& revision,
+						std::vector<ClassificationTree>& data,
+						MasterVersion& version,
+						std::uint64_t& hash,
+						WorkProgress* progress = nullptr);
+
+	// Commit like ApplyEditsToXml (edit.result per edit). False if the service
+	// could not be asked; a commit lost with its reply shows up as
+	// AlreadyApplied when the edits are retried on the file.
+	bool  Commit (const MasterVersion& baseVersion, std::vector<MasterEdit>& edits, CommitResult& result);
+
+private:
+	SyncClient (const SyncClient&) = delete;
+	SyncClient& operator= (const SyncClient&) = delete;
+
+	// Under mutex
+	void  Drop ();
+	bool  Request (const SyncMessage& request, SyncMessage& reply);
+
+	std::mutex         mutex;
+	SyncSocket         socket;
+	std::string        address;
+	std::string        masterPath;
+	std::atomic<bool>  connected;
+};
+
+
+#endif // SYNCCLIENT_HPP
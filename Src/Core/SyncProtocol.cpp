@@ -0,0 +1,539 @@
+#include "SyncProtocol.hpp"
+#include "Counters.hpp"
+#include "ItemIndex.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#if defined (_WIN32)
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+#else
+	#include <arpa/inet.h>
+	#include <fcntl.h>
+	#include <netdb.h>
+	#include <netinet/in.h>
+	#include <netinet/tcp.h>
+	#include <sys/select.h>
+	#include <sys/socket.h>
+	#include <unistd.h>
+	#include <cerrno>
+#endif
+
+
+// ---------------------------------------------------------------------------
+// Platform helpers
+// ---------------------------------------------------------------------------
+
+#if defined (_WIN32)
+	typedef SOCKET  NativeSocket;
+	static const std::intptr_t  kNoSocket = (std::intptr_t)INVALID_SOCKET;
+	static const int            kSendFlags = 0;
+#else
+	typedef int     NativeSocket;
+	static const std::intptr_t  kNoSocket = -1;
+	#if defined (MSG_NOSIGNAL)
+		static const int        kSendFlags = MSG_NOSIGNAL;
+	#else
+		static const int        kSendFlags = 0;
+	#endif
+#endif
+
+
+static void StartSockets ()
+{
+#if defined (_WIN32)
+	static std::once_flag started;
+	std::call_once (started, [] {
+		WSADATA data;
+		WSAStartup (MAKEWORD (2, 2), &data);
+	});
+#endif
+}
+
+
+static void CloseNative (std::intptr_t handle)
+{
+#if defined (_WIN32)
+	closesocket ((NativeSocket)handle);
+#else
+	close ((NativeSocket)handle);
+#endif
+}
+
+
+static void SetBlocking (std::intptr_t handle, bool blocking)
+{
+#if defined (_WIN32)
+	u_long nonBlocking = blocking ? 0 : 1;
+	ioctlsocket ((NativeSocket)handle, FIONBIO, &nonBlocking);
+#else
+	int flags = fcntl ((NativeSocket)handle, F_GETFL, 0);
+	fcntl ((NativeSocket)handle, F_SETFL, blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK));
+#endif
+}
+
+
+// select () on one socket; writable = wait for a connect to finish (Windows
+// reports a failed connect as an exception, the others as writable)
+static bool WaitSocket (std::intptr_t handle, bool writable, int timeoutMs)
+{
+	fd_set set, failed;
+	FD_ZERO (&set);
+	FD_ZERO (&failed);
+	FD_SET ((NativeSocket)handle, &set);
+	FD_SET ((NativeSocket)handle, &failed);
+	timeval timeout;
+	timeout.tv_sec  = timeoutMs / 1000;
+	timeout.tv_usec = (timeoutMs % 1000) * 1000;
+	int ready = select ((int)handle + 1, writable ? nullptr : &set, writable ? &set : nullptr,
+						writable ? &failed : nullptr, &timeout);
+	return ready > 0;
+}
+
+
+static bool ResolveAddress (const std::string& host, std::uint16_t port, sockaddr_in& address)
+{
+	std::memset (&address, 0, sizeof (address));
+	address.sin_family = AF_INET;
+	address.sin_port   = htons (port);
+	if (inet_pton (AF_INET, host.c_str (), &address.sin_addr) == 1)
+		return true;
+
+	addrinfo hints;
+	std::memset (&hints, 0, sizeof (hints));
+	hints.ai_family   = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* found = nullptr;
+	if (getaddrinfo (host.c_str (), nullptr, &hints, &found) != 0 || found == nullptr)
+		return false;
+	address.sin_addr = ((const sockaddr_in*)found->ai_addr)->sin_addr;
+	freeaddrinfo (found);
+	return true;
+}
+
+
+bool ParseSyncAddress (const std::string& text, std::string& host, std::uint16_t& port)
+{
+	host = "127.0.0.1";
+	port = kSyncDefaultPort;
+
+	std::string portText;
+	size_t colon = text.rfind (':');
+	if (colon != std::string::npos) {
+		if (colon > 0)
+			host = text.substr (0, colon);
+		portText = text.substr (colon + 1);
+	} else if (text.find_first_not_of ("0123456789") == std::string::npos) {
+		portText = text;
+	} else {
+		host = text;
+	}
+	if (portText.empty ())
+		return true;
+
+	if (portText.size () > 5 || portText.find_first_not_of ("0123456789") != std::string::npos)
+		return false;
+	unsigned long value = std::strtoul (portText.c_str (), nullptr, 10);
+	if (value == 0 || value > 65535)
+		return false;
+	port = (std::uint16_t)value;
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Socket
+// ---------------------------------------------------------------------------
+
+SyncSocket::SyncSocket () :
+	handle (kNoSocket)
+{
+}
+
+
+SyncSocket::~SyncSocket ()
+{
+	Close ();
+}
+
+
+SyncSocket::SyncSocket (SyncSocket&& other) :
+	handle (other.handle)
+{
+	other.handle = kNoSocket;
+}
+
+
+SyncSocket& SyncSocket::operator= (SyncSocket&& other)
+{
+	if (this != &other) {
+		Close ();
+		handle       = other.handle;
+		other.handle = kNoSocket;
+	}
+	return *this;
+}
+
+
+bool SyncSocket::Connect (const std::string& host, std::uint16_t port, int timeoutMs)
+{
+	Close ();
+	StartSockets ();
+
+	sockaddr_in address;
+	if (!ResolveAddress (host, port, address))
+		return false;
+
+	handle = (std::intptr_t)socket (AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (handle == kNoSocket)
+		return false;
+
+	// Non-blocking connect, so a host that does not answer fails in timeoutMs
+	SetBlocking (handle, false);
+	bool connected = connect ((NativeSocket)handle, (const sockaddr*)&address, sizeof (address)) == 0;
+	if (!connected && WaitSocket (handle, true, timeoutMs)) {
+		int error = 0;
+		socklen_t length = sizeof (error);
+		connected = getsockopt ((NativeSocket)handle, SOL_SOCKET, SO_ERROR, (char*)&error, &length) == 0 && error == 0;
+	}
+	if (!connected) {
+		Close ();
+		return false;
+	}
+	SetBlocking (handle, true);
+
+	// Requests are small and answered at once
+	int noDelay = 1;
+	setsockopt ((NativeSocket)handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof (noDelay));
+#if defined (SO_NOSIGPIPE)
+	int noSigPipe = 1;
+	setsockopt ((NativeSocket)handle, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof (noSigPipe));
+#endif
+	return true;
+}
+
+
+bool SyncSocket::Listen (const std::string& host, std::uint16_t port)
+{
+	Close ();
+	StartSockets ();
+
+	sockaddr_in address;
+	if (!ResolveAddress (host, port, address))
+		return false;
+
+	handle = (std::intptr_t)socket (AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (handle == kNoSocket)
+		return false;
+
+#if !defined (_WIN32)
+	// Restarting the service must not wait for old connections to time out
+	int reuse = 1;
+	setsockopt ((NativeSocket)handle, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof (reuse));
+#endif
+
+	if (bind ((NativeSocket)handle, (const sockaddr*)&address, sizeof (address)) != 0 ||
+		listen ((NativeSocket)handle, SOMAXCONN) != 0)
+	{
+		Close ();
+		return false;
+	}
+	return true;
+}
+
+
+bool SyncSocket::Accept (SyncSocket& connection)
+{
+	std::intptr_t accepted = (std::intptr_t)accept ((NativeSocket)handle, nullptr, nullptr);
+	if (accepted == kNoSocket)
+		return false;
+
+	connection = SyncSocket ();
+	connection.handle = accepted;
+	int noDelay = 1;
+	setsockopt ((NativeSocket)accepted, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof (noDelay));
+#if defined (SO_NOSIGPIPE)
+	int noSigPipe = 1;
+	setsockopt ((NativeSocket)accepted, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof (noSigPipe));
+#endif
+	return true;
+}
+
+
+bool SyncSocket::IsOpen () const
+{
+	return handle != kNoSocket;
+}
+
+
+void SyncSocket::Close ()
+{
+	if (handle == kNoSocket)
+		return;
+	CloseNative (handle);
+	handle = kNoSocket;
+}
+
+
+std::uint16_t SyncSocket::GetLocalPort () const
+{
+	sockaddr_in address;
+	socklen_t length = sizeof (address);
+	if (handle == kNoSocket || getsockname ((NativeSocket)handle, (sockaddr*)&address, &length) != 0)
+		return 0;
+	return ntohs (address.sin_port);
+}
+
+
+bool SyncSocket::WaitReadable (int timeoutMs) const
+{
+	return handle != kNoSocket && WaitSocket (handle, false, timeoutMs);
+}
+
+
+bool SyncSocket::SendAll (const char* data, size_t size)
+{
+	while (size > 0) {
+		int chunk = size > (1u << 20) ? (1 << 20) : (int)size;
+		int sent = (int)send ((NativeSocket)handle, data, chunk, kSendFlags);
+		if (sent <= 0)
+			return false;
+		data += sent;
+		size -= (size_t)sent;
+	}
+	return true;
+}
+
+
+bool SyncSocket::ReceiveAll (char* data, size_t size, int timeoutMs)
+{
+	while (size > 0) {
+		if (!WaitReadable (timeoutMs))
+			return false;
+		int chunk = size > (1u << 20) ? (1 << 20) : (int)size;
+		int received = (int)recv ((NativeSocket)handle, data, chunk, 0);
+		if (received <= 0)
+			return false;
+		data += received;
+		size -= (size_t)received;
+	}
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Fields
+// ---------------------------------------------------------------------------
+
+std::string JoinSyncFields (const std::vector<std::string>& fields)
+{
+	std::string line;
+	for (size_t i = 0; i < fields.size (); i++) {
+		if (i > 0)
+			line += '\t';
+		for (char c : fields[i]) {
+			switch (c) {
+				case '\t': line += "\\t";  break;
+				case '\n': line += "\\n";  break;
+				case '\r': line += "\\r";  break;
+				case '\\': line += "\\\\"; break;
+				default:   line += c;      break;
+			}
+		}
+	}
+	return line;
+}
+
+
+std::vector<std::string> SplitSyncFields (const std::string& line)
+{
+	std::vector<std::string> fields (1);
+	for (size_t i = 0; i < line.size (); i++) {
+		char c = line[i];
+		if (c == '\t') {
+			fields.emplace_back ();
+		} else if (c == '\\' && i + 1 < line.size ()) {
+			char next = line[++i];
+			fields.back () += next == 't' ? '\t' : next == 'n' ? '\n' : next == 'r' ? '\r' : next;
+		} else {
+			fields.back () += c;
+		}
+	}
+	return fields;
+}
+
+
+// ---------------------------------------------------------------------------
+// Messages
+// ---------------------------------------------------------------------------
+
+const std::string& SyncMessage::Field (size_t index) const
+{
+	static const std::string empty;
+	return index < fields.size () ? fields[index] : empty;
+}
+
+
+std::uint64_t SyncMessage::NumberField (size_t index) const
+{
+	return std::strtoull (Field (index).c_str (), nullptr, 10);
+}
+
+
+SyncMessage MakeSyncMessage (const std::vector<std::string>& fields, const std::string& body)
+{
+	SyncMessage message;
+	message.fields = fields;
+	message.body   = body;
+	return message;
+}
+
+
+bool SendSyncMessage (SyncSocket& socket, const SyncMessage& message)
+{
+	std::string header = JoinSyncFields (message.fields);
+	char frame[48];
+	std::snprintf (frame, sizeof (frame), "%llu %llu\n",
+				   (unsigned long long)header.size (), (unsigned long long)message.body.size ());
+
+	std::string data = frame + header;
+	if (!socket.SendAll (data.data (), data.size ()) || !socket.SendAll (message.body.data (), message.body.size ()))
+		return false;
+	AddCounter (Counter::SyncBytesSent, data.size () + message.body.size ());
+	return true;
+}
+
+
+bool ReceiveSyncMessage (SyncSocket& socket, SyncMessage& message, int timeoutMs)
+{
+	// "<header bytes> <body bytes>\n", read byte by byte (it is short)
+	std::string frame;
+	char c = 0;
+	while (frame.size () < 48) {
+		if (!socket.ReceiveAll (&c, 1, timeoutMs))
+			return false;
+		if (c == '\n')
+			break;
+		frame += c;
+	}
+	unsigned long long headerBytes = 0, bodyBytes = 0;
+	if (c != '\n' || std::sscanf (frame.c_str (), "%llu %llu", &headerBytes, &bodyBytes) != 2 ||
+		headerBytes > kSyncMaxMessageBytes || bodyBytes > kSyncMaxMessageBytes)
+	{
+		return false;
+	}
+
+	std::string header ((size_t)headerBytes, '\0');
+	message.body.assign ((size_t)bodyBytes, '\0');
+	if (!socket.ReceiveAll (&header[0], header.size (), timeoutMs) ||
+		!socket.ReceiveAll (&message.body[0], message.body.size (), timeoutMs))
+	{
+		return false;
+	}
+	message.fields = SplitSyncFields (header);
+	AddCounter (Counter::SyncBytesReceived, frame.size () + 1 + headerBytes + bodyBytes);
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Edits
+// ---------------------------------------------------------------------------
+
+std::vector<std::string> FormatSyncEdit (const MasterEdit& edit)
+{
+	return {
+		edit.kind == MasterEditKind::AddItem ? "add" : "name",
+		edit.itemId, edit.baseName, edit.newName, edit.parentId,
+		edit.node.id, edit.node.name, edit.node.description
+	};
+}
+
+
+bool ParseSyncEdit (const std::vector<std::string>& fields, size_t first, MasterEdit& edit)
+{
+	if (fields.size () < first + 8)
+		return false;
+	const std::string& kind = fields[first];
+	if (kind != "add" && kind != "name")
+		return false;
+
+	edit.kind             = kind == "add" ? MasterEditKind::AddItem : MasterEditKind::ChangeName;
+	edit.itemId           = fields[first + 1];
+	edit.baseName         = fields[first + 2];
+	edit.newName          = fields[first + 3];
+	edit.parentId         = fields[first + 4];
+	edit.node.id          = fields[first + 5];
+	edit.node.name        = fields[first + 6];
+	edit.node.description = fields[first + 7];
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Replay edits on a parsed model
+// ---------------------------------------------------------------------------
+
+static ClassificationNode* FindModelNode (std::vector<ClassificationNode>& nodes, const std::string& id)
+{
+	for (ClassificationNode& node : nodes) {
+		if (node.id == id)
+			return &node;
+		if (ClassificationNode* found = FindModelNode (node.children, id))
+			return found;
+	}
+	return nullptr;
+}
+
+
+static ClassificationNode* FindModelNode (std::vector<ClassificationTree>& trees, const std::string& id)
+{
+	for (ClassificationTree& tree : trees) {
+		if (ClassificationNode* found = FindModelNode (tree.rootItems, id))
+			return found;
+	}
+	return nullptr;
+}
+
+
+bool ApplyEditsToModel (std::vector<ClassificationTree>& trees, const std::vector<MasterEdit>& edits)
+{
+	for (const MasterEdit& edit : edits) {
+		if (edit.kind == MasterEditKind::ChangeName) {
+			ClassificationNode* node = FindModelNode (trees, edit.itemId);
+			if (node == nullptr)
+				return false;
+			node->name = edit.newName;
+			continue;
+		}
+
+		if (FindModelNode (trees, edit.node.id) != nullptr)
+			continue;		// already there (AlreadyApplied on the XML)
+
+		std::vector<ClassificationNode>* siblings = nullptr;
+		if (edit.parentId.empty ()) {
+			if (trees.empty ())
+				return false;
+			siblings = &trees[0].rootItems;
+		} else {
+			ClassificationNode* parent = FindModelNode (trees, edit.parentId);
+			if (parent == nullptr)
+				return false;
+			siblings = &parent->children;
+		}
+
+		ClassificationNode node;
+		node.id          = edit.node.id;
+		node.name        = edit.node.name;
+		node.description = edit.node.description;
+
+		auto pos = siblings->begin ();
+		while (pos != siblings->end () && CompareItemIds (pos->id, node.id) <= 0)
+			++pos;
+		siblings->insert (pos, std::move (node));
+	}
+	return true;
+}
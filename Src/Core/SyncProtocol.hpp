@@ -0,0 +1,117 @@
+#ifndef SYNCPROTOCOL_HPP
+#define SYNCPROTOCOL_HPP
+
+#include "ClassificationModel.hpp"
+#include "MasterVersion.hpp"
+#include "XmlWriter.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// Sync service protocol
+//
+// The service (SyncServer) holds one master in memory and numbers every
+// commit with a revision. Clients (SyncClient) keep a parsed copy and ask
+// for the edits since their revision; only a client that is too far behind
+// receives the whole master again. Messages travel over TCP, by default on
+// the loopback interface:
+//
+//   "<header bytes> <body bytes>\n" <header> <body>
+//
+// The header is one line of tab-separated fields (request or reply name
+// first). Bodies hold the master XML or one edit per line.
+//
+//   hello <protocol> <master file name>  -> hello <protocol> <revision> | error <text>
+//   deltas <revision>                    -> unchanged <state> | deltas <state> + edits | reset <revision>
+//   snapshot                             -> snapshot <state> + master XML
+//   commit <size> <hash>                 -> commit <result> <state> + one result per edit
+//
+// <state> is "<revision> <size> <hash> <model hash>": the version of the
+// service's content and HashClassifications of its parsed model, which a
+// client checks after applying deltas.
+// ---------------------------------------------------------------------------
+
+static const int            kSyncProtocolVersion = 1;
+static const std::uint16_t  kSyncDefaultPort     = 47383;
+static const int            kSyncTimeoutMs       = 10000;
+static const std::uint64_t  kSyncMaxMessageBytes = 1ull << 30;
+
+// "host:port", "host" or "port"; the missing part is 127.0.0.1 / the default port.
+bool  ParseSyncAddress (const std::string& text, std::string& host, std::uint16_t& port);
+
+
+// ---------------------------------------------------------------------------
+// Blocking TCP socket (Winsock on Windows, BSD sockets elsewhere)
+// ---------------------------------------------------------------------------
+
+class SyncSocket {
+public:
+	SyncSocket ();
+	~SyncSocket ();
+
+	SyncSocket (SyncSocket&& other);
+	SyncSocket& operator= (SyncSocket&& other);
+
+	bool  Connect (const std::string& host, std::uint16_t port, int timeoutMs);
+	bool  Listen (const std::string& host, std::uint16_t port);		// port 0 = any free port
+	bool  Accept (SyncSocket& connection);
+
+	bool  IsOpen () const;
+	void  Close ();
+	std::uint16_t  GetLocalPort () const;
+
+	// False on timeout or error; waiting is how blocked threads notice a stop.
+	bool  WaitReadable (int timeoutMs) const;
+
+	bool  SendAll (const char* data, size_t size);
+	bool  ReceiveAll (char* data, size_t size, int timeoutMs);
+
+private:
+	SyncSocket (const SyncSocket&) = delete;
+	SyncSocket& operator= (const SyncSocket&) = delete;
+
+	std::intptr_t  handle;		// SOCKET on Windows, file descriptor elsewhere
+};
+
+
+// ---------------------------------------------------------------------------
+// Messages
+// ---------------------------------------------------------------------------
+
+struct SyncMessage {
+	std::vector<std::string>  fields;
+	std::string               body;
+
+	const std::string&  Field (size_t index) const;		// "" when missing
+	std::uint64_t       NumberField (size_t index) const;
+};
+
+SyncMessage  MakeSyncMessage (const std::vector<std::string>& fields, const std::string& body = std::string ());
+
+// Both return false when the connection broke or, for receive, timed out.
+bool  SendSyncMessage (SyncSocket& socket, const SyncMessage& message);
+bool  ReceiveSyncMessage (SyncSocket& socket, SyncMessage& message, int timeoutMs);
+
+// Tab-separated fields with \t \n \r \\ escaped.
+std::string               JoinSyncFields (const std::vector<std::string>& fields);
+std::vector<std::string>  SplitSyncFields (const std::string& line);
+
+
+// ---------------------------------------------------------------------------
+// Edits on the wire and on a parsed model
+// ---------------------------------------------------------------------------
+
+std::vector<std::string>  FormatSyncEdit (const MasterEdit& edit);
+bool                      ParseSyncEdit (const std::vector<std::string>& fields, size_t first, MasterEdit& edit);
+
+// Replay committed edits on a parsed master the way ApplyEditsToContent
+// changes the XML (renames by ID, adds sorted by ID under the parent or the
+// first system). False if a target is missing; the caller then fetches the
+// whole master.
+bool  ApplyEditsToModel (std::vector<ClassificationTree>& trees, const std::vector<MasterEdit>& edits);
+
+
+#endif // SYNCPROTOCOL_HPP
@@ -0,0 +1,353 @@
+#include "SyncServer.hpp"
+#include "FileLock.hpp"
+#include "FileSystem.hpp"
+#include "Log.hpp"
+#include "XmlReader.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <sstream>
+
+
+// Poll interval of the accept and connection threads (how soon Stop returns)
+static const int kSyncPollMs = 200;
+
+
+static std::string FileNameOf (const std::string& path)
+{
+	size_t slash = path.find_last_of ("/\\");
+	std::string name = slash == std::string::npos ? path : path.substr (slash + 1);
+	std::transform (name.begin (), name.end (), name.begin (), [] (unsigned char c) { return (char)std::tolower (c); });
+	return name;
+}
+
+
+// ---------------------------------------------------------------------------
+// Start / stop
+// ---------------------------------------------------------------------------
+
+SyncServer::SyncServer () :
+	modelHash (0),
+	revision (0),
+	historyBase (0),
+	running (false),
+	stopping (false),
+	port (0)
+{
+}
+
+
+SyncServer::~SyncServer ()
+{
+	Stop ();
+}
+
+
+bool SyncServer::Start (const std::string& path, const std::string& host, std::uint16_t listenPort)
+{
+	Stop ();
+	masterPath = path;
+	masterName = FileNameOf (path);
+
+	{
+		// Revisions continue from the clock, so a restarted service never
+		// reuses a number that clients still hold
+		std::lock_guard<std::mutex> lock (mutex);
+		revision = (std::uint64_t)std::chrono::duration_cast<std::chrono::milliseconds> (
+			std::chrono::system_clock::now ().time_since_epoch ()).count ();
+		if (!LoadMaster ())
+			return false;
+	}
+
+	if (!listener.Listen (host, listenPort)) {
+		CS_LOG_ERROR ("ClassSync service: Cannot listen on %s:%u", host.c_str (), (unsigned)listenPort);
+		return false;
+	}
+	port = listener.GetLocalPort ();
+
+	stopping = false;
+	running  = true;
+	acceptor = std::thread ([this] { AcceptLoop (); });
+	CS_LOG_INFO ("ClassSync service: Serving %s on %s:%u", masterPath.c_str (), host.c_str (), (unsigned)port);
+	return true;
+}
+
+
+void SyncServer::Stop ()
+{
+	if (!acceptor.joinable ())
+		return;
+
+	stopping = true;
+	acceptor.join ();
+	listener.Close ();
+	running = false;
+}
+
+
+std::uint64_t SyncServer::GetRevision ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return revision;
+}
+
+
+// ---------------------------------------------------------------------------
+// Master state (all under mutex)
+// ---------------------------------------------------------------------------
+
+// Read the file as the new content: a new revision with no deltas before it
+bool SyncServer::LoadMaster ()
+{
+	MasterStamp loadedStamp = ReadMasterStamp (masterPath);
+	std::string loaded;
+	if (!ReadFile (masterPath, loaded)) {
+		CS_LOG_ERROR ("ClassSync service: Cannot read %s", masterPath.c_str ());
+		return false;
+	}
+
+	std::vector<ClassificationTree> parsed;
+	ParseXmlClassifications (loaded, parsed);
+
+	content     = std::move (loaded);
+	version     = ComputeMasterVersion (content);
+	stamp       = loadedStamp;
+	modelHash   = HashClassifications (parsed);
+	revision++;
+	historyBase = revision;
+	history.clear ();
+
+	CS_LOG_INFO ("ClassSync service: Loaded %s, %d systems, version %s, revision %llu",
+				 masterName.c_str (), (int)parsed.size (), MasterVersionToString (version).c_str (),
+				 (unsigned long long)revision);
+	return true;
+}
+
+
+void SyncServer::ReloadIfChanged ()
+{
+	MasterStamp current = ReadMasterStamp (masterPath);
+	if (!current.valid || current == stamp)
+		return;
+
+	// Touched but equal content keeps the revision and its deltas
+	std::string loaded;
+	if (ReadFile (masterPath, loaded) && ComputeMasterVersion (loaded) == version) {
+		stamp = current;
+		return;
+	}
+	CS_LOG_INFO ("ClassSync service: %s was changed outside the service", masterName.c_str ());
+	LoadMaster ();
+}
+
+
+std::vector<std::string> SyncServer::StateFields (const char* name) const
+{
+	return {
+		name,
+		std::to_string ((unsigned long long)revision),
+		std::to_string ((unsigned long long)version.size),
+		std::to_string ((unsigned long long)version.hash),
+		std::to_string ((unsigned long long)modelHash)
+	};
+}
+
+
+// ---------------------------------------------------------------------------
+// Connections
+// ---------------------------------------------------------------------------
+
+void SyncServer::AcceptLoop ()
+{
+	while (!stopping) {
+		// Finished connections are joined here, the rest on stop
+		for (auto it = connections.begin (); it != connections.end (); ) {
+			if ((*it)->done) {
+				(*it)->thread.join ();
+				it = connections.erase (it);
+			} else {
+				++it;
+			}
+		}
+
+		if (!listener.WaitReadable (kSyncPollMs))
+			continue;
+
+		std::unique_ptr<Connection> connection (new Connection ());
+		if (!listener.Accept (connection->socket))
+			continue;
+		Connection& accepted = *connection;
+		connections.push_back (std::move (connection));
+		accepted.thread = std::thread ([this, &accepted] { Serve (accepted); });
+	}
+
+	for (std::unique_ptr<Connection>& connection : connections)
+		connection->thread.join ();
+	connections.clear ();
+}
+
+
+void SyncServer::Serve (Connection& connection)
+{
+	bool greeted = false;
+	while (!stopping) {
+		if (!connection.socket.WaitReadable (kSyncPollMs))
+			continue;
+
+		SyncMessage request, reply;
+		if (!ReceiveSyncMessage (connection.socket, request, kSyncTimeoutMs))
+			break;
+
+		// The first request must name the same master
+		bool keepOpen = true;
+		if (!greeted) {
+			if (request.Field (0) != "hello" || request.NumberField (1) != (std::uint64_t)kSyncProtocolVersion) {
+				reply = MakeSyncMessage ({ "error", "unsupported protocol" });
+				keepOpen = false;
+			} else if (FileNameOf (request.Field (2)) != masterName) {
+				reply = MakeSyncMessage ({ "error", "this service hosts " + masterName });
+				keepOpen = false;
+			} else {
+				std::lock_guard<std::mutex> lock (mutex);
+				reply = MakeSyncMessage ({ "hello", std::to_string (kSyncProtocolVersion), std::to_string ((unsigned long long)revision) });
+				greeted = true;
+			}
+		} else {
+			keepOpen = Handle (request, reply);
+		}
+
+		if (!SendSyncMessage (connection.socket, reply) || !keepOpen)
+			break;
+	}
+
+	connection.socket.Close ();
+	connection.done = true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Requests
+// ---------------------------------------------------------------------------
+
+bool SyncServer::Handle (const SyncMessage& request, SyncMessage& reply)
+{
+	const std::string& name = request.Field (0);
+
+	if (name == "commit") {
+		Commit (request, reply);
+		return true;
+	}
+
+	std::lock_guard<std::mutex> lock (mutex);
+	ReloadIfChanged ();
+
+	if (name == "snapshot") {
+		reply = MakeSyncMessage (StateFields ("snapshot"), content);
+		return true;
+	}
+
+	if (name == "deltas") {
+		std::uint64_t since = request.NumberField (1);
+		if (since == revision) {
+			reply = MakeSyncMessage (StateFields ("unchanged"));
+		} else if (since >= historyBase && since < revision) {
+			std::string body;
+			for (const Delta& delta : history) {
+				if (delta.revision <= since)
+					continue;
+				for (const MasterEdit& edit : delta.edits) {
+					std::vector<std::string> fields = FormatSyncEdit (edit);
+					fields.insert (fields.begin (), std::to_string ((unsigned long long)delta.revision));
+					body += JoinSyncFields (fields) + "\n";
+				}
+			}
+			reply = MakeSyncMessage (StateFields ("deltas"), body);
+		} else {
+			reply = MakeSyncMessage ({ "reset", std::to_string ((unsigned long long)revision) });
+		}
+		return true;
+	}
+
+	reply = MakeSyncMessage ({ "error", "unknown request " + name });
+	return false;
+}
+
+
+// Same steps as a file commit (XmlWriter CommitEdit) on the held content
+void SyncServer::Commit (const SyncMessage& request, SyncMessage& reply)
+{
+	MasterVersion baseVersion;
+	baseVersion.size  = request.NumberField (1);
+	baseVersion.hash  = request.NumberField (2);
+	baseVersion.valid = true;
+
+	std::vector<MasterEdit> edits;
+	std::istringstream lines (request.body);
+	std::string line;
+	while (std::getline (lines, line)) {
+		MasterEdit edit;
+		if (ParseSyncEdit (SplitSyncFields (line), 0, edit))
+			edits.push_back (edit);
+	}
+
+	std::lock_guard<std::mutex> lock (mutex);
+	CommitResult result = CommitResult::Busy;
+	{
+		CommitGuard guard (masterPath.c_str ());
+		if (guard.IsAcquired ()) {
+			ReloadIfChanged ();
+			bool rebased = baseVersion != version;
+
+			std::string updated = content;
+			result = ApplyEditsToContent (updated, rebased, edits);
+			if (result == CommitResult::Committed) {
+				if (WriteMasterFile (masterPath.c_str (), updated, content)) {
+					content = std::move (updated);
+					version = ComputeMasterVersion (content);
+					stamp   = ReadMasterStamp (masterPath);
+					if (rebased)
+						result = CommitResult::Rebased;
+				} else {
+					result = CommitResult::Failed;
+				}
+			}
+		}
+	}
+
+	// Pending edits share the outcome of the write, as in ApplyEditsToXml
+	Delta delta;
+	for (MasterEdit& edit : edits) {
+		if (result == CommitResult::Busy || result == CommitResult::Failed)
+			edit.result = result;
+		else if (edit.result == CommitResult::Committed && result != CommitResult::AlreadyApplied)
+			edit.result = result;
+		if (IsCommitSuccess (edit.result))
+			delta.edits.push_back (edit);
+	}
+
+	if (IsCommitSuccess (result)) {
+		// Clients replay the edits on their copy and check it against this
+		std::vector<ClassificationTree> parsed;
+		ParseXmlClassifications (content, parsed);
+		modelHash = HashClassifications (parsed);
+
+		revision++;
+		delta.revision = revision;
+		history.push_back (std::move (delta));
+		while (history.size () > kSyncHistoryRevisions) {
+			historyBase = history.front ().revision;
+			history.pop_front ();
+		}
+	}
+
+	std::string body;
+	for (const MasterEdit& edit : edits)
+		body += std::to_string ((int)edit.result) + "\n";
+	std::vector<std::string> fields = StateFields ("commit");
+	fields.insert (fields.begin () + 1, std::to_string ((int)result));
+	reply = MakeSyncMessage (fields, body);
+
+	CS_LOG_INFO ("ClassSync service: Commit of %d edit(s): %s, revision %llu",
+				 (int)edits.size (), CommitResultName (result), (unsigned long long)revision);
+}
@@ -0,0 +1,97 @@
+#ifndef SYNCSERVER_HPP
+#define SYNCSERVER_HPP
+
+#include "ClassificationModel.hpp"
+#include "MasterVersion.hpp"
+#include "SyncProtocol.hpp"
+#include "XmlWriter.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// Sync service: owns one master XML in memory and serves it to clients
+// (SyncProtocol.hpp)
+//
+// Commits are serialized by one mutex and, on disk, by the commit guard, so
+// sessions that still write the file directly can work alongside. Every
+// commit that changes the content is a new revision: its edits are kept
+// for the delta replies and the whole content is written back through an
+// atomic swap before the reply. A change made to the file by someone else
+// is picked up (by size and modification time) before the next request
+// and starts a new revision without deltas.
+// ---------------------------------------------------------------------------
+
+// Revisions whose edits are kept; older clients get the whole master
+static const size_t  kSyncHistoryRevisions = 1000;
+
+class SyncServer {
+public:
+	SyncServer ();
+	~SyncServer ();
+
+	// Load the master (single XML) and listen on host:port (port 0 = any free one).
+	bool  Start (const std::string& masterPath, const std::string& host, std::uint16_t port);
+	void  Stop ();
+
+	bool           IsRunning () const    { return running; }
+	std::uint16_t  GetPort () const      { return port; }
+	std::uint64_t  GetRevision ();
+
+private:
+	SyncServer (const SyncServer&) = delete;
+	SyncServer& operator= (const SyncServer&) = delete;
+
+	struct Connection {
+		SyncSocket         socket;
+		std::thread        thread;
+		std::atomic<bool>  done;
+
+		Connection () : done (false) {}
+	};
+
+	struct Delta {
+		std::uint64_t            revision;
+		std::vector<MasterEdit>  edits;
+	};
+
+	void  AcceptLoop ();
+	void  Serve (Connection& connection);
+	bool  Handle (const SyncMessage& request, SyncMessage& reply);
+
+	// Under mutex
+	bool                      LoadMaster ();
+	void                      ReloadIfChanged ();
+	std::vector<std::string>  StateFields (const char* name) const;
+	void                      Commit (const SyncMessage& request, SyncMessage& reply);
+
+	std::string                      masterPath;
+	std::string                      masterName;
+
+	std::mutex                       mutex;
+	std::string                      content;
+	MasterVersion                    version;
+	MasterStamp                      stamp;		// of the file as last read or written
+	std::uint64_t                    modelHash;	// HashClassifications of the parsed content
+	std::uint64_t                    revision;
+	std::uint64_t                    historyBase;	// oldest revision deltas can start from
+	std::deque<Delta>                history;		// revisions historyBase + 1 .. revision
+
+	SyncSocket                       listener;
+	std::thread                      acceptor;
+	std::list<std::unique_ptr<Connection>>  connections;		// acceptor thread only
+	std::atomic<bool>                running;
+	std::atomic<bool>                stopping;
+	std::uint16_t                    port;
+};
+
+
+#endif // SYNCSERVER_HPP
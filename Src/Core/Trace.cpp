@@ -0,0 +1,254 @@
+#include "Trace.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// Ring buffer
+//
+// Writers claim a slot with one fetch_add and publish it with its sequence
+// number (claim index + 1); a reader copies a slot and keeps it only if the
+// sequence is the one it expects before and after the copy.
+// ---------------------------------------------------------------------------
+
+struct TraceEvent {
+	std::atomic<std::uint64_t>  sequence;	// 0 = being written
+	const char*                 name;
+	std::int64_t                start;		// ns since the trace epoch
+	std::int64_t                duration;	// ns
+	std::uint32_t               thread;
+	char                        detail[TraceScope::kDetailSize];
+};
+
+static TraceEvent                  traceEvents[kTraceCapacity];
+static std::atomic<std::uint64_t>  traceNext (0);
+static std::atomic<bool>           traceEnabled (false);
+
+static std::atomic<std::uint32_t>  traceThreadCount (0);
+static std::mutex                  traceThreadMutex;
+static std::vector<std::pair<std::uint32_t, const char*>>  traceThreadNames;
+
+
+static std::int64_t TraceNow ()
+{
+	static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now ();
+	return std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now () - epoch).count ();
+}
+
+
+static std::uint32_t TraceThreadId ()
+{
+	thread_local std::uint32_t id = ++traceThreadCount;
+	return id;
+}
+
+
+// Copy text into a fixed buffer without cutting a UTF-8 sequence
+static void CopyDetail (char* target, const char* text, size_t length)
+{
+	if (length >= TraceScope::kDetailSize) {
+		length = TraceScope::kDetailSize - 1;
+		while (length > 0 && ((unsigned char)text[length] & 0xC0) == 0x80)
+			length--;
+	}
+	std::memcpy (target, text, length);
+	target[length] = '\0';
+}
+
+
+// ---------------------------------------------------------------------------
+// Control
+// ---------------------------------------------------------------------------
+
+void SetTraceEnabled (bool enabled)
+{
+	TraceNow ();	// fix the epoch before the first span
+	traceEnabled.store (enabled, std::memory_order_relaxed);
+}
+
+
+bool IsTraceEnabled ()
+{
+	return traceEnabled.load (std::memory_order_relaxed);
+}
+
+
+void SetTraceThreadName (const char* name)
+{
+	std::uint32_t thread = TraceThreadId ();
+	std::lock_guard<std::mutex> lock (traceThreadMutex);
+	for (auto& entry : traceThreadNames) {
+		if (entry.first == thread) {
+			entry.second = name;
+			return;
+		}
+	}
+	traceThreadNames.emplace_back (thread, name);
+}
+
+
+void ClearTrace ()
+{
+	for (TraceEvent& event : traceEvents)
+		event.sequence.store (0, std::memory_order_relaxed);
+	traceNext.store (0, std::memory_order_release);
+}
+
+
+// ---------------------------------------------------------------------------
+// Spans
+// ---------------------------------------------------------------------------
+
+TraceScope::TraceScope (const char* name) :
+	name (IsTraceEnabled () ? name : nullptr),
+	start (0)
+{
+	detail[0] = '\0';
+	if (this->name != nullptr)
+		start = TraceNow ();
+}
+
+
+TraceScope::TraceScope (const char* name, const std::string& detail) :
+	TraceScope (name)
+{
+	SetDetail (detail);
+}
+
+
+TraceScope::~TraceScope ()
+{
+	End ();
+}
+
+
+void TraceScope::SetDetail (const std::string& text)
+{
+	if (name != nullptr)
+		CopyDetail (detail, text.data (), text.size ());
+}
+
+
+void TraceScope::End ()
+{
+	if (name == nullptr)
+		return;
+
+	std::int64_t end = TraceNow ();
+	std::uint64_t index = traceNext.fetch_add (1, std::memory_order_relaxed);
+	TraceEvent& event = traceEvents[index % kTraceCapacity];
+
+	event.sequence.store (0, std::memory_order_relaxed);
+	std::atomic_thread_fence (std::memory_order_release);
+	event.name     = name;
+	event.start    = start;
+	event.duration = end - start;
+	event.thread   = TraceThreadId ();
+	std::memcpy (event.detail, detail, sizeof (detail));
+	event.sequence.store (index + 1, std::memory_order_release);
+	name = nullptr;
+}
+
+
+// ---------------------------------------------------------------------------
+// Chrome trace JSON ("X" complete events, "M" thread names; times in us)
+// ---------------------------------------------------------------------------
+
+static void AppendJsonString (std::string& json, const char* text)
+{
+	json += '"';
+	for (const char* p = text; *p != '\0'; p++) {
+		unsigned char c = (unsigned char)*p;
+		if (c == '"' || c == '\\') {
+			json += '\\';
+			json += *p;
+		} else if (c < 0x20) {
+			char escaped[8];
+			std::snprintf (escaped, sizeof (escaped), "\\u%04x", c);
+			json += escaped;
+		} else {
+			json += *p;
+		}
+	}
+	json += '"';
+}
+
+
+static void AppendMicroseconds (std::string& json, std::int64_t ns)
+{
+	char buffer[32];
+	std::snprintf (buffer, sizeof (buffer), "%lld.%03lld", (long long)(ns / 1000), (long long)(ns % 1000));
+	json += buffer;
+}
+
+
+std::string FormatTraceJson ()
+{
+	std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+
+	{
+		std::lock_guard<std::mutex> lock (traceThreadMutex);
+		for (const auto& entry : traceThreadNames) {
+			json += first ? "" : ",\n";
+			json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string (entry.first) + ",\"args\":{\"name\":";
+			AppendJsonString (json, entry.second);
+			json += "}}";
+			first = false;
+		}
+	}
+
+	std::uint64_t next  = traceNext.load (std::memory_order_acquire);
+	std::uint64_t begin = next > kTraceCapacity ? next - kTraceCapacity : 0;
+	for (std::uint64_t index = begin; index < next; index++) {
+		const TraceEvent& slot = traceEvents[index % kTraceCapacity];
+		if (slot.sequence.load (std::memory_order_acquire) != index + 1)
+			continue;
+
+		const char*   name     = slot.name;
+		std::int64_t  start    = slot.start;
+		std::int64_t  duration = slot.duration;
+		std::uint32_t thread   = slot.thread;
+		char          detail[TraceScope::kDetailSize];
+		std::memcpy (detail, slot.detail, sizeof (detail));
+		detail[sizeof (detail) - 1] = '\0';
+		std::atomic_thread_fence (std::memory_order_acquire);
+		if (slot.sequence.load (std::memory_order_relaxed) != index + 1)
+			continue;
+
+		json += first ? "" : ",\n";
+		json += "{\"name\":";
+		AppendJsonString (json, name);
+		json += ",\"cat\":\"classsync\",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string (thread) + ",\"ts\":";
+		AppendMicroseconds (json, start);
+		json += ",\"dur\":";
+		AppendMicroseconds (json, duration);
+		if (detail[0] != '\0') {
+			json += ",\"args\":{\"detail\":";
+			AppendJsonString (json, detail);
+			json += "}";
+		}
+		json += "}";
+		first = false;
+	}
+
+	json += "\n]}\n";
+	return json;
+}
+
+
+bool WriteTraceJson (const std::string& path)
+{
+	std::string json = FormatTraceJson ();
+	std::ofstream file (path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open ())
+		return false;
+	file.write (json.data (), json.size ());
+	return file.good ();
+}
@@ -0,0 +1,64 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <cstdint>
+#include <string>
+
+
+// ---------------------------------------------------------------------------
+// Scoped trace spans for the refresh pipeline
+//
+// A TraceScope records one complete span (name, optional detail, start,
+// duration, thread) into a fixed-size ring buffer when it ends; the oldest
+// spans are overwritten. Recording takes no lock and allocates nothing, and
+// a disabled trace costs one atomic load per scope. FormatTraceJson produces
+// Chrome trace JSON (chrome://tracing, ui.perfetto.dev). Tracing is off
+// until SetTraceEnabled (true).
+// ---------------------------------------------------------------------------
+
+// Spans kept in the ring buffer
+static const size_t kTraceCapacity = 16384;
+
+void  SetTraceEnabled (bool enabled);
+bool  IsTraceEnabled ();
+
+// Track name of the calling thread in the dump ("UI", "refresh worker").
+void  SetTraceThreadName (const char* name);
+
+// Drop all recorded spans.
+void  ClearTrace ();
+
+// Recorded spans, oldest first.
+std::string  FormatTraceJson ();
+
+// False if the file cannot be written.
+bool  WriteTraceJson (const std::string& path);
+
+
+class TraceScope {
+public:
+	// name must outlive the trace (a string literal); detail is copied and
+	// cut to kDetailSize - 1 bytes
+	explicit TraceScope (const char* name);
+	TraceScope (const char* name, const std::string& detail);
+	~TraceScope ();
+
+	// Detail known only once the span is running (e.g. a parsed name).
+	void  SetDetail (const std::string& text);
+
+	// Record the span now instead of at the end of the scope.
+	void  End ();
+
+	static const size_t kDetailSize = 48;
+
+private:
+	TraceScope (const TraceScope&) = delete;
+	TraceScope& operator= (const TraceScope&) = delete;
+
+	const char*    name;		// nullptr while tracing is off
+	std::int64_t   start;		// nanoseconds since the trace epoch
+	char           detail[kDetailSize];
+};
+
+
+#endif // TRACE_HPP
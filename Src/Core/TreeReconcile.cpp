@@ -0,0 +1,156 @@
+#include "TreeReconcile.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+
+
+// ---------------------------------------------------------------------------
+// Subtree hashes (FNV-1a 64 over the node fields and child hashes)
+// ---------------------------------------------------------------------------
+
+static const std::uint64_t kFnvOffset = 14695981039346656037ULL;
+static const std::uint64_t kFnvPrime  = 1099511628211ULL;
+
+static void HashBytes (std::uint64_t& h, const void* data, size_t size)
+{
+	const unsigned char* p = static_cast<const unsigned char*> (data);
+	for (size_t i = 0; i < size; i++) {
+		h ^= p[i];
+		h *= kFnvPrime;
+	}
+}
+
+
+void ComputeViewHashes (ViewNode& node)
+{
+	std::uint64_t h = kFnvOffset;
+	HashBytes (h, node.key.data (), node.key.size ());
+	HashBytes (h, "\0", 1);
+	HashBytes (h, node.text.data (), node.text.size ());
+	HashBytes (h, &node.color, sizeof (node.color));
+	HashBytes (h, &node.tag, sizeof (node.tag));
+	unsigned char expand = node.expand ? 1 : 0;
+	HashBytes (h, &expand, 1);
+
+	for (ViewNode& child : node.children) {
+		ComputeViewHashes (child);
+		HashBytes (h, &child.hash, sizeof (child.hash));
+	}
+	node.hash = h;
+}
+
+
+// ---------------------------------------------------------------------------
+// Reconciliation
+// ---------------------------------------------------------------------------
+
+static void AppendSubtree (ViewNode& node, const ViewNode& parent, const ViewNode* after,
+						   std::vector<TreeMutation>& mutations, ReconcileStats& stats)
+{
+	mutations.push_back ({ TreeMutationKind::Append, &node, &parent, after, kViewNoItem });
+	stats.appended++;
+
+	const ViewNode* prev = nullptr;
+	for (ViewNode& child : node.children) {
+		AppendSubtree (child, node, prev, mutations, stats);
+		prev = &child;
+	}
+
+	if (node.expand) {
+		mutations.push_back ({ TreeMutationKind::Expand, &node, nullptr, nullptr, kViewNoItem });
+		stats.expanded++;
+	}
+}
+
+
+static void ReconcileNode (ViewNode& current, ViewNode& next,
+						   std::vector<TreeMutation>& mutations, ReconcileStats& stats);
+
+
+static void ReconcileChildren (ViewNode& current, ViewNode& next,
+							   std::vector<TreeMutation>& mutations, ReconcileStats& stats)
+{
+	std::unordered_map<std::string, size_t> oldByKey;
+	oldByKey.reserve (current.children.size ());
+	for (size_t i = 0; i < current.children.size (); i++)
+		oldByKey.emplace (current.children[i].key, i);
+
+	// Match by key while the old order is preserved; a node that moved
+	// before an already matched sibling is re-created instead
+	std::vector<size_t> match (next.children.size (), SIZE_MAX);
+	std::vector<bool>   kept (current.children.size (), false);
+	size_t lastOld = 0;
+	bool   any     = false;
+	for (size_t j = 0; j < next.children.size (); j++) {
+		auto it = oldByKey.find (next.children[j].key);
+		if (it == oldByKey.end () || (any && it->second <= lastOld))
+			continue;
+		match[j]         = it->second;
+		kept[it->second] = true;
+		lastOld          = it->second;
+		any              = true;
+	}
+
+	for (size_t i = 0; i < current.children.size (); i++) {
+		if (!kept[i]) {
+			mutations.push_back ({ TreeMutationKind::Delete, nullptr, nullptr, nullptr, current.children[i].item });
+			stats.deleted++;
+		}
+	}
+
+	const ViewNode* prev = nullptr;
+	for (size_t j = 0; j < next.children.size (); j++) {
+		ViewNode& child = next.children[j];
+		if (match[j] == SIZE_MAX)
+			AppendSubtree (child, next, prev, mutations, stats);
+		else
+			ReconcileNode (current.children[match[j]], child, mutations, stats);
+		prev = &child;
+	}
+}
+
+
+static void ReconcileNode (ViewNode& current, ViewNode& next,
+						   std::vector<TreeMutation>& mutations, ReconcileStats& stats)
+{
+	next.item = current.item;
+
+	if (current.hash == next.hash) {
+		// Identical subtree: keep the displayed nodes (they carry the items)
+		next.children = std::move (current.children);
+		stats.subtreesReused++;
+		return;
+	}
+
+	if (current.text != next.text) {
+		mutations.push_back ({ TreeMutationKind::SetText, &next, nullptr, nullptr, kViewNoItem });
+		stats.textChanged++;
+	}
+	if (current.color != next.color) {
+		mutations.push_back ({ TreeMutationKind::SetColor, &next, nullptr, nullptr, kViewNoItem });
+		stats.colorChanged++;
+	}
+
+	ReconcileChildren (current, next, mutations, stats);
+
+	// Expand after the children exist; collapsing is left to the user
+	if (next.expand && !current.expand) {
+		mutations.push_back ({ TreeMutationKind::Expand, &next, nullptr, nullptr, kViewNoItem });
+		stats.expanded++;
+	}
+}
+
+
+void ReconcileViews (ViewNode& current,
+					 ViewNode& next,
+					 std::vector<TreeMutation>& mutations,
+					 ReconcileStats& stats)
+{
+	stats = ReconcileStats ();
+	ComputeViewHashes (next);
+
+	// The root is the tree itself: never created, deleted or relabeled
+	std::int32_t rootItem = next.item;
+	ReconcileChildren (current, next, mutations, stats);
+	next.item = rootItem;
+}
@@ -0,0 +1,74 @@
+#ifndef TREERECONCILE_HPP
+#define TREERECONCILE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// UI-independent model of a tree view. The palette builds a new model on
+// every refresh and reconciles it against the displayed one; only the
+// differences become tree view calls, so unchanged items keep their
+// expansion state and the scroll position is preserved.
+// ---------------------------------------------------------------------------
+
+static const std::uint32_t kViewDefaultColor = 0xFFFFFFFF;
+static const std::int32_t  kViewNoItem       = -1;
+
+struct ViewNode {
+	std::string            key;			// stable among siblings (e.g. system + ID)
+	std::string            text;		// UTF-8 label
+	std::uint32_t          color;		// 0xRRGGBB or kViewDefaultColor
+	std::int32_t           tag;			// caller data (e.g. diff index), part of the hash
+	bool                   expand;		// expand when created or when this turns true
+	std::vector<ViewNode>  children;
+
+	// Filled by reconciliation
+	std::int32_t           item;		// tree view item, kViewNoItem until created
+	std::uint64_t          hash;		// hash of this node and its whole subtree
+
+	ViewNode () : color (kViewDefaultColor), tag (-1), expand (false), item (kViewNoItem), hash (0) {}
+};
+
+
+enum class TreeMutationKind {
+	Append,		// create node as a child of parent, after sibling (nullptr = first)
+	Delete,		// delete item (and its subtree)
+	SetText,
+	SetColor,
+	Expand
+};
+
+struct TreeMutation {
+	TreeMutationKind  kind;
+	ViewNode*         node;		// target in the new model (Append: set node->item)
+	const ViewNode*   parent;	// Append only
+	const ViewNode*   after;	// Append only
+	std::int32_t      item;		// Delete only
+};
+
+struct ReconcileStats {
+	unsigned  appended;
+	unsigned  deleted;
+	unsigned  textChanged;
+	unsigned  colorChanged;
+	unsigned  expanded;
+	unsigned  subtreesReused;	// matched by hash, no calls and no descent
+};
+
+
+// Compute ViewNode::hash bottom-up for a freshly built model.
+void  ComputeViewHashes (ViewNode& root);
+
+// Diff the displayed model (items assigned) against the next model.
+// next.item must be the root item. Items and unchanged subtrees are moved
+// from current into next; mutations refer to nodes of next and must be
+// applied in order. current is left in an unspecified state.
+void  ReconcileViews (ViewNode& current,
+					  ViewNode& next,
+					  std::vector<TreeMutation>& mutations,
+					  ReconcileStats& stats);
+
+
+#endif // TREERECONCILE_HPP
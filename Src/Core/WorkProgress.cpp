@@ -0,0 +1,30 @@
+#include "WorkProgress.hpp"
+#include "Report.hpp"
+
+#include <cstdarg>
+#include <cstdio>
+
+
+// ---------------------------------------------------------------------------
+// Log a line; show it now (UI thread) or hand it to the progress sink (worker)
+// ---------------------------------------------------------------------------
+
+void ReportWork (WorkProgress* progress, LogLevel level, const char* format, ...)
+{
+	if (!IsLogged (level))
+		return;
+
+	char line[1024];
+
+	va_list args;
+	va_start (args, format);
+	vsnprintf (line, sizeof (line), format, args);
+	va_end (args);
+
+	if (!RecordLogLine (level, line))
+		return;
+	if (progress != nullptr)
+		progress->Note (line);
+	else
+		WriteReportLine (line);
+}
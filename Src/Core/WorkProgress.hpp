@@ -0,0 +1,36 @@
+#ifndef WORKPROGRESS_HPP
+#define WORKPROGRESS_HPP
+
+#include "Log.hpp"
+
+#include <cstdint>
+#include <string>
+
+
+// ---------------------------------------------------------------------------
+// Progress and cooperative cancellation for work running off the UI thread
+//
+// The master readers and the diff take an optional WorkProgress*. With one
+// they do not report directly (lines go to Note, to be written on the UI
+// thread) and call Step regularly. Step returns false once the work has been
+// superseded; the callee then returns early and its result must be dropped.
+// ---------------------------------------------------------------------------
+
+class WorkProgress {
+public:
+	virtual ~WorkProgress () {}
+
+	// done of total units of the current stage; false = stop now
+	virtual bool  Step (std::uint64_t done, std::uint64_t total) = 0;
+
+	// A line for the session report
+	virtual void  Note (const std::string& line) = 0;
+};
+
+
+// Log a line at a level; a line that is shown goes to the report without
+// progress and to Note with one.
+void  ReportWork (WorkProgress* progress, LogLevel level, const char* format, ...);
+
+
+#endif // WORKPROGRESS_HPP
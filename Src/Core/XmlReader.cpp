@@ -1,8 +1,14 @@
 #include "XmlReader.hpp"
+#include "Counters.hpp"
+#include "Trace.hpp"
 
 #include <fstream>
 #include <string>
-#include <sstream>
+#include <vector>
+
+
+// Read buffer size; each chunk is one progress step
+static const size_t kReadChunkSize = 256 * 1024;
 
 
 // ---------------------------------------------------------------------------
@@ -56,23 +62,11 @@ static size_t FindMatchingClose (const std::string& xml, const std::string& tag,
 }
 
 
-// ---------------------------------------------------------------------------
-// Convert UTF-8 std::string to GS::UniString
-// ---------------------------------------------------------------------------
-
-static GS::UniString ToUniStr (const std::string& s)
-{
-	if (s.empty ())
-		return GS::UniString ();
-	return GS::UniString (s.c_str (), CC_UTF8);
-}
-
-
 // ---------------------------------------------------------------------------
 // Recursively parse <Item> elements
 // ---------------------------------------------------------------------------
 
-static void ParseItems (const std::string& xml, GS::Array<ClassificationNode>& result)
+static void ParseItems (const std::string& xml, std::vector<ClassificationNode>& result)
 {
 	std::string openItem = "<Item>";
 	size_t pos = 0;
@@ -96,9 +90,9 @@ static void ParseItems (const std::string& xml, GS::Array<ClassificationNode>& r
 			: itemXml;
 
 		ClassificationNode node;
-		node.id          = ToUniStr (ExtractTag (headerPart, "ID"));
-		node.name        = ToUniStr (ExtractTag (headerPart, "Name"));
-		node.description = ToUniStr (ExtractTag (headerPart, "Description"));
+		node.id          = ExtractTag (headerPart, "ID");
+		node.name        = ExtractTag (headerPart, "Name");
+		node.description = ExtractTag (headerPart, "Description");
 
 		// Parse children recursively (must use nesting-aware search
 		// because Children tags are nested: Item/Children/Item/Children/...)
@@ -114,34 +108,38 @@ static void ParseItems (const std::string& xml, GS::Array<ClassificationNode>& r
 			}
 		}
 
-		result.Push (node);
+		result.push_back (std::move (node));
 		pos = end + 7;  // skip past "</Item>"
 	}
 }
 
 
 // ---------------------------------------------------------------------------
-// Read classifications from an ArchiCAD XML file
+// Public entry points for callers that slice the XML themselves (shards)
 // ---------------------------------------------------------------------------
 
-GS::Array<ClassificationTree> ReadXmlClassifications (const char* filePath)
+void ParseXmlItems (const std::string& itemsXml, std::vector<ClassificationNode>& result)
 {
-	GS::Array<ClassificationTree> result;
+	ParseItems (itemsXml, result);
+}
 
-	// Read file
-	std::ifstream file (filePath, std::ios::binary);
-	if (!file.is_open ()) {
-		ACAPI_WriteReport ("ClassSync: Cannot open XML file: %s", false, filePath);
-		return result;
-	}
 
-	std::ostringstream ss;
-	ss << file.rdbuf ();
-	std::string content = ss.str ();
-	file.close ();
+void ParseXmlSystemHeader (const std::string& headerXml, ClassificationTree& tree)
+{
+	tree.systemName = ExtractTag (headerXml, "Name");
+	tree.version    = ExtractTag (headerXml, "EditionVersion");
+	tree.systemGuid = ItemGuid ();
+}
 
-	ACAPI_WriteReport ("ClassSync: Read XML file, %d bytes", false, (int)content.size ());
 
+// ---------------------------------------------------------------------------
+// Helper: parse every <System> of a master held in memory. Steps run from
+// stepBase to stepBase + content size; false if progress cancelled.
+// ---------------------------------------------------------------------------
+
+static bool ParseSystems (const std::string& content, std::vector<ClassificationTree>& result,
+						  WorkProgress* progress, std::uint64_t stepBase, std::uint64_t total)
+{
 	// Find all <System> blocks
 	std::string openSystem  = "<System>";
 	std::string closeSystem = "</System>";
@@ -153,12 +151,13 @@ GS::Array<ClassificationTree> ReadXmlClassifications (const char* filePath)
 			break;
 
 		size_t sysContentStart = sysStart + openSystem.size ();
-		auto sysEnd = content.find (closeSystem, sysContentStart);
+		auto sysEnd = FindMatchingClose (content, "System", sysContentStart);
 		if (sysEnd == std::string::npos)
 			break;
 
 		std::string sysXml = content.substr (sysContentStart, sysEnd - sysContentStart);
 
+		TraceScope systemTrace ("parse system");
 		ClassificationTree tree;
 
 		// Extract system name and version from content before <Items>
@@ -167,22 +166,100 @@ GS::Array<ClassificationTree> ReadXmlClassifications (const char* filePath)
 			? sysXml.substr (0, itemsPos)
 			: sysXml;
 
-		tree.systemName = ToUniStr (ExtractTag (sysHeader, "Name"));
-		tree.version    = ToUniStr (ExtractTag (sysHeader, "EditionVersion"));
+		ParseXmlSystemHeader (sysHeader, tree);
+		systemTrace.SetDetail (tree.systemName);
 
 		// Parse items
 		std::string itemsXml = ExtractTag (sysXml, "Items");
 		if (!itemsXml.empty ())
 			ParseItems (itemsXml, tree.rootItems);
 
-		ACAPI_WriteReport ("ClassSync: Parsed system '%s' v%s, %d root items", false,
-			ExtractTag (sysHeader, "Name").c_str (),
-			ExtractTag (sysHeader, "EditionVersion").c_str (),
-			(int)tree.rootItems.GetSize ());
+		if (IsLogged (LogLevel::Debug))
+			ReportWork (progress, LogLevel::Debug, "ClassSync: Parsed system '%s' v%s, %d root items",
+				ExtractTag (sysHeader, "Name").c_str (),
+				ExtractTag (sysHeader, "EditionVersion").c_str (),
+				(int)tree.rootItems.size ());
 
-		result.Push (tree);
+		result.push_back (std::move (tree));
 		pos = sysEnd + closeSystem.size ();
+
+		if (progress != nullptr && !progress->Step (stepBase + pos, total))
+			return false;
+	}
+
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Read classifications from an ArchiCAD XML file
+// ---------------------------------------------------------------------------
+
+std::vector<ClassificationTree> ReadXmlClassifications (const char* filePath,
+														MasterVersion* version,
+														WorkProgress* progress,
+														std::string* contentOut)
+{
+	TraceScope trace ("ReadXmlClassifications");
+	std::vector<ClassificationTree> result;
+
+	// Read file (in chunks, so a slow share shows progress and can be cancelled)
+	TraceScope readTrace ("read master file");
+	std::ifstream file (filePath, std::ios::binary);
+	if (!file.is_open ()) {
+		ReportWork (progress, LogLevel::Warning, "ClassSync: Cannot open XML file: %s", filePath);
+		return result;
 	}
 
+	std::string content;
+	file.seekg (0, std::ios::end);
+	std::streamoff fileSize = file.tellg ();
+	file.seekg (0, std::ios::beg);
+	if (fileSize > 0)
+		content.reserve ((size_t)fileSize);
+	std::uint64_t total = (fileSize > 0 ? (std::uint64_t)fileSize : 0) * 2;
+
+	std::vector<char> chunk (kReadChunkSize);
+	while (file.read (chunk.data (), chunk.size ()) || file.gcount () > 0) {
+		content.append (chunk.data (), (size_t)file.gcount ());
+		if (progress != nullptr && !progress->Step (content.size (), total))
+			return result;
+	}
+	file.close ();
+	readTrace.End ();
+	AddCounter (Counter::MasterReads);
+	AddCounter (Counter::MasterBytesRead, content.size ());
+
+	// A file that grew while being read: keep the steps below total
+	total = (std::uint64_t)content.size () * 2;
+
+	if (version != nullptr) {
+		TraceScope hashTrace ("hash master");
+		*version = ComputeMasterVersion (content);
+	}
+
+	ReportWork (progress, LogLevel::Debug, "ClassSync: Read XML file, %d bytes", (int)content.size ());
+
+	if (!ParseSystems (content, result, progress, content.size (), total))
+		return result;
+
+	if (progress != nullptr)
+		progress->Step (total, total);
+
+	if (contentOut != nullptr)
+		*contentOut = std::move (content);
 	return result;
 }
+
+
+// ---------------------------------------------------------------------------
+// Parse classifications from master content already in memory
+// ---------------------------------------------------------------------------
+
+bool ParseXmlClassifications (const std::string& content,
+							  std::vector<ClassificationTree>& result,
+							  WorkProgress* progress)
+{
+	result.clear ();
+	return ParseSystems (content, result, progress, 0, content.size ());
+}
@@ -0,0 +1,34 @@
+#ifndef XMLREADER_HPP
+#define XMLREADER_HPP
+
+#include "ClassificationModel.hpp"
+#include "MasterVersion.hpp"
+#include "WorkProgress.hpp"
+
+#include <string>
+
+// Parse all systems from the XML. If version is given, it receives the
+// content version of the bytes that were parsed (for optimistic commits).
+// With progress, steps count bytes read and then bytes parsed (total is
+// twice the file size) and lines go to Note instead of the report.
+// content, if given, receives the bytes that were parsed.
+std::vector<ClassificationTree>  ReadXmlClassifications (const char* filePath,
+														 MasterVersion* version = nullptr,
+														 WorkProgress* progress = nullptr,
+														 std::string* content = nullptr);
+
+// Parse all systems from master content already in memory (e.g. received
+// from the sync service). Steps count bytes parsed; with progress, lines go
+// to Note as above. False if progress stopped the parse.
+bool  ParseXmlClassifications (const std::string& content,
+							   std::vector<ClassificationTree>& result,
+							   WorkProgress* progress = nullptr);
+
+// Parse a sequence of sibling <Item> blocks (e.g. the body of <Items>, or one
+// sharded top-level branch). Does not report - safe to call from a worker.
+void  ParseXmlItems (const std::string& itemsXml, std::vector<ClassificationNode>& result);
+
+// Fill systemName/version from the part of a <System> before <Items>.
+void  ParseXmlSystemHeader (const std::string& headerXml, ClassificationTree& tree);
+
+#endif // XMLREADER_HPP
@@ -0,0 +1,603 @@
+#include "XmlWriter.hpp"
+#include "FileLock.hpp"
+#include "FileSystem.hpp"
+#include "ItemIndex.hpp"
+#include "ChangeLog.hpp"
+#include "Log.hpp"
+#include "MasterStore.hpp"
+#include "Trace.hpp"
+
+#include <string>
+#include <unordered_set>
+
+
+// ---------------------------------------------------------------------------
+// Helper: escape XML special characters
+// ---------------------------------------------------------------------------
+
+static std::string EscapeXml (const std::string& s)
+{
+	return s;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: detect line ending style used in the file
+// ---------------------------------------------------------------------------
+
+static std::string DetectEol (const std::string& xml)
+{
+	auto pos = xml.find ('\n');
+	if (pos != std::string::npos && pos > 0 && xml[pos - 1] == '\r')
+		return "\r\n";
+	return "\n";
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: detect indentation at a given position (count tabs/spaces before tag)
+// ---------------------------------------------------------------------------
+
+static std::string DetectIndent (const std::string& xml, size_t tagPos)
+{
+	std::string indent;
+	size_t pos = tagPos;
+	while (pos > 0) {
+		pos--;
+		if (xml[pos] == '\t')
+			indent = "\t" + indent;
+		else if (xml[pos] == ' ')
+			indent = " " + indent;
+		else
+			break;
+	}
+	return indent;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: find start of a line (position right after the preceding newline)
+// ---------------------------------------------------------------------------
+
+static size_t FindLineStart (const std::string& xml, size_t pos)
+{
+	while (pos > 0 && xml[pos - 1] != '\n')
+		pos--;
+	return pos;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: nesting-aware search for a closing tag
+// Finds the </tag> that matches the <tag> at openPos, skipping nested pairs.
+// ---------------------------------------------------------------------------
+
+static size_t FindMatchingClose (const std::string& xml,
+								  const std::string& openTag,
+								  const std::string& closeTag,
+								  size_t openPos)
+{
+	int depth = 1;
+	size_t pos = openPos + openTag.size ();
+
+	while (depth > 0 && pos < xml.size ()) {
+		auto nextOpen  = xml.find (openTag, pos);
+		auto nextClose = xml.find (closeTag, pos);
+
+		if (nextClose == std::string::npos)
+			return std::string::npos;
+
+		if (nextOpen != std::string::npos && nextOpen < nextClose) {
+			depth++;
+			pos = nextOpen + openTag.size ();
+		} else {
+			depth--;
+			if (depth == 0)
+				return nextClose;
+			pos = nextClose + closeTag.size ();
+		}
+	}
+	return std::string::npos;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: find sorted insertion position among direct child <Item> elements.
+// Scans direct children between regionStart..regionEnd, extracts each <ID>,
+// and returns the line-start position where a new item with newId should go
+// to maintain the natural ID order (CompareItemIds: "9" before "10").
+// ---------------------------------------------------------------------------
+
+static size_t FindSortedInsertPos (const std::string& xml,
+								   size_t regionStart,
+								   size_t regionEnd,
+								   const std::string& newId)
+{
+	// Default: insert before the closing tag (end of list)
+	size_t insertPos = FindLineStart (xml, regionEnd);
+	size_t pos = regionStart;
+
+	while (pos < regionEnd) {
+		auto itemOpen = xml.find ("<Item>", pos);
+		if (itemOpen == std::string::npos || itemOpen >= regionEnd)
+			break;
+
+		// Extract <ID> from this direct child
+		auto idOpen  = xml.find ("<ID>", itemOpen);
+		auto idClose = xml.find ("</ID>", itemOpen);
+		if (idOpen == std::string::npos || idClose == std::string::npos)
+			break;
+
+		std::string childId = xml.substr (idOpen + 4, idClose - idOpen - 4);
+
+		// If this child's ID sorts after newId, insert before it
+		if (CompareItemIds (childId, newId) > 0) {
+			insertPos = FindLineStart (xml, itemOpen);
+			break;
+		}
+
+		// Skip past entire <Item>...</Item> (nesting-aware) to next sibling
+		auto itemClose = FindMatchingClose (xml, "<Item>", "</Item>", itemOpen);
+		if (itemClose == std::string::npos)
+			break;
+		pos = itemClose + 7;  // strlen("</Item>")
+	}
+
+	return insertPos;
+}
+
+
+// ---------------------------------------------------------------------------
+// Build an <Item> XML block with correct line endings
+// ---------------------------------------------------------------------------
+
+static std::string BuildItemXml (const ClassificationNode& node,
+								 const std::string& indent,
+								 const std::string& eol)
+{
+	std::string id   = EscapeXml (node.id);
+	std::string name = EscapeXml (node.name);
+	std::string desc = EscapeXml (node.description);
+
+	std::string xml;
+	xml += indent + "<Item>" + eol;
+	xml += indent + "\t<ID>" + id + "</ID>" + eol;
+	xml += indent + "\t<Name>" + name + "</Name>" + eol;
+	if (desc.empty ())
+		xml += indent + "\t<Description/>" + eol;
+	else
+		xml += indent + "\t<Description>" + desc + "</Description>" + eol;
+	xml += indent + "\t<Children/>" + eol;
+	xml += indent + "</Item>" + eol;
+	return xml;
+}
+
+
+// ---------------------------------------------------------------------------
+// Public wrapper for callers that create item blocks outside a master file
+// ---------------------------------------------------------------------------
+
+std::string FormatItemXml (const ClassificationNode& node,
+						   const std::string& indent,
+						   const std::string& eol)
+{
+	return BuildItemXml (node, indent, eol);
+}
+
+
+// ---------------------------------------------------------------------------
+// Helpers: mark the selected items and their ancestors, then write only the
+// marked items, depth-first (returns the number of items written)
+// ---------------------------------------------------------------------------
+
+static bool MarkFragmentItems (const std::vector<ClassificationNode>& nodes,
+							   const std::unordered_set<std::string>& selected,
+							   std::unordered_set<std::string>& included)
+{
+	bool any = false;
+	for (const ClassificationNode& node : nodes) {
+		bool below = MarkFragmentItems (node.children, selected, included);
+		if (below || selected.count (node.id) != 0) {
+			included.insert (node.id);
+			any = true;
+		}
+	}
+	return any;
+}
+
+
+static size_t AppendFragmentItems (std::string& xml,
+								   const std::vector<ClassificationNode>& nodes,
+								   const std::unordered_set<std::string>& included,
+								   const std::string& indent,
+								   const std::string& eol)
+{
+	size_t written = 0;
+	for (const ClassificationNode& node : nodes) {
+		if (included.count (node.id) == 0)
+			continue;
+
+		std::string desc = EscapeXml (node.description);
+
+		xml += indent + "<Item>" + eol;
+		xml += indent + "\t<ID>" + EscapeXml (node.id) + "</ID>" + eol;
+		xml += indent + "\t<Name>" + EscapeXml (node.name) + "</Name>" + eol;
+		if (desc.empty ())
+			xml += indent + "\t<Description/>" + eol;
+		else
+			xml += indent + "\t<Description>" + desc + "</Description>" + eol;
+
+		std::string children;
+		size_t childCount = AppendFragmentItems (children, node.children, included, indent + "\t\t", eol);
+		if (childCount == 0) {
+			xml += indent + "\t<Children/>" + eol;
+		} else {
+			xml += indent + "\t<Children>" + eol + children;
+			xml += indent + "\t</Children>" + eol;
+		}
+		xml += indent + "</Item>" + eol;
+
+		written += 1 + childCount;
+	}
+	return written;
+}
+
+
+// ---------------------------------------------------------------------------
+// Minimal classification document for a selective import
+// ---------------------------------------------------------------------------
+
+size_t FormatImportFragment (const std::vector<ClassificationTree>& trees,
+							 const std::vector<std::string>& itemIds,
+							 std::string& xml)
+{
+	const std::string eol = "\n";
+
+	std::unordered_set<std::string> selected (itemIds.begin (), itemIds.end ());
+
+	xml.clear ();
+	xml += "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\" ?>" + eol;
+	xml += "<BuildingInformation>" + eol;
+	xml += "\t<Classification>" + eol;
+
+	size_t written = 0;
+	for (const ClassificationTree& tree : trees) {
+		std::unordered_set<std::string> included;
+		if (!MarkFragmentItems (tree.rootItems, selected, included))
+			continue;
+
+		xml += "\t\t<System>" + eol;
+		xml += "\t\t\t<Name>" + EscapeXml (tree.systemName) + "</Name>" + eol;
+		xml += "\t\t\t<EditionVersion>" + EscapeXml (tree.version) + "</EditionVersion>" + eol;
+		xml += "\t\t\t<Description/>" + eol;
+		xml += "\t\t\t<Source/>" + eol;
+		xml += "\t\t\t<Items>" + eol;
+		written += AppendFragmentItems (xml, tree.rootItems, included, "\t\t\t\t", eol);
+		xml += "\t\t\t</Items>" + eol;
+		xml += "\t\t</System>" + eol;
+	}
+
+	xml += "\t</Classification>" + eol;
+	xml += "</BuildingInformation>" + eol;
+	return written;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: locate the <Name> text of the item with the given ID.
+// Returns false if the ID is not present.
+// ---------------------------------------------------------------------------
+
+static bool FindItemName (const std::string& xml, const std::string& id,
+						  size_t& nameStart, size_t& nameEnd)
+{
+	std::string idTag = "<ID>" + id + "</ID>";
+
+	auto idPos = xml.find (idTag);
+	if (idPos == std::string::npos)
+		return false;
+
+	// Find <Name>...</Name> after the ID tag
+	auto nameOpen = xml.find ("<Name>", idPos);
+	auto nameClose = xml.find ("</Name>", idPos);
+	if (nameOpen == std::string::npos || nameClose == std::string::npos)
+		return false;
+
+	nameStart = nameOpen + 6;  // strlen("<Name>")
+	nameEnd   = nameClose;
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: insert an <Item> block under parentId (or the system root) in-place
+// ---------------------------------------------------------------------------
+
+static bool InsertItemBlock (std::string& content,
+							 const std::string& parentIdStr,
+							 const ClassificationNode& node)
+{
+	std::string eol = DetectEol (content);
+
+	const std::string& newId = node.id;
+
+	if (parentIdStr.empty ()) {
+		// Add as root item under <Items>, sorted by ID
+		auto itemsOpen = content.find ("<Items>");
+		auto itemsClose = content.rfind ("</Items>");
+		if (itemsOpen == std::string::npos || itemsClose == std::string::npos)
+			return false;
+
+		std::string indent = DetectIndent (content, itemsClose) + "\t";
+		std::string itemXml = BuildItemXml (node, indent, eol);
+
+		size_t insertPos = FindSortedInsertPos (content,
+			itemsOpen + 7, itemsClose, newId);  // 7 = strlen("<Items>")
+		content.insert (insertPos, itemXml);
+		return true;
+	}
+
+	// Find the parent item by ID
+	std::string parentIdTag = "<ID>" + parentIdStr + "</ID>";
+	auto parentPos = content.find (parentIdTag);
+	if (parentPos == std::string::npos)
+		return false;
+
+	// Find <Children.../> or <Children>...</Children> after the parent ID
+	auto childrenSelfClose = content.find ("<Children/>", parentPos);
+	auto childrenOpen = content.find ("<Children>", parentPos);
+
+	// Use whichever comes first (and is before the parent's </Item>)
+	auto parentClose = content.find ("</Item>", parentPos);
+
+	if (childrenSelfClose != std::string::npos &&
+		childrenSelfClose < parentClose &&
+		(childrenOpen == std::string::npos || childrenSelfClose < childrenOpen))
+	{
+		// Self-closing <Children/> - replace with <Children>...<Item>...</Item>...</Children>
+		std::string indent = DetectIndent (content, childrenSelfClose);
+		std::string replacement = "<Children>" + eol;
+		replacement += BuildItemXml (node, indent + "\t", eol);
+		replacement += indent + "</Children>";
+		content.replace (childrenSelfClose, 11, replacement);  // 11 = strlen("<Children/>")
+		return true;
+	}
+
+	if (childrenOpen != std::string::npos && childrenOpen < parentClose) {
+		// Existing <Children>...</Children> - insert sorted by ID
+		// Nesting-aware search for the matching </Children>
+		auto childrenClose = FindMatchingClose (content, "<Children>", "</Children>", childrenOpen);
+		if (childrenClose == std::string::npos)
+			return false;
+
+		std::string indent = DetectIndent (content, childrenClose) + "\t";
+		std::string itemXml = BuildItemXml (node, indent, eol);
+
+		size_t insertPos = FindSortedInsertPos (content,
+			childrenOpen + 10, childrenClose, newId);  // 10 = strlen("<Children>")
+		content.insert (insertPos, itemXml);
+		return true;
+	}
+
+	return false;
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: record a commit in the master's version store (MasterStore.hpp).
+// The replaced content goes first, so a state written outside ClassSync is
+// kept too (it is skipped when it is already the newest version). Called
+// under the commit guard, so versions are numbered in commit order.
+// ---------------------------------------------------------------------------
+
+static void StoreCommittedVersion (const char* filePath, const std::string& previous, const std::string& content)
+{
+	TraceScope trace ("store master version");
+	std::string   storeDir = GetMasterStoreDir (GetChangeLogDirectory (filePath));
+	StoredVersion stored;
+	if ((previous.empty () || StoreMasterVersion (storeDir, previous)) && StoreMasterVersion (storeDir, content, &stored))
+		CS_LOG_DEBUG ("ClassSync: Master stored as version %u", stored.number);
+	else
+		CS_LOG_WARNING ("ClassSync: Cannot store the master version in %s", storeDir.c_str ());
+}
+
+
+// ---------------------------------------------------------------------------
+// Helper: compare-and-swap commit. Reads the current master under the commit
+// guard, lets apply() check for overlap and edit the content, then swaps the
+// result in. apply() returns Committed to request the write.
+// ---------------------------------------------------------------------------
+
+template <typename ApplyFn>
+static CommitResult CommitEdit (const char* filePath,
+								const MasterVersion& baseVersion,
+								bool storeVersion,
+								ApplyFn apply)
+{
+	CommitGuard guard (filePath);
+	if (!guard.IsAcquired ())
+		return CommitResult::Busy;
+
+	std::string content;
+	if (!ReadMasterFile (filePath, content))
+		return CommitResult::Failed;
+
+	bool rebased = (ComputeMasterVersion (content) != baseVersion);
+
+	std::string previous = storeVersion ? content : std::string ();
+	CommitResult result = apply (content, rebased);
+	if (result != CommitResult::Committed)
+		return result;
+
+	if (!WriteMasterFileAtomic (filePath, content))
+		return CommitResult::Failed;
+	if (storeVersion)
+		StoreCommittedVersion (filePath, previous, content);
+
+	return rebased ? CommitResult::Rebased : CommitResult::Committed;
+}
+
+
+// ---------------------------------------------------------------------------
+// Commit result names (for reports and changelog)
+// ---------------------------------------------------------------------------
+
+const char* CommitResultName (CommitResult result)
+{
+	switch (result) {
+		case CommitResult::Committed:      return "committed";
+		case CommitResult::Rebased:        return "rebased";
+		case CommitResult::AlreadyApplied: return "already applied";
+		case CommitResult::Conflict:       return "conflict";
+		case CommitResult::Busy:           return "busy";
+		case CommitResult::Failed:         return "failed";
+	}
+	return "unknown";
+}
+
+
+// ---------------------------------------------------------------------------
+// Helpers: one edit on the in-memory content. rebased = the master changed
+// since the edit was computed, so a missing target is a conflict.
+// ---------------------------------------------------------------------------
+
+static CommitResult ApplyNameChange (std::string& content, bool rebased,
+									 const std::string& idStr,
+									 const std::string& baseNameStr,
+									 const std::string& nameStr)
+{
+	size_t nameStart, nameEnd;
+	if (!FindItemName (content, idStr, nameStart, nameEnd))
+		return rebased ? CommitResult::Conflict : CommitResult::Failed;
+
+	std::string currentName = content.substr (nameStart, nameEnd - nameStart);
+	if (currentName == nameStr)
+		return CommitResult::AlreadyApplied;
+	if (currentName != baseNameStr)
+		return CommitResult::Conflict;	// renamed by someone else meanwhile
+
+	content.replace (nameStart, nameEnd - nameStart, nameStr);
+	return CommitResult::Committed;
+}
+
+
+static CommitResult ApplyItemAdd (std::string& content, bool rebased,
+								  const std::string& parentIdStr,
+								  const ClassificationNode& node)
+{
+	std::string nameStr = EscapeXml (node.name);
+
+	// Someone may have exported the same ID in the meantime
+	size_t nameStart, nameEnd;
+	if (FindItemName (content, node.id, nameStart, nameEnd)) {
+		if (content.compare (nameStart, nameEnd - nameStart, nameStr) == 0)
+			return CommitResult::AlreadyApplied;
+		return CommitResult::Conflict;
+	}
+
+	if (!InsertItemBlock (content, parentIdStr, node))
+		return rebased ? CommitResult::Conflict : CommitResult::Failed;
+
+	return CommitResult::Committed;
+}
+
+
+static CommitResult ApplyMasterEdit (std::string& content, bool rebased, const MasterEdit& edit)
+{
+	if (edit.kind == MasterEditKind::AddItem)
+		return ApplyItemAdd (content, rebased, edit.parentId, edit.node);
+
+	return ApplyNameChange (content, rebased, edit.itemId,
+							EscapeXml (edit.baseName), EscapeXml (edit.newName));
+}
+
+
+// ---------------------------------------------------------------------------
+// Change an item's <Name> in the XML file
+// ---------------------------------------------------------------------------
+
+CommitResult ChangeItemNameInXml (const char* filePath,
+								  const MasterVersion& baseVersion,
+								  const std::string& itemId,
+								  const std::string& baseName,
+								  const std::string& newName,
+								  bool storeVersion)
+{
+	std::string baseNameStr = EscapeXml (baseName);
+	std::string nameStr     = EscapeXml (newName);
+
+	return CommitEdit (filePath, baseVersion, storeVersion,
+		[&] (std::string& content, bool rebased) -> CommitResult {
+			return ApplyNameChange (content, rebased, itemId, baseNameStr, nameStr);
+		});
+}
+
+
+// ---------------------------------------------------------------------------
+// Add a new <Item> to the XML file
+// ---------------------------------------------------------------------------
+
+CommitResult AddItemToXml (const char* filePath,
+						   const MasterVersion& baseVersion,
+						   const std::string& parentId,
+						   const ClassificationNode& node,
+						   bool storeVersion)
+{
+	return CommitEdit (filePath, baseVersion, storeVersion,
+		[&] (std::string& content, bool rebased) -> CommitResult {
+			return ApplyItemAdd (content, rebased, parentId, node);
+		});
+}
+
+
+// ---------------------------------------------------------------------------
+// Apply a batch of edits to master content in memory
+// ---------------------------------------------------------------------------
+
+CommitResult ApplyEditsToContent (std::string& content, bool rebased, std::vector<MasterEdit>& edits)
+{
+	bool anyChange = false;
+	for (MasterEdit& edit : edits) {
+		edit.result = ApplyMasterEdit (content, rebased, edit);
+		if (edit.result == CommitResult::Committed)
+			anyChange = true;
+	}
+	return anyChange ? CommitResult::Committed : CommitResult::AlreadyApplied;
+}
+
+
+bool WriteMasterFile (const char* filePath, const std::string& content, const std::string& previous)
+{
+	if (!WriteMasterFileAtomic (filePath, content))
+		return false;
+	StoreCommittedVersion (filePath, previous, content);
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Apply a batch of edits in one commit: one guard, one read, one write
+// ---------------------------------------------------------------------------
+
+CommitResult ApplyEditsToXml (const char* filePath,
+							  const MasterVersion& baseVersion,
+							  std::vector<MasterEdit>& edits,
+							  bool storeVersion)
+{
+	// Until apply() runs every edit counts as pending (to be written)
+	for (MasterEdit& edit : edits)
+		edit.result = CommitResult::Committed;
+
+	CommitResult result = CommitEdit (filePath, baseVersion, storeVersion,
+		[&] (std::string& content, bool rebased) -> CommitResult {
+			return ApplyEditsToContent (content, rebased, edits);
+		});
+
+	// Pending edits share the outcome of the write
+	for (MasterEdit& edit : edits) {
+		if (edit.result == CommitResult::Committed && result != CommitResult::AlreadyApplied)
+			edit.result = result;
+	}
+
+	return result;
+}
@@ -0,0 +1,129 @@
+#ifndef XMLWRITER_HPP
+#define XMLWRITER_HPP
+
+#include "ClassificationModel.hpp"
+#include "MasterVersion.hpp"
+
+#include <string>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// Outcome of an optimistic (compare-and-swap) commit to the master XML.
+// Every edit carries the MasterVersion it was computed against; if the file
+// changed in between, the edit is re-applied on top of the new content as
+// long as nobody else touched the same item.
+//
+// A write also records the new master in its version store (changelog/store,
+// MasterStore.hpp) before the commit guard is released. storeVersion = false
+// is for shard files and catalog members, which are not stored.
+// ---------------------------------------------------------------------------
+
+enum class CommitResult {
+	Committed,		// master unchanged since baseVersion, edit written
+	Rebased,		// master changed elsewhere, edit re-applied and written
+	AlreadyApplied,	// master already contains exactly this change
+	Conflict,		// someone else changed the same item - edit rejected
+	Busy,			// another session kept the commit guard too long
+	Failed			// I/O error or target not found
+};
+
+const char*  CommitResultName (CommitResult result);
+
+inline bool  IsCommitSuccess (CommitResult result)
+{
+	return result == CommitResult::Committed || result == CommitResult::Rebased;
+}
+
+
+// ---------------------------------------------------------------------------
+// Change an item's <Name> in the XML file, found by <ID>.
+// baseName is the server name the edit was computed from; the change is
+// rejected as a conflict if the master now holds a different name.
+// ---------------------------------------------------------------------------
+
+CommitResult ChangeItemNameInXml (const char* filePath,
+								  const MasterVersion& baseVersion,
+								  const std::string& itemId,
+								  const std::string& baseName,
+								  const std::string& newName,
+								  bool storeVersion = true);
+
+
+// ---------------------------------------------------------------------------
+// Add a new <Item> block inside a parent's <Children> section.
+// If parentId is empty, adds under the system's <Items> section.
+// Rejected as a conflict if the ID was added concurrently with another name.
+// ---------------------------------------------------------------------------
+
+CommitResult AddItemToXml (const char* filePath,
+						   const MasterVersion& baseVersion,
+						   const std::string& parentId,
+						   const ClassificationNode& node,
+						   bool storeVersion = true);
+
+
+// ---------------------------------------------------------------------------
+// Batch of edits committed as one transaction (bulk Export / Use Project).
+// Edits are applied in order, so a parent must come before its children.
+// Each edit gets its own result; conflicting edits are skipped and the rest
+// are written with a single atomic write. Returns the outcome of the write
+// (AlreadyApplied when nothing needed writing).
+// ---------------------------------------------------------------------------
+
+enum class MasterEditKind {
+	ChangeName,		// itemId: baseName -> newName
+	AddItem			// node under parentId (empty = system root)
+};
+
+struct MasterEdit {
+	MasterEditKind      kind;
+	std::string         itemId;
+	std::string         baseName;
+	std::string         newName;
+	std::string         parentId;
+	std::string         systemName;		// root AddItem: system to add to (catalogs)
+	ClassificationNode  node;
+	CommitResult        result;
+
+	MasterEdit () : kind (MasterEditKind::ChangeName), result (CommitResult::Failed) {}
+};
+
+CommitResult ApplyEditsToXml (const char* filePath,
+							  const MasterVersion& baseVersion,
+							  std::vector<MasterEdit>& edits,
+							  bool storeVersion = true);
+
+// The same on content already in memory (the sync service's copy), without
+// guard or write. rebased = the content is newer than the edits' base.
+// Returns Committed if any edit changed the content, else AlreadyApplied.
+CommitResult ApplyEditsToContent (std::string& content,
+								  bool rebased,
+								  std::vector<MasterEdit>& edits);
+
+// Write a whole master through "<file>.tmp" and an atomic swap; previous is
+// the content it replaces ("" = do not store it).
+bool  WriteMasterFile (const char* filePath, const std::string& content, const std::string& previous = std::string ());
+
+
+// ---------------------------------------------------------------------------
+// Format a leaf <Item> block the way AddItemToXml writes it
+// ---------------------------------------------------------------------------
+
+std::string FormatItemXml (const ClassificationNode& node,
+						   const std::string& indent,
+						   const std::string& eol);
+
+
+// ---------------------------------------------------------------------------
+// Build a classification document holding only the given items and their
+// ancestor chains, from a parsed master (no property definitions). Used for
+// a selective ACAPI_Classification_Import. Returns the number of items.
+// ---------------------------------------------------------------------------
+
+size_t FormatImportFragment (const std::vector<ClassificationTree>& trees,
+							 const std::vector<std::string>& itemIds,
+							 std::string& xml);
+
+
+#endif // XMLWRITER_HPP
@@ -0,0 +1,61 @@
+#include "CoreAdapters.hpp"
+#include "Report.hpp"
+
+#include <cstring>
+
+
+static_assert (sizeof (API_Guid) == sizeof (ItemGuid::bytes), "API_Guid must be 16 bytes");
+
+
+// ---------------------------------------------------------------------------
+// Text
+// ---------------------------------------------------------------------------
+
+std::string ToUtf8 (const GS::UniString& text)
+{
+	if (text.IsEmpty ())
+		return "";
+	return std::string (text.ToCStr (0, MaxUSize, CC_UTF8).Get ());
+}
+
+
+GS::UniString FromUtf8 (const std::string& text)
+{
+	return GS::UniString (text.c_str (), CC_UTF8);
+}
+
+
+// ---------------------------------------------------------------------------
+// GUIDs (same 16 bytes, copied as-is)
+// ---------------------------------------------------------------------------
+
+ItemGuid ToItemGuid (const API_Guid& guid)
+{
+	ItemGuid result;
+	std::memcpy (result.bytes, &guid, sizeof (result.bytes));
+	return result;
+}
+
+
+API_Guid ToApiGuid (const ItemGuid& guid)
+{
+	API_Guid result;
+	std::memcpy (&result, guid.bytes, sizeof (guid.bytes));
+	return result;
+}
+
+
+// ---------------------------------------------------------------------------
+// Report sink
+// ---------------------------------------------------------------------------
+
+static void WriteToSessionReport (const std::string& line)
+{
+	ACAPI_WriteReport ("%s", false, line.c_str ());
+}
+
+
+void InstallCoreReportSink ()
+{
+	SetReportSink (WriteToSessionReport);
+}
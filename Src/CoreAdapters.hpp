@@ -0,0 +1,26 @@
+#ifndef COREADAPTERS_HPP
+#define COREADAPTERS_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+#include "ClassificationModel.hpp"
+
+#include <string>
+
+
+// ---------------------------------------------------------------------------
+// Conversions between the add-on (GS / ACAPI types) and the core library
+// (UTF-8 std::string, ItemGuid). Kept thin: no logic beyond the conversion.
+// ---------------------------------------------------------------------------
+
+std::string    ToUtf8 (const GS::UniString& text);
+GS::UniString  FromUtf8 (const std::string& text);
+
+ItemGuid       ToItemGuid (const API_Guid& guid);
+API_Guid       ToApiGuid (const ItemGuid& guid);
+
+// Route core Report lines to the session report (call once in Initialize).
+void  InstallCoreReportSink ();
+
+
+#endif // COREADAPTERS_HPP
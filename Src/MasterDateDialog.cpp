@@ -0,0 +1,53 @@
+#include "MasterDateDialog.hpp"
+#include "MasterHistory.hpp"
+
+#include <ctime>
+
+
+// ---------------------------------------------------------------------------
+// Constructor / destructor
+// ---------------------------------------------------------------------------
+
+MasterDateDialog::MasterDateDialog () :
+	DG::ModalDialog (ACAPI_GetOwnResModule (), MasterDateDialogResId, ACAPI_GetOwnResModule ()),
+	buttonCompare   (GetReference (), DateItemButtonCompare),
+	buttonCancel    (GetReference (), DateItemButtonCancel),
+	labelPrompt     (GetReference (), DateItemLabelPrompt),
+	editDate        (GetReference (), DateItemEditDate)
+{
+	buttonCompare.Attach (*this);
+	buttonCancel.Attach (*this);
+
+	// Start from today, e.g. "2025-03-14"
+	editDate.SetText (GS::UniString (FormatTimeKey ((std::int64_t)std::time (nullptr)).substr (0, 10).c_str ()));
+	editDate.SelectAll ();
+}
+
+
+MasterDateDialog::~MasterDateDialog ()
+{
+	buttonCancel.Detach (*this);
+	buttonCompare.Detach (*this);
+}
+
+
+// ---------------------------------------------------------------------------
+// ButtonItemObserver: accept only a date the replay engine can parse
+// ---------------------------------------------------------------------------
+
+void MasterDateDialog::ButtonClicked (const DG::ButtonClickEvent& ev)
+{
+	if (ev.GetSource () == &buttonCancel) {
+		PostCloseRequest (DG::ModalDialog::Cancel);
+		return;
+	}
+
+	std::string text (editDate.GetText ().ToCStr (0, MaxUSize, CC_UTF8).Get ());
+	if (!ParseTimeKey (text, timeKey)) {
+		DGAlert (DG_WARNING, "ClassSync", "Invalid date",
+				 "Use YYYY-MM-DD or YYYY-MM-DD HH:MM.", "OK");
+		return;
+	}
+
+	PostCloseRequest (DG::ModalDialog::Accept);
+}
@@ -0,0 +1,52 @@
+#ifndef MASTERDATEDIALOG_HPP
+#define MASTERDATEDIALOG_HPP
+
+#include "APIEnvir.h"
+#include "ACAPinc.h"
+#include "DGModule.hpp"
+
+#include <string>
+
+
+// ---------------------------------------------------------------------------
+// Resource IDs (must match ClassSync.grc)
+// ---------------------------------------------------------------------------
+
+enum {
+	MasterDateDialogResId = 32610,
+
+	DateItemButtonCompare = 1,
+	DateItemButtonCancel  = 2,
+	DateItemLabelPrompt   = 3,
+	DateItemEditDate      = 4
+};
+
+
+// ---------------------------------------------------------------------------
+// Modal dialog asking for the point in time to reconstruct the master at
+// ---------------------------------------------------------------------------
+
+class MasterDateDialog : public DG::ModalDialog,
+						 public DG::ButtonItemObserver
+{
+public:
+	MasterDateDialog ();
+	~MasterDateDialog ();
+
+	// Time key ("YYYY-MM-DDTHH:MM:SS") entered by the user, valid after Invoke () returned true
+	const std::string&  GetTimeKey () const  { return timeKey; }
+
+private:
+	// DG::ButtonItemObserver
+	virtual void  ButtonClicked (const DG::ButtonClickEvent& ev) override;
+
+	DG::Button    buttonCompare;
+	DG::Button    buttonCancel;
+	DG::LeftText  labelPrompt;
+	DG::TextEdit  editDate;
+
+	std::string   timeKey;
+};
+
+
+#endif // MASTERDATEDIALOG_HPP
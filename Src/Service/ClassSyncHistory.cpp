@@ -0,0 +1,131 @@
+#include "ChangeLog.hpp"
+#include "FileLock.hpp"
+#include "FileSystem.hpp"
+#include "MasterStore.hpp"
+#include "XmlWriter.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// classsync_history - the stored versions of a master XML
+//
+//   classsync_history <master.xml> list
+//   classsync_history <master.xml> show <n> <out.xml>
+//   classsync_history <master.xml> diff <from> <to>
+//
+// Versions are recorded by every commit (sessions, the service, rollbacks) in
+// changelog/store next to the master. show writes the exact bytes of a
+// version; giving the master itself as out.xml rolls it back (as a commit,
+// so sessions pick it up like any other change).
+// ---------------------------------------------------------------------------
+
+static void PrintUsage ()
+{
+	std::fprintf (stderr,
+		"usage: classsync_history <master.xml> list\n"
+		"       classsync_history <master.xml> show <n> <out.xml>\n"
+		"       classsync_history <master.xml> diff <from> <to>\n");
+}
+
+
+static bool ParseNumber (const char* text, unsigned& number)
+{
+	char* end = nullptr;
+	unsigned long value = std::strtoul (text, &end, 10);
+	if (end == text || *end != '\0' || value == 0)
+		return false;
+	number = (unsigned)value;
+	return true;
+}
+
+
+static int List (const std::string& storeDir)
+{
+	std::vector<StoredVersion> versions = ListStoredVersions (storeDir);
+	if (versions.empty ()) {
+		std::fprintf (stderr, "classsync_history: no versions in %s\n", storeDir.c_str ());
+		return 1;
+	}
+	for (const StoredVersion& stored : versions)
+		std::printf ("%6u  %s  %s\n", stored.number, stored.time.c_str (), MasterVersionToString (stored.version).c_str ());
+	return 0;
+}
+
+
+static int Show (const std::string& masterPath, const std::string& storeDir, unsigned number, const std::string& outPath)
+{
+	std::string content, error;
+	if (!MaterializeStoredVersion (storeDir, number, content, error)) {
+		std::fprintf (stderr, "classsync_history: %s\n", error.c_str ());
+		return 1;
+	}
+
+	CommitGuard guard (outPath.c_str ());
+	if (!guard.IsAcquired ()) {
+		std::fprintf (stderr, "classsync_history: %s is being committed to, try again\n", outPath.c_str ());
+		return 1;
+	}
+	// A rollback is a commit: it records the replaced and the restored master.
+	// Any other output file is only a copy and stays out of the store.
+	bool        written = false;
+	std::string previous;
+	if (outPath == masterPath)
+		written = ReadFile (masterPath, previous) && WriteMasterFile (outPath.c_str (), content, previous);
+	else
+		written = WriteMasterFileAtomic (outPath.c_str (), content);
+	if (!written) {
+		std::fprintf (stderr, "classsync_history: cannot write %s\n", outPath.c_str ());
+		return 1;
+	}
+	std::printf ("Version %u written to %s (%d bytes)\n", number, outPath.c_str (), (int)content.size ());
+	return 0;
+}
+
+
+static int Diff (const std::string& storeDir, unsigned from, unsigned to)
+{
+	std::vector<StoredChange> changes;
+	std::string error;
+	if (!DiffStoredVersions (storeDir, from, to, changes, error)) {
+		std::fprintf (stderr, "classsync_history: %s\n", error.c_str ());
+		return 1;
+	}
+	for (const StoredChange& change : changes) {
+		std::string tag = change.tag.empty () ? "document" : change.tag;
+		if (change.kind == StoredChangeKind::Changed && change.oldName != change.newName)
+			std::printf ("%-8s %s %s: \"%s\" -> \"%s\"\n", StoredChangeKindName (change.kind), tag.c_str (),
+						 change.id.c_str (), change.oldName.c_str (), change.newName.c_str ());
+		else
+			std::printf ("%-8s %s %s \"%s\"\n", StoredChangeKindName (change.kind), tag.c_str (), change.id.c_str (),
+						 (change.kind == StoredChangeKind::Removed ? change.oldName : change.newName).c_str ());
+	}
+	std::printf ("%d change(s) from version %u to %u\n", (int)changes.size (), from, to);
+	return 0;
+}
+
+
+int main (int argc, char** argv)
+{
+	if (argc < 3) {
+		PrintUsage ();
+		return 2;
+	}
+
+	std::string storeDir = GetMasterStoreDir (GetChangeLogDirectory (argv[1]));
+	std::string command  = argv[2];
+	unsigned    first = 0, second = 0;
+
+	if (command == "list" && argc == 3)
+		return List (storeDir);
+	if (command == "show" && argc == 5 && ParseNumber (argv[3], first))
+		return Show (argv[1], storeDir, first, argv[4]);
+	if (command == "diff" && argc == 5 && ParseNumber (argv[3], first) && ParseNumber (argv[4], second))
+		return Diff (storeDir, first, second);
+
+	PrintUsage ();
+	return 2;
+}
@@ -0,0 +1,96 @@
+#include "Log.hpp"
+#include "SyncServer.hpp"
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+
+// ---------------------------------------------------------------------------
+// classsync_service - host a master XML for the add-on sessions
+//
+//   classsync_service [options] <master.xml>
+//
+// Options:
+//   --listen <host>   address to bind (127.0.0.1; a LAN address serves
+//                     other machines, without any authentication)
+//   --port <n>        TCP port (47383, the add-on's default)
+//   --log <file>      append the service log to a file as well
+//   --verbose         log debug lines
+//
+// Sessions find it through CLASSSYNC_SERVICE (see MANUAL.md). Runs until
+// Ctrl+C / SIGTERM; every commit is already on disk when it is answered.
+// ---------------------------------------------------------------------------
+
+static volatile std::sig_atomic_t stopRequested = 0;
+
+
+static void RequestStop (int)
+{
+	stopRequested = 1;
+}
+
+
+static void PrintUsage ()
+{
+	std::fprintf (stderr,
+		"usage: classsync_service [--listen <host>] [--port <n>] [--log <file>] [--verbose] <master.xml>\n");
+}
+
+
+int main (int argc, char** argv)
+{
+	std::string   masterPath;
+	std::string   host = "127.0.0.1";
+	std::uint16_t port = kSyncDefaultPort;
+	std::string   logPath;
+	LogLevel      level = LogLevel::Info;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--verbose") {
+			level = LogLevel::Debug;
+		} else if (arg.compare (0, 2, "--") == 0 && !hasValue) {
+			std::fprintf (stderr, "classsync_service: %s needs a value\n", arg.c_str ());
+			PrintUsage ();
+			return 2;
+		} else if (arg == "--listen") {
+			host = argv[++i];
+		} else if (arg == "--port") {
+			port = (std::uint16_t)std::atoi (argv[++i]);
+		} else if (arg == "--log") {
+			logPath = argv[++i];
+		} else if (arg.compare (0, 2, "--") == 0 || !masterPath.empty ()) {
+			PrintUsage ();
+			return 2;
+		} else {
+			masterPath = arg;
+		}
+	}
+	if (masterPath.empty ()) {
+		PrintUsage ();
+		return 2;
+	}
+
+	SetLogEchoLevel (level);
+	if (!logPath.empty () && !StartLogFile (logPath))
+		std::fprintf (stderr, "classsync_service: cannot open log file %s\n", logPath.c_str ());
+
+	SyncServer server;
+	if (!server.Start (masterPath, host, port))
+		return 1;
+
+	std::signal (SIGINT, RequestStop);
+	std::signal (SIGTERM, RequestStop);
+	while (!stopRequested)
+		std::this_thread::sleep_for (std::chrono::milliseconds (200));
+
+	server.Stop ();
+	CS_LOG_INFO ("ClassSync service: Stopped at revision %llu", (unsigned long long)server.GetRevision ());
+	StopLogFile ();
+	return 0;
+}
@@ -1,8 +0,0 @@
-#ifndef XMLREADER_HPP
-#define XMLREADER_HPP
-
-#include "ClassificationData.hpp"
-
-GS::Array<ClassificationTree>  ReadXmlClassifications (const char* filePath);
-
-#endif // XMLREADER_HPP
@@ -0,0 +1,171 @@
+#include "BenchBaseline.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+
+// ---------------------------------------------------------------------------
+// Helpers
+// ---------------------------------------------------------------------------
+
+static std::string JsonEscape (const std::string& text)
+{
+	std::string escaped;
+	for (char c : text) {
+		switch (c) {
+			case '"':  escaped += "\\\""; break;
+			case '\\': escaped += "\\\\"; break;
+			case '\n': escaped += "\\n";  break;
+			case '\t': escaped += "\\t";  break;
+			default:   escaped += c;      break;
+		}
+	}
+	return escaped;
+}
+
+static std::string FormatNumber (double value)
+{
+	char buffer[64];
+	std::snprintf (buffer, sizeof (buffer), "%.4f", value);
+	return buffer;
+}
+
+// Position just after "key": in [begin, end), skipping spaces (nullptr if absent)
+static const char* FindValue (const char* begin, const char* end, const char* key)
+{
+	std::string pattern = std::string ("\"") + key + "\"";
+	const char* p = std::search (begin, end, pattern.begin (), pattern.end ());
+	if (p == end)
+		return nullptr;
+	p += pattern.size ();
+	while (p < end && (*p == ' ' || *p == '\t' || *p == ':'))
+		p++;
+	return p < end ? p : nullptr;
+}
+
+static std::string StringValue (const char* begin, const char* end, const char* key)
+{
+	const char* p = FindValue (begin, end, key);
+	if (p == nullptr || *p != '"')
+		return "";
+
+	std::string value;
+	for (p++; p < end && *p != '"'; p++) {
+		if (*p == '\\' && p + 1 < end) {
+			p++;
+			value += *p == 'n' ? '\n' : *p == 't' ? '\t' : *p;
+		} else {
+			value += *p;
+		}
+	}
+	return value;
+}
+
+static double NumberValue (const char* begin, const char* end, const char* key)
+{
+	const char* p = FindValue (begin, end, key);
+	if (p == nullptr)
+		return 0.0;
+	return std::strtod (std::string (p, std::min<size_t> (32, end - p)).c_str (), nullptr);
+}
+
+
+// ---------------------------------------------------------------------------
+// JSON
+// ---------------------------------------------------------------------------
+
+std::string FormatBenchJson (const BenchRun& run)
+{
+	std::string json = "{\n";
+	json += "\t\"master\": \"" + JsonEscape (run.master) + "\",\n";
+	json += "\t\"items\": " + std::to_string ((unsigned long long)run.items) + ",\n";
+	json += "\t\"iterations\": " + std::to_string (run.iterations) + ",\n";
+	json += "\t\"stages\": [\n";
+	for (size_t i = 0; i < run.stages.size (); i++) {
+		const BenchStage& stage = run.stages[i];
+		json += "\t\t{\"name\": \"" + JsonEscape (stage.name) + "\"";
+		json += ", \"best_ms\": " + FormatNumber (stage.bestMs);
+		json += ", \"mean_ms\": " + FormatNumber (stage.meanMs);
+		json += ", \"bytes\": " + std::to_string ((unsigned long long)stage.bytes);
+		json += ", \"bytes_per_sec\": " + FormatNumber (stage.BytesPerSec ());
+		json += ", \"allocs\": " + std::to_string ((unsigned long long)stage.allocs);
+		json += ", \"alloc_bytes\": " + std::to_string ((unsigned long long)stage.allocBytes);
+		json += ", \"peak_bytes\": " + std::to_string ((unsigned long long)stage.peakBytes) + "}";
+		json += i + 1 < run.stages.size () ? ",\n" : "\n";
+	}
+	json += "\t]\n}\n";
+	return json;
+}
+
+bool ParseBenchJson (const std::string& json, BenchRun& run)
+{
+	const char* begin = json.data ();
+	const char* end   = begin + json.size ();
+
+	const char* stages = FindValue (begin, end, "stages");
+	const char* header = stages != nullptr ? stages : end;
+	run.master     = StringValue (begin, header, "master");
+	run.items      = (std::uint64_t)NumberValue (begin, header, "items");
+	run.iterations = (int)NumberValue (begin, header, "iterations");
+	run.stages.clear ();
+	if (stages == nullptr)
+		return false;
+
+	// One flat object per stage
+	const char* p = stages;
+	while (true) {
+		const char* open = std::find (p, end, '{');
+		if (open == end)
+			break;
+		const char* close = std::find (open, end, '}');
+		if (close == end)
+			break;
+
+		BenchStage stage;
+		stage.name       = StringValue (open, close, "name");
+		stage.bestMs     = NumberValue (open, close, "best_ms");
+		stage.meanMs     = NumberValue (open, close, "mean_ms");
+		stage.bytes      = (std::uint64_t)NumberValue (open, close, "bytes");
+		stage.allocs     = (std::uint64_t)NumberValue (open, close, "allocs");
+		stage.allocBytes = (std::uint64_t)NumberValue (open, close, "alloc_bytes");
+		stage.peakBytes  = (std::uint64_t)NumberValue (open, close, "peak_bytes");
+		if (!stage.name.empty ())
+			run.stages.push_back (stage);
+		p = close + 1;
+	}
+	return !run.stages.empty ();
+}
+
+
+// ---------------------------------------------------------------------------
+// Comparison
+// ---------------------------------------------------------------------------
+
+bool CompareWithBaseline (const BenchRun& current, const BenchRun& baseline, double threshold, double noiseMs,
+						  std::vector<BaselineComparison>& result)
+{
+	bool passed = true;
+	result.clear ();
+	for (const BenchStage& stage : current.stages) {
+		BaselineComparison comparison;
+		comparison.name       = stage.name;
+		comparison.baselineMs = 0.0;
+		comparison.currentMs  = stage.bestMs;
+		comparison.ratio      = 0.0;
+		comparison.regressed  = false;
+
+		auto it = std::find_if (baseline.stages.begin (), baseline.stages.end (),
+								[&] (const BenchStage& base) { return base.name == stage.name; });
+		if (it != baseline.stages.end () && it->bestMs > 0.0) {
+			comparison.baselineMs = it->bestMs;
+			comparison.ratio      = stage.bestMs / it->bestMs;
+			comparison.regressed  = comparison.ratio > threshold && stage.bestMs - it->bestMs > noiseMs;
+		}
+		if (comparison.regressed)
+			passed = false;
+		result.push_back (comparison);
+	}
+	return passed;
+}
@@ -0,0 +1,64 @@
+#ifndef BENCHBASELINE_HPP
+#define BENCHBASELINE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// Benchmark results and stored baselines
+//
+// A run is saved as JSON with one flat object per stage on its own line, so
+// baselines can be committed and diffed. Comparing a run against a baseline
+// flags every stage whose best time grew by more than the threshold ratio.
+// ---------------------------------------------------------------------------
+
+struct BenchStage {
+	std::string    name;
+	double         bestMs;
+	double         meanMs;
+	std::uint64_t  bytes;		// bytes read or written per iteration (0 = n/a)
+	std::uint64_t  allocs;		// heap allocations per iteration
+	std::uint64_t  allocBytes;	// heap bytes allocated per iteration
+	std::uint64_t  peakBytes;	// highest heap growth within one iteration
+
+	BenchStage () : bestMs (0.0), meanMs (0.0), bytes (0), allocs (0), allocBytes (0), peakBytes (0) {}
+
+	double  BytesPerSec () const  { return bytes > 0 && bestMs > 0.0 ? bytes / (bestMs / 1000.0) : 0.0; }
+};
+
+struct BenchRun {
+	std::string              master;
+	std::uint64_t            items;
+	int                      iterations;
+	std::vector<BenchStage>  stages;
+
+	BenchRun () : items (0), iterations (0) {}
+};
+
+std::string  FormatBenchJson (const BenchRun& run);
+
+// False if no stage could be read.
+bool  ParseBenchJson (const std::string& json, BenchRun& run);
+
+
+struct BaselineComparison {
+	std::string  name;
+	double       baselineMs;	// 0 when the stage is not in the baseline
+	double       currentMs;
+	double       ratio;			// current / baseline (0 when not comparable)
+	bool         regressed;
+};
+
+// Differences below noiseMs never count as a regression (sub-millisecond
+// stages jitter by more than any sensible threshold). Returns false if any
+// stage regressed.
+bool  CompareWithBaseline (const BenchRun& current,
+						   const BenchRun& baseline,
+						   double threshold,
+						   double noiseMs,
+						   std::vector<BaselineComparison>& result);
+
+
+#endif // BENCHBASELINE_HPP
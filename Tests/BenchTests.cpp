@@ -0,0 +1,226 @@
+#include "TestHarness.hpp"
+#include "BenchBaseline.hpp"
+#include "MasterGenerator.hpp"
+#include "ShardedMaster.hpp"
+#include "XmlReader.hpp"
+
+#include <set>
+
+
+// ---------------------------------------------------------------------------
+// Benchmark support: synthetic masters and baseline comparison
+// ---------------------------------------------------------------------------
+
+static size_t CountItems (const std::vector<ClassificationNode>& nodes, int level, int& maxDepth)
+{
+	size_t count = 0;
+	for (const ClassificationNode& node : nodes) {
+		maxDepth = std::max (maxDepth, level);
+		count += 1 + CountItems (node.children, level + 1, maxDepth);
+	}
+	return count;
+}
+
+static bool HasNonAscii (const std::string& text)
+{
+	for (char c : text) {
+		if ((unsigned char)c >= 0x80)
+			return true;
+	}
+	return false;
+}
+
+// Every <ItemID> ... </ItemID> in a document
+static std::vector<std::string> ReferencedIds (const std::string& xml)
+{
+	std::vector<std::string> ids;
+	size_t pos = 0;
+	while ((pos = xml.find ("<ItemID>", pos)) != std::string::npos) {
+		pos += 8;
+		size_t end = xml.find ("</ItemID>", pos);
+		ids.push_back (xml.substr (pos, end - pos));
+		pos = end;
+	}
+	return ids;
+}
+
+static void CollectIdSet (const std::vector<ClassificationNode>& nodes, std::set<std::string>& ids)
+{
+	for (const ClassificationNode& node : nodes) {
+		ids.insert (node.id);
+		CollectIdSet (node.children, ids);
+	}
+}
+
+
+TEST (GeneratedMasterMatchesRequestedShape)
+{
+	TempDir dir;
+	MasterGeneratorOptions options;
+	options.items = 490;
+
+	MasterGeneratorStats stats = {};
+	CHECK (WriteGeneratedMaster (dir.File ("Generated.xml"), options, &stats));
+	CHECK_EQ (stats.items, 490u);
+	CHECK_EQ (stats.maxDepth, 3);
+
+	std::vector<ClassificationTree> trees = ReadXmlClassifications (dir.File ("Generated.xml").c_str ());
+	CHECK_EQ (trees.size (), 1u);
+	if (trees.empty ())
+		return;
+	CHECK_EQ (trees[0].systemName, std::string (GeneratedSystemName));
+	CHECK_EQ (trees[0].version, std::string ("03"));
+
+	int maxDepth = 0;
+	CHECK_EQ (CountItems (trees[0].rootItems, 1, maxDepth), 490u);
+	CHECK_EQ (maxDepth, 3);
+
+	// Names round-trip with their diacritics and have the requested length
+	const ClassificationNode& first = trees[0].rootItems[0];
+	CHECK (first.name.size () >= options.nameLength);
+	std::string content = ReadTextFile (dir.File ("Generated.xml"));
+	CHECK (HasNonAscii (content));
+	CHECK_EQ (stats.bytes, (std::uint64_t)content.size ());
+
+	// Reference density near the requested mean, all pointing at real items
+	std::vector<std::string> references = ReferencedIds (content);
+	CHECK_EQ ((std::uint64_t)references.size (), stats.references);
+	CHECK (references.size () > 490 * 20 && references.size () < 490 * 30);
+
+	std::set<std::string> ids;
+	CollectIdSet (trees[0].rootItems, ids);
+	CHECK_EQ (ids.size (), 490u);
+	for (const std::string& id : references)
+		CHECK (ids.count (id) == 1);
+}
+
+
+TEST (GeneratorOptionsAndSeed)
+{
+	TempDir dir;
+	MasterGeneratorOptions options;
+	options.items       = 1000;
+	options.depth       = 1;
+	options.diacritics  = false;
+	options.refsPerItem = 0.0;
+
+	MasterGeneratorStats stats = {};
+	CHECK (WriteGeneratedMaster (dir.File ("a.xml"), options, &stats));
+	CHECK_EQ (stats.references, 0u);
+	CHECK_EQ (stats.maxDepth, 1);
+	CHECK (!HasNonAscii (ReadTextFile (dir.File ("a.xml"))));
+
+	// A flat list beyond the two-letter root IDs still has unique IDs
+	std::vector<ClassificationTree> trees = ReadXmlClassifications (dir.File ("a.xml").c_str ());
+	CHECK (!trees.empty () && trees[0].rootItems.size () == 1000);
+	std::set<std::string> ids;
+	if (!trees.empty ())
+		CollectIdSet (trees[0].rootItems, ids);
+	CHECK_EQ (ids.size (), 1000u);
+
+	// Same seed, same bytes; another seed, other names
+	CHECK (WriteGeneratedMaster (dir.File ("b.xml"), options));
+	CHECK (ReadTextFile (dir.File ("a.xml")) == ReadTextFile (dir.File ("b.xml")));
+	options.seed = 7;
+	CHECK (WriteGeneratedMaster (dir.File ("c.xml"), options));
+	CHECK (ReadTextFile (dir.File ("a.xml")) != ReadTextFile (dir.File ("c.xml")));
+
+	CHECK (!WriteGeneratedMaster (dir.File ("missing/x.xml"), options));
+}
+
+
+TEST (GeneratedMasterSplitsIntoShards)
+{
+	TempDir dir;
+	MasterGeneratorOptions options;
+	options.items = 5000;
+	options.depth = 4;
+	CHECK (WriteGeneratedMaster (dir.File ("Generated.xml"), options));
+
+	std::string manifestPath, error;
+	CHECK (SplitMasterIntoShards (dir.File ("Generated.xml").c_str (), manifestPath, error));
+
+	ShardedMasterCache cache;
+	std::vector<ClassificationTree> sharded = ReadShardedClassifications (manifestPath.c_str (), cache);
+	CHECK_EQ (HashClassifications (sharded), HashClassifications (ReadXmlClassifications (dir.File ("Generated.xml").c_str ())));
+}
+
+
+static BenchStage MakeStage (const char* name, double bestMs)
+{
+	BenchStage stage;
+	stage.name   = name;
+	stage.bestMs = bestMs;
+	stage.meanMs = bestMs * 1.1;
+	return stage;
+}
+
+
+TEST (BaselineJsonRoundTrip)
+{
+	BenchRun run;
+	run.master     = "C:\\Masters\\\"Green\" PLANTS.xml";
+	run.items      = 490;
+	run.iterations = 10;
+	run.stages.push_back (MakeStage ("read + parse", 25.5));
+	run.stages.back ().bytes      = 2400000;
+	run.stages.back ().allocs     = 12345;
+	run.stages.back ().allocBytes = 3000000;
+	run.stages.back ().peakBytes  = 1500000;
+	run.stages.push_back (MakeStage ("diff", 5.25));
+
+	std::string json = FormatBenchJson (run);
+	BenchRun parsed;
+	CHECK (ParseBenchJson (json, parsed));
+	CHECK_EQ (parsed.master, run.master);
+	CHECK_EQ (parsed.items, 490u);
+	CHECK_EQ (parsed.iterations, 10);
+	CHECK_EQ (parsed.stages.size (), 2u);
+	if (parsed.stages.size () == 2) {
+		CHECK_EQ (parsed.stages[0].name, std::string ("read + parse"));
+		CHECK (std::abs (parsed.stages[0].bestMs - 25.5) < 1e-6);
+		CHECK_EQ (parsed.stages[0].bytes, 2400000u);
+		CHECK_EQ (parsed.stages[0].allocs, 12345u);
+		CHECK_EQ (parsed.stages[0].allocBytes, 3000000u);
+		CHECK_EQ (parsed.stages[0].peakBytes, 1500000u);
+		CHECK (std::abs (parsed.stages[1].bestMs - 5.25) < 1e-6);
+	}
+
+	BenchRun empty;
+	CHECK (!ParseBenchJson ("{\"items\": 3}", empty));
+}
+
+
+TEST (BaselineFlagsSlowerStages)
+{
+	BenchRun baseline;
+	baseline.stages.push_back (MakeStage ("read + parse", 20.0));
+	baseline.stages.push_back (MakeStage ("diff", 10.0));
+	baseline.stages.push_back (MakeStage ("fingerprint", 0.1));
+
+	BenchRun current;
+	current.stages.push_back (MakeStage ("read + parse", 24.0));	// 1.2x: within 1.25
+	current.stages.push_back (MakeStage ("diff", 13.0));			// 1.3x: slower
+	current.stages.push_back (MakeStage ("fingerprint", 0.3));		// 3x but under the noise floor
+	current.stages.push_back (MakeStage ("new stage", 50.0));		// not in the baseline
+
+	std::vector<BaselineComparison> result;
+	CHECK (!CompareWithBaseline (current, baseline, 1.25, 0.5, result));
+	CHECK_EQ (result.size (), 4u);
+	if (result.size () == 4) {
+		CHECK (!result[0].regressed);
+		CHECK (result[1].regressed);
+		CHECK (std::abs (result[1].ratio - 1.3) < 1e-9);
+		CHECK (!result[2].regressed);
+		CHECK (!result[3].regressed && result[3].baselineMs == 0.0);
+	}
+
+	current.stages[1].bestMs = 12.0;
+	CHECK (CompareWithBaseline (current, baseline, 1.25, 0.5, result));
+}
+
+
+int main ()
+{
+	return RunAllTests ();
+}
@@ -0,0 +1,209 @@
+#include "TestHarness.hpp"
+#include "ChangeLog.hpp"
+#include "ChangeLogIndex.hpp"
+#include "FileSystem.hpp"
+#include "MasterHistory.hpp"
+#include "XmlReader.hpp"
+
+#include <cstdio>
+#include <ctime>
+
+
+// ---------------------------------------------------------------------------
+// Changelog writer, per-item index and point-in-time reconstruction
+// ---------------------------------------------------------------------------
+
+TEST (RecordsAreIndexedPerItem)
+{
+	TempDir dir;
+	std::string xmlPath = dir.File ("Master.xml");
+
+	{
+		ChangeLogBatch batch;
+		LogExport (xmlPath, "A.1", "Birch", "A");
+		LogUseProject (xmlPath, "A.1", "Birch", "Silver birch");
+		LogUseServer (xmlPath, "B.2", "Oak (project)", "Oak");
+		LogImport (xmlPath, "", "");
+	}
+	FlushChangeLog ();
+
+	ChangeLogIndex index;
+	CHECK (index.Update (dir.File ("changelog")));
+
+	std::vector<HistoryEntry> history = index.Query ("A.1");
+	CHECK_EQ (history.size (), 2u);
+	if (history.size () == 2) {
+		CHECK_EQ (history[0].action, "export");
+		CHECK_EQ (history[0].parentId, "A");
+		CHECK_EQ (history[1].action, "use-project");
+		CHECK_EQ (history[1].oldValue, "Birch");
+		CHECK_EQ (history[1].newValue, "Silver birch");
+	}
+	CHECK_EQ (index.Query ("B.2").size (), 1u);
+	CHECK (index.Query ("C.3").empty ());
+
+	// Appended records are picked up incrementally
+	LogExport (xmlPath, "B.2.1", "Red oak", "B.2");
+	FlushChangeLog ();
+	CHECK (index.Update (dir.File ("changelog")));
+	CHECK_EQ (index.Query ("B.2.1").size (), 1u);
+
+	// A fresh index reads the sidecar and agrees
+	ChangeLogIndex reopened;
+	CHECK (reopened.Update (dir.File ("changelog")));
+	CHECK_EQ (reopened.Query ("A.1").size (), 2u);
+	CHECK_EQ (reopened.Query ("B.2.1").size (), 1u);
+}
+
+
+TEST (UpgradeDayKeepsLegacyEntries)
+{
+	TempDir dir;
+	std::string logDir = dir.File ("changelog");
+	std::filesystem::create_directories (logDir);
+
+	// The .txt holds an entry from before the upgrade and a copy of the .jsonl record
+	WriteTextFile (JoinPath (logDir, "2026-03-02.txt"),
+		"[08:15:00] anna\n  Export: A.1 \"Birch\"\n  Parent: A\n\n"
+		"[09:30:00] anna\n  Use Project (resolve conflict): A.1\n  Server name: \"Birch\"\n  Project name: \"Silver birch\"\n\n");
+	WriteTextFile (JoinPath (logDir, "2026-03-02.jsonl"),
+		"{\"seq\":1,\"ts\":\"2026-03-02T09:30:00\",\"session\":\"s\",\"user\":\"anna\",\"action\":\"use-project\","
+		"\"item\":\"A.1\",\"parent\":\"\",\"old\":\"Birch\",\"new\":\"Silver birch\"}\n");
+
+	ChangeLogIndex index;
+	CHECK (index.Update (logDir));
+	std::vector<HistoryEntry> history = index.Query ("A.1");
+	CHECK_EQ (history.size (), 2u);
+	if (history.size () == 2) {
+		CHECK_EQ (history[0].time, "08:15:00");
+		CHECK_EQ (history[0].action, "export");
+		CHECK_EQ (history[1].time, "09:30:00");
+		CHECK_EQ (history[1].newValue, "Silver birch");
+	}
+}
+
+
+TEST (DeletedDirectoryIsCreatedAgain)
+{
+	TempDir dir;
+	std::string xmlPath = dir.File ("Master.xml");
+
+	LogExport (xmlPath, "A.1", "Birch", "A");
+	FlushChangeLog ();
+
+	// The folder goes away during the session: later records recreate it
+	CHECK (std::rename (dir.File ("changelog").c_str (), dir.File ("moved").c_str ()) == 0);
+	LogExport (xmlPath, "B.2", "Oak", "B");
+	FlushChangeLog ();
+
+	ChangeLogIndex index;
+	CHECK (index.Update (dir.File ("changelog")));
+	CHECK_EQ (index.Query ("B.2").size (), 1u);
+	CHECK (index.Query ("A.1").empty ());
+}
+
+
+TEST (JsonLineParsing)
+{
+	HistoryEntry e = ParseChangeLogJsonLine (
+		"{\"seq\":3,\"ts\":\"2026-03-01T12:34:56\",\"session\":\"42\",\"user\":\"u (pc)\","
+		"\"action\":\"use-project\",\"item\":\"DR.L.01\",\"parent\":\"\",\"old\":\"A \\\"q\\\"\",\"new\":\"B\"}",
+		"2026-03-01");
+	CHECK_EQ (e.time, "12:34:56");
+	CHECK_EQ (e.action, "use-project");
+	CHECK_EQ (e.itemId, "DR.L.01");
+	CHECK_EQ (e.oldValue, "A \"q\"");
+	CHECK_EQ (e.newValue, "B");
+}
+
+
+TEST (TimeKeys)
+{
+	std::string key;
+	CHECK (ParseTimeKey ("2026-03-01", key));
+	CHECK_EQ (key, "2026-03-01T23:59:59");
+	CHECK (ParseTimeKey ("2026-03-01 08:15", key));
+	CHECK_EQ (key, "2026-03-01T08:15:00");
+	CHECK (!ParseTimeKey ("yesterday", key));
+}
+
+
+TEST (ReconstructFromSnapshotAndRecords)
+{
+	TempDir dir;
+	std::string xmlPath = CopyMaster (dir);
+	std::string logDir  = dir.File ("changelog");
+
+	MasterVersion version;
+	std::vector<ClassificationTree> master = ReadXmlClassifications (xmlPath.c_str (), &version);
+	CHECK (WriteMasterSnapshotIfDue (logDir, master, version, 0));
+	CHECK (!WriteMasterSnapshotIfDue (logDir, master, version, 3600));
+
+	LogExport (xmlPath, "DRZ.ZZ", "Leaf", "DRZ");
+	LogUseProject (xmlPath, "DR.L.01", "BRZOZY", "BIRCHES");
+	LogExport (xmlPath, "X.1", "Orphan", "NO.SUCH.PARENT");
+	FlushChangeLog ();
+
+	std::vector<ClassificationTree> past;
+	ReplayResult result;
+	std::string  error;
+	CHECK (ReconstructMasterAt (logDir, FormatTimeKey ((std::int64_t)std::time (nullptr) + 1), past, result, error));
+	CHECK_EQ (result.recordsApplied, 2u);
+	CHECK_EQ (result.recordsSkipped, 1u);
+	if (past.empty ()) {
+		CHECK (false);
+		return;
+	}
+
+	const ClassificationNode* drz = FindNode (past[0].rootItems, "DRZ");
+	CHECK (drz != nullptr && FindNode (drz->children, "DRZ.ZZ") != nullptr);
+	const ClassificationNode* birches = FindNode (past[0].rootItems, "DR.L.01");
+	CHECK (birches != nullptr && birches->name == "BIRCHES");
+
+	// Before the first snapshot there is nothing to start from
+	CHECK (!ReconstructMasterAt (logDir, "2000-01-01T00:00:00", past, result, error));
+	CHECK (!error.empty ());
+}
+
+
+TEST (ReplayKeepsNaturalSiblingOrder)
+{
+	TempDir dir;
+	std::string xmlPath = CopyMaster (dir);
+	std::string logDir  = dir.File ("changelog");
+
+	MasterVersion version;
+	std::vector<ClassificationTree> master = ReadXmlClassifications (xmlPath.c_str (), &version);
+	CHECK (WriteMasterSnapshotIfDue (logDir, master, version, 0));
+
+	LogExport (xmlPath, "DRZ.10", "Ten", "DRZ");
+	LogExport (xmlPath, "DRZ.9", "Nine", "DRZ");
+	FlushChangeLog ();
+
+	std::vector<ClassificationTree> past;
+	ReplayResult result;
+	std::string  error;
+	CHECK (ReconstructMasterAt (logDir, FormatTimeKey ((std::int64_t)std::time (nullptr) + 1), past, result, error));
+	const ClassificationNode* drz = past.empty () ? nullptr : FindNode (past[0].rootItems, "DRZ");
+	CHECK (drz != nullptr);
+	if (drz == nullptr)
+		return;
+
+	int nine = -1, ten = -1;
+	for (size_t i = 0; i < drz->children.size (); i++) {
+		if (drz->children[i].id == "DRZ.9")
+			nine = (int)i;
+		else if (drz->children[i].id == "DRZ.10")
+			ten = (int)i;
+	}
+	CHECK (nine >= 0 && ten >= 0);
+	CHECK (nine < ten);
+}
+
+
+int main ()
+{
+	int failures = RunAllTests ();
+	ShutdownChangeLog ();
+	return failures;
+}
@@ -0,0 +1,542 @@
+#include "BenchBaseline.hpp"
+#include "ChangeLog.hpp"
+#include "ChangeLogIndex.hpp"
+#include "ClassificationModel.hpp"
+#include "MasterGenerator.hpp"
+#include "MemoryStats.hpp"
+#include "Report.hpp"
+#include "ShardedMaster.hpp"
+#include "Trace.hpp"
+#include "TreeReconcile.hpp"
+#include "XmlReader.hpp"
+#include "XmlWriter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// classsync_bench - timings of the core refresh/commit stages
+//
+//   classsync_bench [options] <master.xml|.manifest> [iterations]
+//   classsync_bench [options] --generate <items> [iterations]
+//   classsync_bench generate <out.xml> --items <n> [generator options]
+//
+// Stages: read + parse (or sharded cold/cached), fingerprint, diff, import
+// fragment, batch write, changelog append, changelog index, tree reconcile.
+// Each reports best/mean ms, bytes/s where bytes are read or written, and
+// heap allocations, allocated bytes and peak heap growth per iteration
+// (MemoryStats.hpp; every allocation in the process is counted, including
+// the changelog writer thread while a stage waits for it). The resident
+// size of the parsed master, the project copy and the diff is printed too.
+// Writes go to copies in a scratch directory, never to the master itself.
+//
+// Options:
+//   --json <file>          save the run as JSON (a baseline for later runs)
+//   --baseline <file>      compare against a saved run, exit 1 on regression
+//   --threshold <ratio>    best-time ratio that counts as slower (1.25)
+//   --noise-ms <ms>        ignore smaller absolute differences (0.5)
+//   --trace <file>         write the core trace spans as Chrome trace JSON
+// Generator options (see MasterGenerator.hpp):
+//   --depth <n> --name-length <bytes> --refs <per item> --ascii --seed <n>
+//
+// Build RelWithDebInfo and run it under perf record -g or
+// valgrind --tool=callgrind to profile one stage in isolation.
+// ---------------------------------------------------------------------------
+
+static void DropReportLine (const std::string&) {}
+
+
+// ---------------------------------------------------------------------------
+// Helpers
+// ---------------------------------------------------------------------------
+
+// Scratch directory for copies and changelogs, removed on exit
+class ScratchDir {
+public:
+	ScratchDir ()
+	{
+		auto stamp = std::chrono::steady_clock::now ().time_since_epoch ().count ();
+		path = std::filesystem::temp_directory_path () / ("classsync-bench-" + std::to_string ((long long)stamp));
+		std::filesystem::create_directories (path);
+	}
+
+	~ScratchDir ()
+	{
+		std::error_code ec;
+		std::filesystem::remove_all (path, ec);
+	}
+
+	std::string  File (const std::string& name) const { return (path / name).string (); }
+
+private:
+	std::filesystem::path  path;
+};
+
+
+static std::uint64_t FileSize (const std::string& path)
+{
+	std::error_code ec;
+	std::uintmax_t size = std::filesystem::file_size (path, ec);
+	return ec ? 0 : (std::uint64_t)size;
+}
+
+static std::uint64_t DirectorySize (const std::string& path)
+{
+	std::uint64_t total = 0;
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator (path, ec)) {
+		if (entry.is_regular_file (ec))
+			total += FileSize (entry.path ().string ());
+	}
+	return total;
+}
+
+
+// Time stage () over iterations; prepare () runs before each one, untimed.
+// bytes is per iteration (0 when the stage does no I/O).
+static BenchStage& TimeStage (BenchRun& run, const char* name, int iterations, std::uint64_t bytes,
+							  const std::function<void ()>& stage,
+							  const std::function<void ()>& prepare = nullptr)
+{
+	BenchStage timing;
+	timing.name  = name;
+	timing.bytes = bytes;
+
+	double totalMs = 0.0;
+	std::uint64_t allocations = 0;
+	std::uint64_t allocBytes  = 0;
+	for (int i = 0; i < iterations; i++) {
+		if (prepare)
+			prepare ();
+		ResetHeapPeak ();
+		AllocationStats before = GetHeapTotals ();
+		auto start = std::chrono::steady_clock::now ();
+		stage ();
+		double ms = std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now () - start).count ();
+		AllocationStats after = GetHeapTotals ();
+		allocations += after.allocations - before.allocations;
+		allocBytes  += after.bytes - before.bytes;
+		std::int64_t peak = after.peakBytes - before.netBytes;
+		if (peak > 0 && (std::uint64_t)peak > timing.peakBytes)
+			timing.peakBytes = (std::uint64_t)peak;
+		totalMs += ms;
+		if (i == 0 || ms < timing.bestMs)
+			timing.bestMs = ms;
+	}
+	timing.meanMs     = totalMs / iterations;
+	timing.allocs     = allocations / iterations;
+	timing.allocBytes = allocBytes / iterations;
+	run.stages.push_back (timing);
+	return run.stages.back ();
+}
+
+
+static void CollectNodes (const std::vector<ClassificationNode>& nodes, std::vector<const ClassificationNode*>& out)
+{
+	for (const ClassificationNode& node : nodes) {
+		out.push_back (&node);
+		CollectNodes (node.children, out);
+	}
+}
+
+
+// Every 7th item renamed, every 11th removed: a project with all statuses
+static void MutateNodes (std::vector<ClassificationNode>& nodes, size_t& counter)
+{
+	for (size_t i = 0; i < nodes.size (); ) {
+		counter++;
+		if (counter % 11 == 0 && nodes[i].children.empty ()) {
+			nodes.erase (nodes.begin () + i);
+			continue;
+		}
+		if (counter % 7 == 0)
+			nodes[i].name += " (project)";
+		MutateNodes (nodes[i].children, counter);
+		i++;
+	}
+}
+
+
+static void BuildView (const std::vector<ClassificationNode>& nodes, ViewNode& parent)
+{
+	for (const ClassificationNode& node : nodes) {
+		ViewNode view;
+		view.key  = node.id;
+		view.text = node.id + "  -  " + node.name;
+		BuildView (node.children, view);
+		parent.children.push_back (std::move (view));
+	}
+}
+
+
+static bool ReadFile (const std::string& path, std::string& content)
+{
+	std::ifstream file (path, std::ios::binary);
+	if (!file)
+		return false;
+	std::ostringstream buffer;
+	buffer << file.rdbuf ();
+	content = buffer.str ();
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Command line
+// ---------------------------------------------------------------------------
+
+struct BenchOptions {
+	std::string             masterPath;
+	std::string             generateTo;		// "generate" command: output file
+	std::uint64_t           generateItems;	// 0 = use masterPath
+	int                     iterations;
+	std::string             jsonPath;
+	std::string             baselinePath;
+	std::string             tracePath;
+	double                  threshold;
+	double                  noiseMs;
+	MasterGeneratorOptions  generator;
+
+	BenchOptions () : generateItems (0), iterations (10), threshold (1.25), noiseMs (0.5) {}
+};
+
+static void PrintUsage ()
+{
+	std::fprintf (stderr,
+		"usage: classsync_bench [options] <master.xml|.manifest> [iterations]\n"
+		"       classsync_bench [options] --generate <items> [iterations]\n"
+		"       classsync_bench generate <out.xml> --items <n> [generator options]\n"
+		"options:   --json <file> --baseline <file> --threshold <ratio> --noise-ms <ms> --trace <file>\n"
+		"generator: --depth <n> --name-length <bytes> --refs <per item> --ascii --seed <n>\n");
+}
+
+static bool ParseOptions (int argc, char** argv, BenchOptions& options)
+{
+	std::vector<std::string> positional;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--ascii") {
+			options.generator.diacritics = false;
+		} else if (arg.compare (0, 2, "--") == 0 && !hasValue) {
+			std::fprintf (stderr, "classsync_bench: %s needs a value\n", arg.c_str ());
+			return false;
+		} else if (arg == "--json") {
+			options.jsonPath = argv[++i];
+		} else if (arg == "--baseline") {
+			options.baselinePath = argv[++i];
+		} else if (arg == "--trace") {
+			options.tracePath = argv[++i];
+		} else if (arg == "--threshold") {
+			options.threshold = std::atof (argv[++i]);
+		} else if (arg == "--noise-ms") {
+			options.noiseMs = std::atof (argv[++i]);
+		} else if (arg == "--generate" || arg == "--items") {
+			options.generateItems = std::strtoull (argv[++i], nullptr, 10);
+		} else if (arg == "--depth") {
+			options.generator.depth = std::atoi (argv[++i]);
+		} else if (arg == "--name-length") {
+			options.generator.nameLength = (size_t)std::strtoull (argv[++i], nullptr, 10);
+		} else if (arg == "--refs") {
+			options.generator.refsPerItem = std::atof (argv[++i]);
+		} else if (arg == "--seed") {
+			options.generator.seed = (std::uint32_t)std::strtoul (argv[++i], nullptr, 10);
+		} else if (arg.compare (0, 2, "--") == 0) {
+			std::fprintf (stderr, "classsync_bench: unknown option %s\n", arg.c_str ());
+			return false;
+		} else {
+			positional.push_back (arg);
+		}
+	}
+
+	if (!positional.empty () && positional[0] == "generate") {
+		if (positional.size () != 2 || options.generateItems == 0)
+			return false;
+		options.generateTo = positional[1];
+		return true;
+	}
+
+	size_t next = 0;
+	if (options.generateItems == 0) {
+		if (positional.empty ())
+			return false;
+		options.masterPath = positional[next++];
+	}
+	if (next < positional.size ())
+		options.iterations = std::max (1, std::atoi (positional[next++].c_str ()));
+	return next == positional.size () && options.threshold > 0.0;
+}
+
+
+static bool Generate (const std::string& path, const BenchOptions& options)
+{
+	MasterGeneratorOptions generator = options.generator;
+	generator.items = options.generateItems;
+
+	MasterGeneratorStats stats = {};
+	auto start = std::chrono::steady_clock::now ();
+	if (!WriteGeneratedMaster (path, generator, &stats)) {
+		std::fprintf (stderr, "classsync_bench: cannot write %s\n", path.c_str ());
+		return false;
+	}
+	double ms = std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now () - start).count ();
+	std::printf ("generated %s: %llu item(s), depth %d, %llu reference(s), %.1f MB in %.0f ms\n",
+				 path.c_str (), (unsigned long long)stats.items, stats.maxDepth,
+				 (unsigned long long)stats.references, stats.bytes / 1048576.0, ms);
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Output
+// ---------------------------------------------------------------------------
+
+static void PrintRun (const BenchRun& run, size_t diffCount)
+{
+	std::printf ("%s: %llu item(s), %u diff entries, %d iteration(s)\n",
+				 run.master.c_str (), (unsigned long long)run.items, (unsigned)diffCount, run.iterations);
+	std::printf ("%-24s %10s %10s %10s %12s %12s %10s\n", "stage", "best ms", "mean ms", "MB/s", "allocs/iter",
+				 "alloc MB", "peak MB");
+	for (const BenchStage& stage : run.stages) {
+		char rate[32] = "-";
+		if (stage.bytes > 0)
+			std::snprintf (rate, sizeof (rate), "%.1f", stage.BytesPerSec () / 1048576.0);
+		std::printf ("%-24s %10.2f %10.2f %10s %12llu %12.2f %10.2f\n", stage.name.c_str (), stage.bestMs, stage.meanMs,
+					 rate, (unsigned long long)stage.allocs, stage.allocBytes / 1048576.0, stage.peakBytes / 1048576.0);
+	}
+}
+
+// 0 = within threshold, 1 = regression, 2 = baseline unreadable
+static int CompareAndPrint (const BenchRun& run, const BenchOptions& options)
+{
+	std::string json;
+	BenchRun baseline;
+	if (!ReadFile (options.baselinePath, json) || !ParseBenchJson (json, baseline)) {
+		std::fprintf (stderr, "classsync_bench: cannot read baseline %s\n", options.baselinePath.c_str ());
+		return 2;
+	}
+	if (baseline.items != run.items)
+		std::printf ("note: baseline has %llu item(s), this run %llu\n",
+					 (unsigned long long)baseline.items, (unsigned long long)run.items);
+
+	std::vector<BaselineComparison> comparisons;
+	bool passed = CompareWithBaseline (run, baseline, options.threshold, options.noiseMs, comparisons);
+
+	std::printf ("\nbaseline %s (threshold x%.2f, noise %.2f ms)\n",
+				 options.baselinePath.c_str (), options.threshold, options.noiseMs);
+	std::printf ("%-24s %10s %10s %8s\n", "stage", "base ms", "best ms", "ratio");
+	for (const BaselineComparison& comparison : comparisons) {
+		if (comparison.baselineMs <= 0.0) {
+			std::printf ("%-24s %10s %10.2f %8s\n", comparison.name.c_str (), "-", comparison.currentMs, "new");
+			continue;
+		}
+		std::printf ("%-24s %10.2f %10.2f %7.2fx%s\n", comparison.name.c_str (), comparison.baselineMs,
+					 comparison.currentMs, comparison.ratio, comparison.regressed ? "  SLOWER" : "");
+	}
+	std::printf ("%s\n", passed ? "baseline: ok" : "baseline: REGRESSION");
+	return passed ? 0 : 1;
+}
+
+
+// ---------------------------------------------------------------------------
+// Main
+// ---------------------------------------------------------------------------
+
+int main (int argc, char** argv)
+{
+	BenchOptions options;
+	if (!ParseOptions (argc, argv, options)) {
+		PrintUsage ();
+		return 2;
+	}
+	if (std::getenv ("CLASSSYNC_BENCH_VERBOSE") == nullptr)
+		SetReportSink (DropReportLine);
+	if (!options.tracePath.empty ()) {
+		SetTraceEnabled (true);
+		SetTraceThreadName ("bench");
+	}
+	SetAllocationCounting (true);
+
+	if (!options.generateTo.empty ())
+		return Generate (options.generateTo, options) ? 0 : 1;
+
+	ScratchDir scratch;
+	std::string masterPath = options.masterPath;
+	if (options.generateItems > 0) {
+		masterPath = scratch.File ("Generated.xml");
+		if (!Generate (masterPath, options))
+			return 1;
+	}
+
+	int iterations = options.iterations;
+	bool sharded = IsShardedMaster (masterPath.c_str ());
+	ShardedMasterCache cache;
+
+	std::vector<ClassificationTree> master = sharded
+		? ReadShardedClassifications (masterPath.c_str (), cache)
+		: ReadXmlClassifications (masterPath.c_str ());
+	if (master.empty ()) {
+		std::fprintf (stderr, "classsync_bench: cannot read %s\n", masterPath.c_str ());
+		return 1;
+	}
+
+	std::vector<ClassificationTree> project = master;
+	size_t counter = 0;
+	for (ClassificationTree& tree : project)
+		MutateNodes (tree.rootItems, counter);
+
+	std::vector<const ClassificationNode*> nodes;
+	for (const ClassificationTree& tree : master)
+		CollectNodes (tree.rootItems, nodes);
+	std::vector<std::string> ids;
+	for (const ClassificationNode* node : nodes)
+		ids.push_back (node->id);
+
+	BenchRun run;
+	run.master     = options.generateItems > 0 ? "generated:" + std::to_string ((unsigned long long)options.generateItems) : masterPath;
+	run.items      = ids.size ();
+	run.iterations = iterations;
+	volatile std::uint64_t sink = 0;
+
+	if (!sharded) {
+		TimeStage (run, "read + parse", iterations, FileSize (masterPath), [&] {
+			MasterVersion version;
+			sink = sink + ReadXmlClassifications (masterPath.c_str (), &version).size ();
+		});
+	} else {
+		TimeStage (run, "sharded read (cold)", iterations, 0, [&] {
+			ShardedMasterCache cold;
+			sink = sink + ReadShardedClassifications (masterPath.c_str (), cold).size ();
+		});
+		TimeStage (run, "sharded read (cached)", iterations, 0, [&] {
+			sink = sink + ReadShardedClassifications (masterPath.c_str (), cache).size ();
+		});
+	}
+
+	TimeStage (run, "fingerprint", iterations, 0, [&] {
+		sink = sink + HashClassifications (master);
+	});
+
+	std::vector<DiffEntry> diff;
+	TimeStage (run, "diff", iterations, 0, [&] {
+		diff = CompareClassifications (project, master);
+	});
+
+	std::string fragment;
+	BenchStage& fragmentStage = TimeStage (run, "import fragment (all)", iterations, 0, [&] {
+		fragment.clear ();
+		sink = sink + FormatImportFragment (master, ids, fragment);
+	});
+	fragmentStage.bytes = fragment.size ();
+
+	// Batch rename of every 50th item on a copy, alternating between the
+	// original and the edited names so each iteration writes real changes
+	if (!sharded) {
+		std::string copyPath = scratch.File ("Write.xml");
+		std::filesystem::copy_file (masterPath, copyPath);
+		std::string content;
+		MasterVersion version;
+		std::vector<MasterEdit> edits;
+		bool edited = false;
+
+		TimeStage (run, "batch write (2% renamed)", iterations, FileSize (copyPath), [&] {
+			sink = sink + (int)ApplyEditsToXml (copyPath.c_str (), version, edits);
+			edited = !edited;
+		}, [&] {
+			ReadFile (copyPath, content);
+			version = ComputeMasterVersion (content);
+			edits.clear ();
+			for (size_t i = 0; i < nodes.size (); i += 50) {
+				MasterEdit edit;
+				edit.kind     = MasterEditKind::ChangeName;
+				edit.itemId   = nodes[i]->id;
+				edit.baseName = edited ? nodes[i]->name + " *" : nodes[i]->name;
+				edit.newName  = edited ? nodes[i]->name : nodes[i]->name + " *";
+				edits.push_back (edit);
+			}
+		});
+	}
+
+	// Changelog: one export record per 50 items (at least 100) per iteration
+	std::string logMaster = scratch.File ("Log.xml");
+	std::string logDir    = scratch.File ("changelog");
+	size_t records = std::max<size_t> (100, nodes.size () / 50);
+	BenchStage& logStage = TimeStage (run, "changelog append", iterations, 0, [&] {
+		{
+			ChangeLogBatch batch;
+			for (size_t i = 0; i < records; i++) {
+				const ClassificationNode* node = nodes[i % nodes.size ()];
+				LogExport (logMaster, node->id, node->name, std::string ());
+			}
+		}
+		FlushChangeLog ();
+	});
+	std::uint64_t logBytes = DirectorySize (logDir);
+	logStage.bytes = logBytes / iterations;
+
+	TimeStage (run, "changelog index (cold)", iterations, logBytes, [&] {
+		ChangeLogIndex index;
+		index.Update (logDir);
+		for (size_t i = 0; i < nodes.size (); i += std::max<size_t> (1, nodes.size () / 100))
+			sink = sink + index.Query (nodes[i]->id).size ();
+	}, [&] {
+		std::error_code ec;
+		std::filesystem::remove (std::filesystem::path (logDir) / "history.idx", ec);
+	});
+	ShutdownChangeLog ();
+
+	TimeStage (run, "tree reconcile", iterations, 0, [&] {
+		ViewNode displayed;
+		ViewNode first;
+		for (const ClassificationTree& tree : master)
+			BuildView (tree.rootItems, first);
+		std::vector<TreeMutation> mutations;
+		ReconcileStats stats = {};
+		first.item = 0;
+		ReconcileViews (displayed, first, mutations, stats);
+		displayed = std::move (first);
+
+		ViewNode next;
+		for (const ClassificationTree& tree : master)
+			BuildView (tree.rootItems, next);
+		mutations.clear ();
+		next.item = 0;
+		ReconcileViews (displayed, next, mutations, stats);
+		sink = sink + mutations.size ();
+	});
+
+	PrintRun (run, diff.size ());
+	std::printf ("resident: master %s, project %s, diff %s, shard cache %s\n",
+				 FormatByteSize ((std::int64_t)EstimateModelBytes (master)).c_str (),
+				 FormatByteSize ((std::int64_t)EstimateModelBytes (project)).c_str (),
+				 FormatByteSize ((std::int64_t)EstimateDiffBytes (diff)).c_str (),
+				 FormatByteSize ((std::int64_t)EstimateShardCacheBytes (cache)).c_str ());
+
+	if (!options.jsonPath.empty ()) {
+		std::ofstream file (options.jsonPath, std::ios::binary | std::ios::trunc);
+		file << FormatBenchJson (run);
+		if (!file) {
+			std::fprintf (stderr, "classsync_bench: cannot write %s\n", options.jsonPath.c_str ());
+			return 1;
+		}
+	}
+
+	if (!options.tracePath.empty () && !WriteTraceJson (options.tracePath)) {
+		std::fprintf (stderr, "classsync_bench: cannot write %s\n", options.tracePath.c_str ());
+		return 1;
+	}
+
+	if (!options.baselinePath.empty ())
+		return CompareAndPrint (run, options);
+	return 0;
+}
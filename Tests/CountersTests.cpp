@@ -0,0 +1,116 @@
+#include "TestHarness.hpp"
+#include "Counters.hpp"
+#include "ChangeLog.hpp"
+#include "FileLock.hpp"
+#include "MasterVersion.hpp"
+#include "XmlReader.hpp"
+#include "XmlWriter.hpp"
+
+
+// ---------------------------------------------------------------------------
+// Diagnostic counters: registry, snapshots, JSON, and the I/O sites
+// ---------------------------------------------------------------------------
+
+TEST (CountersAndGauges)
+{
+	ResetCounters ();
+	AddCounter (Counter::MasterReads);
+	AddCounter (Counter::MasterBytesRead, 100);
+	SetCounter (Counter::ProjectItems, 490);
+	CounterSnapshot before = TakeCounterSnapshot ();
+
+	AddCounter (Counter::MasterReads, 2);
+	SetCounter (Counter::ProjectItems, 12);
+	CounterSnapshot delta = SubtractCounterSnapshot (TakeCounterSnapshot (), before);
+	CHECK_EQ (delta.Get (Counter::MasterReads), 2u);
+	CHECK_EQ (delta.Get (Counter::MasterBytesRead), 0u);
+	CHECK_EQ (delta.Get (Counter::ProjectItems), 12u);		// gauges keep the latest value
+
+	// Activity lists the counters that moved, never gauges
+	CHECK_EQ (FormatCounterActivity (delta), "master_reads 2");
+	CHECK (IsGauge (Counter::DiffConflicts) && !IsGauge (Counter::ChangeLogAppends));
+
+	ResetCounters ();
+	CHECK_EQ (GetCounter (Counter::MasterReads), 0u);
+	CHECK_EQ (FormatCounterActivity (TakeCounterSnapshot ()), "");
+}
+
+
+TEST (JsonListsEveryCounter)
+{
+	ResetCounters ();
+	AddCounter (Counter::LockFileReads, 7);
+	std::string json = FormatCountersJson (TakeCounterSnapshot ());
+	CHECK (json.find ("{\"counters\": {") == 0);
+	CHECK (json.find ("\"lock_file_reads\": 7,") != std::string::npos);
+	CHECK (json.find ("\"property_drift\": 0\n}}") != std::string::npos);
+	for (size_t i = 0; i < kCounterCount; i++)
+		CHECK (json.find ("\"" + std::string (CounterName ((Counter)i)) + "\":") != std::string::npos);
+
+	TempDir dir;
+	CHECK (WriteCountersJson (dir.File ("counters.json"), TakeCounterSnapshot ()));
+	CHECK_EQ (ReadTextFile (dir.File ("counters.json")), json);
+	CHECK (!WriteCountersJson (dir.File ("missing/counters.json"), TakeCounterSnapshot ()));
+}
+
+
+TEST (MasterReadAndRewriteAreCounted)
+{
+	TempDir dir;
+	std::string path = CopyMaster (dir);
+	size_t size = ReadTextFile (path).size ();
+
+	ResetCounters ();
+	MasterVersion version;
+	ReadXmlClassifications (path.c_str (), &version);
+	ReadMasterStamp (path);
+	CHECK_EQ (GetCounter (Counter::MasterReads), 1u);
+	CHECK_EQ (GetCounter (Counter::MasterBytesRead), size);
+	CHECK_EQ (GetCounter (Counter::MasterStats), 1u);
+	CHECK_EQ (GetCounter (Counter::MasterWrites), 0u);
+
+	// Two edits, one rewrite
+	MasterEdit rename;
+	rename.itemId   = "DRZ";
+	rename.baseName = "DRZEWA";
+	rename.newName  = "TREES";
+	MasterEdit second = rename;
+	second.itemId   = "DR.L.01";
+	second.baseName = "BRZOZY";
+	second.newName  = "BIRCHES";
+	std::vector<MasterEdit> edits = { rename, second };
+	CHECK (ApplyEditsToXml (path.c_str (), version, edits) == CommitResult::Committed);
+	CHECK_EQ (GetCounter (Counter::MasterWrites), 1u);
+	CHECK_EQ (GetCounter (Counter::MasterBytesWritten), ReadTextFile (path).size ());
+	CHECK (GetCounter (Counter::CommitGuardAttempts) >= 1u);
+}
+
+
+TEST (LockAndChangeLogAreCounted)
+{
+	TempDir dir;
+	std::string xmlPath = dir.File ("Master.xml");
+
+	ResetCounters ();
+	GetLockInfo (xmlPath);
+	CHECK (AcquireLock (xmlPath));
+	CHECK (ReleaseLock (xmlPath));
+	CHECK_EQ (GetCounter (Counter::LockFileReads), 3u);		// info, check before create, owner check
+	CHECK_EQ (GetCounter (Counter::LockFileWrites), 1u);
+
+	{
+		ChangeLogBatch batch;
+		LogExport (xmlPath, "A.1", "Birch", "A");
+		LogExport (xmlPath, "A.2", "Oak", "A");
+	}
+	FlushChangeLog ();
+	CHECK_EQ (GetCounter (Counter::ChangeLogRecords), 2u);
+	CHECK_EQ (GetCounter (Counter::ChangeLogAppends), 2u);		// one .txt and one .jsonl append
+	CHECK (GetCounter (Counter::ChangeLogBytesWritten) > 0u);
+}
+
+
+int main ()
+{
+	return RunAllTests ();
+}
@@ -0,0 +1,176 @@
+#include "TestHarness.hpp"
+#include "EnumRemap.hpp"
+#include "RefreshWorker.hpp"
+#include "XmlReader.hpp"
+
+#include <algorithm>
+
+
+// ---------------------------------------------------------------------------
+// Enumeration values: normalized text match, GUID translation, per-project cache
+// ---------------------------------------------------------------------------
+
+static const char* kBulbs = "ROŚLINY CEBULOWE";
+
+
+// The master's definitions as another project has them: every enumeration
+// key replaced, display texts in another case and spacing, values reversed
+static std::vector<PropertyDefinitionInfo> MakeProject (const std::vector<PropertyDefinitionInfo>& master, const std::string& tag)
+{
+	std::vector<PropertyDefinitionInfo> project = master;
+	for (PropertyDefinitionInfo& definition : project) {
+		for (EnumValueInfo& value : definition.enumValues) {
+			value.key  = tag + value.key;
+			value.text = "  " + value.text + " ";
+		}
+		std::reverse (definition.enumValues.begin (), definition.enumValues.end ());
+	}
+	return project;
+}
+
+
+TEST (TextIsNormalized)
+{
+	CHECK_EQ (NormalizeEnumText ("  Czosnek   GŁÓWKOWATY \t"), "czosnek główkowaty");
+	CHECK_EQ (NormalizeEnumText ("ŻÓŁĆ ĄĘŚŃŹ"), "żółć ąęśńź");
+	CHECK_EQ (NormalizeEnumText ("Mix cebul: Tulipany, Narcyze"), "mix cebul: tulipany, narcyze");
+	CHECK_EQ (NormalizeEnumText ("3"), "3");
+	CHECK_EQ (NormalizeEnumText ("   "), "");
+}
+
+
+TEST (MasterEnumValuesAreRead)
+{
+	std::vector<PropertyDefinitionInfo> master = ReadDefinitions (CLASSSYNC_MASTER_XML);
+	PropertyDefinitionInfo* bulbs = FindDefinition (master, kBulbs);
+	CHECK (bulbs != nullptr);
+	if (bulbs != nullptr && bulbs->enumValues.size () >= 2) {
+		CHECK_EQ (bulbs->enumValues[0].key, "62382B6E-EE9B-4E03-8375-A086AD65AFB6");
+		CHECK_EQ (bulbs->enumValues[0].text, "Czosnek główkowaty");
+		CHECK_EQ (bulbs->enumValues[1].text, "Mix cebul: Tulipany, Narcyze");
+	}
+
+	size_t enumerations = std::count_if (master.begin (), master.end (),
+										 [] (const PropertyDefinitionInfo& d) { return !d.enumValues.empty (); });
+	CHECK_EQ (enumerations, 7u);
+	PropertyDefinitionInfo* single = FindDefinition (master, "ID");
+	CHECK (single != nullptr && single->enumValues.empty ());
+}
+
+
+TEST (TableTranslatesKeys)
+{
+	std::vector<PropertyDefinitionInfo> master  = ReadDefinitions (CLASSSYNC_MASTER_XML);
+	std::vector<PropertyDefinitionInfo> project = MakeProject (master, "P-");
+
+	PropertyDefinitionInfo* masterBulbs  = FindDefinition (master, kBulbs);
+	PropertyDefinitionInfo* projectBulbs = FindDefinition (project, kBulbs);
+	CHECK (masterBulbs != nullptr && projectBulbs != nullptr);
+	if (masterBulbs == nullptr || projectBulbs == nullptr)
+		return;
+
+	// One value renamed in the project only, one added there
+	auto garlic = std::find_if (projectBulbs->enumValues.begin (), projectBulbs->enumValues.end (),
+								[] (const EnumValueInfo& v) { return v.text.find ("Czosnek") != std::string::npos; });
+	CHECK (garlic != projectBulbs->enumValues.end ());
+	garlic->text = "CZOSNEK  GŁÓWKOWATY";
+	projectBulbs->enumValues.push_back ({ "P-NEW", "Szafirek" });
+	EnumValueInfo removed = masterBulbs->enumValues.back ();
+	projectBulbs->enumValues.erase (std::remove_if (projectBulbs->enumValues.begin (), projectBulbs->enumValues.end (),
+													[&] (const EnumValueInfo& v) { return v.key == "P-" + removed.key; }),
+									projectBulbs->enumValues.end ());
+
+	EnumRemapTable table (project, master);
+	const std::string group = masterBulbs->group;
+	const std::string& garlicKey = masterBulbs->enumValues[0].key;
+	CHECK_EQ (table.ToProject (group, kBulbs, garlicKey), "P-" + garlicKey);
+	CHECK_EQ (table.ToMaster (group, kBulbs, "P-" + garlicKey), garlicKey);
+	CHECK_EQ (table.ToProject (group, kBulbs, removed.key), "");
+	CHECK_EQ (table.ToMaster (group, kBulbs, "P-NEW"), "");
+	CHECK_EQ (table.ToProject (group, "ID", garlicKey), "");
+
+	size_t values = 0;
+	for (const PropertyDefinitionInfo& definition : master)
+		values += definition.enumValues.size ();
+	CHECK_EQ (table.GetMatchedCount (), values - 1);
+
+	const std::vector<PropertyDrift>& unmatched = table.GetUnmatched ();
+	CHECK_EQ (unmatched.size (), 2u);
+	if (unmatched.size () == 2) {
+		CHECK (unmatched[0].value == removed.text && !unmatched[0].inProject);
+		CHECK (unmatched[1].value == "Szafirek" && unmatched[1].inProject);
+		CHECK (unmatched[0].itemId.empty () && unmatched[0].name == kBulbs);
+	}
+}
+
+
+TEST (TablesAreCachedPerProject)
+{
+	std::vector<PropertyDefinitionInfo> master = ReadDefinitions (CLASSSYNC_MASTER_XML);
+	std::vector<PropertyDefinitionInfo> first  = MakeProject (master, "A-");
+	std::vector<PropertyDefinitionInfo> second = MakeProject (master, "B-");
+
+	EnumRemapCache cache;
+	bool rebuilt = false;
+	std::shared_ptr<const EnumRemapTable> a = cache.Get (first, master, &rebuilt);
+	CHECK (rebuilt);
+	CHECK (cache.Get (first, master, &rebuilt) == a);
+	CHECK (!rebuilt);
+
+	// Another project, then back: the first one's table is still there
+	std::shared_ptr<const EnumRemapTable> b = cache.Get (second, master, &rebuilt);
+	CHECK (rebuilt && b != a);
+	CHECK (cache.Get (first, master, &rebuilt) == a);
+	CHECK (!rebuilt);
+	CHECK_EQ (cache.GetSize (), 2u);
+
+	// Applicability changes do not touch the values
+	std::vector<PropertyDefinitionInfo> remapped = first;
+	remapped[0].itemIds.clear ();
+	CHECK (cache.Get (remapped, master, &rebuilt) == a);
+	CHECK (!rebuilt);
+
+	// A new master value invalidates
+	std::vector<PropertyDefinitionInfo> changed = master;
+	FindDefinition (changed, kBulbs)->enumValues.push_back ({ "M-NEW", "Szafirek" });
+	std::shared_ptr<const EnumRemapTable> c = cache.Get (first, changed, &rebuilt);
+	CHECK (rebuilt && c != a);
+	CHECK_EQ (c->GetUnmatched ().size (), 1u);
+
+	// Least recently used projects are dropped
+	for (int i = 0; i < (int)EnumRemapCache::kMaxProjects + 1; i++)
+		cache.Get (MakeProject (master, std::to_string (i) + "-"), master);
+	CHECK_EQ (cache.GetSize (), EnumRemapCache::kMaxProjects);
+	cache.Get (first, master, &rebuilt);
+	CHECK (rebuilt);
+}
+
+
+TEST (WorkerReportsValuesOnOneSide)
+{
+	TempDir dir;
+	std::string path = CopyMaster (dir);
+
+	std::vector<PropertyDefinitionInfo> project = MakeProject (ReadDefinitions (path), "P-");
+	FindDefinition (project, kBulbs)->enumValues.push_back ({ "P-NEW", "Szafirek" });
+
+	RefreshWorker worker;
+	RefreshResult result;
+	RefreshRequest request;
+	request.masterPath        = path;
+	request.projectData       = ReadXmlClassifications (path.c_str ());
+	request.projectProperties = project;
+	worker.Submit (std::move (request));
+	CHECK (WaitFor ([&] { return worker.TakeResult (result); }, 20000));
+	CHECK_EQ (result.propertyDrift.size (), 1u);
+	if (result.propertyDrift.size () == 1) {
+		CHECK_EQ (result.propertyDrift[0].value, "Szafirek");
+		CHECK (result.propertyDrift[0].inProject);
+	}
+}
+
+
+int main ()
+{
+	return RunAllTests ();
+}
@@ -0,0 +1,109 @@
+#include "TestHarness.hpp"
+#include "FileLock.hpp"
+#include "MasterWatcher.hpp"
+
+#include <chrono>
+#include <filesystem>
+
+
+// ---------------------------------------------------------------------------
+// Write lock, commit guard and the master directory watcher
+// ---------------------------------------------------------------------------
+
+TEST (LockFileLifecycle)
+{
+	TempDir dir;
+	std::string xmlPath = dir.File ("Master.xml");
+
+	CHECK (!GetLockInfo (xmlPath).locked);
+	CHECK (!IsLockedByUs (xmlPath));
+
+	CHECK (AcquireLock (xmlPath));
+	LockInfo info = GetLockInfo (xmlPath);
+	CHECK (info.locked);
+	CHECK_EQ (info.user, GetCurrentUser ());
+	CHECK_EQ (info.session, GetSessionId ());
+	CHECK (!info.time.empty ());
+	CHECK (IsOwnLock (info));
+
+	// Held already (by us) - a second acquire fails
+	CHECK (!AcquireLock (xmlPath));
+
+	CHECK (ReleaseLock (xmlPath));
+	CHECK (!GetLockInfo (xmlPath).locked);
+	CHECK (!ReleaseLock (xmlPath));
+}
+
+
+TEST (ForeignLockIsNotOurs)
+{
+	TempDir dir;
+	std::string xmlPath = dir.File ("Master.xml");
+	WriteTextFile (xmlPath + ".lock", "user=OTHER\\someone\r\ntime=2026-03-01 12:34:56\r\nsession=1\r\n");
+
+	LockInfo info = GetLockInfo (xmlPath);
+	CHECK (info.locked);
+	CHECK_EQ (info.user, "OTHER\\someone");
+	CHECK_EQ (info.session, "1");
+	CHECK (!IsOwnLock (info));
+	CHECK (!ReleaseLock (xmlPath));
+}
+
+
+TEST (CommitGuardIsExclusive)
+{
+	TempDir dir;
+	std::string xmlPath = dir.File ("Master.xml");
+
+	{
+		CommitGuard first (xmlPath.c_str ());
+		CHECK (first.IsAcquired ());
+
+		// Gives up after its retries while the first one is held
+		CommitGuard second (xmlPath.c_str ());
+		CHECK (!second.IsAcquired ());
+	}
+
+	CommitGuard again (xmlPath.c_str ());
+	CHECK (again.IsAcquired ());
+}
+
+
+TEST (WatcherClassifiesPaths)
+{
+	CHECK_EQ (MasterWatcher::ClassifyChange ("Master.xml", "Master.xml"), (unsigned)MasterChangeContent);
+	CHECK_EQ (MasterWatcher::ClassifyChange ("Master.xml", "master.XML"), (unsigned)MasterChangeContent);
+	CHECK_EQ (MasterWatcher::ClassifyChange ("Master.xml", "Master.xml.lock"), (unsigned)MasterChangeLock);
+	CHECK_EQ (MasterWatcher::ClassifyChange ("Master.xml", "changelog/2026-03-01.jsonl"), (unsigned)MasterChangeChangelog);
+	CHECK_EQ (MasterWatcher::ClassifyChange ("Master.xml", "Master.xml.tmp"), (unsigned)MasterChangeNone);
+	CHECK_EQ (MasterWatcher::ClassifyChange ("Master.xml", "changelogs.txt"), (unsigned)MasterChangeNone);
+}
+
+
+TEST (WatcherReportsMasterWrites)
+{
+	TempDir dir;
+	std::string xmlPath = dir.File ("Master.xml");
+	WriteTextFile (xmlPath, "<BuildingInformation/>");
+
+	std::atomic<unsigned> seen (MasterChangeNone);
+	MasterWatcher watcher;
+	CHECK (watcher.Start (xmlPath, 20, [&] (unsigned changes) { seen.fetch_or (changes); }));
+	CHECK (watcher.IsRunning ());
+
+	WriteTextFile (xmlPath, "<BuildingInformation></BuildingInformation>");
+	CHECK (WaitFor ([&] { return (seen.load () & MasterChangeContent) != 0; }));
+
+	CHECK (AcquireLock (xmlPath));
+	CHECK (WaitFor ([&] { return (seen.load () & MasterChangeLock) != 0; }));
+	ReleaseLock (xmlPath);
+
+	watcher.Stop ();
+	CHECK (!watcher.IsRunning ());
+}
+
+
+int main ()
+{
+	return RunAllTests ();
+}
@@ -0,0 +1,130 @@
+#include "TestHarness.hpp"
+#include "ItemIndex.hpp"
+#include "XmlReader.hpp"
+#include "XmlWriter.hpp"
+
+#include <algorithm>
+
+
+// ---------------------------------------------------------------------------
+// Hierarchical IDs: natural order, encoded keys, tree index
+// ---------------------------------------------------------------------------
+
+static std::vector<std::string> ChildIds (const ClassificationNode& node)
+{
+	std::vector<std::string> ids;
+	for (const ClassificationNode& child : node.children)
+		ids.push_back (child.id);
+	return ids;
+}
+
+
+TEST (NaturalIdOrder)
+{
+	CHECK (CompareItemIds ("DR.L.9", "DR.L.10") < 0);
+	CHECK (CompareItemIds ("DR.L.10", "DR.L.9") > 0);
+	CHECK (CompareItemIds ("DR.L.01", "DR.L.01") == 0);
+	CHECK (CompareItemIds ("DR.L.01.02", "DR.L.01.10") < 0);
+
+	// A parent sorts before its children, its children before the next sibling
+	CHECK (CompareItemIds ("DR.L", "DR.L.01") < 0);
+	CHECK (CompareItemIds ("DR.L.99", "DR.LA") < 0);
+	CHECK (CompareItemIds ("A.B.C", "A.BC") < 0);
+
+	// Leading zeros only break ties
+	CHECK (CompareItemIds ("DR.L.1", "DR.L.01") < 0);
+	CHECK (CompareItemIds ("DR.L.01", "DR.L.2") < 0);
+	CHECK (CompareItemIds ("X2", "X10") < 0);
+
+	CHECK (IsItemIdPrefix ("DR.L", "DR.L.01"));
+	CHECK (!IsItemIdPrefix ("DR.L", "DR.LA"));
+	CHECK (!IsItemIdPrefix ("DR.L", "DR.L"));
+}
+
+
+TEST (EncodedKeysSortLikeIds)
+{
+	std::vector<ClassificationTree> master = ReadXmlClassifications (CLASSSYNC_MASTER_XML);
+	ItemIndex index (master);
+	CHECK (index.Size () > 400u);
+
+	std::vector<std::string> byCompare, byKey;
+	for (ItemIndex::Ref ref = 0; ref < (ItemIndex::Ref)index.Size (); ref++)
+		byCompare.push_back (index.GetId (ref));
+	byKey = byCompare;
+	std::sort (byCompare.begin (), byCompare.end (), [] (const std::string& a, const std::string& b) { return CompareItemIds (a, b) < 0; });
+	std::sort (byKey.begin (), byKey.end (), [] (const std::string& a, const std::string& b) { return EncodeItemIdKey (a) < EncodeItemIdKey (b); });
+	CHECK (byCompare == byKey);
+
+	// Ranks agree with the codec
+	ItemIndex::Ref nine = index.Find ("DR.L.09"), ten = index.Find ("DR.L.10");
+	CHECK (nine != ItemIndex::kNoItem && ten != ItemIndex::kNoItem);
+	if (nine != ItemIndex::kNoItem && ten != ItemIndex::kNoItem)
+		CHECK (index.Less (nine, ten) && !index.Less (ten, nine));
+}
+
+
+TEST (IndexAnswersFromTheTree)
+{
+	std::vector<ClassificationTree> master = ReadXmlClassifications (CLASSSYNC_MASTER_XML);
+	ItemIndex index (master);
+
+	// Not what cutting at the last dot would say
+	CHECK_EQ (index.FindParentId ("DR.L.01"), "DRZ.L");
+	CHECK_EQ (index.FindParentId ("DR.L.01.03"), "DR.L.01");
+	CHECK_EQ (index.FindParentId ("DRZ"), "");
+	CHECK_EQ (index.FindParentId ("NOPE"), "");
+	CHECK (index.Find ("NOPE") == ItemIndex::kNoItem);
+
+	// Children in natural order (the file has .05 before .02)
+	ItemIndex::Ref branch = index.Find ("DR.L.01");
+	CHECK (branch != ItemIndex::kNoItem);
+	if (branch != ItemIndex::kNoItem) {
+		std::vector<std::string> children;
+		for (ItemIndex::Ref child : index.GetChildren (branch))
+			children.push_back (index.GetId (child));
+		std::vector<std::string> expected = { "DR.L.01.01", "DR.L.01.02", "DR.L.01.03", "DR.L.01.04", "DR.L.01.05" };
+		CHECK (children == expected);
+		CHECK_EQ (index.GetNode (branch).name, FindNode (master[0].rootItems, "DR.L.01")->name);
+		CHECK_EQ (index.GetSystem (branch), 0u);
+	}
+
+	// Prefix queries follow IDs, not the tree, and exclude the prefix itself
+	std::vector<ItemIndex::Ref> under = index.FindByPrefix ("DR.L.01");
+	CHECK_EQ (under.size (), 5u);
+	for (size_t i = 1; i < under.size (); i++)
+		CHECK (index.Less (under[i - 1], under[i]));
+	CHECK (index.FindByPrefix ("DR.L.01.01").empty ());
+	CHECK (index.FindByPrefix ("DR.L").size () > index.FindByPrefix ("DR.L.01").size ());
+	for (ItemIndex::Ref ref : index.FindByPrefix ("DR.L"))
+		CHECK (IsItemIdPrefix ("DR.L", index.GetId (ref)));
+}
+
+
+TEST (WriterInsertsInNaturalOrder)
+{
+	TempDir dir;
+	std::string path = CopyMaster (dir);
+
+	MasterVersion version;
+	ReadXmlClassifications (path.c_str (), &version);
+	CHECK (AddItemToXml (path.c_str (), version, "DR.L.01", MakeNode ("DR.L.01.10", "Ten")) == CommitResult::Committed);
+	ReadXmlClassifications (path.c_str (), &version);
+	CHECK (AddItemToXml (path.c_str (), version, "DR.L.01", MakeNode ("DR.L.01.9", "Nine")) == CommitResult::Committed);
+
+	std::vector<ClassificationTree> master = ReadXmlClassifications (path.c_str ());
+	const ClassificationNode* branch = master.empty () ? nullptr : FindNode (master[0].rootItems, "DR.L.01");
+	CHECK (branch != nullptr);
+	if (branch != nullptr) {
+		std::vector<std::string> ids = ChildIds (*branch);
+		auto nine = std::find (ids.begin (), ids.end (), "DR.L.01.9");
+		auto ten  = std::find (ids.begin (), ids.end (), "DR.L.01.10");
+		CHECK (nine != ids.end () && ten != ids.end () && nine < ten);
+	}
+}
+
+
+int main ()
+{
+	return RunAllTests ();
+}
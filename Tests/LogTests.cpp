@@ -0,0 +1,191 @@
+#include "TestHarness.hpp"
+#include "Log.hpp"
+#include "Report.hpp"
+#include "WorkProgress.hpp"
+
+
+// ---------------------------------------------------------------------------
+// Session log: levels, lazy arguments, ring buffer, report echo, file sink
+// ---------------------------------------------------------------------------
+
+static std::vector<std::string> shownLines;
+
+static void CollectReportLine (const std::string& line)
+{
+	shownLines.push_back (line);
+}
+
+
+static size_t CountOccurrences (const std::string& text, const std::string& pattern)
+{
+	size_t count = 0;
+	for (size_t pos = text.find (pattern); pos != std::string::npos; pos = text.find (pattern, pos + 1))
+		count++;
+	return count;
+}
+
+
+struct LogSetup {
+	LogSetup ()
+	{
+		ClearLog ();
+		shownLines.clear ();
+		SetReportSink (CollectReportLine);
+		SetLogLevel (LogLevel::Debug);
+		SetLogEchoLevel (LogLevel::Info);
+	}
+	~LogSetup ()
+	{
+		SetReportSink (nullptr);
+	}
+};
+
+
+TEST (DebugIsRecordedButNotShown)
+{
+	LogSetup setup;
+	CS_LOG_DEBUG ("debug %d", 1);
+	CS_LOG_INFO ("info %s", "two");
+	CS_LOG_WARNING ("warning");
+	Report ("report %d", 4);
+
+	CHECK_EQ (shownLines.size (), 3u);
+	if (shownLines.size () == 3) {
+		CHECK_EQ (shownLines[0], "info two");
+		CHECK_EQ (shownLines[2], "report 4");
+	}
+
+	std::string lines = FormatLogLines ();
+	CHECK_EQ (CountOccurrences (lines, "\n"), 4u);
+	CHECK (lines.find (" debug ") != std::string::npos && lines.find ("debug 1\n") != std::string::npos);
+	CHECK (lines.find ("info two\n") != std::string::npos);
+	CHECK (lines.find (" warning ") != std::string::npos);
+
+	// Newest lines only
+	CHECK_EQ (FormatLogLines (1).find ("report 4"), FormatLogLines (1).size () - 9);
+}
+
+
+static int evaluated = 0;
+
+static const char* Expensive ()
+{
+	evaluated++;
+	return "expensive";
+}
+
+
+TEST (FilteredLinesDoNotEvaluateArguments)
+{
+	LogSetup setup;
+	SetLogLevel (LogLevel::Warning);
+	SetLogEchoLevel (LogLevel::Warning);
+	CHECK (!IsLogged (LogLevel::Info));
+
+	evaluated = 0;
+	CS_LOG_DEBUG ("%s", Expensive ());
+	CS_LOG_INFO ("%s", Expensive ());
+	CHECK_EQ (evaluated, 0);
+	CS_LOG_ERROR ("%s", Expensive ());
+	CHECK_EQ (evaluated, 1);
+	CHECK_EQ (shownLines.size (), 1u);
+	CHECK_EQ (CountOccurrences (FormatLogLines (), "\n"), 1u);
+
+	// Off: nothing at all
+	SetLogLevel (LogLevel::Off);
+	SetLogEchoLevel (LogLevel::Off);
+	CS_LOG_ERROR ("%s", Expensive ());
+	CHECK_EQ (evaluated, 1);
+}
+
+
+TEST (LevelNames)
+{
+	LogLevel level = LogLevel::Off;
+	CHECK (ParseLogLevel ("debug", level) && level == LogLevel::Debug);
+	CHECK (ParseLogLevel ("warning", level) && level == LogLevel::Warning);
+	CHECK (!ParseLogLevel ("verbose", level) && level == LogLevel::Warning);
+	CHECK_EQ (std::string (LogLevelName (LogLevel::Error)), "error");
+}
+
+
+struct CollectNotes : public WorkProgress {
+	virtual bool  Step (std::uint64_t, std::uint64_t) override  { return true; }
+	virtual void  Note (const std::string& line) override       { notes.push_back (line); }
+
+	std::vector<std::string>  notes;
+};
+
+
+TEST (WorkerLinesAreNotedOnlyWhenShown)
+{
+	LogSetup setup;
+	CollectNotes progress;
+	ReportWork (&progress, LogLevel::Debug, "parsed %d", 1);
+	ReportWork (&progress, LogLevel::Warning, "cannot open %s", "x.xml");
+	ReportWork (nullptr, LogLevel::Info, "on the UI thread");
+
+	CHECK_EQ (progress.notes.size (), 1u);
+	CHECK (!progress.notes.empty () && progress.notes[0] == "cannot open x.xml");
+	CHECK_EQ (shownLines.size (), 1u);
+	CHECK (FormatLogLines ().find ("parsed 1") != std::string::npos);
+}
+
+
+TEST (RingKeepsNewestLinesFromSeveralThreads)
+{
+	LogSetup setup;
+	SetLogEchoLevel (LogLevel::Off);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; t++) {
+		threads.emplace_back ([] {
+			for (int i = 0; i < 3000; i++)
+				CS_LOG_DEBUG ("line %d", i);
+		});
+	}
+	for (std::thread& thread : threads)
+		thread.join ();
+
+	CHECK_EQ (CountOccurrences (FormatLogLines (), "\n"), kLogCapacity);
+
+	// A long line is cut on a character boundary
+	ClearLog ();
+	std::string text;
+	for (int i = 0; i < 200; i++)
+		text += "\xc5\x82";
+	CS_LOG_DEBUG ("%s", text.c_str ());
+	std::string lines = FormatLogLines ();
+	size_t start = lines.find ('\xc5');
+	CHECK (start != std::string::npos && lines.size () - 1 - start == kLogLineSize - 2);
+}
+
+
+TEST (FileSinkAppendsEveryLine)
+{
+	LogSetup setup;
+	SetLogEchoLevel (LogLevel::Off);
+	TempDir dir;
+	std::string path = dir.File ("classsync.log");
+
+	CS_LOG_INFO ("before start");
+	CHECK (StartLogFile (path));
+	for (int i = 0; i < 100; i++)
+		CS_LOG_DEBUG ("record %d", i);
+	StopLogFile ();
+
+	std::string text = ReadTextFile (path);
+	CHECK (text.find ("before start") != std::string::npos);
+	CHECK (text.find ("record 0\n") != std::string::npos);
+	CHECK (text.find ("record 99\n") != std::string::npos);
+	CHECK_EQ (CountOccurrences (text, "\n"), 101u);
+
+	CHECK (!StartLogFile (dir.File ("missing/classsync.log")));
+	CHECK (WriteLogLines (dir.File ("dump.txt")));
+	CHECK_EQ (ReadTextFile (dir.File ("dump.txt")), FormatLogLines ());
+}
+
+
+int main ()
+{
+	return RunAllTests ();
+}
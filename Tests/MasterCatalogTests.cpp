@@ -0,0 +1,173 @@
+#include "TestHarness.hpp"
+#include "Counters.hpp"
+#include "MasterCatalog.hpp"
+#include "RefreshWorker.hpp"
+#include "XmlReader.hpp"
+
+#include <filesystem>
+
+
+// ---------------------------------------------------------------------------
+// Master catalog: both repository masters as one server view
+// ---------------------------------------------------------------------------
+
+// Copy of "INST INSTALACJE.xml" (next to the PLANTS master) in dir
+static std::string CopyInstallationsMaster (const TempDir& dir, const std::string& name = "Installations.xml")
+{
+	std::string target = dir.File (name);
+	std::filesystem::copy_file (std::filesystem::path (CLASSSYNC_MASTER_XML).parent_path () / "INST INSTALACJE.xml", target);
+	return target;
+}
+
+
+// Catalog "Masters.catalog" listing Plants.xml and Installations.xml
+static std::string MakeCatalog (const TempDir& dir)
+{
+	CopyMaster (dir, "Plants.xml");
+	CopyInstallationsMaster (dir);
+	std::string path = dir.File ("Masters.catalog");
+	WriteTextFile (path, "ClassSync master catalog 1\n# plants first\nPlants.xml\r\n\nInstallations.xml\n");
+	return path;
+}
+
+
+TEST (CatalogMergesSystems)
+{
+	TempDir dir;
+	std::string catalog = MakeCatalog (dir);
+	CHECK (IsMasterCatalog (catalog.c_str ()));
+	CHECK (!IsMasterCatalog (dir.File ("Plants.xml").c_str ()));
+
+	std::vector<std::string> masters;
+	CHECK (ReadMasterCatalog (catalog.c_str (), masters));
+	CHECK_EQ (masters.size (), 2u);
+
+	MasterCatalogCache cache;
+	MasterVersion version;
+	std::vector<ClassificationTree> merged = ReadCatalogClassifications (catalog.c_str (), cache, &version);
+	CHECK_EQ (merged.size (), 2u);
+	CHECK (version.valid);
+	if (merged.size () == 2) {
+		CHECK_EQ (merged[0].systemName, "Green Accent PLANTS");
+		CHECK_EQ (merged[1].systemName, "GA INSTALACJI");
+		CHECK (FindNode (merged[0].rootItems, "DRZ.L") != nullptr);
+		CHECK (FindNode (merged[1].rootItems, "OS_OGR") != nullptr);
+	}
+	CHECK_EQ (cache.systemToMaster["GA INSTALACJI"], dir.File ("Installations.xml"));
+	CHECK_EQ (cache.itemToMaster["DRZ.L"], dir.File ("Plants.xml"));
+
+	// A master listed twice under another name: its system is already there
+	CopyInstallationsMaster (dir, "Copy.xml");
+	WriteTextFile (catalog, ReadTextFile (catalog) + "Copy.xml\n");
+	merged = ReadCatalogClassifications (catalog.c_str (), cache);
+	CHECK_EQ (merged.size (), 2u);
+	CHECK_EQ (cache.masters.size (), 3u);
+
+	// Not a catalog
+	WriteTextFile (catalog, "Plants.xml\n");
+	CHECK (!ReadMasterCatalog (catalog.c_str (), masters));
+	CHECK (ReadCatalogClassifications (catalog.c_str (), cache).empty ());
+}
+
+
+TEST (OnlyChangedMastersAreReread)
+{
+	TempDir dir;
+	std::string catalog = MakeCatalog (dir);
+	MasterCatalogCache cache;
+	MasterVersion first;
+	ReadCatalogClassifications (catalog.c_str (), cache, &first);
+
+	ResetCounters ();
+	MasterVersion second;
+	std::vector<ClassificationTree> merged = ReadCatalogClassifications (catalog.c_str (), cache, &second);
+	CHECK_EQ (GetCounter (Counter::MasterReads), 0u);
+	CHECK (second == first);
+	CHECK_EQ (merged.size (), 2u);
+
+	std::vector<MasterEdit> edits = { RenameEdit ("OS_OGR", "OGRODOWE", "Garden") };
+	CHECK (ApplyEditsToCatalog (cache, edits) == CommitResult::Committed);
+
+	ResetCounters ();
+	MasterVersion third;
+	merged = ReadCatalogClassifications (catalog.c_str (), cache, &third);
+	CHECK_EQ (GetCounter (Counter::MasterReads), 1u);
+	CHECK (third != first);
+	if (merged.size () == 2) {
+		const ClassificationNode* garden = FindNode (merged[1].rootItems, "OS_OGR");
+		CHECK (garden != nullptr && garden->name == "Garden");
+	}
+}
+
+
+TEST (EditsGoToTheOwningMaster)
+{
+	TempDir dir;
+	std::string catalog = MakeCatalog (dir);
+	MasterCatalogCache cache;
+	ReadCatalogClassifications (catalog.c_str (), cache);
+
+	MasterEdit root = AddEdit ("", "ZZZ", "New installations");
+	root.systemName = "GA INSTALACJI";
+	std::vector<MasterEdit> edits = {
+		RenameEdit ("DRZ.L", "DRZEW LIŚCIASTE", "Broadleaf"),
+		RenameEdit ("OS", "OŚWIETLENIE", "Lighting"),
+		root,
+		AddEdit ("ZZZ", "ZZZ.1", "Child of a new root"),
+		RenameEdit ("NOPE", "x", "y")
+	};
+	CHECK (ApplyEditsToCatalog (cache, edits) == CommitResult::Committed);
+	for (size_t i = 0; i < 4; i++)
+		CHECK (edits[i].result == CommitResult::Committed);
+	CHECK (edits[4].result == CommitResult::Failed);
+
+	std::vector<ClassificationTree> plants        = ReadXmlClassifications (dir.File ("Plants.xml").c_str ());
+	std::vector<ClassificationTree> installations = ReadXmlClassifications (dir.File ("Installations.xml").c_str ());
+	CHECK (!plants.empty () && !installations.empty ());
+	if (!plants.empty () && !installations.empty ()) {
+		const ClassificationNode* broadleaf = FindNode (plants[0].rootItems, "DRZ.L");
+		const ClassificationNode* lighting  = FindNode (installations[0].rootItems, "OS");
+		CHECK (broadleaf != nullptr && broadleaf->name == "Broadleaf");
+		CHECK (lighting != nullptr && lighting->name == "Lighting");
+		CHECK (FindNode (installations[0].rootItems, "ZZZ.1") != nullptr);
+		CHECK (FindNode (plants[0].rootItems, "ZZZ") == nullptr);
+	}
+
+	// The cache still holds the old versions: a stale rename conflicts
+	std::vector<MasterEdit> stale = { RenameEdit ("OS", "OŚWIETLENIE", "Lights") };
+	ApplyEditsToCatalog (cache, stale);
+	CHECK (stale[0].result == CommitResult::Conflict);
+}
+
+
+TEST (WorkerReadsCatalogs)
+{
+	TempDir dir;
+	std::string catalog = MakeCatalog (dir);
+
+	RefreshWorker worker;
+	RefreshResult result;
+	RefreshRequest request;
+	request.masterPath = catalog;
+	worker.Submit (std::move (request));
+	CHECK (WaitFor ([&] { return worker.TakeResult (result); }, 20000));
+	CHECK (result.masterReread && result.serverChanged);
+	CHECK_EQ (result.serverData.size (), 2u);
+	CHECK_EQ (result.catalogCache.masters.size (), 2u);
+
+	// Nothing changed: the cache comes back and nothing is re-read
+	RefreshRequest again;
+	again.masterPath      = catalog;
+	again.catalogCache    = result.catalogCache;
+	again.shownServerHash = result.serverHash;
+	worker.Submit (std::move (again));
+	CHECK (WaitFor ([&] { return worker.TakeResult (result); }, 20000));
+	CHECK (!result.masterReread);
+	CHECK (!result.serverChanged);
+}
+
+
+int main ()
+{
+	return RunAllTests ();
+}
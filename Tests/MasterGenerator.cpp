@@ -0,0 +1,371 @@
+#include "MasterGenerator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <random>
+
+
+const char* const  GeneratedSystemName = "Generated PLANTS";
+
+static const char* const  GeneratedVersion = "03";
+
+
+// ---------------------------------------------------------------------------
+// Name vocabulary - plant names as they appear in the real master, each with
+// its ASCII-folded form for --ascii runs
+// ---------------------------------------------------------------------------
+
+struct NameWord {
+	const char*  polish;
+	const char*  ascii;
+};
+
+static const NameWord  NameWords[] = {
+	{ "Brzoza",      "Brzoza" },      { "pożyteczna",  "pozyteczna" },
+	{ "Dąb",         "Dab" },         { "szypułkowy",  "szypulkowy" },
+	{ "Klon",        "Klon" },        { "zwyczajny",   "zwyczajny" },
+	{ "Świerk",      "Swierk" },      { "kłujący",     "klujacy" },
+	{ "Mięta",       "Mieta" },       { "nadwodna",    "nadwodna" },
+	{ "Żurawka",     "Zurawka" },     { "ogrodowa",    "ogrodowa" },
+	{ "Róża",        "Roza" },        { "pnąca",       "pnaca" },
+	{ "Czosnek",     "Czosnek" },     { "główkowaty",  "glowkowaty" },
+	{ "Jeżówka",     "Jezowka" },     { "purpurowa",   "purpurowa" },
+	{ "Wiąz",        "Wiaz" },        { "szypułkowy",  "szypulkowy" },
+	{ "Grab",        "Grab" },        { "pospolity",   "pospolity" },
+	{ "Łubin",       "Lubin" },       { "trwały",      "trwaly" },
+	{ "Krzewuszka",  "Krzewuszka" },  { "cudowna",     "cudowna" },
+	{ "Turzyca",     "Turzyca" },     { "Morrowa",     "Morrowa" },
+	{ "Kostrzewa",   "Kostrzewa" },   { "sina",        "sina" },
+	{ "Paproć",      "Paproc" },      { "Wrzos",       "Wrzos" },
+	{ "DRZEWA",      "DRZEWA" },      { "LIŚCIASTE",   "LISCIASTE" },
+	{ "KRZEWY",      "KRZEWY" },      { "IGLASTE",     "IGLASTE" },
+	{ "BYLINY",      "BYLINY" },      { "TRAWY",       "TRAWY" }
+};
+
+static const size_t  NameWordCount = sizeof (NameWords) / sizeof (NameWords[0]);
+
+
+// ---------------------------------------------------------------------------
+// Buffered output - the document is built in chunks and appended to the file
+// ---------------------------------------------------------------------------
+
+class ChunkWriter {
+public:
+	explicit ChunkWriter (std::FILE* file) : file (file), written (0), failed (false) { chunk.reserve (ChunkSize * 2); }
+
+	void  Put (const char* text)         { chunk += text; FlushIfFull (); }
+	void  Put (const std::string& text)  { chunk += text; FlushIfFull (); }
+
+	bool  Finish ()
+	{
+		Flush ();
+		return !failed;
+	}
+
+	std::uint64_t  GetWritten () const  { return written; }
+
+private:
+	static const size_t  ChunkSize = 1 << 20;
+
+	void  FlushIfFull ()
+	{
+		if (chunk.size () >= ChunkSize)
+			Flush ();
+	}
+
+	void  Flush ()
+	{
+		if (!chunk.empty () && std::fwrite (chunk.data (), 1, chunk.size (), file) != chunk.size ())
+			failed = true;
+		written += chunk.size ();
+		chunk.clear ();
+	}
+
+	std::FILE*     file;
+	std::string    chunk;
+	std::uint64_t  written;
+	bool           failed;
+};
+
+
+static std::string Indent (int level)
+{
+	return std::string ((size_t)level, '\t');
+}
+
+
+// Stable per (item, property) decision, independent of walk order
+static std::uint64_t MixBits (std::uint64_t value)
+{
+	value ^= value >> 33;
+	value *= 0xff51afd7ed558ccdULL;
+	value ^= value >> 33;
+	value *= 0xc4ceb9fe1a85ec53ULL;
+	value ^= value >> 33;
+	return value;
+}
+
+
+// ---------------------------------------------------------------------------
+// Item tree shape
+//
+// Every level gets the same fan-out (items^(1/depth), rounded up); the items
+// left below a node are split evenly between its children and the last
+// level takes whatever remains. Root IDs are two letters ("AA", "AB", ...),
+// lower levels append a zero-padded index ("AA.01.03"), like the real master.
+// ---------------------------------------------------------------------------
+
+struct TreeShape {
+	std::uint64_t  fanOut;
+	int            depth;
+};
+
+static std::string RootSegment (std::uint64_t index)
+{
+	if (index < 26 * 26) {
+		std::string segment (2, 'A');
+		segment[0] = (char)('A' + index / 26);
+		segment[1] = (char)('A' + index % 26);
+		return segment;
+	}
+	return "Z" + std::to_string ((unsigned long long)index);
+}
+
+static std::string ChildSegment (std::uint64_t index, std::uint64_t count)
+{
+	std::string number = std::to_string ((unsigned long long)(index + 1));
+	size_t width = std::max<size_t> (2, std::to_string ((unsigned long long)count).size ());
+	if (number.size () < width)
+		number.insert (0, width - number.size (), '0');
+	return number;
+}
+
+// visit (id, level, preorder index, hasChildren) and close (level) after the
+// children of a node that has them
+typedef std::function<void (const std::string&, int, std::uint64_t, bool)>  ItemVisitor;
+typedef std::function<void (int)>                                         ItemCloser;
+
+static void WalkItems (const TreeShape& shape, const std::string& parentId, std::uint64_t budget, int level,
+					   std::uint64_t& index, const ItemVisitor& visit, const ItemCloser& close)
+{
+	bool lastLevel = level + 1 >= shape.depth;
+	std::uint64_t count = lastLevel ? budget : std::min (shape.fanOut, budget);
+	if (count == 0)
+		return;
+
+	std::uint64_t below = budget - count;
+	for (std::uint64_t i = 0; i < count; i++) {
+		std::string id = parentId.empty ()
+			? RootSegment (i)
+			: parentId + "." + ChildSegment (i, count);
+		std::uint64_t share = lastLevel ? 0 : below / count + (i < below % count ? 1 : 0);
+		visit (id, level, index++, share > 0);
+		if (share > 0) {
+			WalkItems (shape, id, share, level + 1, index, visit, close);
+			close (level);
+		}
+	}
+}
+
+static TreeShape MakeShape (const MasterGeneratorOptions& options)
+{
+	TreeShape shape;
+	shape.depth  = std::max (1, options.depth);
+	shape.fanOut = std::max<std::uint64_t> (1, (std::uint64_t)std::ceil (std::pow ((double)options.items, 1.0 / shape.depth) - 1e-9));
+	return shape;
+}
+
+
+// ---------------------------------------------------------------------------
+// Document parts
+// ---------------------------------------------------------------------------
+
+static std::string MakeName (std::mt19937& random, size_t length, bool diacritics)
+{
+	std::string name;
+	do {
+		const NameWord& word = NameWords[random () % NameWordCount];
+		if (!name.empty ())
+			name += ' ';
+		name += diacritics ? word.polish : word.ascii;
+	} while (name.size () < length);
+	return name;
+}
+
+static std::string MakeKey (std::mt19937& random)
+{
+	static const char  hex[] = "0123456789ABCDEF";
+	std::string key = "00000000-0000-0000-0000-000000000000";
+	for (char& c : key) {
+		if (c == '0')
+			c = hex[random () % 16];
+	}
+	return key;
+}
+
+static void WriteSystemHeader (ChunkWriter& out)
+{
+	out.Put ("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\" ?>\n");
+	out.Put ("<BuildingInformation>\n");
+	out.Put ("\t<Classification>\n");
+	out.Put ("\t\t<System>\n");
+	out.Put (std::string ("\t\t\t<Name>") + GeneratedSystemName + "</Name>\n");
+	out.Put (std::string ("\t\t\t<EditionVersion>") + GeneratedVersion + "</EditionVersion>\n");
+	out.Put ("\t\t\t<EditionDate>\n");
+	out.Put ("\t\t\t\t<Year>2024</Year>\n");
+	out.Put ("\t\t\t\t<Month>2</Month>\n");
+	out.Put ("\t\t\t\t<Day>1</Day>\n");
+	out.Put ("\t\t\t</EditionDate>\n");
+	out.Put ("\t\t\t<Description/>\n");
+	out.Put ("\t\t\t<Source/>\n");
+	out.Put ("\t\t\t<Items>\n");
+}
+
+static void WriteValueDescriptor (ChunkWriter& out, std::mt19937& random, bool enumeration, bool diacritics)
+{
+	if (!enumeration) {
+		out.Put ("\t\t\t\t\t<ValueDescriptor Type=\"SingleValueDescriptor\">\n");
+		out.Put ("\t\t\t\t\t\t<ValueType>String</ValueType>\n");
+		out.Put ("\t\t\t\t\t</ValueDescriptor>\n");
+		out.Put ("\t\t\t\t\t<MeasureType>Default</MeasureType>\n");
+		out.Put ("\t\t\t\t\t<DefaultValue>\n");
+		out.Put ("\t\t\t\t\t\t<DefaultValueType>Basic</DefaultValueType>\n");
+		out.Put ("\t\t\t\t\t\t<Variant Type=\"StringVariant\">\n");
+		out.Put ("\t\t\t\t\t\t\t<Status>Normal</Status>\n");
+		out.Put ("\t\t\t\t\t\t\t<Value/>\n");
+		out.Put ("\t\t\t\t\t\t</Variant>\n");
+		out.Put ("\t\t\t\t\t</DefaultValue>\n");
+		return;
+	}
+
+	out.Put ("\t\t\t\t\t<ValueDescriptor Type=\"EnumerationValueDescriptor\" Version=\"2\">\n");
+	out.Put ("\t\t\t\t\t\t<EnumerationValueDescriptorWithStoredValues>\n");
+	out.Put ("\t\t\t\t\t\t\t<ValueType>3</ValueType>\n");
+	out.Put ("\t\t\t\t\t\t\t<Values>\n");
+	int valueCount = 3 + (int)(random () % 3);
+	for (int i = 0; i < valueCount; i++) {
+		out.Put ("\t\t\t\t\t\t\t\t<Key>" + MakeKey (random) + "</Key>\n");
+		out.Put ("\t\t\t\t\t\t\t\t<Value Empty=\"false\">\n");
+		out.Put ("\t\t\t\t\t\t\t\t\t<Variant Type=\"StringVariant\">\n");
+		out.Put ("\t\t\t\t\t\t\t\t\t\t<Status>Normal</Status>\n");
+		out.Put ("\t\t\t\t\t\t\t\t\t\t<Value>" + MakeName (random, 16, diacritics) + "</Value>\n");
+		out.Put ("\t\t\t\t\t\t\t\t\t</Variant>\n");
+		out.Put ("\t\t\t\t\t\t\t\t</Value>\n");
+	}
+	out.Put ("\t\t\t\t\t\t\t</Values>\n");
+	out.Put ("\t\t\t\t\t\t</EnumerationValueDescriptorWithStoredValues>\n");
+	out.Put ("\t\t\t\t\t\t<HasMultiValue>true</HasMultiValue>\n");
+	out.Put ("\t\t\t\t\t</ValueDescriptor>\n");
+	out.Put ("\t\t\t\t\t<MeasureType>Default</MeasureType>\n");
+	out.Put ("\t\t\t\t\t<DefaultValue>\n");
+	out.Put ("\t\t\t\t\t\t<DefaultValueType>Basic</DefaultValueType>\n");
+	out.Put ("\t\t\t\t\t\t<Variant Type=\"GuidListVariant\">\n");
+	out.Put ("\t\t\t\t\t\t\t<Status>UserUndefined</Status>\n");
+	out.Put ("\t\t\t\t\t\t</Variant>\n");
+	out.Put ("\t\t\t\t\t</DefaultValue>\n");
+}
+
+
+// ---------------------------------------------------------------------------
+// Generator
+// ---------------------------------------------------------------------------
+
+bool WriteGeneratedMaster (const std::string& filePath, const MasterGeneratorOptions& options, MasterGeneratorStats* stats)
+{
+	std::FILE* file = std::fopen (filePath.c_str (), "wb");
+	if (file == nullptr)
+		return false;
+
+	ChunkWriter out (file);
+	std::mt19937 random (options.seed);
+	TreeShape shape = MakeShape (options);
+	std::uint64_t itemCount = 0;
+	int maxDepth = 0;
+
+	// Items: <Item> is at 4 + 2 * level tabs, its <Children> one deeper
+	WriteSystemHeader (out);
+	std::uint64_t index = 0;
+	WalkItems (shape, std::string (), options.items, 0, index,
+		[&] (const std::string& id, int level, std::uint64_t, bool hasChildren) {
+			std::string indent = Indent (4 + 2 * level);
+			out.Put (indent + "<Item>\n");
+			out.Put (indent + "\t<ID>" + id + "</ID>\n");
+			out.Put (indent + "\t<Name>" + MakeName (random, options.nameLength, options.diacritics) + "</Name>\n");
+			out.Put (indent + "\t<Description/>\n");
+			if (hasChildren) {
+				out.Put (indent + "\t<Children>\n");
+			} else {
+				out.Put (indent + "\t<Children/>\n");
+				out.Put (indent + "</Item>\n");
+			}
+			itemCount++;
+			maxDepth = std::max (maxDepth, level + 1);
+		},
+		[&] (int level) {
+			std::string indent = Indent (4 + 2 * level);
+			out.Put (indent + "\t</Children>\n");
+			out.Put (indent + "</Item>\n");
+		});
+	out.Put ("\t\t\t</Items>\n");
+	out.Put ("\t\t</System>\n");
+	out.Put ("\t</Classification>\n");
+
+	// Property definitions: each item is referenced by refsPerItem of them
+	// on average (capped at one reference per definition)
+	int properties = std::max (1, options.properties);
+	int groups = std::max (1, std::min (options.propertyGroups, properties));
+	double share = std::min (1.0, std::max (0.0, options.refsPerItem) / properties);
+	std::uint64_t threshold = (std::uint64_t)(share * 1048576.0);
+	std::uint64_t references = 0;
+
+	out.Put ("\t<PropertyDefinitionGroups>\n");
+	int property = 0;
+	for (int group = 0; group < groups; group++) {
+		int groupSize = properties / groups + (group < properties % groups ? 1 : 0);
+		out.Put ("\t\t<PropertyDefinitionGroup>\n");
+		out.Put ("\t\t\t<Name>" + MakeName (random, 6, options.diacritics) + " " + std::to_string (group + 1) + "</Name>\n");
+		out.Put ("\t\t\t<Description/>\n");
+		out.Put ("\t\t\t<PropertyDefinitions>\n");
+		for (int i = 0; i < groupSize; i++, property++) {
+			out.Put ("\t\t\t\t<PropertyDefinition>\n");
+			out.Put ("\t\t\t\t\t<Name>" + MakeName (random, 12, options.diacritics) + "</Name>\n");
+			out.Put ("\t\t\t\t\t<Description/>\n");
+			WriteValueDescriptor (out, random, property % 4 == 3, options.diacritics);
+			out.Put ("\t\t\t\t\t<ClassificationIDs>\n");
+			std::uint64_t walkIndex = 0;
+			WalkItems (shape, std::string (), options.items, 0, walkIndex,
+				[&] (const std::string& id, int, std::uint64_t itemIndex, bool) {
+					std::uint64_t bits = MixBits (((std::uint64_t)options.seed << 40) ^ (itemIndex * 1000003 + (std::uint64_t)property));
+					if ((bits & 0xFFFFF) >= threshold)
+						return;
+					out.Put ("\t\t\t\t\t\t<ClassificationID>\n");
+					out.Put ("\t\t\t\t\t\t\t<ItemID>" + id + "</ItemID>\n");
+					out.Put (std::string ("\t\t\t\t\t\t\t<SystemIDName>") + GeneratedSystemName + "</SystemIDName>\n");
+					out.Put (std::string ("\t\t\t\t\t\t\t<SystemIDVersion>") + GeneratedVersion + "</SystemIDVersion>\n");
+					out.Put ("\t\t\t\t\t\t</ClassificationID>\n");
+					references++;
+				},
+				[] (int) {});
+			out.Put ("\t\t\t\t\t</ClassificationIDs>\n");
+			out.Put ("\t\t\t\t</PropertyDefinition>\n");
+		}
+		out.Put ("\t\t\t</PropertyDefinitions>\n");
+		out.Put ("\t\t</PropertyDefinitionGroup>\n");
+	}
+	out.Put ("\t</PropertyDefinitionGroups>\n");
+	out.Put ("</BuildingInformation>\n");
+
+	bool written = out.Finish ();
+	if (std::fclose (file) != 0)
+		written = false;
+
+	if (stats != nullptr) {
+		stats->items      = itemCount;
+		stats->references = references;
+		stats->bytes      = out.GetWritten ();
+		stats->maxDepth   = maxDepth;
+	}
+	return written;
+}
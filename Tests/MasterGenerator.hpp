@@ -0,0 +1,50 @@
+#ifndef MASTERGENERATOR_HPP
+#define MASTERGENERATOR_HPP
+
+#include <cstdint>
+#include <string>
+
+
+// ---------------------------------------------------------------------------
+// Synthetic ArchiCAD classification masters for benchmarks
+//
+// Writes the same document layout as "Green Accent PLANTS.xml": one system
+// with tab-indented <Item> trees, followed by <PropertyDefinitionGroups>
+// whose <ClassificationIDs> reference the items. The defaults reproduce the
+// shape of that master (490 items, 3 levels, ~25 property references per
+// item); output is deterministic for a given seed and streamed to disk, so
+// 1M-item masters do not need to fit in memory.
+// ---------------------------------------------------------------------------
+
+struct MasterGeneratorOptions {
+	std::uint64_t  items;			// total <Item> count (all levels)
+	int            depth;			// levels below <Items>, 1 = flat list
+	size_t         nameLength;		// approximate <Name> length in bytes
+	bool           diacritics;		// Polish names (UTF-8) or ASCII-folded
+	double         refsPerItem;		// mean <ClassificationID> count per item
+	int            propertyGroups;	// <PropertyDefinitionGroup> count
+	int            properties;		// <PropertyDefinition> count (all groups)
+	std::uint32_t  seed;
+
+	MasterGeneratorOptions () :
+		items (490), depth (3), nameLength (24), diacritics (true),
+		refsPerItem (25.0), propertyGroups (5), properties (30), seed (1)
+	{}
+};
+
+struct MasterGeneratorStats {
+	std::uint64_t  items;
+	std::uint64_t  references;		// <ClassificationID> blocks written
+	std::uint64_t  bytes;
+	int            maxDepth;
+};
+
+extern const char* const  GeneratedSystemName;		// "Generated PLANTS"
+
+// False if the file cannot be written.
+bool  WriteGeneratedMaster (const std::string& filePath,
+							const MasterGeneratorOptions& options,
+							MasterGeneratorStats* stats = nullptr);
+
+
+#endif // MASTERGENERATOR_HPP
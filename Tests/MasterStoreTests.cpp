@@ -0,0 +1,206 @@
+#include "TestHarness.hpp"
+#include "Counters.hpp"
+#include "MasterStore.hpp"
+#include "RefreshWorker.hpp"
+#include "SyncClient.hpp"
+#include "SyncServer.hpp"
+#include "XmlWriter.hpp"
+
+#include <filesystem>
+
+
+// ---------------------------------------------------------------------------
+// Version store: content-addressed blobs, exact materialization, diffs
+// ---------------------------------------------------------------------------
+
+static const StoredChange* FindChange (const std::vector<StoredChange>& changes, const std::string& id)
+{
+	for (const StoredChange& change : changes) {
+		if (change.id == id)
+			return &change;
+	}
+	return nullptr;
+}
+
+
+TEST (StoreRoundTripsExactBytes)
+{
+	TempDir dir;
+	std::string path  = CopyMaster (dir);
+	std::string store = GetMasterStoreDir (dir.File ("changelog"));
+	std::string original = ReadTextFile (path);
+
+	StoredVersion stored;
+	CHECK (StoreMasterVersion (store, original, &stored));
+	CHECK_EQ (stored.number, 1u);
+	CHECK (stored.version == ComputeMasterVersion (original));
+
+	// The same bytes again are not a new version
+	StoredVersion again;
+	CHECK (StoreMasterVersion (store, original, &again));
+	CHECK_EQ (again.number, 1u);
+	CHECK_EQ (ListStoredVersions (store).size (), 1u);
+
+	std::string content, error;
+	CHECK (MaterializeStoredVersion (store, 1, content, error));
+	CHECK (content == original);
+	CHECK (!MaterializeStoredVersion (store, 2, content, error));
+	CHECK (!error.empty ());
+}
+
+
+TEST (VersionsShareUnchangedBranches)
+{
+	TempDir dir;
+	std::string path  = CopyMaster (dir);
+	std::string store = GetMasterStoreDir (dir.File ("changelog"));
+	std::string first = ReadTextFile (path);
+
+	ResetCounters ();
+	CHECK (StoreMasterVersion (store, first));
+	std::uint64_t firstBytes = GetCounter (Counter::StoreBytesWritten);
+	CHECK (GetCounter (Counter::StoreBlobsWritten) > 490u);
+
+	std::vector<MasterEdit> edits = { RenameEdit ("DRZ.L", "DRZEW LIŚCIASTE", "Broadleaf"), AddEdit ("DR.L.01", "DR.L.01.99", "Brzoza nowa") };
+	CHECK (ApplyEditsToXml (path.c_str (), ComputeMasterVersion (first), edits) == CommitResult::Committed);
+	std::string second = ReadTextFile (path);
+
+	ResetCounters ();
+	StoredVersion stored;
+	CHECK (StoreMasterVersion (store, second, &stored));
+	CHECK_EQ (stored.number, 2u);
+
+	// Only the changed items, their ancestors and the root are new
+	CHECK (GetCounter (Counter::StoreBlobsWritten) <= 8u);
+	CHECK (GetCounter (Counter::StoreBytesWritten) * 50 < firstBytes);
+
+	std::string content, error;
+	CHECK (MaterializeStoredVersion (store, 1, content, error));
+	CHECK (content == first);
+	CHECK (MaterializeStoredVersion (store, 2, content, error));
+	CHECK (content == second);
+}
+
+
+TEST (DiffFollowsOnlyChangedHashes)
+{
+	TempDir dir;
+	std::string path  = CopyMaster (dir);
+	std::string store = GetMasterStoreDir (dir.File ("changelog"));
+	std::string first = ReadTextFile (path);
+	CHECK (StoreMasterVersion (store, first));
+
+	std::vector<MasterEdit> edits = { RenameEdit ("DRZ.L", "DRZEW LIŚCIASTE", "Broadleaf"), AddEdit ("DR.L.01", "DR.L.01.99", "Brzoza nowa") };
+	CHECK (ApplyEditsToXml (path.c_str (), ComputeMasterVersion (first), edits) == CommitResult::Committed);
+	CHECK (StoreMasterVersion (store, ReadTextFile (path)));
+
+	std::vector<StoredChange> changes;
+	std::string error;
+	CHECK (DiffStoredVersions (store, 1, 2, changes, error));
+	CHECK_EQ (changes.size (), 2u);
+	const StoredChange* renamed = FindChange (changes, "DRZ.L");
+	CHECK (renamed != nullptr && renamed->kind == StoredChangeKind::Changed);
+	if (renamed != nullptr) {
+		CHECK_EQ (renamed->tag, "Item");
+		CHECK_EQ (renamed->oldName, "DRZEW LIŚCIASTE");
+		CHECK_EQ (renamed->newName, "Broadleaf");
+	}
+	const StoredChange* added = FindChange (changes, "DR.L.01.99");
+	CHECK (added != nullptr && added->kind == StoredChangeKind::Added);
+
+	// Backwards the addition is a removal
+	CHECK (DiffStoredVersions (store, 2, 1, changes, error));
+	added = FindChange (changes, "DR.L.01.99");
+	CHECK (added != nullptr && added->kind == StoredChangeKind::Removed);
+
+	CHECK (DiffStoredVersions (store, 2, 2, changes, error));
+	CHECK (changes.empty ());
+
+	StoredVersion found;
+	CHECK (FindStoredVersionAt (store, "9999-12-31T23:59:59", found));
+	CHECK_EQ (found.number, 2u);
+	CHECK (!FindStoredVersionAt (store, "2000-01-01T00:00:00", found));
+}
+
+
+TEST (DamagedBlobsAreReported)
+{
+	TempDir dir;
+	std::string path  = CopyMaster (dir);
+	std::string store = GetMasterStoreDir (dir.File ("changelog"));
+	StoredVersion stored;
+	CHECK (StoreMasterVersion (store, ReadTextFile (path), &stored));
+
+	// Corrupt one item blob
+	std::string damaged;
+	for (const auto& entry : std::filesystem::recursive_directory_iterator (std::filesystem::path (store) / "objects")) {
+		if (entry.is_regular_file () && ReadTextFile (entry.path ().string ()).compare (0, 6, "<Item>") == 0) {
+			damaged = entry.path ().string ();
+			break;
+		}
+	}
+	CHECK (!damaged.empty ());
+	WriteTextFile (damaged, "<Item>tampered</Item>");
+
+	std::string content, error;
+	CHECK (!MaterializeStoredVersion (store, stored.number, content, error));
+	CHECK (error.find ("Damaged blob") == 0);
+}
+
+
+TEST (CommitsAreRecorded)
+{
+	TempDir dir;
+	std::string path  = CopyMaster (dir);
+	std::string store = GetMasterStoreDir (dir.File ("changelog"));
+	std::string original = ReadTextFile (path);
+
+	// Reading the master records nothing
+	RefreshWorker worker;
+	RefreshResult result;
+	RefreshRequest request;
+	request.masterPath = path;
+	worker.Submit (std::move (request));
+	CHECK (WaitFor ([&] { return worker.TakeResult (result); }, 20000));
+	CHECK (ListStoredVersions (store).empty ());
+
+	// A commit records the state it replaced and the new one
+	std::vector<MasterEdit> edits = { RenameEdit ("DRZ", "DRZEWA", "TREES") };
+	CHECK (ApplyEditsToXml (path.c_str (), result.serverVersion, edits) == CommitResult::Committed);
+	std::vector<StoredVersion> versions = ListStoredVersions (store);
+	CHECK_EQ (versions.size (), 2u);
+	if (versions.size () == 2) {
+		CHECK (versions[0].version == ComputeMasterVersion (original));
+		CHECK (versions[1].version == ComputeMasterVersion (ReadTextFile (path)));
+	}
+
+	// An edit made outside ClassSync is kept by the next commit, here the service's
+	std::string edited = ReadTextFile (path);
+	size_t birches = edited.find ("BRZOZY");
+	CHECK (birches != std::string::npos);
+	edited.replace (birches, 6, "BETULA");
+	WriteTextFile (path, edited);
+
+	SyncServer server;
+	CHECK (server.Start (path, "127.0.0.1", 0));
+	CHECK_EQ (ListStoredVersions (store).size (), 2u);
+	SyncClient client;
+	CHECK (client.Connect ("127.0.0.1:" + std::to_string (server.GetPort ()), path));
+	edits = { RenameEdit ("KRZ", "KRZEWY", "SHRUBS") };
+	CommitResult commit = CommitResult::Failed;
+	CHECK (client.Commit (ComputeMasterVersion (edited), edits, commit));
+	CHECK (commit == CommitResult::Committed);
+
+	versions = ListStoredVersions (store);
+	CHECK_EQ (versions.size (), 4u);
+	if (versions.size () == 4) {
+		CHECK (versions[2].version == ComputeMasterVersion (edited));
+		CHECK (versions[3].version == ComputeMasterVersion (ReadTextFile (path)));
+	}
+}
+
+
+int main ()
+{
+	return RunAllTests ();
+}
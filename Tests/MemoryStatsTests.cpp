@@ -0,0 +1,157 @@
+#include "TestHarness.hpp"
+#include "MemoryStats.hpp"
+#include "RefreshWorker.hpp"
+#include "XmlReader.hpp"
+
+
+// ---------------------------------------------------------------------------
+// Memory accounting: heap counting, scopes, the stage table, size estimates
+// ---------------------------------------------------------------------------
+
+// Blocks kept here cannot be optimized away
+static std::vector<std::vector<char>>  keptBlocks;
+
+
+TEST (CountingIsOffByDefault)
+{
+	CHECK (!IsAllocationCounting ());
+	AllocationStats before = GetHeapTotals ();
+	keptBlocks.emplace_back (4096);
+	CHECK_EQ (GetHeapTotals ().allocations, before.allocations);
+	keptBlocks.clear ();
+}
+
+
+TEST (ScopeCountsAllocationsAndPeak)
+{
+	SetAllocationCounting (true);
+	{
+		AllocationScope outer;
+		keptBlocks.reserve (8);
+		{
+			AllocationScope inner;
+			for (int i = 0; i < 4; i++)
+				keptBlocks.emplace_back (10000);
+			keptBlocks.clear ();
+
+			AllocationStats stats = inner.Get ();
+			CHECK_EQ (stats.allocations, 4u);
+			CHECK_EQ (stats.frees, 4u);
+			CHECK (stats.bytes >= 40000u);
+			CHECK_EQ (stats.netBytes, 0);
+			CHECK (stats.peakBytes >= 40000);
+		}
+
+		// The inner peak carries over to the enclosing scope
+		AllocationStats stats = outer.Get ();
+		CHECK (stats.allocations >= 5u);
+		CHECK (stats.peakBytes >= 40000);
+	}
+	keptBlocks.shrink_to_fit ();
+
+	// Other threads count in the process totals, not in this thread's scope
+	AllocationScope scope;
+	AllocationStats before = GetHeapTotals ();
+	std::thread ([] { keptBlocks.emplace_back (1000); }).join ();
+	CHECK (scope.Get ().bytes < 1000u);		// only the thread's own state
+	CHECK (GetHeapTotals ().bytes >= before.bytes + 1000);
+	keptBlocks.clear ();
+	SetAllocationCounting (false);
+}
+
+
+TEST (StagesCollectIntoTable)
+{
+	ClearStageMemory ();
+	{
+		MemoryStage stage ("ignored");		// counting is off
+		keptBlocks.emplace_back (100);
+	}
+	CHECK (GetStageMemory ().empty ());
+
+	SetAllocationCounting (true);
+	for (int run = 0; run < 2; run++) {
+		MemoryStage stage ("parse");
+		keptBlocks.emplace_back (2000);
+	}
+	{
+		MemoryStage stage ("compare");
+		keptBlocks.emplace_back (100000);
+		stage.End ();
+		keptBlocks.emplace_back (100000);		// after End: not counted
+	}
+	SetAllocationCounting (false);
+	keptBlocks.clear ();
+
+	std::vector<StageMemory> stages = GetStageMemory ();
+	CHECK_EQ (stages.size (), 2u);
+	if (stages.size () == 2) {
+		CHECK_EQ (std::string (stages[0].name), "parse");
+		CHECK_EQ (stages[0].runs, 2u);
+		CHECK (stages[0].total.bytes >= 4000u);
+		CHECK (stages[1].last.bytes >= 100000u && stages[1].last.bytes < 200000u);
+	}
+	std::string table = FormatStageMemory (stages);
+	CHECK (table.find ("parse: 2 run(s)") == 0);
+	CHECK (table.find ("compare: 1 run(s)") != std::string::npos);
+
+	CHECK_EQ (FormatByteSize (512), "512 B");
+	CHECK_EQ (FormatByteSize (3 * 1024), "3 KB");
+	CHECK_EQ (FormatByteSize (5 * 1048576 / 2), "2.5 MB");
+}
+
+
+TEST (WorkerRecordsRefreshStages)
+{
+	ClearStageMemory ();
+	SetAllocationCounting (true);
+	RefreshWorker worker;
+	RefreshRequest request;
+	request.masterPath = CLASSSYNC_MASTER_XML;
+	worker.Submit (std::move (request));
+	RefreshResult result;
+	CHECK (WaitFor ([&] { return worker.TakeResult (result); }, 20000));
+	SetAllocationCounting (false);
+
+	std::string table = FormatStageMemory (GetStageMemory ());
+	CHECK (table.find ("read master:") != std::string::npos);
+	CHECK (table.find ("compare:") != std::string::npos);
+	CHECK (table.find ("refresh job:") != std::string::npos);
+}
+
+
+TEST (EstimatesGrowWithTheModel)
+{
+	std::string shortText = "abc";
+	std::string longText (200, 'x');
+	CHECK_EQ (EstimateStringBytes (shortText), 0u);
+	CHECK (EstimateStringBytes (longText) >= 201u);
+
+	std::vector<ClassificationTree> master = ReadXmlClassifications (CLASSSYNC_MASTER_XML);
+	CHECK (!master.empty ());
+	std::uint64_t bytes = EstimateModelBytes (master);
+	CHECK (bytes > 490u * sizeof (ClassificationNode));
+
+	std::vector<ClassificationTree> bigger = master;
+	bigger.push_back (master[0]);
+	CHECK (EstimateModelBytes (bigger) > bytes);
+
+	std::vector<DiffEntry> diff = CompareClassifications (master, master);
+	CHECK (EstimateDiffBytes (diff) >= diff.size () * sizeof (DiffEntry));
+
+	ViewNode root;
+	root.children.resize (10);
+	root.children[3].text = longText;
+	CHECK (EstimateViewBytes (root) >= 10 * sizeof (ViewNode) + 201);
+
+	std::unordered_map<std::string, int> map;
+	std::uint64_t emptyMap = EstimateMapBytes (map);
+	map[longText] = 1;
+	CHECK (EstimateMapBytes (map) >= emptyMap + kNodeOverheadBytes + 201);
+}
+
+
+int main ()
+{
+	return RunAllTests ();
+}
@@ -0,0 +1,103 @@
+#include "TestHarness.hpp"
+#include "ClassificationModel.hpp"
+
+
+// ---------------------------------------------------------------------------
+// Diff and fingerprints
+// ---------------------------------------------------------------------------
+
+static ClassificationTree MakeTree (const std::string& system)
+{
+	ClassificationTree tree;
+	tree.systemName = system;
+	tree.version    = "1";
+	return tree;
+}
+
+
+static const DiffEntry* FindEntry (const std::vector<DiffEntry>& entries, const std::string& id)
+{
+	for (const DiffEntry& entry : entries) {
+		if (entry.id == id)
+			return &entry;
+	}
+	return nullptr;
+}
+
+
+TEST (CompareReportsAllStatuses)
+{
+	ClassificationTree project = MakeTree ("Plants");
+	project.rootItems.push_back (MakeNode ("A", "Trees"));
+	project.rootItems[0].children.push_back (MakeNode ("A.1", "Birch"));
+	project.rootItems[0].children.push_back (MakeNode ("A.2", "Oak (project)"));
+	project.rootItems[0].children.push_back (MakeNode ("A.3", "Maple"));
+	project.rootItems[0].children[0].guid.bytes[0] = 7;
+
+	ClassificationTree server = MakeTree ("Plants");
+	server.rootItems.push_back (MakeNode ("A", "Trees"));
+	server.rootItems[0].children.push_back (MakeNode ("A.1", "Birch"));
+	server.rootItems[0].children.push_back (MakeNode ("A.2", "Oak"));
+	server.rootItems[0].children.push_back (MakeNode ("A.4", "Pine"));
+
+	std::vector<DiffEntry> entries = CompareClassifications ({ project }, { server });
+
+	const DiffEntry* match    = FindEntry (entries, "A.1");
+	const DiffEntry* conflict = FindEntry (entries, "A.2");
+	const DiffEntry* onlyProj = FindEntry (entries, "A.3");
+	const DiffEntry* onlyServ = FindEntry (entries, "A.4");
+
+	CHECK (match != nullptr && match->status == DiffStatus::Match);
+	CHECK (match != nullptr && !match->projectItemGuid.IsNull ());
+	CHECK (conflict != nullptr && conflict->status == DiffStatus::Conflict);
+	CHECK (conflict != nullptr && conflict->projectName == "Oak (project)" && conflict->serverName == "Oak");
+	CHECK (onlyProj != nullptr && onlyProj->status == DiffStatus::OnlyInProject);
+	CHECK (onlyServ != nullptr && onlyServ->status == DiffStatus::OnlyInServer);
+}
+
+
+TEST (CompareEmptyModels)
+{
+	CHECK (CompareClassifications ({}, {}).empty ());
+}
+
+
+TEST (HashFollowsContent)
+{
+	ClassificationTree tree = MakeTree ("Plants");
+	tree.rootItems.push_back (MakeNode ("A", "Trees"));
+
+	std::uint64_t before = HashClassifications ({ tree });
+	CHECK (before != 0);
+	CHECK_EQ (before, HashClassifications ({ tree }));
+
+	tree.rootItems[0].name = "Shrubs";
+	CHECK (HashClassifications ({ tree }) != before);
+
+	// Same items under another parent is a different model
+	ClassificationTree flat = MakeTree ("Plants");
+	flat.rootItems.push_back (MakeNode ("A", "Trees"));
+	flat.rootItems.push_back (MakeNode ("B", "Birch"));
+	ClassificationTree nested = MakeTree ("Plants");
+	nested.rootItems.push_back (MakeNode ("A", "Trees"));
+	nested.rootItems[0].children.push_back (MakeNode ("B", "Birch"));
+	CHECK (HashClassifications ({ flat }) != HashClassifications ({ nested }));
+
+	CHECK (HashDiffEntries ({}) != 0);
+}
+
+
+TEST (ItemGuidNull)
+{
+	ItemGuid guid;
+	CHECK (guid.IsNull ());
+	guid.bytes[15] = 1;
+	CHECK (!guid.IsNull ());
+	CHECK (guid != ItemGuid ());
+}
+
+
+int main ()
+{
+	return RunAllTests ();
+}
@@ -0,0 +1,154 @@
+#include "TestHarness.hpp"
+#include "PropertyApplicability.hpp"
+#include "RefreshWorker.hpp"
+#include "ShardedMaster.hpp"
+#include "XmlReader.hpp"
+
+#include <algorithm>
+
+
+// ---------------------------------------------------------------------------
+// Property applicability: definitions from the master, bit matrix diff
+// ---------------------------------------------------------------------------
+
+static void RemoveItem (PropertyDefinitionInfo& definition, const std::string& id)
+{
+	definition.itemIds.erase (std::remove (definition.itemIds.begin (), definition.itemIds.end (), id),
+							  definition.itemIds.end ());
+}
+
+
+TEST (MasterDefinitionsAreRead)
+{
+	std::vector<PropertyDefinitionInfo> definitions = ReadDefinitions (CLASSSYNC_MASTER_XML);
+	CHECK_EQ (definitions.size (), 30u);
+
+	PropertyDefinitionInfo* count = FindDefinition (definitions, "ROSLINY OBLICZENIA", "ILOŚĆ W SZT.");
+	CHECK (count != nullptr);
+	if (count != nullptr) {
+		CHECK (count->itemIds.size () > 400u);
+		CHECK (std::find (count->itemIds.begin (), count->itemIds.end (), "DR.L.01.03") != count->itemIds.end ());
+	}
+
+	// A sharded master keeps its definitions in the properties shard
+	TempDir dir;
+	std::string manifest, error;
+	CHECK (SplitMasterIntoShards (CopyMaster (dir).c_str (), manifest, error));
+	std::vector<PropertyDefinitionInfo> sharded = ReadDefinitions (manifest);
+	CHECK (HashPropertyDefinitions (sharded) == HashPropertyDefinitions (definitions));
+
+	std::vector<PropertyDefinitionInfo> none;
+	CHECK (!ReadMasterPropertyDefinitions (dir.File ("missing.xml").c_str (), none));
+}
+
+
+TEST (SameDefinitionsDoNotDrift)
+{
+	std::vector<ClassificationTree>     master      = ReadXmlClassifications (CLASSSYNC_MASTER_XML);
+	std::vector<PropertyDefinitionInfo> definitions = ReadDefinitions (CLASSSYNC_MASTER_XML);
+
+	// Definition order and duplicate mappings do not matter
+	std::vector<PropertyDefinitionInfo> project = definitions;
+	std::reverse (project.begin (), project.end ());
+	project[0].itemIds.push_back (project[0].itemIds.front ());
+
+	CHECK (ComparePropertyApplicability (master, project, master, definitions).empty ());
+}
+
+
+TEST (XorFindsEveryDifference)
+{
+	std::vector<ClassificationTree>     master      = ReadXmlClassifications (CLASSSYNC_MASTER_XML);
+	std::vector<PropertyDefinitionInfo> definitions = ReadDefinitions (CLASSSYNC_MASTER_XML);
+	std::vector<PropertyDefinitionInfo> project     = definitions;
+
+	// Master only: one species lost its count, project only: an extra mapping
+	RemoveItem (*FindDefinition (project, "ROSLINY OBLICZENIA", "ILOŚĆ W SZT."), "DR.L.01.03");
+	RemoveItem (*FindDefinition (definitions, "ROSLINY OBLICZENIA", "CENA JEDN."), "KRZ");
+	// A definition the project does not have, and one the master does not
+	project.erase (project.begin () + (FindDefinition (project, "LAND4 Add-On", "Name") - project.data ()));
+	project.push_back ({ "PROJEKT", "Uwagi", { "DRZ" }, {} });
+	// Items the master does not have are the classification diff's business
+	FindDefinition (project, "OGÓLNE", "ID")->itemIds.push_back ("ONLY.IN.PROJECT");
+
+	std::vector<PropertyDrift> drift = ComparePropertyApplicability (master, project, master, definitions);
+	CHECK_EQ (drift.size (), 4u);
+	if (drift.size () == 4) {
+		CHECK (drift[0].itemId.empty () && drift[0].name == "Name" && !drift[0].inProject);
+		CHECK (drift[1].itemId.empty () && drift[1].group == "PROJEKT" && drift[1].inProject);
+
+		// Cells in project item order
+		CHECK_EQ (drift[2].itemId, "DR.L.01.03");
+		CHECK_EQ (drift[2].name, "ILOŚĆ W SZT.");
+		CHECK (!drift[2].inProject);
+		CHECK_EQ (drift[3].itemId, "KRZ");
+		CHECK_EQ (drift[3].name, "CENA JEDN.");
+		CHECK (drift[3].inProject);
+	}
+
+	// Project items missing on the master are no rows
+	std::vector<ClassificationTree> trimmed = master;
+	trimmed[0].rootItems.erase (std::remove_if (trimmed[0].rootItems.begin (), trimmed[0].rootItems.end (),
+												[] (const ClassificationNode& node) { return node.id == "KRZ"; }),
+								trimmed[0].rootItems.end ());
+	CHECK_EQ (ComparePropertyApplicability (master, project, trimmed, definitions).size (), 3u);
+
+	ApplicabilityMatrix matrix (3, 130);
+	CHECK_EQ (matrix.GetWordsPerRow (), 3u);
+	matrix.Set (2, 129);
+	CHECK (matrix.Get (2, 129) && !matrix.Get (1, 129) && !matrix.Get (2, 65));
+}
+
+
+TEST (WorkerReusesDrift)
+{
+	TempDir dir;
+	std::string path = CopyMaster (dir);
+
+	std::vector<PropertyDefinitionInfo> project = ReadDefinitions (path);
+	RemoveItem (*FindDefinition (project, "ROSLINY OBLICZENIA", "RABATA NR"), "DR.L.01.03");
+
+	RefreshWorker worker;
+	RefreshResult result;
+	RefreshRequest request;
+	request.masterPath        = path;
+	request.projectData       = ReadXmlClassifications (path.c_str ());
+	request.projectProperties = project;
+	worker.Submit (std::move (request));
+	CHECK (WaitFor ([&] { return worker.TakeResult (result); }, 20000));
+	CHECK (result.propertiesChanged);
+	CHECK_EQ (result.propertyDrift.size (), 1u);
+	if (!result.propertyDrift.empty ())
+		CHECK_EQ (result.propertyDrift[0].itemId, "DR.L.01.03");
+
+	// Same inputs: nothing to deliver
+	RefreshRequest again;
+	again.masterPath        = path;
+	again.projectData       = ReadXmlClassifications (path.c_str ());
+	again.projectProperties = project;
+	again.shownProjectHash  = result.projectHash;
+	again.shownServerHash   = result.serverHash;
+	again.shownPropertyHash = result.propertyHash;
+	std::uint64_t shown = result.propertyHash;
+	worker.Submit (std::move (again));
+	CHECK (WaitFor ([&] { return worker.TakeResult (result); }, 20000));
+	CHECK (!result.propertiesChanged);
+	CHECK (result.propertyHash == shown);
+
+	// The project catches up: the drift is gone
+	RefreshRequest fixed;
+	fixed.masterPath        = path;
+	fixed.projectData       = ReadXmlClassifications (path.c_str ());
+	fixed.projectProperties = ReadDefinitions (path);
+	fixed.shownPropertyHash = shown;
+	worker.Submit (std::move (fixed));
+	CHECK (WaitFor ([&] { return worker.TakeResult (result); }, 20000));
+	CHECK (result.propertiesChanged);
+	CHECK (result.propertyDrift.empty ());
+}
+
+
+int main ()
+{
+	return RunAllTests ();
+}
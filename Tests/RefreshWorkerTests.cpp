@@ -0,0 +1,163 @@
+#include "TestHarness.hpp"
+#include "RefreshWorker.hpp"
+#include "FileLock.hpp"
+#include "ShardedMaster.hpp"
+#include "XmlReader.hpp"
+
+
+// ---------------------------------------------------------------------------
+// Background refresh: results, memoized stages, supersession
+// ---------------------------------------------------------------------------
+
+static bool WaitForResult (RefreshWorker& worker, RefreshResult& result)
+{
+	return WaitFor ([&] { return worker.TakeResult (result); }, 20000);
+}
+
+
+// Project = the master with one item renamed
+static std::vector<ClassificationTree> MakeProject ()
+{
+	std::vector<ClassificationTree> project = ReadXmlClassifications (CLASSSYNC_MASTER_XML);
+	if (!project.empty () && !project[0].rootItems.empty ())
+		project[0].rootItems[0].name = "TREES";
+	return project;
+}
+
+
+TEST (RefreshDiffsProjectAgainstMaster)
+{
+	TempDir dir;
+	std::string path = CopyMaster (dir);
+
+	RefreshWorker worker;
+	RefreshRequest request;
+	request.masterPath  = path;
+	request.projectData = MakeProject ();
+	worker.Submit (std::move (request));
+
+	RefreshResult result;
+	CHECK (WaitForResult (worker, result));
+	CHECK (result.projectChanged && result.serverChanged && result.diffChanged && result.masterReread);
+	CHECK (result.serverVersion.valid);
+	CHECK (!result.serverData.empty ());
+
+	unsigned conflicts = 0;
+	for (const DiffEntry& entry : result.diffEntries) {
+		if (entry.status == DiffStatus::Conflict) {
+			conflicts++;
+			CHECK_EQ (entry.id, "DRZ");
+		}
+	}
+	CHECK_EQ (conflicts, 1u);
+	CHECK (!worker.IsBusy ());
+	CHECK_EQ (worker.GetProgress (), 1000u);
+
+	// Same inputs, shown hashes current: nothing is re-read or re-sent
+	RefreshRequest again;
+	again.masterPath       = path;
+	again.projectData      = MakeProject ();
+	again.shownProjectHash = result.projectHash;
+	again.shownServerHash  = result.serverHash;
+	worker.Submit (std::move (again));
+
+	RefreshResult second;
+	CHECK (WaitForResult (worker, second));
+	CHECK (!second.masterReread);
+	CHECK (!second.projectChanged && !second.serverChanged && !second.diffChanged);
+	CHECK (second.serverData.empty () && second.diffEntries.empty ());
+}
+
+
+TEST (ShardWrittenBehindStaleManifestIsReread)
+{
+	TempDir dir;
+	std::string path = CopyMaster (dir);
+	std::string manifestPath, error;
+	CHECK (SplitMasterIntoShards (path.c_str (), manifestPath, error));
+
+	RefreshWorker worker;
+	RefreshRequest request;
+	request.masterPath = manifestPath;
+	worker.Submit (std::move (request));
+	RefreshResult first;
+	CHECK (WaitForResult (worker, first));
+	CHECK (first.masterReread);
+
+	// The shard is committed, its manifest entry is not
+	std::string manifest = ReadTextFile (manifestPath);
+	{
+		CommitGuard held (manifestPath.c_str ());
+		CHECK (held.IsAcquired ());
+		CHECK (ChangeItemNameInShards (manifestPath.c_str (), first.shardCache, "DRZ", "DRZEWA", "TREES") == CommitResult::Busy);
+	}
+	CHECK_EQ (ReadTextFile (manifestPath), manifest);
+
+	RefreshRequest again;
+	again.masterPath      = manifestPath;
+	again.shardCache      = first.shardCache;
+	again.shownServerHash = first.serverHash;
+	worker.Submit (std::move (again));
+	RefreshResult second;
+	CHECK (WaitForResult (worker, second));
+	CHECK (second.masterReread && second.serverChanged);
+	const ClassificationNode* drz = second.serverData.empty () ? nullptr : FindNode (second.serverData[0].rootItems, "DRZ");
+	CHECK (drz != nullptr && drz->name == "TREES");
+
+	// Nothing changed since: read, but not reported as re-read
+	RefreshRequest third;
+	third.masterPath      = manifestPath;
+	third.shardCache      = second.shardCache;
+	third.shownServerHash = second.serverHash;
+	worker.Submit (std::move (third));
+	RefreshResult last;
+	CHECK (WaitForResult (worker, last));
+	CHECK (!last.masterReread && !last.serverChanged);
+}
+
+
+TEST (LatestSubmitWins)
+{
+	TempDir dir;
+	std::string path = CopyMaster (dir);
+
+	RefreshWorker worker;
+	std::uint64_t last = 0;
+	for (int i = 0; i < 3; i++) {
+		RefreshRequest request;
+		request.masterPath  = path;
+		request.projectData = MakeProject ();
+		last = worker.Submit (std::move (request));
+	}
+
+	RefreshResult result;
+	CHECK (WaitForResult (worker, result));
+	CHECK_EQ (result.generation, last);
+	CHECK (!worker.TakeResult (result));
+}
+
+
+TEST (CancelDropsTheResult)
+{
+	TempDir dir;
+	std::string path = CopyMaster (dir);
+
+	RefreshWorker worker;
+	RefreshRequest request;
+	request.masterPath  = path;
+	request.projectData = MakeProject ();
+	worker.Submit (std::move (request));
+	worker.Cancel ();
+	CHECK (!worker.IsBusy ());
+
+	std::this_thread::sleep_for (std::chrono::milliseconds (200));
+	RefreshResult result;
+	CHECK (!worker.TakeResult (result));
+	worker.Stop ();
+}
+
+
+int main ()
+{
+	return RunAllTests ();
+}
@@ -0,0 +1,120 @@
+#include "TestHarness.hpp"
+#include "ShardedMaster.hpp"
+#include "FileLock.hpp"
+#include "XmlReader.hpp"
+#include "XmlWriter.hpp"
+
+
+// ---------------------------------------------------------------------------
+// Sharded master: split, cached read, edits routed to the owning shard
+// ---------------------------------------------------------------------------
+
+TEST (SplitReadsBackTheSameModel)
+{
+	TempDir dir;
+	std::string path = CopyMaster (dir);
+
+	std::string manifestPath, error;
+	CHECK (SplitMasterIntoShards (path.c_str (), manifestPath, error));
+	CHECK (IsShardedMaster (manifestPath.c_str ()));
+	CHECK (!IsShardedMaster (path.c_str ()));
+
+	ShardedMasterCache cache;
+	MasterVersion version;
+	std::vector<ClassificationTree> sharded = ReadShardedClassifications (manifestPath.c_str (), cache, &version);
+	std::vector<ClassificationTree> single  = ReadXmlClassifications (path.c_str ());
+
+	CHECK (version.valid);
+	CHECK_EQ (HashClassifications (sharded), HashClassifications (single));
+	CHECK (!cache.itemToShard.empty ());
+
+	// Assembled document parses to the same model
+	std::string xml;
+	CHECK (AssembleShardedXml (manifestPath.c_str (), xml));
+	WriteTextFile (dir.File ("assembled.xml"), xml);
+	CHECK_EQ (HashClassifications (ReadXmlClassifications (dir.File ("assembled.xml").c_str ())),
+			  HashClassifications (single));
+}
+
+
+TEST (EditsGoToOwningShards)
+{
+	TempDir dir;
+	std::string path = CopyMaster (dir);
+
+	std::string manifestPath, error;
+	CHECK (SplitMasterIntoShards (path.c_str (), manifestPath, error));
+
+	ShardedMasterCache cache;
+	ReadShardedClassifications (manifestPath.c_str (), cache);
+
+	std::vector<MasterEdit> edits (4);
+	edits[0].kind     = MasterEditKind::ChangeName;
+	edits[0].itemId   = "DRZ";
+	edits[0].baseName = "DRZEWA";
+	edits[0].newName  = "TREES";
+	edits[1].kind     = MasterEditKind::AddItem;
+	edits[1].itemId   = "ZZZ";
+	edits[1].node     = MakeNode ("ZZZ", "New branch");
+	edits[2].kind     = MasterEditKind::AddItem;
+	edits[2].itemId   = "ZZZ.1";
+	edits[2].parentId = "ZZZ";
+	edits[2].node     = MakeNode ("ZZZ.1", "Child");
+	edits[3].kind     = MasterEditKind::ChangeName;
+	edits[3].itemId   = "DRZ.L";
+	edits[3].baseName = "stale name";
+	edits[3].newName  = "X";
+
+	ApplyEditsToShards (manifestPath.c_str (), cache, edits);
+	CHECK (IsCommitSuccess (edits[0].result));
+	CHECK (IsCommitSuccess (edits[1].result));
+	CHECK (IsCommitSuccess (edits[2].result));
+	CHECK (edits[3].result == CommitResult::Conflict);
+
+	std::vector<ClassificationTree> trees = ReadShardedClassifications (manifestPath.c_str (), cache);
+	if (trees.empty ()) {
+		CHECK (false);
+		return;
+	}
+	const ClassificationNode* drz = FindNode (trees[0].rootItems, "DRZ");
+	CHECK (drz != nullptr && drz->name == "TREES");
+	const ClassificationNode* branch = FindNode (trees[0].rootItems, "ZZZ");
+	CHECK (branch != nullptr && FindNode (branch->children, "ZZZ.1") != nullptr);
+}
+
+
+TEST (StaleManifestIsNotTrusted)
+{
+	TempDir dir;
+	std::string path = CopyMaster (dir);
+
+	std::string manifestPath, error;
+	CHECK (SplitMasterIntoShards (path.c_str (), manifestPath, error));
+
+	ShardedMasterCache cache;
+	ReadShardedClassifications (manifestPath.c_str (), cache);
+	std::string before = ReadTextFile (manifestPath);
+
+	// Another session holds the manifest: the shard is written, the entry is not
+	{
+		CommitGuard held (manifestPath.c_str ());
+		CHECK (held.IsAcquired ());
+		CHECK (ChangeItemNameInShards (manifestPath.c_str (), cache, "DRZ", "DRZEWA", "TREES") == CommitResult::Busy);
+	}
+	CHECK_EQ (ReadTextFile (manifestPath), before);
+
+	// Readers see the shard anyway, by its file stamp
+	std::vector<ClassificationTree> trees = ReadShardedClassifications (manifestPath.c_str (), cache);
+	const ClassificationNode* drz = trees.empty () ? nullptr : FindNode (trees[0].rootItems, "DRZ");
+	CHECK (drz != nullptr && drz->name == "TREES");
+
+	// Retrying the edit repairs the manifest
+	CHECK (ChangeItemNameInShards (manifestPath.c_str (), cache, "DRZ", "DRZEWA", "TREES") == CommitResult::AlreadyApplied);
+	CHECK (ReadTextFile (manifestPath) != before);
+}
+
+
+int main ()
+{
+	return RunAllTests ();
+}
@@ -0,0 +1,259 @@
+#include "TestHarness.hpp"
+#include "RefreshWorker.hpp"
+#include "SyncClient.hpp"
+#include "SyncServer.hpp"
+#include "XmlReader.hpp"
+
+
+// ---------------------------------------------------------------------------
+// Sync service: protocol pieces, snapshots, deltas and commits over loopback
+// ---------------------------------------------------------------------------
+
+// A parsed copy of the master as the refresh worker keeps it
+struct ClientCopy {
+	std::uint64_t                   revision = 0;
+	std::vector<ClassificationTree>  data;
+	MasterVersion                   version;
+	std::uint64_t                   hash = 0;
+
+	SyncUpdate  Update (SyncClient& client)  { return client.Update (revision, data, version, hash); }
+};
+
+
+static std::string LocalAddress (const SyncServer& server)
+{
+	return "127.0.0.1:" + std::to_string (server.GetPort ());
+}
+
+
+TEST (AddressesAndFields)
+{
+	std::string   host;
+	std::uint16_t port = 0;
+	CHECK (ParseSyncAddress ("", host, port));
+	CHECK_EQ (host, "127.0.0.1");
+	CHECK_EQ (port, kSyncDefaultPort);
+	CHECK (ParseSyncAddress ("10.0.0.5:5000", host, port));
+	CHECK_EQ (host, "10.0.0.5");
+	CHECK_EQ (port, 5000);
+	CHECK (ParseSyncAddress ("6000", host, port));
+	CHECK_EQ (host, "127.0.0.1");
+	CHECK_EQ (port, 6000);
+	CHECK (!ParseSyncAddress ("host:notaport", host, port));
+
+	std::vector<std::string> fields = { "a\tb", "line\nbreak\r", "back\\slash", "" };
+	std::string line = JoinSyncFields (fields);
+	CHECK (line.find ('\n') == std::string::npos);
+	CHECK (SplitSyncFields (line) == fields);
+
+	MasterEdit edit = AddEdit ("DRZ", "DRZ.ZZ", "Liść\tnowy");
+	edit.node.description = "opis";
+	MasterEdit parsed;
+	CHECK (ParseSyncEdit (SplitSyncFields (JoinSyncFields (FormatSyncEdit (edit))), 0, parsed));
+	CHECK (parsed.kind == MasterEditKind::AddItem);
+	CHECK_EQ (parsed.parentId, "DRZ");
+	CHECK_EQ (parsed.node.name, "Liść\tnowy");
+	CHECK_EQ (parsed.node.description, "opis");
+}
+
+
+TEST (SnapshotMatchesTheFile)
+{
+	TempDir dir;
+	std::string path = CopyMaster (dir);
+	SyncServer server;
+	CHECK (server.Start (path, "127.0.0.1", 0));
+	CHECK (server.GetPort () != 0);
+
+	SyncClient client;
+	CHECK (client.Connect (LocalAddress (server), path));
+
+	ClientCopy copy;
+	CHECK (copy.Update (client) == SyncUpdate::Snapshot);
+	CHECK_EQ (copy.revision, server.GetRevision ());
+
+	MasterVersion fileVersion;
+	std::vector<ClassificationTree> file = ReadXmlClassifications (path.c_str (), &fileVersion);
+	CHECK (copy.version == fileVersion);
+	CHECK_EQ (copy.hash, HashClassifications (file));
+
+	// Nothing committed since: no body, same copy
+	CHECK (copy.Update (client) == SyncUpdate::Unchanged);
+	CHECK_EQ (copy.hash, HashClassifications (file));
+}
+
+
+TEST (CommitsTravelAsDeltas)
+{
+	TempDir dir;
+	std::string path = CopyMaster (dir);
+	SyncServer server;
+	CHECK (server.Start (path, "127.0.0.1", 0));
+
+	SyncClient writer, reader;
+	CHECK (writer.Connect (LocalAddress (server), path));
+	CHECK (reader.Connect (LocalAddress (server), path));
+	ClientCopy writerCopy, readerCopy;
+	CHECK (writerCopy.Update (writer) == SyncUpdate::Snapshot);
+	CHECK (readerCopy.Update (reader) == SyncUpdate::Snapshot);
+	std::uint64_t startRevision = readerCopy.revision;
+
+	std::vector<MasterEdit> edits;
+	edits.push_back (RenameEdit ("DRZ", "DRZEWA", "TREES"));
+	edits.push_back (AddEdit ("", "ZZZ", "New branch"));
+	edits.push_back (AddEdit ("ZZZ", "ZZZ.1", "Child"));
+	edits.push_back (AddEdit ("DRZ", "DRZ.ZZ", "Leaf"));
+	CommitResult result = CommitResult::Failed;
+	CHECK (writer.Commit (writerCopy.version, edits, result));
+	CHECK (result == CommitResult::Committed);
+	for (const MasterEdit& edit : edits)
+		CHECK (edit.result == CommitResult::Committed);
+	CHECK_EQ (server.GetRevision (), startRevision + 1);
+
+	// Written through before the reply
+	MasterVersion fileVersion;
+	std::vector<ClassificationTree> file = ReadXmlClassifications (path.c_str (), &fileVersion);
+	if (!file.empty ()) {
+		const ClassificationNode* drz = FindNode (file[0].rootItems, "DRZ");
+		CHECK (drz != nullptr && drz->name == "TREES");
+	}
+
+	// The other client replays the edits and lands on the file's model
+	CHECK (readerCopy.Update (reader) == SyncUpdate::Deltas);
+	CHECK_EQ (readerCopy.revision, startRevision + 1);
+	CHECK (readerCopy.version == fileVersion);
+	CHECK_EQ (readerCopy.hash, HashClassifications (file));
+	CHECK_EQ (HashClassifications (readerCopy.data), HashClassifications (file));
+
+	// The same edits again change nothing and add no revision
+	CHECK (writer.Commit (fileVersion, edits, result));
+	CHECK (result == CommitResult::AlreadyApplied);
+	CHECK_EQ (server.GetRevision (), startRevision + 1);
+	CHECK (readerCopy.Update (reader) == SyncUpdate::Unchanged);
+}
+
+
+TEST (StaleCommitConflicts)
+{
+	TempDir dir;
+	std::string path = CopyMaster (dir);
+	SyncServer server;
+	CHECK (server.Start (path, "127.0.0.1", 0));
+
+	SyncClient first, second;
+	CHECK (first.Connect (LocalAddress (server), path));
+	CHECK (second.Connect (LocalAddress (server), path));
+	ClientCopy copy;
+	CHECK (copy.Update (first) == SyncUpdate::Snapshot);
+
+	std::vector<MasterEdit> mine  = { RenameEdit ("DRZ", "DRZEWA", "TREES") };
+	std::vector<MasterEdit> yours = { RenameEdit ("DRZ", "DRZEWA", "BAUME"), RenameEdit ("DRZ.L", "DRZEW LIŚCIASTE", "Broadleaf") };
+	CommitResult result = CommitResult::Failed;
+	CHECK (first.Commit (copy.version, mine, result));
+	CHECK (result == CommitResult::Committed);
+
+	// Same base: the other item is rebased, the same item conflicts
+	CHECK (second.Commit (copy.version, yours, result));
+	CHECK (yours[0].result == CommitResult::Conflict);
+	CHECK (yours[1].result == CommitResult::Rebased);
+	CHECK (result == CommitResult::Rebased);
+
+	std::vector<ClassificationTree> file = ReadXmlClassifications (path.c_str ());
+	if (!file.empty ()) {
+		const ClassificationNode* drz = FindNode (file[0].rootItems, "DRZ");
+		CHECK (drz != nullptr && drz->name == "TREES");
+	}
+}
+
+
+TEST (OutsideWritesResetClients)
+{
+	TempDir dir;
+	std::string path = CopyMaster (dir);
+	SyncServer server;
+	CHECK (server.Start (path, "127.0.0.1", 0));
+
+	SyncClient client;
+	CHECK (client.Connect (LocalAddress (server), path));
+	ClientCopy copy;
+	CHECK (copy.Update (client) == SyncUpdate::Snapshot);
+	std::uint64_t before = copy.revision;
+
+	// A session without the service commits to the file directly
+	std::vector<MasterEdit> edits = { RenameEdit ("DRZ", "DRZEWA", "TREES") };
+	CHECK (ApplyEditsToXml (path.c_str (), copy.version, edits) == CommitResult::Committed);
+
+	CHECK (copy.Update (client) == SyncUpdate::Snapshot);
+	CHECK (copy.revision > before);
+	CHECK_EQ (copy.hash, HashClassifications (ReadXmlClassifications (path.c_str ())));
+}
+
+
+TEST (RefusedAndMissingServices)
+{
+	TempDir dir;
+	std::string path = CopyMaster (dir);
+	SyncServer server;
+	CHECK (server.Start (path, "127.0.0.1", 0));
+	std::string address = LocalAddress (server);
+
+	// Another master of a different name
+	SyncClient client;
+	CHECK (!client.Connect (address, dir.File ("Other.xml")));
+	CHECK (!client.IsConnected ());
+
+	CHECK (client.Connect (address, path));
+	server.Stop ();
+
+	// The service went away: the caller falls back to the file
+	ClientCopy copy;
+	copy.revision = 1;
+	CHECK (copy.Update (client) == SyncUpdate::Failed);
+	CHECK (!client.IsConnected ());
+	CHECK_EQ (copy.revision, 0u);
+
+	std::vector<MasterEdit> edits = { RenameEdit ("DRZ", "DRZEWA", "TREES") };
+	CommitResult result;
+	CHECK (!client.Commit (MasterVersion (), edits, result));
+	CHECK (!client.Connect (address, path));
+}
+
+
+TEST (WorkerReadsThroughTheService)
+{
+	TempDir dir;
+	std::string path = CopyMaster (dir);
+	SyncServer server;
+	CHECK (server.Start (path, "127.0.0.1", 0));
+
+	std::shared_ptr<SyncClient> client = std::make_shared<SyncClient> ();
+	CHECK (client->Connect (LocalAddress (server), path));
+
+	RefreshWorker worker;
+	RefreshRequest request;
+	request.masterPath = path;
+	request.syncClient = client;
+	worker.Submit (std::move (request));
+	RefreshResult result;
+	CHECK (WaitFor ([&] { return worker.TakeResult (result); }, 20000));
+	CHECK (result.fromService);
+	CHECK (result.serverChanged);
+	CHECK_EQ (result.serverHash, HashClassifications (ReadXmlClassifications (path.c_str ())));
+
+	// Without the service the same request reads the file
+	server.Stop ();
+	RefreshRequest fallback;
+	fallback.masterPath = path;
+	fallback.syncClient = client;
+	worker.Submit (std::move (fallback));
+	CHECK (WaitFor ([&] { return worker.TakeResult (result); }, 20000));
+	CHECK (!result.fromService);
+	CHECK (result.masterReread);
+	CHECK_EQ (result.serverHash, HashClassifications (ReadXmlClassifications (path.c_str ())));
+}
+
+
+int main ()
+{
+	return RunAllTests ();
+}
@@ -0,0 +1,224 @@
+#ifndef TESTHARNESS_HPP
+#define TESTHARNESS_HPP
+
+#include "ClassificationModel.hpp"
+#include "PropertyApplicability.hpp"
+#include "Report.hpp"
+#include "XmlWriter.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// ---------------------------------------------------------------------------
+// Minimal test harness (no framework dependency)
+//
+// Each test file is one executable: TEST bodies register themselves, CHECK
+// records a failure and continues, main () = RunAllTests (). ctest runs
+// every executable; a non-zero exit code fails it.
+// ---------------------------------------------------------------------------
+
+struct TestCase {
+	const char*            name;
+	std::function<void ()> body;
+};
+
+inline std::vector<TestCase>& GetTestCases ()
+{
+	static std::vector<TestCase> cases;
+	return cases;
+}
+
+inline int& GetTestFailures ()
+{
+	static int failures = 0;
+	return failures;
+}
+
+struct TestRegistrar {
+	TestRegistrar (const char* name, void (*body) ()) { GetTestCases ().push_back ({ name, body }); }
+};
+
+#define TEST(name) \
+	static void name (); \
+	static TestRegistrar name##Registrar (#name, name); \
+	static void name ()
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			std::fprintf (stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+			GetTestFailures ()++; \
+		} \
+	} while (false)
+
+#define CHECK_EQ(a, b) \
+	do { \
+		if (!((a) == (b))) { \
+			std::ostringstream checkText; \
+			checkText << (a) << " != " << (b); \
+			std::fprintf (stderr, "%s:%d: CHECK_EQ failed: %s == %s (%s)\n", __FILE__, __LINE__, #a, #b, checkText.str ().c_str ()); \
+			GetTestFailures ()++; \
+		} \
+	} while (false)
+
+// Report lines are dropped unless CLASSSYNC_TEST_VERBOSE is set
+inline void DropReportLine (const std::string&) {}
+
+inline int RunAllTests ()
+{
+	if (std::getenv ("CLASSSYNC_TEST_VERBOSE") == nullptr)
+		SetReportSink (DropReportLine);
+
+	for (const TestCase& test : GetTestCases ()) {
+		int before = GetTestFailures ();
+		test.body ();
+		std::printf ("%s %s\n", GetTestFailures () == before ? "[ ok ]" : "[FAIL]", test.name);
+	}
+	std::printf ("%d test(s), %d failure(s)\n", (int)GetTestCases ().size (), GetTestFailures ());
+	return GetTestFailures () == 0 ? 0 : 1;
+}
+
+
+// ---------------------------------------------------------------------------
+// Fixtures
+// ---------------------------------------------------------------------------
+
+// Scratch directory, removed with everything in it
+class TempDir {
+public:
+	TempDir ()
+	{
+		static std::atomic<unsigned> counter (0);
+		auto stamp = std::chrono::steady_clock::now ().time_since_epoch ().count ();
+		path = std::filesystem::temp_directory_path () /
+			("classsync-test-" + std::to_string ((long long)stamp) + "-" + std::to_string (counter++));
+		std::filesystem::create_directories (path);
+	}
+
+	~TempDir ()
+	{
+		std::error_code ec;
+		std::filesystem::remove_all (path, ec);
+	}
+
+	std::string  File (const std::string& name) const { return (path / name).string (); }
+	std::string  Path () const                         { return path.string (); }
+
+private:
+	std::filesystem::path  path;
+};
+
+inline std::string ReadTextFile (const std::string& path)
+{
+	std::ifstream file (path, std::ios::binary);
+	std::ostringstream content;
+	content << file.rdbuf ();
+	return content.str ();
+}
+
+inline void WriteTextFile (const std::string& path, const std::string& content)
+{
+	std::ofstream file (path, std::ios::binary | std::ios::trunc);
+	file << content;
+}
+
+// Copy of the repository master ("Green Accent PLANTS.xml") in dir
+inline std::string CopyMaster (const TempDir& dir, const std::string& name = "Master.xml")
+{
+	std::string target = dir.File (name);
+	std::filesystem::copy_file (CLASSSYNC_MASTER_XML, target);
+	return target;
+}
+
+// Node by ID anywhere below nodes (nullptr if missing)
+inline const ClassificationNode* FindNode (const std::vector<ClassificationNode>& nodes, const std::string& id)
+{
+	for (const ClassificationNode& node : nodes) {
+		if (node.id == id)
+			return &node;
+		if (const ClassificationNode* found = FindNode (node.children, id))
+			return found;
+	}
+	return nullptr;
+}
+
+inline ClassificationNode MakeNode (const std::string& id, const std::string& name)
+{
+	ClassificationNode node;
+	node.id   = id;
+	node.name = name;
+	return node;
+}
+
+inline MasterEdit RenameEdit (const std::string& id, const std::string& baseName, const std::string& newName)
+{
+	MasterEdit edit;
+	edit.kind     = MasterEditKind::ChangeName;
+	edit.itemId   = id;
+	edit.baseName = baseName;
+	edit.newName  = newName;
+	return edit;
+}
+
+inline MasterEdit AddEdit (const std::string& parentId, const std::string& id, const std::string& name)
+{
+	MasterEdit edit;
+	edit.kind     = MasterEditKind::AddItem;
+	edit.itemId   = id;
+	edit.newName  = name;
+	edit.parentId = parentId;
+	edit.node     = MakeNode (id, name);
+	return edit;
+}
+
+// Property definitions of a master (a failed read fails the test)
+inline std::vector<PropertyDefinitionInfo> ReadDefinitions (const std::string& path)
+{
+	std::vector<PropertyDefinitionInfo> definitions;
+	CHECK (ReadMasterPropertyDefinitions (path.c_str (), definitions));
+	return definitions;
+}
+
+// Definition by name, or by group and name (nullptr if missing)
+inline PropertyDefinitionInfo* FindDefinition (std::vector<PropertyDefinitionInfo>& definitions, const std::string& name)
+{
+	for (PropertyDefinitionInfo& definition : definitions) {
+		if (definition.name == name)
+			return &definition;
+	}
+	return nullptr;
+}
+
+inline PropertyDefinitionInfo* FindDefinition (std::vector<PropertyDefinitionInfo>& definitions,
+											   const std::string& group, const std::string& name)
+{
+	for (PropertyDefinitionInfo& definition : definitions) {
+		if (definition.group == group && definition.name == name)
+			return &definition;
+	}
+	return nullptr;
+}
+
+// Poll until pred is true or timeoutMs passes
+inline bool WaitFor (const std::function<bool ()>& pred, int timeoutMs = 5000)
+{
+	auto deadline = std::chrono::steady_clock::now () + std::chrono::milliseconds (timeoutMs);
+	while (!pred ()) {
+		if (std::chrono::steady_clock::now () > deadline)
+			return false;
+		std::this_thread::sleep_for (std::chrono::milliseconds (5));
+	}
+	return true;
+}
+
+
+#endif // TESTHARNESS_HPP
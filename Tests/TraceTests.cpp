@@ -0,0 +1,145 @@
+#include "TestHarness.hpp"
+#include "Trace.hpp"
+#include "XmlReader.hpp"
+
+
+// ---------------------------------------------------------------------------
+// Trace spans: ring buffer, Chrome trace JSON, spans of the refresh stages
+// ---------------------------------------------------------------------------
+
+static size_t CountOccurrences (const std::string& text, const std::string& pattern)
+{
+	size_t count = 0;
+	for (size_t pos = text.find (pattern); pos != std::string::npos; pos = text.find (pattern, pos + 1))
+		count++;
+	return count;
+}
+
+
+TEST (DisabledTraceRecordsNothing)
+{
+	ClearTrace ();
+	SetTraceEnabled (false);
+	{
+		TraceScope span ("not recorded");
+	}
+	CHECK (FormatTraceJson ().find ("not recorded") == std::string::npos);
+}
+
+
+TEST (SpansBecomeCompleteEvents)
+{
+	ClearTrace ();
+	SetTraceEnabled (true);
+	SetTraceThreadName ("test main");
+	{
+		TraceScope outer ("outer span");
+		TraceScope inner ("inner span", "detail \"quoted\"");
+		std::this_thread::sleep_for (std::chrono::milliseconds (2));
+	}
+	{
+		TraceScope late ("late detail");
+		late.SetDetail ("set later");
+		late.End ();
+		late.End ();	// recorded once
+	}
+	SetTraceEnabled (false);
+
+	std::string json = FormatTraceJson ();
+	CHECK (json.find ("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[") == 0);
+	CHECK (json.find ("\"name\":\"thread_name\",\"ph\":\"M\"") != std::string::npos);
+	CHECK (json.find ("\"args\":{\"name\":\"test main\"}") != std::string::npos);
+	CHECK_EQ (CountOccurrences (json, "\"ph\":\"X\""), 3u);
+	CHECK (json.find ("\"name\":\"outer span\"") != std::string::npos);
+	CHECK (json.find ("\"detail\":\"detail \\\"quoted\\\"\"") != std::string::npos);
+	CHECK_EQ (CountOccurrences (json, "\"detail\":\"set later\""), 1u);
+
+	// The inner span ends first, so it is listed before the outer one
+	CHECK (json.find ("inner span") < json.find ("outer span"));
+
+	// At least the 2 ms sleep, in microseconds
+	size_t outer = json.find ("\"name\":\"outer span\"");
+	size_t dur = json.find ("\"dur\":", outer);
+	CHECK (dur != std::string::npos && std::atof (json.c_str () + dur + 6) >= 2000.0);
+}
+
+
+TEST (LongDetailIsCutOnCharacterBoundary)
+{
+	ClearTrace ();
+	SetTraceEnabled (true);
+	{
+		// 2-byte characters: a cut in the middle would leave a lone lead byte
+		std::string name;
+		for (int i = 0; i < 40; i++)
+			name += "\xc5\x82";
+		TraceScope span ("long detail", name);
+	}
+	SetTraceEnabled (false);
+
+	std::string json = FormatTraceJson ();
+	size_t start = json.find ("\"detail\":\"") + 10;
+	size_t end   = json.find ('"', start);
+	CHECK_EQ (end - start, TraceScope::kDetailSize - 2);
+}
+
+
+TEST (RingBufferKeepsNewestSpans)
+{
+	ClearTrace ();
+	SetTraceEnabled (true);
+	for (size_t i = 0; i < kTraceCapacity + 10; i++)
+		TraceScope span (i < 10 ? "oldest" : "newer");
+	SetTraceEnabled (false);
+
+	std::string json = FormatTraceJson ();
+	CHECK_EQ (CountOccurrences (json, "\"name\":\"oldest\""), 0u);
+	CHECK_EQ (CountOccurrences (json, "\"name\":\"newer\""), kTraceCapacity);
+}
+
+
+TEST (SpansFromSeveralThreads)
+{
+	ClearTrace ();
+	SetTraceEnabled (true);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; t++) {
+		threads.emplace_back ([] {
+			for (int i = 0; i < 1000; i++)
+				TraceScope span ("worker span");
+		});
+	}
+	for (std::thread& thread : threads)
+		thread.join ();
+	SetTraceEnabled (false);
+
+	CHECK_EQ (CountOccurrences (FormatTraceJson (), "\"name\":\"worker span\""), 4000u);
+}
+
+
+TEST (MasterReadIsTraced)
+{
+	TempDir dir;
+	std::string path = CopyMaster (dir);
+
+	ClearTrace ();
+	SetTraceEnabled (true);
+	ReadXmlClassifications (path.c_str ());
+	SetTraceEnabled (false);
+
+	std::string json = FormatTraceJson ();
+	CHECK (json.find ("\"name\":\"ReadXmlClassifications\"") != std::string::npos);
+	CHECK (json.find ("\"name\":\"read master file\"") != std::string::npos);
+	CHECK (json.find ("\"name\":\"parse system\"") != std::string::npos);
+	CHECK (json.find ("\"detail\":\"Green Accent PLANTS\"") != std::string::npos);
+
+	CHECK (WriteTraceJson (dir.File ("trace.json")));
+	CHECK (ReadTextFile (dir.File ("trace.json")) == json);
+	CHECK (!WriteTraceJson (dir.File ("missing/trace.json")));
+}
+
+
+int main ()
+{
+	return RunAllTests ();
+}
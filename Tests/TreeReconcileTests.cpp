@@ -0,0 +1,153 @@
+#include "TestHarness.hpp"
+#include "TreeReconcile.hpp"
+
+
+// ---------------------------------------------------------------------------
+// View model reconciliation against a fake tree view
+// ---------------------------------------------------------------------------
+
+static ViewNode MakeView (const std::string& key, const std::string& text)
+{
+	ViewNode node;
+	node.key  = key;
+	node.text = text;
+	return node;
+}
+
+
+// Two systems, the first with a branch of three items
+static ViewNode BuildModel (const std::string& leafText)
+{
+	ViewNode root;
+	root.children.push_back (MakeView ("Plants", "Plants (v1)"));
+	root.children[0].children.push_back (MakeView ("A", "A - Trees"));
+	root.children[0].children[0].children.push_back (MakeView ("A.1", "A.1 - Birch"));
+	root.children[0].children[0].children.push_back (MakeView ("A.2", leafText));
+	root.children[0].children[0].children.push_back (MakeView ("A.3", "A.3 - Maple"));
+	root.children.push_back (MakeView ("Pipes", "Pipes (v2)"));
+	return root;
+}
+
+
+// Applies mutations the way the palette does; item IDs count up
+class FakeTree {
+public:
+	FakeTree () : nextItem (1), itemCount (0) {}
+
+	std::vector<TreeMutation>  Update (ViewNode& displayed, ViewNode& next, ReconcileStats& stats)
+	{
+		std::vector<TreeMutation> mutations;
+		stats = ReconcileStats ();
+		next.item = 0;
+		ReconcileViews (displayed, next, mutations, stats);
+
+		for (TreeMutation& m : mutations) {
+			if (m.kind == TreeMutationKind::Append) {
+				m.node->item = nextItem++;
+				itemCount++;
+			} else if (m.kind == TreeMutationKind::Delete) {
+				itemCount--;
+			}
+		}
+		displayed = std::move (next);
+		return mutations;
+	}
+
+	std::int32_t  nextItem;
+	int           itemCount;
+};
+
+
+TEST (FirstBuildAppendsEverything)
+{
+	FakeTree       tree;
+	ViewNode       displayed;
+	ReconcileStats stats;
+
+	ViewNode next = BuildModel ("A.2 - Oak");
+	tree.Update (displayed, next, stats);
+	CHECK_EQ (stats.appended, 6u);
+	CHECK_EQ (tree.itemCount, 6);
+	CHECK (displayed.children[0].children[0].item != kViewNoItem);
+}
+
+
+TEST (UnchangedModelMakesNoCalls)
+{
+	FakeTree       tree;
+	ViewNode       displayed;
+	ReconcileStats stats;
+
+	ViewNode first = BuildModel ("A.2 - Oak");
+	tree.Update (displayed, first, stats);
+	std::int32_t leafItem = displayed.children[0].children[0].children[1].item;
+
+	ViewNode same = BuildModel ("A.2 - Oak");
+	CHECK (tree.Update (displayed, same, stats).empty ());
+	CHECK (stats.subtreesReused > 0);
+	CHECK_EQ (displayed.children[0].children[0].children[1].item, leafItem);
+}
+
+
+TEST (ChangedLabelKeepsTheItem)
+{
+	FakeTree       tree;
+	ViewNode       displayed;
+	ReconcileStats stats;
+
+	ViewNode first = BuildModel ("A.2 - Oak");
+	tree.Update (displayed, first, stats);
+	std::int32_t leafItem = displayed.children[0].children[0].children[1].item;
+
+	ViewNode renamed = BuildModel ("A.2 - Oak (renamed)");
+	std::vector<TreeMutation> mutations = tree.Update (displayed, renamed, stats);
+	CHECK_EQ (mutations.size (), 1u);
+	CHECK (!mutations.empty () && mutations[0].kind == TreeMutationKind::SetText);
+	CHECK_EQ (stats.textChanged, 1u);
+	CHECK_EQ (displayed.children[0].children[0].children[1].item, leafItem);
+	CHECK_EQ (tree.itemCount, 6);
+}
+
+
+TEST (RemovedAndAddedItems)
+{
+	FakeTree       tree;
+	ViewNode       displayed;
+	ReconcileStats stats;
+
+	ViewNode first = BuildModel ("A.2 - Oak");
+	tree.Update (displayed, first, stats);
+
+	ViewNode next = BuildModel ("A.2 - Oak");
+	std::vector<ViewNode>& leaves = next.children[0].children[0].children;
+	leaves.erase (leaves.begin ());
+	leaves.push_back (MakeView ("A.4", "A.4 - Pine"));
+
+	tree.Update (displayed, next, stats);
+	CHECK_EQ (stats.deleted, 1u);
+	CHECK_EQ (stats.appended, 1u);
+	CHECK_EQ (tree.itemCount, 6);
+	CHECK_EQ (displayed.children[0].children[0].children.back ().key, "A.4");
+}
+
+
+TEST (HashesCoverTagsAndColors)
+{
+	ViewNode a = BuildModel ("A.2 - Oak");
+	ViewNode b = BuildModel ("A.2 - Oak");
+	b.children[0].children[0].children[1].tag = 3;
+	ViewNode c = BuildModel ("A.2 - Oak");
+	c.children[0].children[0].children[1].color = 0x336699;
+
+	ComputeViewHashes (a);
+	ComputeViewHashes (b);
+	ComputeViewHashes (c);
+	CHECK (a.hash != b.hash);
+	CHECK (a.hash != c.hash);
+}
+
+
+int main ()
+{
+	return RunAllTests ();
+}
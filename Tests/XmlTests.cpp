@@ -0,0 +1,138 @@
+#include "TestHarness.hpp"
+#include "XmlReader.hpp"
+#include "XmlWriter.hpp"
+
+
+// ---------------------------------------------------------------------------
+// Master XML: read, batch edits with optimistic commits, import fragment
+// ---------------------------------------------------------------------------
+
+TEST (ReadRepositoryMaster)
+{
+	MasterVersion version;
+	std::vector<ClassificationTree> trees = ReadXmlClassifications (CLASSSYNC_MASTER_XML, &version);
+
+	CHECK_EQ (trees.size (), 1u);
+	CHECK (version.valid);
+	if (trees.empty ())
+		return;
+
+	CHECK_EQ (trees[0].systemName, "Green Accent PLANTS");
+	CHECK_EQ (trees[0].version, "03");
+	CHECK (trees[0].systemGuid.IsNull ());
+
+	const ClassificationNode* drz = FindNode (trees[0].rootItems, "DRZ");
+	CHECK (drz != nullptr && drz->name == "DRZEWA");
+	const ClassificationNode* birches = FindNode (trees[0].rootItems, "DR.L.01");
+	CHECK (birches != nullptr && birches->children.size () == 5);
+	const ClassificationNode* leafy = FindNode (trees[0].rootItems, "DRZ.L");
+	CHECK (leafy != nullptr && leafy->name == "DRZEW LI\xC5\x9A" "CIASTE");
+}
+
+
+TEST (ReadMissingFile)
+{
+	MasterVersion version;
+	CHECK (ReadXmlClassifications ("/nonexistent/classsync.xml", &version).empty ());
+	CHECK (!version.valid);
+}
+
+
+TEST (BatchEditsCommitOnce)
+{
+	TempDir dir;
+	std::string path = CopyMaster (dir);
+
+	MasterVersion version;
+	ReadXmlClassifications (path.c_str (), &version);
+
+	std::vector<MasterEdit> edits;
+	edits.push_back (RenameEdit ("DRZ", "DRZEWA", "TREES"));
+	edits.push_back (RenameEdit ("DRZ.L", "stale name", "X"));
+	edits.push_back (AddEdit ("", "ZZZ", "New branch"));
+	edits.push_back (AddEdit ("ZZZ", "ZZZ.1", "Child"));
+	edits.push_back (AddEdit ("DRZ", "DRZ.ZZ", "Leaf"));
+
+	CommitResult result = ApplyEditsToXml (path.c_str (), version, edits);
+	CHECK (result == CommitResult::Committed);
+	CHECK (edits[0].result == CommitResult::Committed);
+	CHECK (edits[1].result == CommitResult::Conflict);
+	CHECK (edits[2].result == CommitResult::Committed);
+	CHECK (edits[3].result == CommitResult::Committed);
+	CHECK (edits[4].result == CommitResult::Committed);
+
+	MasterVersion after;
+	std::vector<ClassificationTree> trees = ReadXmlClassifications (path.c_str (), &after);
+	CHECK (after != version);
+	if (trees.empty ())
+		return;
+
+	const ClassificationNode* drz = FindNode (trees[0].rootItems, "DRZ");
+	CHECK (drz != nullptr && drz->name == "TREES");
+	CHECK (FindNode (trees[0].rootItems, "ZZZ.1") != nullptr);
+	CHECK (drz != nullptr && FindNode (drz->children, "DRZ.ZZ") != nullptr);
+	const ClassificationNode* leafy = FindNode (trees[0].rootItems, "DRZ.L");
+	CHECK (leafy != nullptr && leafy->name != "X");
+
+	// The same batch again: everything is already there
+	ApplyEditsToXml (path.c_str (), after, edits);
+	CHECK (edits[0].result == CommitResult::AlreadyApplied);
+	CHECK (edits[2].result == CommitResult::AlreadyApplied);
+}
+
+
+TEST (StaleBaseVersionRebases)
+{
+	TempDir dir;
+	std::string path = CopyMaster (dir);
+
+	MasterVersion version;
+	ReadXmlClassifications (path.c_str (), &version);
+
+	// Another session renames a different item first
+	std::vector<MasterEdit> other = { RenameEdit ("DR.L.01", "BRZOZY", "BIRCHES") };
+	CHECK (ApplyEditsToXml (path.c_str (), version, other) == CommitResult::Committed);
+
+	std::vector<MasterEdit> mine = { RenameEdit ("DRZ", "DRZEWA", "TREES") };
+	CHECK (ApplyEditsToXml (path.c_str (), version, mine) == CommitResult::Rebased);
+
+	// ... and the same item: rejected
+	std::vector<MasterEdit> late = { RenameEdit ("DR.L.01", "BRZOZY", "BETULA") };
+	ApplyEditsToXml (path.c_str (), version, late);
+	CHECK (late[0].result == CommitResult::Conflict);
+
+	std::vector<ClassificationTree> trees = ReadXmlClassifications (path.c_str ());
+	const ClassificationNode* birches = trees.empty () ? nullptr : FindNode (trees[0].rootItems, "DR.L.01");
+	CHECK (birches != nullptr && birches->name == "BIRCHES");
+}
+
+
+TEST (ImportFragmentKeepsAncestors)
+{
+	std::vector<ClassificationTree> trees = ReadXmlClassifications (CLASSSYNC_MASTER_XML);
+
+	std::string xml;
+	size_t count = FormatImportFragment (trees, { "DR.L.01.03" }, xml);
+	CHECK_EQ (count, 4u);
+
+	TempDir dir;
+	WriteTextFile (dir.File ("fragment.xml"), xml);
+	std::vector<ClassificationTree> fragment = ReadXmlClassifications (dir.File ("fragment.xml").c_str ());
+	CHECK_EQ (fragment.size (), 1u);
+	if (fragment.empty ())
+		return;
+
+	CHECK_EQ (fragment[0].systemName, "Green Accent PLANTS");
+	CHECK_EQ (fragment[0].rootItems.size (), 1u);
+	const ClassificationNode* leaf = FindNode (fragment[0].rootItems, "DR.L.01.03");
+	CHECK (leaf != nullptr && leaf->name == "Brzoza papierowa");
+	CHECK (FindNode (fragment[0].rootItems, "DR.L.01.01") == nullptr);
+
+	CHECK_EQ (FormatImportFragment (trees, { "NO.SUCH.ID" }, xml), 0u);
+}
+
+
+int main ()
+{
+	return RunAllTests ();
+}